@@ -0,0 +1,138 @@
+/*
+ * NAME:
+ * benchrun
+ *
+ * PURPOSE:
+ * Support for the benchmark drivers fmsnowthroughput and
+ * fmaccusnowbench.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * NA
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: The fmsnowtimer line of a run is
+ * found by readtimerline and timerfield (from fmaccusnowbench).
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/*
+ * NAME:
+ * runcommand
+ *
+ * PURPOSE:
+ * To run a command with stdout and stderr appended to logfile, and
+ * return exit status, wall clock time and resource usage of it.
+ */
+int runcommand(char *argv[], char *logfile, runstat *rs) {
+
+    char *where="runcommand";
+    int fd, status;
+    pid_t pid;
+    struct timeval t0, t1;
+    struct rusage ru;
+
+    gettimeofday(&t0, NULL);
+    pid = fork();
+    if (pid < 0) {
+	fmerrmsg(where,"Could not fork");
+	return(FM_OTHER_ERR);
+    }
+    if (pid == 0) {
+	fd = open(logfile, O_WRONLY|O_CREAT|O_APPEND, 0644);
+	if (fd >= 0) {
+	    dup2(fd, 1);
+	    dup2(fd, 2);
+	    close(fd);
+	}
+	execv(argv[0], argv);
+	fprintf(stderr,"Could not execute %s\n", argv[0]);
+	_exit(127);
+    }
+    if (wait4(pid, &status, 0, &ru) < 0) {
+	fmerrmsg(where,"Could not wait for %s", argv[0]);
+	return(FM_OTHER_ERR);
+    }
+    gettimeofday(&t1, NULL);
+
+    rs->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    rs->wall = (t1.tv_sec-t0.tv_sec)+1.e-6*(t1.tv_usec-t0.tv_usec);
+    rs->user = ru.ru_utime.tv_sec+1.e-6*ru.ru_utime.tv_usec;
+    rs->sys = ru.ru_stime.tv_sec+1.e-6*ru.ru_stime.tv_usec;
+    rs->maxrss = ru.ru_maxrss;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * readtimerline
+ *
+ * PURPOSE:
+ * To find the line of fmsnowtimer of a run in logfile, reading from
+ * offset (the size of the log before the run).
+ *
+ * RETURN VALUES:
+ * FM_OK - line found
+ * FM_IO_ERR - no line found, line is then empty
+ */
+int readtimerline(char *logfile, long offset, char *line, int len) {
+
+    FILE *fp;
+
+    line[0] = '\0';
+    fp = fopen(logfile,"r");
+    if (!fp) return(FM_IO_ERR);
+    if (offset > 0 && fseek(fp,offset,SEEK_SET)) {
+	fclose(fp);
+	return(FM_IO_ERR);
+    }
+    while (fgets(line,len,fp)) {
+	if (strncmp(line,"fmsnowtimer ",12) == 0) break;
+    }
+    if (strncmp(line,"fmsnowtimer ",12) != 0) line[0] = '\0';
+    fclose(fp);
+
+    return(line[0] ? FM_OK : FM_IO_ERR);
+}
+
+/*
+ * NAME:
+ * timerfield
+ *
+ * PURPOSE:
+ * To find the value of key in a fmsnowtimer line, 0 if not found.
+ */
+double timerfield(char *line, char *key) {
+    char pattern[FMSNOWCOVER_MSGLENGTH], *pt;
+
+    sprintf(pattern," %s=",key);
+    pt = strstr(line,pattern);
+    if (!pt) return(0.);
+
+    return(atof(pt+strlen(pattern)));
+}
+
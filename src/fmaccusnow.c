@@ -9,7 +9,8 @@
  * 
  * SYNTAX: accusnow -s <dir_fmsnow> -d <date_end> 
  *         -p <period> -a <pref_outf> -o <path_outf>
- *         (-t <satellite> -l <satlist> -m <arealist> -z)
+ *         (-t <satellite> -l <satlist> -m <arealist> -z -n -M <metricsfile>
+ *         -j <threads> -u <target> -g <lmdir> -k -T <tracefile>)
  *
  *    <dir_fmsnow>  : Directory with hdf5 files with fmsnow data.
  *    <date_end>     : End date of merging period.
@@ -20,9 +21,34 @@
  *    <satlist>      : File with satellites to use (optional).
  *    <arealist>     : File with tile areas to use (optional).
  *    -z             : Use threshold on satellite zenith angle (value from header file).
+ *    -n             : No MITIFF images, fmsnowrender makes them on demand.
+ *    <metricsfile>  : File the timing report is appended to (optional).
+ *    <threads>      : Number of threads reading and summing the passes
+ *                     of a tile (optional), the result does not depend
+ *                     on it.
+ *    <target>       : Composite the latest cloud free observations
+ *                     instead of averaging all passes, up to <target>
+ *                     observations of each pixel (optional).
+ *    <lmdir>        : Directory of the land/sea masks of fmsnowcover,
+ *                     with -u only land pixels must be observed
+ *                     (optional).
+ *    -k             : <dir_fmsnow> holds the cubes of fmsnowcover
+ *                     (CUBEPATH) instead of pass files (optional).
+ *    <tracefile>    : Timeline of the run in the trace event format of
+ *                     Chrome and Perfetto (optional).
  *
  * NOTE:
- * NA
+ * With -u the passes are read newest first and reading stops when all
+ * (land) pixels have <target> cloud free observations, see
+ * latest_merge_files. The default prefix is then accusnowlatest.
+ *
+ * With -k the passes of each tile are read from its cube,
+ * fmsnowcube_<tile>.hdf5, by cube_merge_tile. Only the passes of the
+ * period (and satellites) are read, and only once for all passes.
+ *
+ * The trace of -T has the stages of the timing report, each file read,
+ * each tile and, with -j, the reading, summing and waiting of each
+ * thread, see fmsnowtrace.c.
  * 
  * AUTHOR: 
  * Steinar Eastwood, DNMI, 21.08.2000
@@ -33,6 +59,21 @@
  * ystein Gody, METNO/FOU, 23.04.2009: More cleaning of software.
  * Mari Anne Killie, METNO/FOU, 02.07.2010: Replacing
  * store_mitiff_.. with store_snow.
+ * ystein Gody, METNO/FOU, 19.10.2026: Time used for directory scan,
+ * header checks, reading, merging and writing is reported at the end.
+ * ystein Gody, METNO/FOU, 19.10.2026: Each output file is timed, the
+ * report includes peak memory and may be appended to a metrics file (-M).
+ * ystein Gody, METNO/FOU, 19.10.2026: MITIFF images are not written if -n
+ * is given.
+ * ystein Gody, METNO/FOU, 19.10.2026: The passes of a tile may be read
+ * and summed by several threads (-j).
+ * ystein Gody, METNO/FOU, 19.10.2026: Latest clear observation composite
+ * (-u, -g).
+ * ystein Gody, METNO/FOU, 19.10.2026: Passes may be read from the cubes
+ * of the tiles (-k).
+ * ystein Gody, METNO/FOU, 19.10.2026: Timeline trace of the run (-T).
+ * ystein Gody, METNO/FOU, 19.10.2026: The number of arguments is not
+ * limited, the required options are checked after getopt.
  *
  * CVS_ID:
  * $Id: fmaccusnow.c,v 1.10 2011-11-25 13:21:49 mariak Exp $
@@ -46,7 +87,8 @@ int main(int argc, char *argv[]) {
     char *where="fmaccusnow";
     extern char *optarg;
     char *dir_avhrrice, *date_start, *date_prod, *date_end;
-    int sflg, dflg, pflg, aflg, oflg, tflg, lflg, mflg, zflg, cflg;
+    int sflg, dflg, pflg, aflg, oflg, tflg, lflg, mflg, zflg, cflg, Mflg, nflg;
+    int kflg;
     int period, i, j, f, t, tile, nrInput, ret, ind, numf;
     int numsat, numarea;
     fmsec1970 stime, ftime, etime, prodtime;
@@ -56,11 +98,13 @@ int main(int argc, char *argv[]) {
     char *pref_outf, *path_outf, *checkfile, *sret, datestr[13], *procsat; 
     char datestr_ymdhms[15];
     char *satlistfile, *arealistfile, **satlist, **arealist;
+    char *metricsfile, *lmdir = NULL, *tracefile = NULL;
     fmtime timedate;
     fmucsref refucs;
     struct dirent *dirl_avhrrice;
     DIR *dirp_avhrrice;
     char *defpref = "accusnow";
+    char *latestpref = "accusnowlatest";
     char *pref_ps = "sp";
     char *pref_cl = "cl";
     int satfound;
@@ -84,8 +128,15 @@ int main(int argc, char *argv[]) {
 	0, 0, 0, 0., 0., -999., -999.
     };
     int include_sar = 0;
+    int nthreads = 0, target = 0, nread;
+    unsigned char *land;
+    fmsnowtimer timer;
+    fmsnowcube cube;
+    char **cubesats;
+    int ncubesats;
+    double ttile, tread;
   
-    if (!(argc >= 9 && argc <= 18)) usage();
+    fmsnowtimer_init(&timer, where);
 
     fprintf(stdout,"\n");
     fprintf(stdout,"\t=================================================\n");
@@ -94,8 +145,8 @@ int main(int argc, char *argv[]) {
     fprintf(stdout,"\n");
 
     /* Interprete commandline arguments */
-    sflg=dflg=pflg=aflg=oflg=tflg=lflg=mflg=zflg=cflg=0;
-    while ((ret = getopt(argc, argv, "s:d:p:a:o:t:l:m:c:z")) != EOF) {
+    sflg=dflg=pflg=aflg=oflg=tflg=lflg=mflg=zflg=cflg=Mflg=nflg=kflg=0;
+    while ((ret = getopt(argc, argv, "s:d:p:a:o:t:l:m:c:znM:j:u:g:kT:")) != EOF) {
 	switch (ret) {
 	    case 's':
 		dir_avhrrice = (char *) malloc(strlen(optarg)+1);
@@ -171,12 +222,41 @@ int main(int argc, char *argv[]) {
 	    case 'z':
 		zflg++;
 		break;
+	    case 'n':
+		nflg++;
+		break;
+	    case 'M':
+		metricsfile = optarg;
+		Mflg++;
+		break;
+	    case 'j':
+		nthreads = atoi(optarg);
+		if (nthreads < 0) usage();
+		break;
+	    case 'u':
+		target = atoi(optarg);
+		if (target < 1) usage();
+		break;
+	    case 'g':
+		lmdir = optarg;
+		break;
+	    case 'k':
+		kflg++;
+		break;
+	    case 'T':
+		tracefile = optarg;
+		break;
 	    default:
 		usage();
 	}
     }
 
     if (!sflg || !dflg || !pflg || !oflg) usage();
+    fmsnowtimer_input(&timer, dir_avhrrice);
+    if (tracefile && fmsnowtrace_open(tracefile, where)) {
+	fmerrmsg(where,"Could not open trace file %s", tracefile);
+	exit(FM_IO_ERR);
+    }
     if (lflg && tflg) {
 	fprintf(stdout,
 		"\n ERROR: do not give arguments l and t simultaneously\n\n");
@@ -221,7 +301,11 @@ int main(int argc, char *argv[]) {
     if (aflg) {
 	fprintf(stdout,"\tPrefix outfile:        %s \n", pref_outf);
     } else {
-	pref_outf = defpref;
+	pref_outf = (target > 0) ? latestpref : defpref;
+    }
+    if (target > 0) {
+	fprintf(stdout,"\tLatest clear observations: %d per pixel\n",
+		target);
     }
 
     if (tflg) {
@@ -346,16 +430,22 @@ int main(int argc, char *argv[]) {
     /* 
      * Reading directory, find all avhrrice files to process. 
      */
+    fmsnowtimer_start(&timer, "scan");
     dirp_avhrrice = opendir(dir_avhrrice);
     if (!dirp_avhrrice) {
 	fmerrmsg(where,"Could not open %s",dir_avhrrice);
 	return(FM_IO_ERR);
     }
 
-    numf = 0;
-    while ((dirl_avhrrice = readdir(dirp_avhrrice)) != NULL) {
+    /*
+     * With -k there is one cube for each tile, the passes are selected
+     * when it is read.
+     */
+    numf = kflg ? numarea : 0;
+    while (!kflg && (dirl_avhrrice = readdir(dirp_avhrrice)) != NULL) {
 	if (strncmp(dirl_avhrrice->d_name,BASEFNAME,strlen(BASEFNAME)) == 0 &&
 	    strstr(dirl_avhrrice->d_name,".hdf") != NULL && 
+	    strstr(dirl_avhrrice->d_name,PASSEXTENT_SUFFIX) == NULL &&
 	    strlen(dirl_avhrrice->d_name) >= MINLENFNAME) {
 	    sret = strncpy(datestr,&dirl_avhrrice->d_name[10],12);
 	    datestr[12] = '\0';
@@ -385,13 +475,14 @@ int main(int argc, char *argv[]) {
     /*
      * Loop through files
      */
-    while ((dirl_avhrrice = readdir(dirp_avhrrice)) != NULL) {
+    while (!kflg && (dirl_avhrrice = readdir(dirp_avhrrice)) != NULL) {
 
 	/*
 	 * Check input filename
 	 */
 	if (strncmp(dirl_avhrrice->d_name,BASEFNAME,strlen(BASEFNAME)) 
 		== 0 &&	strstr(dirl_avhrrice->d_name,".hdf") != NULL && 
+		strstr(dirl_avhrrice->d_name,PASSEXTENT_SUFFIX) == NULL &&
 		strlen(dirl_avhrrice->d_name) >= MINLENFNAME) {
 
 	    /*
@@ -416,7 +507,14 @@ int main(int argc, char *argv[]) {
 	    }
 	    sprintf(checkfile,"%s/%s",dir_avhrrice,dirl_avhrrice->d_name);
 	    init_osihdf(&checkfileheader);
+	    fmsnowtimer_stop(&timer, "scan");
+	    fmsnowtimer_start(&timer, "header");
+	    tread = fmsnowtrace_now();
 	    ret = read_hdf5_product(checkfile,&checkfileheader,1);
+	    fmsnowtrace_span("read", "header", checkfile, tread,
+		    fmsnowtrace_now());
+	    fmsnowtimer_stop(&timer, "header");
+	    fmsnowtimer_start(&timer, "scan");
 	    free(checkfile);
 	    if (ret != 0) {
 	      fmerrmsg(where,"Could not open %s, skipping file",
@@ -479,11 +577,32 @@ int main(int argc, char *argv[]) {
 	    num_files_area[ind]++;
 	}
     }
+    for (t=0;kflg && t<numarea;t++) {
+	infile_avhrrice[i] = (char *) malloc(256*sizeof(char));
+	infile_sorted[i]   = (char *) malloc(256*sizeof(char));
+	if (! infile_avhrrice[i] || ! infile_sorted[i]) {
+	    fmerrmsg(where,"Could not allocate infile_avhrrice[%d]", i);
+	    exit(FM_MEMALL_ERR);
+	}
+	fmsnowcube_name(dir_avhrrice,arealist[t],infile_avhrrice[i]);
+	if (access(infile_avhrrice[i],R_OK) != 0) {
+	    free(infile_avhrrice[i]);
+	    free(infile_sorted[i]);
+	    continue;
+	}
+	sprintf(infile_sorted[i],"%s",infile_avhrrice[i]);
+	i ++;
+	num_files_area[t]++;
+    }
+    closedir(dirp_avhrrice);
     free(dir_avhrrice);
     nrInput = i;
+    fmsnowtimer_stop(&timer, "scan");
 
     if (nrInput == 0) {
 	fmerrmsg(where,"No files to be processed.");
+	fmsnowtimer_report(&timer, stdout);
+	if (Mflg) fmsnowtimer_append(&timer, metricsfile);
 	exit(FM_OK);
     }
 
@@ -503,7 +622,7 @@ int main(int argc, char *argv[]) {
 		arealist[t],num_files_area[t]);
 	num_files_area_counter[t] = 0;
     }
-    for (i=0;i<nrInput;i++) {
+    for (i=0;!kflg && i<nrInput;i++) {
 	for (t=0;t<numarea;t++) {
 	    sprintf(checkstr,"fmsnow_%2s",arealist[t]);
 	    if (strstr(infile_avhrrice[i],checkstr)) {
@@ -538,6 +657,7 @@ int main(int argc, char *argv[]) {
        "\t No input files for tile %s, continuing on list\n",arealist[tile]);
 	    continue;
 	}
+	ttile = fmsnowtrace_now();
 
 	index_offset=0;
 	for (t=0;t<tile;t++) {
@@ -576,9 +696,37 @@ int main(int argc, char *argv[]) {
 	 * Read headers of all files on list to compare products and collect
 	 * information. Products must cover the same area.
 	 */
-	for (f=0;f<num_files_area[tile];f++) {
+	fmsnowtimer_start(&timer, "header");
+	if (kflg) {
+	    init_osihdf(&inputhdf[0]);
+	    if (fmsnowcube_open(infile_currenttile[0],&cube) != 0) {
+		fmerrmsg(where,"Could not open %s",infile_currenttile[0]);
+		exit(FM_IO_ERR);
+	    }
+	    inputhdf[0].h.iw = cube.ref.iw;
+	    inputhdf[0].h.ih = cube.ref.ih;
+	    inputhdf[0].h.z  = FMACCUSNOWPROD_LEVELS;
+	    inputhdf[0].h.Ax = cube.ref.Ax;
+	    inputhdf[0].h.Ay = cube.ref.Ay;
+	    inputhdf[0].h.Bx = cube.ref.Bx;
+	    inputhdf[0].h.By = cube.ref.By;
+	    sprintf(inputhdf[0].h.area, "%s", cube.area);
+	    sprintf(inputhdf[0].h.source, "%s", satstring);
+	    sprintf(inputhdf[0].h.product, "%s", cube.product);
+	    sprintf(inputhdf[0].h.projstr, "%s", cube.projstr);
+	    for (i=0;i<cube.nslots;i++) {
+		if (cube.pass[i].time >= stime && cube.pass[i].time <= etime) {
+		    sprintf(inputhdf[0].h.source, "%s", cube.pass[i].satellite);
+		    break;
+		}
+	    }
+	}
+	for (f=0;!kflg && f<num_files_area[tile];f++) {
 	    init_osihdf(&inputhdf[f]);
+	    tread = fmsnowtrace_now();
 	    ret=read_hdf5_product(infile_currenttile[f],&inputhdf[f], 1);
+	    fmsnowtrace_span("read", "header", infile_currenttile[f], tread,
+		    fmsnowtrace_now());
 	    if (ret != 0) {
 	fmerrmsg(where,"Could not read header of %s",infile_currenttile[f]);
 	    }
@@ -593,6 +741,7 @@ int main(int argc, char *argv[]) {
 		exit(FM_IO_ERR);
 	    }
 	}
+	fmsnowtimer_stop(&timer, "header");
 
 	snowprod.h.iw = inputhdf[0].h.iw;
 	snowprod.h.ih = inputhdf[0].h.ih;
@@ -654,12 +803,78 @@ int main(int argc, char *argv[]) {
 	/*
 	 * Do the time integration using the method chosen...
 	 */
-	if (num_files_area[tile] > 0) {
+	if (kflg) {
+	    fprintf(stdout,"\n\tNow merging the cube of tile %s..\n",
+		    arealist[tile]);
+	    land = NULL;
+	    if (target > 0 && lmdir &&
+		read_land_mask(lmdir, arealist[tile], refucs, &land)) {
+		fmlogmsg(where,
+			"Continuing without land/sea mask for tile %s",
+			arealist[tile]);
+	    }
+	    cubesats = tflg ? &procsat : satlist;
+	    ncubesats = tflg ? 1 : (lflg ? numsat : 0);
+	    ret = cube_merge_tile(&cube, stime, etime, cubesats, ncubesats,
+				  catclass, snowclass, probsnow, probclear,
+				  cloudlim, numCloudfree, land, target,
+				  &nread, &timer);
+	    fmsnowcube_close(&cube);
+	    if (land) free(land);
+	    if (ret != 0) {
+		fmerrmsg(where,"Could not finish cube_merge_tile");
+		exit(FM_OTHER_ERR);
+	    }
+	    fmlogmsg(where,"Merged %d passes of tile %s", nread,
+		     arealist[tile]);
+	    fmsnowtimer_count(&timer, "passes.read", nread);
+	    if (nread == 0) {
+		fprintf(stdout,
+       "\t No passes for tile %s in the period, continuing on list\n",
+			arealist[tile]);
+		free(infile_currenttile[0]);
+		free(infile_currenttile);
+		free(inputhdf);
+		free(catclass);
+		free(snowclass);
+		free(probsnow);
+		free(probclear);
+		free(numCloudfree);
+		fmsnowtrace_span("tile", arealist[tile], NULL, ttile,
+			fmsnowtrace_now());
+		continue;
+	    }
+	} else if (num_files_area[tile] > 0 && target > 0) {
+	    fprintf(stdout,
+		    "\n\tNow compositing latest observations of tile %s (%d files)..\n",
+		    arealist[tile],num_files_area[tile]);
+	    land = NULL;
+	    if (lmdir && read_land_mask(lmdir, arealist[tile], refucs, &land)) {
+		fmlogmsg(where,
+			"Continuing without land/sea mask for tile %s",
+			arealist[tile]);
+	    }
+	    ret = latest_merge_files(infile_currenttile, num_files_area[tile],
+				     refucs, catclass, snowclass, probsnow,
+				     probclear, cloudlim, numCloudfree, land,
+				     target, &nread, &timer);
+	    if (land) free(land);
+	    if (ret != 0) {
+		fmerrmsg(where,"Could not finish latest_merge_files");
+		exit(FM_OTHER_ERR);
+	    }
+	    fmlogmsg(where,"Read %d of %d files for tile %s", nread,
+		     num_files_area[tile], arealist[tile]);
+	    fmsnowtimer_count(&timer, "passes.read", nread);
+	    fmsnowtimer_count(&timer, "passes.skipped",
+			      num_files_area[tile]-nread);
+	} else if (num_files_area[tile] > 0) {
 	    fprintf(stdout,"\n\tNow averaging tile %s (%d files)..\n",
 		    arealist[tile],num_files_area[tile]);
 	    ret = average_merge_files(infile_currenttile, num_files_area[tile],
 				      refucs, catclass, snowclass, probsnow, 
-				      probclear, cloudlim, numCloudfree); 
+				      probclear, cloudlim, numCloudfree,
+				      nthreads, &timer); 
 	    if (ret != 0) {
 		fmerrmsg(where,"Could not finish average_merge_files");
 		exit(FM_OTHER_ERR);
@@ -868,58 +1083,78 @@ int main(int argc, char *argv[]) {
 	/* 
 	 * Create the output HDF5 product file 
 	 */
+	fmsnowtimer_start(&timer, "write");
 	outfHDF = (char *) malloc(FILELEN+5);
 	if (!outfHDF) exit(FM_MEMALL_ERR);
 	sprintf(outfHDF,"%s/%s_%s_%04d%02d%02d%02d-%dhours_%s.hdf5",path_outf,
 	    pref_outf,arealist[tile],
 	    snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
 	    period,satstring);
+	fmsnowtimer_start(&timer, "hdf5");
 	ret = store_hdf5_product(outfHDF, snowprod);
 	if (ret != 0)  {
 	    fmerrmsg(where,"Could not create HDF file %s", outfHDF);
 	    exit(FM_IO_ERR);
 	}    
+	fmsnowtimer_stop(&timer, "hdf5");
 
 	
-	/* 
-	 * Create MITIFF for the classified/categorized image 
-	 */
-	image_type = 1;
-	sprintf(clinfo.satellite,"%s",satstring);
-	outfMITIFF_class = (char *) malloc(FILELEN+5);
-	if (!outfMITIFF_class) exit(FM_MEMALL_ERR);
-	sprintf(outfMITIFF_class,
-	    "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
-	    path_outf,pref_outf,pref_cl,arealist[tile],
-	    snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
-	    period,satstring);
-	ret = store_snow(outfMITIFF_class, catclass, clinfo, image_type);
-	if (ret != 0)  { 
-	    fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_class);
-	    exit(FM_IO_ERR);
-	} 
-
-	/* 
-	 * Create MITIFF for ice probability image 
+	/*
+	 * The MITIFF images are made by fmsnowrender on demand if -n is
+	 * given.
 	 */
-	image_type = 0;
-	sprintf(clinfo.satellite,"%s",satstring);
-	outfMITIFF_psnow = (char *) malloc(FILELEN+5);
-	if (!outfMITIFF_psnow) exit(FM_MEMALL_ERR);
-	sprintf(outfMITIFF_psnow,
-	    "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
-	    path_outf,pref_outf,pref_ps,arealist[tile],
-	    snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
-	    period,satstring);
-	ret = store_snow(outfMITIFF_psnow, snowclass, clinfo, image_type);
-	if (ret != 0)  {
-	    fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_psnow);
-	    exit(FM_IO_ERR);
+	outfMITIFF_class = NULL;
+	outfMITIFF_psnow = NULL;
+	if (!nflg) {
+	    /* 
+	     * Create MITIFF for the classified/categorized image 
+	     */
+	    image_type = 1;
+	    sprintf(clinfo.satellite,"%s",satstring);
+	    outfMITIFF_class = (char *) malloc(FILELEN+5);
+	    if (!outfMITIFF_class) exit(FM_MEMALL_ERR);
+	    sprintf(outfMITIFF_class,
+	        "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
+	        path_outf,pref_outf,pref_cl,arealist[tile],
+	        snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
+	        period,satstring);
+	    fmsnowtimer_start(&timer, "mitiffclass");
+	    ret = store_snow(outfMITIFF_class, catclass, clinfo, image_type);
+	    if (ret != 0)  { 
+	        fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_class);
+	        exit(FM_IO_ERR);
+	    } 
+	    fmsnowtimer_stop(&timer, "mitiffclass");
+
+	    /* 
+	     * Create MITIFF for ice probability image 
+	     */
+	    image_type = 0;
+	    sprintf(clinfo.satellite,"%s",satstring);
+	    outfMITIFF_psnow = (char *) malloc(FILELEN+5);
+	    if (!outfMITIFF_psnow) exit(FM_MEMALL_ERR);
+	    sprintf(outfMITIFF_psnow,
+	        "%s/%s-%s_%s_%04d%02d%02d%02d-%dhours_%s.mitiff",
+	        path_outf,pref_outf,pref_ps,arealist[tile],
+	        snowprod.h.year,snowprod.h.month,snowprod.h.day,snowprod.h.hour,
+	        period,satstring);
+	    fmsnowtimer_start(&timer, "mitiffpsnow");
+	    ret = store_snow(outfMITIFF_psnow, snowclass, clinfo, image_type);
+	    if (ret != 0)  {
+	        fmerrmsg(where,"Could not create MITIFF file %s", outfMITIFF_psnow);
+	        exit(FM_IO_ERR);
+	    }
+	    fmsnowtimer_stop(&timer, "mitiffpsnow");
 	}
 
+	fmsnowtimer_stop(&timer, "write");
+
 	fprintf(stdout,"\t%s\n",outfHDF);
-	fprintf(stdout,"\t%s\n",outfMITIFF_class);
-	fprintf(stdout,"\t%s\n\n",outfMITIFF_psnow);
+	if (!nflg) {
+	    fprintf(stdout,"\t%s\n",outfMITIFF_class);
+	    fprintf(stdout,"\t%s\n",outfMITIFF_psnow);
+	}
+	fprintf(stdout,"\n");
 
 	/* 
 	 * Free some memory, check that everything is handled!! 
@@ -933,6 +1168,8 @@ int main(int argc, char *argv[]) {
 	free(probclear);
 	free(numCloudfree);
 	free_osihdf(&snowprod);   
+	fmsnowtrace_span("tile", arealist[tile], NULL, ttile,
+		fmsnowtrace_now());
 
     } /* end for-loop for tile */
 
@@ -969,6 +1206,9 @@ int main(int argc, char *argv[]) {
     if (lflg) {free(satlistfile);}
     if (mflg) {free(arealistfile);}
 
+    fmsnowtimer_report(&timer, stdout);
+    if (Mflg) fmsnowtimer_append(&timer, metricsfile);
+    fmsnowtrace_close();
     fprintf(stdout,"\t=================================================\n");
 
     exit(FM_OK);
@@ -978,7 +1218,9 @@ void usage() {
     fprintf(stdout,"\n  SYNTAX: \n");
     fprintf(stdout,"  accusnow -s <dir_avhrrice> -d <date_end> -p <period>\n");
     fprintf(stdout,"\t  -a <pref_outf> -o <path_outf> (-t <satellite name>\n");
-    fprintf(stdout,"\t  -l <satlist> -c <cloudlimit> -m <arealist> -z) \n\n");
+    fprintf(stdout,"\t  -l <satlist> -c <cloudlimit> -m <arealist> -z\n");
+    fprintf(stdout,"\t  -n -M <metricsfile> -j <threads> -u <target>\n");
+    fprintf(stdout,"\t  -g <lmdir> -k -T <tracefile>) \n\n");
     fprintf(stdout,"  <dir_avhrrice> : Directory with hdf5 files ");
     fprintf(stdout,"with avhrr ice data.\n");
     fprintf(stdout,"  <date_end>   : End date of merging period\n");
@@ -994,6 +1236,28 @@ void usage() {
     fprintf(stdout,
     "  <cloudlimit>   : Probability limit for class cloud (optional).\n");
     fprintf(stdout,"  -z             : Use threshold on satellite ");
-    fprintf(stdout,"zenith angle (not in use!).\n\n");
+    fprintf(stdout,"zenith angle (not in use!).\n");
+    fprintf(stdout,"  -n             : No MITIFF images, use fmsnowrender ");
+    fprintf(stdout,"to make them.\n");
+    fprintf(stdout,
+    "  <metricsfile>  : File the timing report is appended to (optional).\n");
+    fprintf(stdout,
+    "  <threads>      : Threads reading and summing passes (optional).\n");
+    fprintf(stdout,
+    "  <target>       : Use the latest <target> cloud free observations\n");
+    fprintf(stdout,
+    "                   of each pixel, newest passes first (optional).\n");
+    fprintf(stdout,
+    "  <lmdir>        : Land/sea masks, with -u only land pixels must\n");
+    fprintf(stdout,
+    "                   be observed (optional).\n");
+    fprintf(stdout,
+    "  -k             : <dir_avhrrice> holds the cubes of the tiles\n");
+    fprintf(stdout,
+    "                   (CUBEPATH of fmsnowcover) (optional).\n");
+    fprintf(stdout,
+    "  <tracefile>    : Timeline of the run for chrome://tracing or\n");
+    fprintf(stdout,
+    "                   Perfetto (optional).\n\n");
     exit(FM_OK);
 }
@@ -11,6 +11,16 @@
  * MODIFIED: 
  * ystein Gody, METNO/FOU, 23.04.2009: Modified for use within the
  * fmsnowcover package.
+ * ystein Gody, METNO/FOU, 19.10.2026: average_merge_files takes a timer.
+ * ystein Gody, METNO/FOU, 19.10.2026: average_merge_files takes the
+ * number of threads.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added latest_merge_files and
+ * read_land_mask.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added passextent.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added cube_merge_tile, fmsnowcube.h
+ * included.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added FMACCUSNOWMISVAL_SEA.
+ * ystein Gody, METNO/FOU, 19.10.2026: fmsnowtrace.h included.
  *
  * CVS_ID:
  * $Id: fmaccusnow.h,v 1.5 2013-02-01 10:31:28 steingod Exp $
@@ -28,6 +38,8 @@
 #include <fmutil.h>
 #include <fmio.h>
 #include <dirent.h>
+#include <fmsnowtimer.h>
+#include <fmsnowtrace.h>
 
 /*
  * Useful constants
@@ -56,6 +68,8 @@
 #define FMACCUSNOWMISVAL_NIGHT -990  /* Night scene */
 #define FMACCUSNOWMISVAL_LAND -992 /* Land pixel */
 #define FMACCUSNOWMISVAL_3A -993 /* AVHRR 3A missing */
+#define FMACCUSNOWMISVAL_SEA -994 /* Sea pixel, land only products */
+#define FMACCUSNOWSEA 0 /* Sea in the land/sea mask (FMSNOWSEA) */
 
 /* 
  * Parameters for HDF5 files
@@ -81,13 +95,48 @@
 #define FILELEN 256 /* standard length of filenames including path */
 #define FMACCUSNOWPROD_LEVELS 3
 
+/*
+ * Valid data extent of a pass product, the first and last column with
+ * probabilities in each row. first > last for rows without.
+ */
+#define PASSEXTENT_SUFFIX ".extent"
+
+typedef struct {
+    int iw, ih;
+    int nrows; /* rows with valid pixels */
+    int *first, *last;
+} passextent;
+
+#include <fmsnowcube.h>
+
 /*
  * Function prototypes.
  */
 int average_merge_files(char **infSST, int nrInput, fmucsref safucs, 
 			unsigned char *class, unsigned char *probclass,
 			float *probice, float *probclear, float cloudlim,
-			int *numCloudfree);
+			int *numCloudfree, int nthreads, fmsnowtimer *tm);
+
+int latest_merge_files(char **infAVHRRICE, int nrInput, fmucsref safucs, 
+		       unsigned char *catclass, unsigned char *probclass, 
+		       float *probice, float *probclear, float cloudlim,
+		       int *numCloudfree, unsigned char *land, int target,
+		       int *nread, fmsnowtimer *tm);
+
+int cube_merge_tile(fmsnowcube *cb, fmsec1970 stime, fmsec1970 etime,
+		    char **sats, int nsats, unsigned char *catclass,
+		    unsigned char *probclass, float *probice,
+		    float *probclear, float cloudlim, int *numCloudfree,
+		    unsigned char *land, int target, int *npass,
+		    fmsnowtimer *tm);
+
+int read_land_mask(char *lmdir, char *area, fmucsref safucs,
+		   unsigned char **land);
+
+int find_pass_extent(float *pice, int iw, int ih, passextent *ex);
+int write_pass_extent(char *prodfile, passextent *ex);
+int read_pass_extent(char *prodfile, int iw, int ih, passextent *ex);
+void free_pass_extent(passextent *ex);
 
 int check_headers(int nrInput, PRODhead hrSSThead[]);
 
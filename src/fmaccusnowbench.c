@@ -0,0 +1,342 @@
+/*
+ * NAME:
+ * fmaccusnowbench
+ *
+ * PURPOSE:
+ * Scaling benchmark of fmaccusnow. A number of synthetic fmsnowcover
+ * pass products (fmsnow_<tile>_<yyyymmddhhmm>.hdf5) are created within
+ * the integration period, fmaccusnow is run on them and the time used
+ * is reported as CSV, split on the stages reported by fmaccusnow.
+ *
+ * REQUIREMENTS:
+ * fmaccusnow binary
+ *
+ * INPUT:
+ * Number of products, integration period, tiles and tile size given on
+ * the commandline.
+ *
+ * OUTPUT:
+ * CSV with one line per run of fmaccusnow:
+ * files,period_h,tiles,size,run,status,wall_s,files_per_s,read_mb,
+ * read_mb_per_s,scan_s,header_s,read_s,merge_s,write_s,maxrss_kb
+ *
+ * NOTES:
+ * The products are distributed evenly on the tiles and in time within
+ * the period, so the number of files per tile can not exceed the number
+ * of minutes in the period. Pixels are not covered (15%), night (10%)
+ * or have random probabilities of ice, clear and cloud.
+ *
+ * The stage times are taken from the fmsnowtimer line written by
+ * fmaccusnow, the output of the last run is kept in fmaccusnow.log in
+ * the work directory.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <synthpix.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define ACCUBENCH_MAXTILES 20
+#define ACCUBENCH_LINELEN 4096
+
+static int writeproduct(char *fname, char *tile, int size, fmsec1970 t);
+static void accubenchusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmaccusnowbench";
+    extern char *optarg;
+    char *workdir = NULL, *csvfile = NULL;
+    char *fmaccusnow = "./fmaccusnow", *tilelist = "ns";
+    char *enddate = "2010032112";
+    char tilebuf[FILELEN], *tiles[ACCUBENCH_MAXTILES], *pt, *save;
+    char proddir[FILELEN], outdir[FILELEN], listfile[FILELEN];
+    char logfile[FILELEN], fname[FILELEN], line[ACCUBENCH_LINELEN];
+    char periodstr[20], datestr[20];
+    char *cargv[20];
+    int ret, nfiles = 100, period = 24, size = 1200, nrep = 3;
+    int ntiles, nper, i, k, r, n;
+    fmsec1970 etime, stime, ftime;
+    fmtime ft;
+    fmucsref ucs;
+    double readmb, readwall;
+    runstat rs;
+    struct dirent *de;
+    DIR *dp;
+    FILE *fp, *csv;
+
+    while ((ret = getopt(argc, argv, "w:a:n:p:t:s:r:e:o:")) != EOF) {
+	switch (ret) {
+	    case 'w':
+		workdir = optarg;
+		break;
+	    case 'a':
+		fmaccusnow = optarg;
+		break;
+	    case 'n':
+		nfiles = atoi(optarg);
+		break;
+	    case 'p':
+		period = atoi(optarg);
+		break;
+	    case 't':
+		tilelist = optarg;
+		break;
+	    case 's':
+		size = atoi(optarg);
+		break;
+	    case 'r':
+		nrep = atoi(optarg);
+		break;
+	    case 'e':
+		enddate = optarg;
+		break;
+	    case 'o':
+		csvfile = optarg;
+		break;
+	    default:
+		accubenchusage();
+	}
+    }
+    if (!workdir || nfiles < 1 || period < 1 || size < 2 || nrep < 1) {
+	accubenchusage();
+    }
+    if (strlen(enddate) != 10) {
+	fmerrmsg(where,"The end date should be given as yyyymmddhh");
+	exit(FM_SYNTAX_ERR);
+    }
+
+    sprintf(tilebuf,"%s",tilelist);
+    ntiles = 0;
+    for (pt=strtok_r(tilebuf,",",&save); pt && ntiles<ACCUBENCH_MAXTILES;
+	    pt=strtok_r(NULL,",",&save)) {
+	if (synthtileucs(pt, size, &ucs)) {
+	    fmerrmsg(where,"Tile %s is not known", pt);
+	    exit(FM_VAROUTOFSCOPE_ERR);
+	}
+	tiles[ntiles++] = pt;
+    }
+    nper = (nfiles+ntiles-1)/ntiles;
+    if (nper > period*60) {
+	fmerrmsg(where,"Too many files (%d per tile) for a period of %d hours",
+		nper, period);
+	exit(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    sprintf(proddir,"%s/prod",workdir);
+    sprintf(outdir,"%s/out",workdir);
+    sprintf(listfile,"%s/tilelist",workdir);
+    sprintf(logfile,"%s/fmaccusnow.log",workdir);
+    mkdir(workdir,0755);
+    mkdir(proddir,0755);
+    mkdir(outdir,0755);
+
+    /*
+     * Remove products of earlier runs, they would otherwise be
+     * included.
+     */
+    dp = opendir(proddir);
+    if (!dp) {
+	fmerrmsg(where,"Could not open %s", proddir);
+	exit(FM_IO_ERR);
+    }
+    while ((de = readdir(dp)) != NULL) {
+	if (strncmp(de->d_name,"fmsnow_",7) == 0) {
+	    sprintf(fname,"%s/%s",proddir,de->d_name);
+	    unlink(fname);
+	}
+    }
+    closedir(dp);
+
+    fp = fopen(listfile,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not create %s", listfile);
+	exit(FM_IO_ERR);
+    }
+    for (k=0;k<ntiles;k++) {
+	fprintf(fp,"%s\n",tiles[k]);
+    }
+    fclose(fp);
+
+    /*
+     * Create the products, file i is put on tile i%ntiles at time step
+     * i/ntiles within the period.
+     */
+    etime = ymdh2fmsec1970(enddate,0);
+    stime = etime-period*3600;
+    fmlogmsg(where,"Creating %d products of %dx%d pixels in %s",
+	    nfiles, size, size, proddir);
+    for (i=0;i<nfiles;i++) {
+	ftime = stime+60*(((i/ntiles)*period*60)/nper+1);
+	tofmtime(ftime, &ft);
+	sprintf(fname,"%s/fmsnow_%s_%04d%02d%02d%02d%02d.hdf5",
+		proddir, tiles[i%ntiles], ft.fm_year, ft.fm_mon, ft.fm_mday,
+		ft.fm_hour, ft.fm_min);
+	if (writeproduct(fname, tiles[i%ntiles], size, ftime)) {
+	    fmerrmsg(where,"Could not create %s", fname);
+	    exit(FM_IO_ERR);
+	}
+    }
+
+    if (csvfile) {
+	csv = fopen(csvfile,"w");
+	if (!csv) {
+	    fmerrmsg(where,"Could not create %s", csvfile);
+	    exit(FM_IO_ERR);
+	}
+    } else {
+	csv = stdout;
+    }
+    fprintf(csv,"files,period_h,tiles,size,run,status,wall_s,files_per_s,");
+    fprintf(csv,"read_mb,read_mb_per_s,scan_s,header_s,read_s,merge_s,");
+    fprintf(csv,"write_s,maxrss_kb\n");
+
+    sprintf(periodstr,"%d",period);
+    sprintf(datestr,"%s",enddate);
+    n = 0;
+    cargv[n++] = fmaccusnow;
+    cargv[n++] = "-s"; cargv[n++] = proddir;
+    cargv[n++] = "-d"; cargv[n++] = datestr;
+    cargv[n++] = "-p"; cargv[n++] = periodstr;
+    cargv[n++] = "-o"; cargv[n++] = outdir;
+    cargv[n++] = "-m"; cargv[n++] = listfile;
+    cargv[n++] = "-c"; cargv[n++] = "0.4";
+    cargv[n] = NULL;
+
+    for (r=0;r<nrep;r++) {
+	unlink(logfile);
+	if (runcommand(cargv, logfile, &rs)) {
+	    fmerrmsg(where,"Could not run %s", fmaccusnow);
+	    exit(FM_IO_ERR);
+	}
+
+	/*
+	 * Find the stage times reported by fmaccusnow.
+	 */
+	if (readtimerline(logfile, 0, line, ACCUBENCH_LINELEN)) {
+	    fmerrmsg(where,"No timing reported by %s, see %s", fmaccusnow,
+		    logfile);
+	}
+	readmb = timerfield(line,"read.bytes")/1.e6;
+	readwall = timerfield(line,"read.wall");
+
+	fprintf(csv,"%d,%d,%d,%d,%d,%d,%.3f,%.1f,%.1f,%.1f,",
+		nfiles, period, ntiles, size, r, rs.status, rs.wall,
+		(rs.wall > 0.) ? nfiles/rs.wall : 0.,
+		readmb, (readwall > 0.) ? readmb/readwall : 0.);
+	fprintf(csv,"%.3f,%.3f,%.3f,%.3f,%.3f,%ld\n",
+		timerfield(line,"scan.wall"), timerfield(line,"header.wall"),
+		readwall, timerfield(line,"merge.wall"),
+		timerfield(line,"write.wall"), rs.maxrss);
+	fflush(csv);
+    }
+
+    if (csv != stdout) fclose(csv);
+
+    exit(FM_OK);
+}
+
+/*
+ * NAME:
+ * writeproduct
+ *
+ * PURPOSE:
+ * To create a synthetic pass product with the layers written by
+ * fmsnowcover.
+ */
+static int writeproduct(char *fname, char *tile, int size, fmsec1970 t) {
+
+    int i, j, status;
+    double u, p[FMSNOWCOVER_OLEVELS], sum;
+    fmtime ft;
+    fmucsref ucs;
+    osihdf prod;
+    osi_dtype prod_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    char *prod_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)",
+	"P(cloud)"};
+
+    if (synthtileucs(tile, size, &ucs)) return(FM_VAROUTOFSCOPE_ERR);
+
+    tofmtime(t, &ft);
+    init_osihdf(&prod);
+    sprintf(prod.h.source, "%s", "NOAA-18");
+    sprintf(prod.h.product, "%s", "fmsnowcover");
+    sprintf(prod.h.area, "%s", tile);
+    prod.h.iw = size;
+    prod.h.ih = size;
+    prod.h.z = FMSNOWCOVER_OLEVELS;
+    sprintf(prod.h.projstr, "%s",
+	    "+proj=stere +a=6371000 +b=6371000 +lat_0=90 +lat_ts=60 +lon_0=0");
+    prod.h.Ax = ucs.Ax;
+    prod.h.Ay = ucs.Ay;
+    prod.h.Bx = ucs.Bx;
+    prod.h.By = ucs.By;
+    prod.h.year = ft.fm_year;
+    prod.h.month = ft.fm_mon;
+    prod.h.day = ft.fm_mday;
+    prod.h.hour = ft.fm_hour;
+    prod.h.minute = ft.fm_min;
+    if (malloc_osihdf(&prod,prod_ft,prod_desc)) return(FM_MEMALL_ERR);
+
+    for (i=0;i<size*size;i++) {
+	u = synthuniform();
+	if (u < 0.15) {
+	    for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+		((float *) prod.d[j].data)[i] = FMSNOWCOVERMISVAL_NOCOV;
+	    }
+	    continue;
+	} else if (u < 0.25) {
+	    for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+		((float *) prod.d[j].data)[i] = FMSNOWCOVERMISVAL_NIGHT;
+	    }
+	    continue;
+	}
+	sum = 0.;
+	for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+	    p[j] = synthuniform()+1.e-3;
+	    sum += p[j];
+	}
+	for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+	    ((float *) prod.d[j].data)[i] = p[j]/sum;
+	}
+    }
+
+    status = store_hdf5_product(fname,prod);
+    free_osihdf(&prod);
+
+    return(status ? FM_IO_ERR : FM_OK);
+}
+
+static void accubenchusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " fmaccusnowbench -w <workdir> [-n <files>] [-p <period>] [-t <tiles>]\n");
+    fprintf(stdout,
+	    "   [-s <size>] [-e <yyyymmddhh>] [-r <repeats>] [-a <fmaccusnow>]\n");
+    fprintf(stdout,
+	    "   [-o <csvfile>]\n\n");
+    fprintf(stdout," <workdir>: Directory for products and output.\n");
+    fprintf(stdout," <files>: Number of pass products (default 100).\n");
+    fprintf(stdout," <period>: Integration period in hours (default 24).\n");
+    fprintf(stdout," <tiles>: Comma separated tiles (default ns).\n");
+    fprintf(stdout," <size>: Pixels along each side (default 1200).\n");
+    fprintf(stdout," <yyyymmddhh>: End of integration period.\n");
+    fprintf(stdout," <repeats>: Runs of fmaccusnow (default 3).\n");
+    fprintf(stdout," <csvfile>: Output file, default is stdout.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
@@ -15,13 +15,103 @@
  * Mari Anne Killie, METNO/FOU, 08.01.2009: Original file by Steinar
  * Eastwood modified for use within the fmsnowcover package.
  * ystein Gody, METNO/FOU, 23.04.2009: More cleaning of software.
+ * ystein Gody, METNO/FOU, 19.10.2026: Reading and merging in
+ * average_merge_files are timed as separate stages if a timer is given.
+ * ystein Gody, METNO/FOU, 19.10.2026: Passes are read and summed in
+ * groups of MERGECHUNK, optionally by several threads, and the sums of the
+ * groups added in a fixed order.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added latest_merge_files and
+ * read_land_mask, the classification of the sums is shared with
+ * average_merge_files.
+ * ystein Gody, METNO/FOU, 19.10.2026: Only the valid data extent of a
+ * pass is summed, passes without valid data, or in latest_merge_files
+ * without pixels still lacking observations, are not read.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added cube_merge_tile, the pixels
+ * of a pass are added to the sums by mergepixel.
+ * ystein Gody, METNO/FOU, 19.10.2026: Sea pixels of land only products
+ * are undefined.
+ * ystein Gody, METNO/FOU, 19.10.2026: Files read, passes summed and waits
+ * of the merging threads are added to the trace.
+ * ystein Gody, METNO/FOU, 19.10.2026: The sums of the pass are freed if
+ * the memory of latest_merge_files can not be allocated.
  *
  * CVS_ID:
  * $Id: fmaccusnowfuncs.c,v 1.3 2013-02-01 08:41:36 mariak Exp $
  */ 
 
 #include <fmaccusnow.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
 
+/*
+ * Number of consecutive passes summed into one partial sum. This, and
+ * not the number of threads, decides the order of the floating point
+ * additions.
+ */
+#define MERGECHUNK 4
+
+/*
+ * Sums for each pixel, over a group of passes or all passes.
+ */
+typedef struct {
+  float *sumIce, *sumClear;
+  int *numCloudfree, *numPix, *numCloud, *numUndef;
+} mergesums;
+
+/*
+ * Shared by the threads of average_merge_files. Groups are handed out in
+ * order (next) and added to total in order (reduced), protected by lock.
+ */
+typedef struct {
+  char **files;
+  int nfiles, iw, ih, size, nchunks, next, reduced, status;
+  int skipped; /* passes without valid data, not read */
+  float cloudlim;
+  mergesums total;
+  fmsnowtimer *tm; /* only when run in the calling thread */
+  int reads;
+  double readwall, readcpu;
+  long long readbytes;
+  pthread_mutex_t lock;
+  pthread_cond_t turn;
+} mergejob;
+
+/*
+ * Reading of HDF5 files, the HDF5 library is not thread safe.
+ */
+static pthread_mutex_t mergereadlock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *mergeworker(void *arg);
+static int mergepass(osihdf *ice_h5p, char *fname, mergesums *s,
+		     float cloudlim, passextent *ex);
+static int mergepixel(mergesums *s, int elem, float Pice_val,
+		      float Pclear_val, float Pcloud_val, float cloudlim,
+		      char *fname);
+static int extentneeded(passextent *ex, int *numCloudfree,
+			unsigned char *land, int target);
+static int allocsums(mergesums *s, int size);
+static void clearsums(mergesums *s, int size);
+static void addsums(mergesums *to, mergesums *from, int size);
+static void freesums(mergesums *s);
+static double mergewall(void);
+static double mergecpu(void);
+static int mergeclassify(mergesums *s, int size, unsigned char *catclass,
+			 unsigned char *probclass, float *probice,
+			 float *probclear);
+static fmsec1970 passtime(char *fname);
+static int cmpnewest(const void *a, const void *b);
+static int cmpslots(const void *a, const void *b);
+
+/*
+ * A pass of a cube selected by cube_merge_tile.
+ */
+typedef struct {
+  fmsec1970 time;
+  int slot;
+  int newest; /* order newest first */
+} cubeslot;
 
 
 /* 
@@ -30,148 +120,470 @@
  *  'cloudlim' are thrown away. The remaining are summed, and then
  *  averaged to find a probability for snow for cloudfree case.
  *
+ *  The passes are summed in groups of MERGECHUNK passes, and the sums of
+ *  the groups are added in the order of the passes. With nthreads > 0
+ *  the groups are read and summed by nthreads threads, otherwise by the
+ *  calling thread. The result is the same whatever the number of
+ *  threads. Only one file is read at a time as HDF5 is not thread safe,
+ *  the threads read one pass while summing others.
+ *
+ *  If the extent of the valid data of a pass is written with it by
+ *  fmsnowcover (see passextent.c) only that extent is summed, and a pass
+ *  without valid data is not read. Pixels outside the extent have no
+ *  data, so the result is the same as when summing the whole tile.
+ *
+ *  The time used is added to the stages "read" and "merge" of tm,
+ *  which may be NULL. With threads, "read" is the time used by the
+ *  threads and "merge" the time of the calling thread, including the
+ *  time waiting for the threads.
  */
 
 int average_merge_files(char **infAVHRRICE, int nrInput, fmucsref safucs, 
 			unsigned char *catclass, unsigned char *probclass, 
 			float *probice, float *probclear, float cloudlim,
-			int *numCloudfree)
+			int *numCloudfree, int nthreads, fmsnowtimer *tm)
 {
 
-  char *errmsg="\n\tERROR(average_merge_files): ";
-  int i, elem, pn, status, ret, size_n;
-  unsigned int xc, yc;
-  int *numPix, *numIce, *numLand, *numCloud, *numUndef;
-  float Pice_val, Pclear_val, Pcloud_val, probsum, sumCloudfree;
-  float *sumIce, *sumClear;
-  osihdf ice_h5p;
+  int i, ret, size_n;
+  mergejob mj;
+  pthread_t *thread;
 
   /* Allocate memory */
   size_n = safucs.iw*safucs.ih;
 
-  sumIce   = (float *) malloc(size_n*sizeof(float));
-  sumClear = (float *) malloc(size_n*sizeof(float));
-  numIce   = (int *) malloc(size_n*sizeof(int));
-  numPix   = (int *) malloc(size_n*sizeof(int));
-  numLand  = (int *) malloc(size_n*sizeof(int));
-  numCloud = (int *) malloc(size_n*sizeof(int));
-  numUndef = (int *) malloc(size_n*sizeof(int));  
-
-  if (!sumIce || !sumClear || !numIce || !numPix || !numLand
-      || !numCloud || !numUndef){
+  memset(&mj,0,sizeof(mergejob));
+  if (allocsums(&mj.total,size_n)) {
      fprintf(stderr," Could not allocate memory for data field\n");
      return(3);
   }
+  free(mj.total.numCloudfree);
+  mj.total.numCloudfree = numCloudfree;
 
   /* Initialize */
-  for (i=0;i<size_n;i++)  {
-    sumIce[i]   = 0.0;
-    sumClear[i] = 0.0;
-    numIce[i]   = 0;
-    numCloudfree[i] = 0;
-    numPix[i]   = 0;
-    numLand[i]  = 0;
-    numCloud[i] = 0;
-    numUndef[i] = 0;
+  fmsnowtimer_start(tm, "merge");
+  clearsums(&mj.total,size_n);
+
+  /* Sum all sat.passes */
+  mj.files = infAVHRRICE;
+  mj.nfiles = nrInput;
+  mj.iw = safucs.iw;
+  mj.ih = safucs.ih;
+  mj.size = size_n;
+  mj.nchunks = (nrInput+MERGECHUNK-1)/MERGECHUNK;
+  mj.cloudlim = cloudlim;
+  pthread_mutex_init(&mj.lock, NULL);
+  pthread_cond_init(&mj.turn, NULL);
+
+  if (nthreads > mj.nchunks) nthreads = mj.nchunks;
+  if (nthreads > 0) {
+    thread = (pthread_t *) malloc(nthreads*sizeof(pthread_t));
+    if (!thread) {
+      fprintf(stderr," Could not allocate memory for threads\n");
+      fmsnowtimer_stop(tm, "merge");
+      mj.total.numCloudfree = NULL;
+      freesums(&mj.total);
+      return(3);
+    }
+    for (i=0;i<nthreads;i++) {
+      if (pthread_create(&thread[i], NULL, mergeworker, &mj)) {
+	fprintf(stderr," Could not start merging thread\n");
+	pthread_mutex_lock(&mj.lock);
+	mj.status = 3;
+	pthread_mutex_unlock(&mj.lock);
+	break;
+      }
+    }
+    nthreads = i;
+    for (i=0;i<nthreads;i++) {
+      pthread_join(thread[i], NULL);
+    }
+    free(thread);
+    fmsnowtimer_add(tm, "read", mj.reads, mj.readwall, mj.readcpu,
+		    mj.readbytes);
+  } else {
+    mj.tm = tm;
+    mergeworker(&mj);
   }
 
+  fmsnowtimer_count(tm, "passes.skipped", mj.skipped);
+  pthread_cond_destroy(&mj.turn);
+  pthread_mutex_destroy(&mj.lock);
+  if (mj.status) {
+    fmsnowtimer_stop(tm, "merge");
+    mj.total.numCloudfree = NULL;
+    freesums(&mj.total);
+    return(mj.status);
+  }
 
-  for (pn=0;pn<nrInput;pn++)  {      /* Loop through all sat.passes */   
-   
-    init_osihdf(&ice_h5p);
+  ret = mergeclassify(&mj.total, size_n, catclass, probclass, probice,
+		      probclear);
+
+  fmsnowtimer_stop(tm, "merge");
+
+  mj.total.numCloudfree = NULL;
+  freesums(&mj.total);
+
+  return(ret);
+}
+
+/*
+ *  Function to composite the latest cloud free observations of each
+ *  pixel. The passes are visited newest first, as given by the time in
+ *  the file names, and the pixels of a pass are added only to pixels
+ *  with less than target cloud free observations. Reading stops when
+ *  all pixels have target observations, only pixels that are land or
+ *  coast in land are considered if land is given (as the land/sea masks
+ *  of fmsnowcover, see read_land_mask). The probabilities are the
+ *  average of the observations used and classified as by
+ *  average_merge_files, target 1 gives the latest clear observation.
+ *
+ *  A pass with a valid data extent (see passextent.c) is not read if no
+ *  pixel of the extent still lacks observations, and only the extent is
+ *  summed.
+ *
+ *  The number of passes read is returned in nread. The time used is
+ *  added to the stages "read" and "merge" of tm, which may be NULL.
+ */
 
-    ret = read_hdf5_product(infAVHRRICE[pn],&ice_h5p,0); /*0:reads everything*/
+int latest_merge_files(char **infAVHRRICE, int nrInput, fmucsref safucs, 
+		       unsigned char *catclass, unsigned char *probclass, 
+		       float *probice, float *probclear, float cloudlim,
+		       int *numCloudfree, unsigned char *land, int target,
+		       int *nread, fmsnowtimer *tm)
+{
+
+  char *errmsg="\n\tERROR(latest_merge_files): ";
+  int i, pn, ret, size_n, remaining;
+  double t0;
+  char **order;
+  mergesums total, pass;
+  osihdf ice_h5p;
+  passextent ext;
+  struct stat sbuf;
+
+  *nread = 0;
+  memset(&total,0,sizeof(mergesums));
+  memset(&pass,0,sizeof(mergesums));
+  size_n = safucs.iw*safucs.ih;
+  if (target < 1) target = 1;
+
+  order = (char **) malloc(nrInput*sizeof(char *));
+  if (!order || allocsums(&total,size_n) || allocsums(&pass,size_n)) {
+    fprintf(stderr," Could not allocate memory for data field\n");
+    if (order) free(order);
+    freesums(&pass);
+    freesums(&total);
+    return(3);
+  }
+  free(total.numCloudfree);
+  total.numCloudfree = numCloudfree;
+
+  fmsnowtimer_start(tm, "merge");
+  clearsums(&total,size_n);
+  memcpy(order,infAVHRRICE,nrInput*sizeof(char *));
+  qsort(order,nrInput,sizeof(char *),cmpnewest);
+
+  remaining = 0;
+  for (i=0;i<size_n;i++) {
+    if (!land || land[i] > FMACCUSNOWSEA) remaining++;
+  }
+
+  ret = 0;
+  for (pn=0;pn<nrInput && remaining > 0;pn++) {
+
+    if (read_pass_extent(order[pn],safucs.iw,safucs.ih,&ext) == FM_OK &&
+	!extentneeded(&ext,total.numCloudfree,land,target)) {
+      free_pass_extent(&ext);
+      continue;
+    }
+
+    init_osihdf(&ice_h5p);
+    fmsnowtimer_stop(tm, "merge");
+    fmsnowtimer_start(tm, "read");
+    t0 = fmsnowtrace_now();
+    ret = read_hdf5_product(order[pn],&ice_h5p,0); /*0:reads everything*/
+    fmsnowtrace_span("read", "pass", order[pn], t0, fmsnowtrace_now());
+    if (stat(order[pn],&sbuf) == 0) {
+      fmsnowtimer_addbytes(tm, "read", (long long) sbuf.st_size);
+    }
+    fmsnowtimer_stop(tm, "read");
+    fmsnowtimer_start(tm, "merge");
+    (*nread)++;
     if (ret) {
       fprintf(stderr,
 	      "%s, Trouble encountered when reading data file %s (%d).\n", 
-	      errmsg, infAVHRRICE[pn],status);
+	      errmsg, order[pn],ret);
       fprintf(stderr,"\t Skipping file.\n");
+      free_pass_extent(&ext);
+      ret = 0;
+      continue;
+    }
+    if (ice_h5p.h.iw != safucs.iw || ice_h5p.h.ih != safucs.ih) {
+      fprintf(stderr,"%s Size of %s differs from the tile, skipping file.\n",
+	      errmsg, order[pn]);
+      free_osihdf(&ice_h5p);
+      free_pass_extent(&ext);
       continue;
     }
-      
 
-    for (yc=0;yc<ice_h5p.h.ih;yc++) {
-    for (xc=0;xc<ice_h5p.h.iw;xc++) {
+    /*
+     * The pass is summed on its own and added to the pixels still
+     * lacking observations.
+     */
+    clearsums(&pass,size_n);
+    ret = mergepass(&ice_h5p, order[pn], &pass, cloudlim,
+		    ext.first ? &ext : NULL);
+    free_pass_extent(&ext);
+    if (free_osihdf(&ice_h5p) != 0) {
+      fprintf(stderr,"%s Could not free ice_h5p properly.",errmsg);
+      ret = 3;
+    }
+    if (ret) break;
 
-      elem = fmivec(xc, yc, ice_h5p.h.iw);
+    for (i=0;i<size_n;i++) {
+      if (total.numCloudfree[i] >= target) continue;
+      total.sumIce[i]       += pass.sumIce[i];
+      total.sumClear[i]     += pass.sumClear[i];
+      total.numCloudfree[i] += pass.numCloudfree[i];
+      total.numPix[i]       += pass.numPix[i];
+      total.numCloud[i]     += pass.numCloud[i];
+      total.numUndef[i]     += pass.numUndef[i];
+      if (total.numCloudfree[i] >= target && (!land || land[i] > FMACCUSNOWSEA)) {
+	remaining--;
+      }
+    }
+  }
 
-      Pice_val   = ((float *) ice_h5p.d[0].data)[elem];
-      Pclear_val = ((float *) ice_h5p.d[1].data)[elem];
-      Pcloud_val = ((float *) ice_h5p.d[2].data)[elem];
+  if (!ret) {
+    ret = mergeclassify(&total, size_n, catclass, probclass, probice,
+			probclear);
+  }
 
+  fmsnowtimer_stop(tm, "merge");
 
-      /*1) check that pixel has prob.value */
-      if ( (Pcloud_val>=MINPROBAVHRR) && (Pcloud_val<=MAXPROBAVHRR) && (Pclear_val>=MINPROBAVHRR) && (Pclear_val<=MAXPROBAVHRR) && (Pice_val>=MINPROBAVHRR) && (Pice_val<=MAXPROBAVHRR) ){
-	
-	/*2) check that prob.values sum to ~1*/
-	probsum = Pcloud_val + Pclear_val + Pice_val;
-	if (probsum > 1.05 || probsum < 0.95) { 
-	/*this should never be true due to similar check in avhrrice_pap!*/
-	/* printf("P(ice): %f, P(clear): %f, P(cloud): %f\n",
-	   Pice_val, Pclear_val, Pcloud_val); 
-	  fprintf(stderr,"The probability does not add up to 1 (%f),",probsum);
-	  fprintf(stderr," check input file %s\n", infAVHRRICE[pn]);*/
-	  continue;
-	}
+  free(order);
+  freesums(&pass);
+  total.numCloudfree = NULL;
+  freesums(&total);
 
-	/*3) check cloud probability -> if too high, throw away pixel*/
-	if (Pcloud_val >= cloudlim) {
-	  numCloud[elem] ++;
-	  numPix[elem] ++;
-	  continue;
-	}
-	
-	/*4) compute a prob based on the ratio between clear and ice/snow*/
-	else { 
- 	  sumCloudfree = Pclear_val + Pice_val;
-	  if (sumCloudfree <= MINPROBAVHRR) {
-	    /* will not happen unless cloudlim > 0.95 (still unlikely)*/
-	    fprintf(stderr,"Not nice to divide by zero, check cloudlim!\n");
-	    return(8); /*random return value used.. */
-	  }
-	  numCloudfree[elem] ++; 
-	  numPix[elem] ++;
-	  sumIce[elem] += Pice_val/sumCloudfree;
-	  sumClear[elem] += Pclear_val/sumCloudfree;
-	}
+  return(ret);
+}
+
+/*
+ *  Function to merge the passes of a cube (see snowcube.c) from stime
+ *  to etime, of the satellites sats if nsats > 0. With target 0 all
+ *  passes are averaged as by average_merge_files, otherwise the latest
+ *  target cloud free observations are composited as by
+ *  latest_merge_files. The values are those of the passes within the
+ *  precision of the cube.
+ *
+ *  The cube is read in blocks of FMSNOWCUBE_SCHUNK x FMSNOWCUBE_SCHUNK
+ *  pixels, all passes of a block in one read. With target > 0 blocks
+ *  without pixels lacking observations (e.g. sea if land is given) are
+ *  not read. The number of passes merged is returned in npass. The
+ *  time used is added to the stages "read" and "merge" of tm, which
+ *  may be NULL.
+ */
+
+int cube_merge_tile(fmsnowcube *cb, fmsec1970 stime, fmsec1970 etime,
+		    char **sats, int nsats, unsigned char *catclass,
+		    unsigned char *probclass, float *probice,
+		    float *probclear, float cloudlim, int *numCloudfree,
+		    unsigned char *land, int target, int *npass,
+		    fmsnowtimer *tm)
+{
+
+  char *errmsg="\n\tERROR(cube_merge_tile): ";
+  int i, j, k, n, p, ret, size_n, slot0, slot1, nslots;
+  int row0, col0, row, col, w, h, bsize, off, elem, remaining;
+  double t0;
+  unsigned char *buf[FMSNOWCUBE_LEVELS];
+  float *value = cb->value;
+  cubeslot *sel;
+  mergesums total;
+
+  *npass = 0;
+  memset(&total,0,sizeof(mergesums));
+  memset(buf,0,sizeof(buf));
+  size_n = cb->ref.iw*cb->ref.ih;
+
+  /*
+   * Passes of the period and satellites, oldest or newest first.
+   */
+  sel = (cubeslot *) malloc((cb->nslots+1)*sizeof(cubeslot));
+  if (!sel || allocsums(&total,size_n)) {
+    fprintf(stderr," Could not allocate memory for data field\n");
+    if (sel) free(sel);
+    freesums(&total);
+    return(3);
+  }
+  free(total.numCloudfree);
+  total.numCloudfree = numCloudfree;
+
+  fmsnowtimer_start(tm, "merge");
+  clearsums(&total,size_n);
+  n = 0;
+  slot0 = cb->nslots;
+  slot1 = -1;
+  for (i=0;i<cb->nslots;i++) {
+    if (cb->pass[i].time == 0 || cb->pass[i].time < stime ||
+	cb->pass[i].time > etime) continue;
+    if (nsats > 0) {
+      for (j=0;j<nsats && !strstr(cb->pass[i].satellite,sats[j]);j++);
+      if (j == nsats) continue;
+    }
+    sel[n].time = cb->pass[i].time;
+    sel[n].slot = i;
+    sel[n].newest = (target > 0);
+    if (i < slot0) slot0 = i;
+    if (i > slot1) slot1 = i;
+    n++;
+  }
+  qsort(sel,n,sizeof(cubeslot),cmpslots);
+  nslots = slot1-slot0+1;
+
+  ret = 0;
+  if (n > 0) {
+    bsize = FMSNOWCUBE_SCHUNK*FMSNOWCUBE_SCHUNK;
+    for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+      buf[k] = (unsigned char *) malloc(nslots*bsize*sizeof(char));
+      if (!buf[k]) {
+	fprintf(stderr," Could not allocate memory for data field\n");
+	ret = 3;
       }
+    }
+  }
 
-      /* if NOT prob.value for this pixel: */
-      else if (Pice_val == FMACCUSNOWMISVAL_NOCOV || Pice_val == FMACCUSNOWMISVAL_NIGHT || Pice_val == FMACCUSNOWMISVAL_3A){ /* Undefined*/
-	if (Pcloud_val != Pice_val || Pclear_val != Pice_val) {
-	  /*not supposed to happen, check avhrrice_pap routines!*/
-	  fprintf(stderr,
-		  "Strange values encountered for pixel %d in file %s\n",
-		  elem,infAVHRRICE[pn]);
-	  fprintf(stderr,"(P(ice) = %f, P(clear) = %f, P(cloud) = %f)\n",
-		  Pice_val,Pclear_val,Pcloud_val);
-	  continue;
+  for (row0=0;n>0 && ret==0 && row0<cb->ref.ih;row0+=FMSNOWCUBE_SCHUNK) {
+    for (col0=0;ret==0 && col0<cb->ref.iw;col0+=FMSNOWCUBE_SCHUNK) {
+      w = cb->ref.iw-col0;
+      if (w > FMSNOWCUBE_SCHUNK) w = FMSNOWCUBE_SCHUNK;
+      h = cb->ref.ih-row0;
+      if (h > FMSNOWCUBE_SCHUNK) h = FMSNOWCUBE_SCHUNK;
+
+      remaining = 0;
+      for (row=row0;target>0 && row<row0+h;row++) {
+	for (col=col0;col<col0+w;col++) {
+	  elem = fmivec(col, row, cb->ref.iw);
+	  if (!land || land[elem] > FMACCUSNOWSEA) remaining++;
 	}
-	numUndef[elem] ++;	 
-	numPix[elem] ++; 
       }
-      
-      else { /*also not supposed to happen, check avhrrice_pap/input files*/
-	/*fprintf(stderr,"Invalid pixel values encountered in file %s\n",
-		infAVHRRICE[pn]);
-	fprintf(stderr,"\tP(ice) = %f, P(clear) = %f, P(cloud) = %f\n",
-	Pice_val,Pclear_val,Pcloud_val);*/
-	continue;
+      if (target > 0 && remaining == 0) continue;
+
+      fmsnowtimer_stop(tm, "merge");
+      fmsnowtimer_start(tm, "read");
+      t0 = fmsnowtrace_now();
+      ret = fmsnowcube_read(cb, slot0, nslots, col0, row0, w, h, buf);
+      fmsnowtrace_span("read", "cube", cb->fname, t0, fmsnowtrace_now());
+      fmsnowtimer_addbytes(tm, "read",
+			   (long long) FMSNOWCUBE_LEVELS*nslots*w*h);
+      fmsnowtimer_stop(tm, "read");
+      fmsnowtimer_start(tm, "merge");
+      if (ret) {
+	fprintf(stderr,"%s Could not read %s.\n", errmsg, cb->fname);
+	ret = 3;
+	break;
+      }
+
+      for (p=0;p<n && ret==0 && (target==0 || remaining>0);p++) {
+	off = (sel[p].slot-slot0)*w*h;
+	for (row=0;ret==0 && row<h;row++) {
+	  for (col=0;col<w;col++) {
+	    elem = fmivec(col0+col, row0+row, cb->ref.iw);
+	    if (target > 0 && numCloudfree[elem] >= target) continue;
+	    i = off+row*w+col;
+	    ret = mergepixel(&total, elem, value[buf[0][i]],
+			     value[buf[1][i]], value[buf[2][i]], cloudlim,
+			     cb->fname);
+	    if (ret) break;
+	    if (target > 0 && numCloudfree[elem] >= target &&
+		(!land || land[elem] > FMACCUSNOWSEA)) {
+	      remaining--;
+	    }
+	  }
+	}
       }
-   
-    }
-    } /*finished looping through all pixels for current sat.pass*/
- 
-    
-    if (free_osihdf(&ice_h5p) != 0) {
-      fprintf(stderr,"%s Could not free ice_h5p properly.",errmsg);
-      return(3);
     }
+  }
+
+  if (!ret) {
+    ret = mergeclassify(&total, size_n, catclass, probclass, probice,
+			probclear);
+    *npass = n;
+  }
+
+  fmsnowtimer_stop(tm, "merge");
 
-  } /*finished looping through all sat.passes*/
+  for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+    if (buf[k]) free(buf[k]);
+  }
+  free(sel);
+  total.numCloudfree = NULL;
+  freesums(&total);
+
+  return(ret);
+}
 
+/*
+ *  Function to read the land/sea mask of fmsnowcover for a tile,
+ *  physiography.dn<area>.hdf5 in lmdir. The mask is returned in land
+ *  (allocated), or NULL if it is not available or does not match the
+ *  tile.
+ */
+
+int read_land_mask(char *lmdir, char *area, fmucsref safucs,
+		   unsigned char **land)
+{
+
+  char *where="read_land_mask";
+  char lmaskf[FILELEN];
+  int size_n, ret;
+  double t0;
+  osihdf lm;
+
+  *land = NULL;
+  snprintf(lmaskf,FILELEN,"%s/physiography.dn%s.hdf5",lmdir,area);
+  init_osihdf(&lm);
+  t0 = fmsnowtrace_now();
+  ret = read_hdf5_product(lmaskf,&lm,0);
+  fmsnowtrace_span("read", "landmask", lmaskf, t0, fmsnowtrace_now());
+  if (ret) {
+    fmerrmsg(where,"Could not read land/sea mask %s", lmaskf);
+    return(FM_IO_ERR);
+  }
+  if (lm.h.iw != safucs.iw || lm.h.ih != safucs.ih ||
+      ((int) floorf(lm.h.Bx*10.)) != ((int) floorf(safucs.Bx*10.)) ||
+      ((int) floorf(lm.h.By*10.)) != ((int) floorf(safucs.By*10.)) ||
+      lm.h.z < 1) {
+    fmerrmsg(where,"Land/sea mask %s does not match the tile", lmaskf);
+    free_osihdf(&lm);
+    return(FM_IO_ERR);
+  }
+  size_n = safucs.iw*safucs.ih;
+  *land = (unsigned char *) malloc(size_n);
+  if (!*land) {
+    free_osihdf(&lm);
+    return(FM_MEMALL_ERR);
+  }
+  memcpy(*land,lm.d[0].data,size_n);
+  free_osihdf(&lm);
+
+  return(FM_OK);
+}
+
+/*
+ * Loop through grid and calculate average probabilities of the sums.
+ */
+static int mergeclassify(mergesums *s, int size_n, unsigned char *catclass,
+			 unsigned char *probclass, float *probice,
+			 float *probclear)
+{
+
+  int elem;
+  int *numCloudfree = s->numCloudfree, *numPix = s->numPix;
+  int *numCloud = s->numCloud, *numUndef = s->numUndef;
+  float *sumIce = s->sumIce, *sumClear = s->sumClear;
 
-  /* Loop through grid and calculate average probabilities */
   for (elem=0;elem<size_n;elem++) {
 
     /* First control that things add up*/
@@ -257,18 +669,373 @@ int average_merge_files(char **infAVHRRICE, int nrInput, fmucsref safucs,
     
   }
 
+  return(0);
+}
+
+/*
+ * Time of a pass from the file name, fmsnow_<tile>_<yyyymmddhhmm>, 0
+ * if not found.
+ */
+static fmsec1970 passtime(char *fname)
+{
+
+  char *base, datestr[15];
+
+  base = strrchr(fname,'/');
+  base = base ? base+1 : fname;
+  if (strlen(base) < MINLENFNAME) return(0);
+  snprintf(datestr,15,"%.12s00",base+10);
+
+  return(ymdhms2fmsec1970(datestr,0));
+}
+
+static int cmpnewest(const void *a, const void *b)
+{
+
+  fmsec1970 ta = passtime(*(char **) a), tb = passtime(*(char **) b);
+
+  if (ta != tb) return((ta > tb) ? -1 : 1);
+
+  return(strcmp(*(char **) a, *(char **) b));
+}
+
+/*
+ * Order the passes of a cube in time, oldest or newest first, passes of
+ * the same time by slot.
+ */
+static int cmpslots(const void *a, const void *b)
+{
+
+  cubeslot *sa = (cubeslot *) a, *sb = (cubeslot *) b;
+
+  if (sa->time != sb->time) {
+    if (sa->newest) return((sa->time > sb->time) ? -1 : 1);
+    return((sa->time < sb->time) ? -1 : 1);
+  }
+
+  return(sa->slot-sb->slot);
+}
+
+/*
+ * Take groups of passes in order, sum each group into private sums and
+ * add these to the total when all earlier groups are added.
+ */
+static void *mergeworker(void *arg)
+{
+
+  char *errmsg="\n\tERROR(average_merge_files): ";
+  mergejob *mj = (mergejob *) arg;
+  mergesums part;
+  osihdf ice_h5p;
+  passextent ext;
+  struct stat sbuf;
+  int c, pn, ret, status;
+  double wall0, cpu0, t0;
+
+  if (!mj->tm) fmsnowtrace_thread("merge");
+  if (allocsums(&part,mj->size)) {
+    fprintf(stderr," Could not allocate memory for data field\n");
+    pthread_mutex_lock(&mj->lock);
+    if (!mj->status) mj->status = 3;
+    pthread_mutex_unlock(&mj->lock);
+    return(NULL);
+  }
+
+  pthread_mutex_lock(&mj->lock);
+  while (!mj->status && mj->next < mj->nchunks) {
+    c = mj->next++;
+    pthread_mutex_unlock(&mj->lock);
 
-  free(sumIce);
-  free(sumClear);
-  free(numIce);
-  free(numPix);
-  free(numLand);
-  free(numCloud);
-  free(numUndef);
+    clearsums(&part,mj->size);
+    status = 0;
+    for (pn=c*MERGECHUNK;pn<(c+1)*MERGECHUNK && pn<mj->nfiles;pn++) {
+
+      if (read_pass_extent(mj->files[pn],mj->iw,mj->ih,&ext) == FM_OK &&
+	  ext.nrows == 0) {
+	free_pass_extent(&ext);
+	pthread_mutex_lock(&mj->lock);
+	mj->skipped++;
+	pthread_mutex_unlock(&mj->lock);
+	continue;
+      }
+
+      init_osihdf(&ice_h5p);
+
+      if (mj->tm) {
+	fmsnowtimer_stop(mj->tm, "merge");
+	fmsnowtimer_start(mj->tm, "read");
+      }
+      wall0 = mergewall();
+      cpu0 = mergecpu();
+      t0 = fmsnowtrace_now();
+      pthread_mutex_lock(&mergereadlock);
+      fmsnowtrace_span("wait", "hdf5lock", NULL, t0, fmsnowtrace_now());
+      t0 = fmsnowtrace_now();
+      ret = read_hdf5_product(mj->files[pn],&ice_h5p,0); /*0:reads everything*/
+      fmsnowtrace_span("read", "pass", mj->files[pn], t0, fmsnowtrace_now());
+      pthread_mutex_unlock(&mergereadlock);
+      if (stat(mj->files[pn],&sbuf) != 0) sbuf.st_size = 0;
+      if (mj->tm) {
+	fmsnowtimer_addbytes(mj->tm, "read", (long long) sbuf.st_size);
+	fmsnowtimer_stop(mj->tm, "read");
+	fmsnowtimer_start(mj->tm, "merge");
+      } else {
+	pthread_mutex_lock(&mj->lock);
+	mj->reads++;
+	mj->readwall += mergewall()-wall0;
+	mj->readcpu += mergecpu()-cpu0;
+	mj->readbytes += (long long) sbuf.st_size;
+	pthread_mutex_unlock(&mj->lock);
+      }
+      if (ret) {
+	fprintf(stderr,
+		"%s, Trouble encountered when reading data file %s (%d).\n", 
+		errmsg, mj->files[pn],ret);
+	fprintf(stderr,"\t Skipping file.\n");
+	free_pass_extent(&ext);
+	continue;
+      }
+
+      t0 = fmsnowtrace_now();
+      status = mergepass(&ice_h5p, mj->files[pn], &part, mj->cloudlim,
+			 ext.first ? &ext : NULL);
+      fmsnowtrace_span("merge", "pass", mj->files[pn], t0, fmsnowtrace_now());
+      free_pass_extent(&ext);
+
+      if (free_osihdf(&ice_h5p) != 0) {
+	fprintf(stderr,"%s Could not free ice_h5p properly.",errmsg);
+	status = 3;
+      }
+      if (status) break;
+    }
+
+    t0 = fmsnowtrace_now();
+    pthread_mutex_lock(&mj->lock);
+    while (mj->reduced != c) {
+      pthread_cond_wait(&mj->turn, &mj->lock);
+    }
+    fmsnowtrace_span("wait", "reduce", NULL, t0, fmsnowtrace_now());
+    if (status && !mj->status) mj->status = status;
+    if (!mj->status) addsums(&mj->total,&part,mj->size);
+    mj->reduced++;
+    pthread_cond_broadcast(&mj->turn);
+  }
+  pthread_mutex_unlock(&mj->lock);
+
+  freesums(&part);
+
+  return(NULL);
+}
+
+/*
+ * Add the pixels of one sat.pass to the sums s, only those of the extent
+ * ex if given and of the size of the pass.
+ */
+static int mergepass(osihdf *ice_h5p, char *fname, mergesums *s,
+		     float cloudlim, passextent *ex)
+{
+
+  int elem, xfirst, xlast;
+  unsigned int xc, yc;
+
+  if (ex && (ex->iw != ice_h5p->h.iw || ex->ih != ice_h5p->h.ih)) ex = NULL;
+
+    for (yc=0;yc<ice_h5p->h.ih;yc++) {
+    xfirst = ex ? ex->first[yc] : 0;
+    xlast = ex ? ex->last[yc] : (int) ice_h5p->h.iw-1;
+    for (xc=xfirst;(int) xc<=xlast;xc++) {
+
+      elem = fmivec(xc, yc, ice_h5p->h.iw);
+
+      if (mergepixel(s, elem, ((float *) ice_h5p->d[0].data)[elem],
+		     ((float *) ice_h5p->d[1].data)[elem],
+		     ((float *) ice_h5p->d[2].data)[elem], cloudlim, fname)) {
+	return(8);
+      }
+   
+    }
+    } /*finished looping through all pixels for current sat.pass*/
 
   return(0);
 }
 
+/*
+ * Add pixel elem of one sat.pass to the sums s.
+ */
+static int mergepixel(mergesums *s, int elem, float Pice_val,
+		      float Pclear_val, float Pcloud_val, float cloudlim,
+		      char *fname)
+{
+
+  float probsum, sumCloudfree;
+
+      /*1) check that pixel has prob.value */
+      if ( (Pcloud_val>=MINPROBAVHRR) && (Pcloud_val<=MAXPROBAVHRR) && (Pclear_val>=MINPROBAVHRR) && (Pclear_val<=MAXPROBAVHRR) && (Pice_val>=MINPROBAVHRR) && (Pice_val<=MAXPROBAVHRR) ){
+	
+	/*2) check that prob.values sum to ~1*/
+	probsum = Pcloud_val + Pclear_val + Pice_val;
+	if (probsum > 1.05 || probsum < 0.95) { 
+	/*this should never be true due to similar check in avhrrice_pap!*/
+	/* printf("P(ice): %f, P(clear): %f, P(cloud): %f\n",
+	   Pice_val, Pclear_val, Pcloud_val); 
+	  fprintf(stderr,"The probability does not add up to 1 (%f),",probsum);
+	  fprintf(stderr," check input file %s\n", fname);*/
+	  return(0);
+	}
+
+	/*3) check cloud probability -> if too high, throw away pixel*/
+	if (Pcloud_val >= cloudlim) {
+	  s->numCloud[elem] ++;
+	  s->numPix[elem] ++;
+	  return(0);
+	}
+	
+	/*4) compute a prob based on the ratio between clear and ice/snow*/
+	else { 
+ 	  sumCloudfree = Pclear_val + Pice_val;
+	  if (sumCloudfree <= MINPROBAVHRR) {
+	    /* will not happen unless cloudlim > 0.95 (still unlikely)*/
+	    fprintf(stderr,"Not nice to divide by zero, check cloudlim!\n");
+	    return(8); /*random return value used.. */
+	  }
+	  s->numCloudfree[elem] ++; 
+	  s->numPix[elem] ++;
+	  s->sumIce[elem] += Pice_val/sumCloudfree;
+	  s->sumClear[elem] += Pclear_val/sumCloudfree;
+	}
+      }
+
+      /* if NOT prob.value for this pixel: */
+      else if (Pice_val == FMACCUSNOWMISVAL_NOCOV || Pice_val == FMACCUSNOWMISVAL_NIGHT || Pice_val == FMACCUSNOWMISVAL_3A ||
+	       Pice_val == FMACCUSNOWMISVAL_SEA){ /* Undefined*/
+	if (Pcloud_val != Pice_val || Pclear_val != Pice_val) {
+	  /*not supposed to happen, check avhrrice_pap routines!*/
+	  fprintf(stderr,
+		  "Strange values encountered for pixel %d in file %s\n",
+		  elem,fname);
+	  fprintf(stderr,"(P(ice) = %f, P(clear) = %f, P(cloud) = %f)\n",
+		  Pice_val,Pclear_val,Pcloud_val);
+	  return(0);
+	}
+	s->numUndef[elem] ++;	 
+	s->numPix[elem] ++; 
+      }
+      
+      else { /*also not supposed to happen, check avhrrice_pap/input files*/
+	/*fprintf(stderr,"Invalid pixel values encountered in file %s\n",
+		fname);
+	fprintf(stderr,"\tP(ice) = %f, P(clear) = %f, P(cloud) = %f\n",
+	Pice_val,Pclear_val,Pcloud_val);*/
+	return(0);
+      }
+
+  return(0);
+}
+
+/*
+ * Whether any pixel of the extent ex lacks target cloud free
+ * observations, only land pixels are considered if land is given.
+ */
+static int extentneeded(passextent *ex, int *numCloudfree,
+			unsigned char *land, int target)
+{
+
+  int row, col, elem;
+
+  for (row=0;row<ex->ih;row++) {
+    for (col=ex->first[row];col<=ex->last[row];col++) {
+      elem = fmivec(col, row, ex->iw);
+      if (numCloudfree[elem] < target &&
+	  (!land || land[elem] > FMACCUSNOWSEA)) {
+	return(1);
+      }
+    }
+  }
+
+  return(0);
+}
+
+static int allocsums(mergesums *s, int size)
+{
+
+  s->sumIce       = (float *) malloc(size*sizeof(float));
+  s->sumClear     = (float *) malloc(size*sizeof(float));
+  s->numCloudfree = (int *) malloc(size*sizeof(int));
+  s->numPix       = (int *) malloc(size*sizeof(int));
+  s->numCloud     = (int *) malloc(size*sizeof(int));
+  s->numUndef     = (int *) malloc(size*sizeof(int));
+
+  if (!s->sumIce || !s->sumClear || !s->numCloudfree || !s->numPix
+      || !s->numCloud || !s->numUndef) {
+    freesums(s);
+    return(3);
+  }
+
+  return(0);
+}
+
+static void clearsums(mergesums *s, int size)
+{
+
+  int i;
+
+  for (i=0;i<size;i++) {
+    s->sumIce[i]       = 0.0;
+    s->sumClear[i]     = 0.0;
+    s->numCloudfree[i] = 0;
+    s->numPix[i]       = 0;
+    s->numCloud[i]     = 0;
+    s->numUndef[i]     = 0;
+  }
+}
+
+static void addsums(mergesums *to, mergesums *from, int size)
+{
+
+  int i;
+
+  for (i=0;i<size;i++) {
+    to->sumIce[i]       += from->sumIce[i];
+    to->sumClear[i]     += from->sumClear[i];
+    to->numCloudfree[i] += from->numCloudfree[i];
+    to->numPix[i]       += from->numPix[i];
+    to->numCloud[i]     += from->numCloud[i];
+    to->numUndef[i]     += from->numUndef[i];
+  }
+}
+
+static void freesums(mergesums *s)
+{
+
+  if (s->sumIce) free(s->sumIce);
+  if (s->sumClear) free(s->sumClear);
+  if (s->numCloudfree) free(s->numCloudfree);
+  if (s->numPix) free(s->numPix);
+  if (s->numCloud) free(s->numCloud);
+  if (s->numUndef) free(s->numUndef);
+  memset(s,0,sizeof(mergesums));
+}
+
+static double mergewall(void)
+{
+
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return(tv.tv_sec+1.e-6*tv.tv_usec);
+}
+
+static double mergecpu(void)
+{
+
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) return(0.);
+
+  return(ts.tv_sec+1.e-9*ts.tv_nsec);
+}
+
 
 
 /*
@@ -0,0 +1,343 @@
+/*
+ * NAME:
+ * fmsnowbench
+ *
+ * PURPOSE:
+ * Microbenchmarks for the kernels used in the pixel loop of
+ * process_pixels4ice. Each kernel is run on synthetic pixels and the
+ * time used is reported as ns/pixel and pixels/s.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Statistical coefficients (e.g. etc/statcoeffs_4surfs.txt), the
+ *   synthetic features of each class are drawn from these pdfs.
+ * o Optionally a MITIFF file, the calibration of this file is used for
+ *   the calibration benchmark. Without it that benchmark is skipped.
+ *
+ * OUTPUT:
+ * One line per kernel, regime (sea/land/coast) and channel mode (3A/3B)
+ * on stdout.
+ *
+ * NOTES:
+ * Kernels benchmarked:
+ * o probest - the full Bayes estimate of a pixel
+ * o findprob - the pdfs of all classes and features of a pixel
+ *   evaluated one by one as before the coefficient tables
+ * o normalpdf/gammapdf - single pdf evaluations
+ * o calibration - fm_byte2float of the 6 channels of a pixel
+ * o solar zenith - geolocation and solar zenith angle of a pixel
+ * o class binning - pice2class and probs2cat of a pixel
+ *
+ * Pixels are made by synthpixels, drawing a class (weighted by its
+ * prior) among the classes used in the regime, and then each feature
+ * from the pdf of that class. The same seed is used each time, to
+ * compare results of different builds on the same machine.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define BENCH_NPIXELS 200000
+#define BENCH_REPEAT 5
+
+static volatile double benchsink;
+
+static double wallclock(void);
+static void report(char *kernel, char *regime, char *mode, double secs,
+	long npix);
+static void benchusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowbench";
+    extern char *optarg;
+    char *coffile = "../etc/statcoeffs_4surfs.txt";
+    char *imgfile = NULL;
+    char *regname[FMSNOWREGIMES] = {"sea","land","coast"};
+    char *modename[FMSNOWMODES] = {"3A","3B"};
+    short lmaskval[FMSNOWREGIMES] = {FMSNOWSEA,255,100};
+    int ret, npix = BENCH_NPIXELS, nrep = BENCH_REPEAT;
+    int i, j, k, r, reg, mode;
+    double t0, sum;
+    pinpstr *pix;
+    probstr *p;
+    unsigned char *bytes, cl;
+    float *pdfx;
+    fmio_img img;
+    fmscale calib;
+    fmucsref ucs0;
+    fmindex cart;
+    fmucspos ucspos;
+    fmgeopos geop;
+    fmtime timeid;
+    fmsec1970 timeidsec, tst;
+    statcoeffstr coeffs;
+
+    while ((ret = getopt(argc, argv, "c:i:n:r:")) != EOF) {
+	switch (ret) {
+	    case 'c':
+		coffile = optarg;
+		break;
+	    case 'i':
+		imgfile = optarg;
+		break;
+	    case 'n':
+		npix = atoi(optarg);
+		break;
+	    case 'r':
+		nrep = atoi(optarg);
+		break;
+	    default:
+		benchusage();
+	}
+    }
+    if (npix < 1 || nrep < 1) benchusage();
+
+    initstatcoeffs(&coeffs);
+    if (rdstatcoeffs(coffile,&coeffs) == FM_IO_ERR ||
+	    buildstatcoeffs(&coeffs)) {
+	fmerrmsg(where,"Could not use statistical coefficients in %s",
+		coffile);
+	exit(FM_IO_ERR);
+    }
+
+    pix = (pinpstr *) malloc(npix*sizeof(pinpstr));
+    p = (probstr *) malloc(npix*sizeof(probstr));
+    bytes = (unsigned char *) malloc(MAXCHANNELS*npix);
+    pdfx = (float *) malloc(npix*sizeof(float));
+    if (!pix || !p || !bytes || !pdfx) {
+	fmerrmsg(where,"Could not allocate memory for %d pixels",npix);
+	exit(FM_MEMALL_ERR);
+    }
+
+    fprintf(stdout,"# coefficients: %s\n",coffile);
+    fprintf(stdout,"# pixels: %d repeats: %d\n",npix,nrep);
+    fprintf(stdout,"%-14s %-6s %-4s %12s %14s\n",
+	    "# kernel","regime","mode","ns/pixel","pixels/s");
+
+    /*
+     * The kernels depending on the surface regime and channel mode.
+     */
+    for (reg=0;reg<FMSNOWREGIMES;reg++) {
+	for (mode=0;mode<FMSNOWMODES;mode++) {
+	    for (i=0;i<npix;i++) {
+		pix[i].lmask = lmaskval[reg];
+		pix[i].soz = -1.;
+	    }
+	    if (synthpixels(&coeffs, reg, mode, pix, npix)) {
+		fmlogmsg(where,"No classes for %s %s, skipping",
+			regname[reg],modename[mode]);
+		continue;
+	    }
+
+	    t0 = wallclock();
+	    for (r=0;r<nrep;r++) {
+		for (i=0;i<npix;i++) {
+		    probest(pix[i], &p[i], &coeffs);
+		}
+	    }
+	    report("probest",regname[reg],modename[mode],
+		    wallclock()-t0,(long) npix*nrep);
+
+	    /*
+	     * All pdfs of the pixel evaluated by findprob, features
+	     * estimated as in probest.
+	     */
+	    t0 = wallclock();
+	    for (r=0;r<nrep;r++) {
+		for (i=0;i<npix;i++) {
+		    double x, a1;
+		    short id;
+		    a1 = pix[i].A1/cos(fmdeg2rad(pix[i].soz));
+		    for (k=0;k<coeffs.nuse[mode];k++) {
+			id = coeffs.feat[coeffs.use[mode][k]].id;
+			switch (id) {
+			    case FMSNOWFEAT_A1: x = a1; break;
+			    case FMSNOWFEAT_R21: x = pix[i].A2/pix[i].A1; break;
+			    case FMSNOWFEAT_R3A1: x = pix[i].A3/pix[i].A1; break;
+			    case FMSNOWFEAT_R3B1: x = pix[i].A3b/a1; break;
+			    case FMSNOWFEAT_DT: x = pix[i].tdiff; break;
+			    default: x = pix[i].T4-pix[i].T5;
+			}
+			for (j=0;j<coeffs.nact[reg];j++) {
+			    benchsink = findprob(
+				&coeffs.par[coeffs.act[reg][j]][coeffs.use[mode][k]],
+				x, where);
+			}
+		    }
+		}
+	    }
+	    report("findprob",regname[reg],modename[mode],
+		    wallclock()-t0,(long) npix*nrep);
+
+	    t0 = wallclock();
+	    for (r=0;r<nrep;r++) {
+		for (i=0;i<npix;i++) {
+		    cl = pice2class(p[i].pice);
+		    cl += probs2cat(&p[i]);
+		    benchsink = cl;
+		}
+	    }
+	    report("classbin",regname[reg],modename[mode],
+		    wallclock()-t0,(long) npix*nrep);
+	}
+    }
+
+    /*
+     * The pdfs, one evaluation per pixel.
+     */
+    for (i=0;i<npix;i++) {
+	pdfx[i] = synthgamma(2.,3.);
+    }
+    t0 = wallclock();
+    sum = 0.;
+    for (r=0;r<nrep;r++) {
+	for (i=0;i<npix;i++) {
+	    sum += normalpdf(5.,3.,pdfx[i]);
+	}
+    }
+    benchsink = sum;
+    report("normalpdf","all","-",wallclock()-t0,(long) npix*nrep);
+
+    t0 = wallclock();
+    sum = 0.;
+    for (r=0;r<nrep;r++) {
+	for (i=0;i<npix;i++) {
+	    sum += gammapdf(2.,3.,pdfx[i]);
+	}
+    }
+    benchsink = sum;
+    report("gammapdf","all","-",wallclock()-t0,(long) npix*nrep);
+
+    /*
+     * Calibration of the 6 channels as done in process_pixels4ice. The
+     * slopes are those of a real image, without -i the kernel is skipped.
+     */
+    if (imgfile) {
+	fm_init_fmio_img(&img);
+	if (fm_readheader(imgfile, &img)) {
+	    fmerrmsg(where,"Could not read header of %s", imgfile);
+	    exit(FM_IO_ERR);
+	}
+	fm_img2slopes(img,&calib);
+	for (i=0;i<MAXCHANNELS*npix;i++) {
+	    bytes[i] = (unsigned char) (synthuniform()*256.);
+	}
+	t0 = wallclock();
+	sum = 0.;
+	for (r=0;r<nrep;r++) {
+	    for (i=0;i<npix;i++) {
+		k = MAXCHANNELS*i;
+		sum += fm_byte2float(bytes[k], calib, "Reflectance");
+		sum += fm_byte2float(bytes[k+1], calib, "Reflectance");
+		sum += fm_byte2float(bytes[k+5], calib, "Reflectance");
+		sum += fm_byte2float(bytes[k+2], calib, "Temperature");
+		sum += fm_byte2float(bytes[k+3], calib, "Temperature");
+		sum += fm_byte2float(bytes[k+4], calib, "Temperature");
+	    }
+	}
+	benchsink = sum;
+	report("calibration","all","-",wallclock()-t0,(long) npix*nrep);
+    } else {
+	fprintf(stdout,"# calibration skipped, no image given (-i)\n");
+    }
+
+    /*
+     * Solar zenith angle, pixels run through a 1200x1200 tile of 1.5 km
+     * (the ns tile) at noon 21 March.
+     */
+    ucs0.Ax = 1.5;
+    ucs0.Ay = 1.5;
+    ucs0.Bx = -335.;
+    ucs0.By = -2540.;
+    ucs0.iw = 1200;
+    ucs0.ih = 1200;
+    timeid.fm_year = 2010;
+    timeid.fm_mon = 3;
+    timeid.fm_mday = 21;
+    timeid.fm_hour = 12;
+    timeid.fm_min = 0;
+    timeid.fm_sec = 0;
+    timeidsec = tofmsec1970(timeid);
+    t0 = wallclock();
+    sum = 0.;
+    for (r=0;r<nrep;r++) {
+	for (i=0;i<npix;i++) {
+	    k = i%(ucs0.iw*ucs0.ih);
+	    cart.row = k/ucs0.iw;
+	    cart.col = k%ucs0.iw;
+	    ucspos = fmind2ucs(ucs0, cart);
+	    geop = fmucs2geo(ucspos,MI);
+	    tst = fmutc2tst(timeidsec, geop.lon);
+	    sum += fmsolarzenith(tst, geop);
+	}
+    }
+    benchsink = sum;
+    report("solarzenith","all","-",wallclock()-t0,(long) npix*nrep);
+
+    free(pix);
+    free(p);
+    free(bytes);
+    free(pdfx);
+
+    exit(FM_OK);
+}
+
+/*
+ * NAME:
+ * wallclock
+ *
+ * PURPOSE:
+ * Returns wall clock time in seconds.
+ */
+static double wallclock(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return(tv.tv_sec+1.e-6*tv.tv_usec);
+}
+
+static void report(char *kernel, char *regime, char *mode, double secs,
+	long npix) {
+
+    fprintf(stdout,"%-14s %-6s %-4s %12.1f %14.0f\n",
+	    kernel, regime, mode, 1.e9*secs/npix,
+	    (secs > 0.) ? npix/secs : 0.);
+}
+
+static void benchusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " fmsnowbench [-c <coeffile>] [-i <mitiff>] [-n <pixels>] [-r <repeats>]\n\n");
+    fprintf(stdout,
+	    " <coeffile>: Statistical coefficients used to draw pixels.\n");
+    fprintf(stdout,
+	    " <mitiff>: MITIFF file providing the calibration, the\n");
+    fprintf(stdout,
+	    "           calibration benchmark is skipped without it.\n");
+    fprintf(stdout,
+	    " <pixels>: Number of synthetic pixels (default %d).\n",
+	    BENCH_NPIXELS);
+    fprintf(stdout,
+	    " <repeats>: Number of times each kernel is run (default %d).\n",
+	    BENCH_REPEAT);
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
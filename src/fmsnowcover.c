@@ -49,6 +49,54 @@
  * landmask + surface. d34 removed.
  * Mari Anne Killie, METNO/FOU, 02.07.2010: replacing
  * store_mitiff_result with store_snow.
+ * ystein Gody, METNO/FOU, 19.10.2026: rdstatcoeffs and friends moved to
+ * statcoeffs.c, coefficients are checked by buildstatcoeffs before use.
+ * ystein Gody, METNO/FOU, 19.10.2026: NWP data are not read if NWPPATH is
+ * not given in the configuration file.
+ * ystein Gody, METNO/FOU, 19.10.2026: Time and memory used by each
+ * processing stage are reported at the end and optionally appended to a
+ * metrics file (-M).
+ * ystein Gody, METNO/FOU, 19.10.2026: Pixel counters for each exit of
+ * process_pixels4ice are added to the report and the index file.
+ * ystein Gody, METNO/FOU, 19.10.2026: Interpolated NWP fields are cached
+ * in NWPCACHE if given in the configuration file.
+ * ystein Gody, METNO/FOU, 19.10.2026: Products are written by background
+ * writer threads (-w), several input files may be given (-i) and are
+ * processed in order. The index file is updated when the products of a
+ * scene are written.
+ * ystein Gody, METNO/FOU, 19.10.2026: MITIFF images are not written if -n
+ * is given.
+ * ystein Gody, METNO/FOU, 19.10.2026: findcloudfree replaced by
+ * statistics collected by process_pixels4ice, class counts and mean
+ * P(ice/snow) by regime added to the index file.
+ * ystein Gody, METNO/FOU, 19.10.2026: The index file is locked while
+ * updated.
+ * ystein Gody, METNO/FOU, 19.10.2026: Scenes are checked from the header
+ * before the image data are read, scenes outside a time window (-d, -p) are
+ * skipped and -l lists the scenes without processing them.
+ * ystein Gody, METNO/FOU, 19.10.2026: Products may be made for a region
+ * of interest only (-r, -g), they are written to the directory given by -o.
+ * ystein Gody, METNO/FOU, 19.10.2026: A decimated quick-look may be
+ * written before the full resolution products (-q).
+ * ystein Gody, METNO/FOU, 19.10.2026: Scenes may be read from stdin or a
+ * named pipe (-s) and the products written to stdout (-x).
+ * ystein Gody, METNO/FOU, 19.10.2026: The extent of the valid data is
+ * written with the HDF5 product, as <product>.extent, for fmaccusnow.
+ * ystein Gody, METNO/FOU, 19.10.2026: Pass products are added to the cube
+ * of the tile instead of written as files if CUBEPATH is given in the
+ * configuration file.
+ * ystein Gody, METNO/FOU, 19.10.2026: Only land and coast pixels are
+ * processed with -L, the spans of these are cached next to the land/sea
+ * mask.
+ * ystein Gody, METNO/FOU, 19.10.2026: Timeline trace of the run (-T).
+ * ystein Gody, METNO/FOU, 19.10.2026: A quick-look that can not be
+ * written does not stop the indexing of the scene.
+ * ystein Gody, METNO/FOU, 19.10.2026: Streamed scenes of counts use the
+ * 3A test of process_pixels4ice.
+ * ystein Gody, METNO/FOU, 19.10.2026: The NWP surface temperature of
+ * streamed scenes is sampled from the coarse grid by fmsnowlib_classify.
+ * ystein Gody, METNO/FOU, 19.10.2026: The products of file and streamed
+ * scenes are handed to the writer by submit_products.
  *
  * CVS_ID:
  * $Id: fmsnowcover.c,v 1.12 2010-07-02 15:07:18 mariak Exp $
@@ -56,55 +104,71 @@
  
 #include <fmsnowcover.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
 #include <fmaccusnow.h>
+#include <fmsnowwriter.h>
+#include <fmsnowstream.h>
 /*#undef FMSNOWCOVER_HAVE_LIBUSENWP*/
 
+/*
+ * Tile of the last scene read from a stream, kept while the following
+ * scenes are of the same tile.
+ */
+typedef struct {
+    char lmtile[8];
+    fmsnowlib_tile t;
+} streamtile;
+
+static int process_scene(char *fname, fmsnowprobe *pr, cfgstruct *cfg,
+	statcoeffstr *coeffs, int mitiff, fmsnowroi *roi, int quicklook,
+	int landonly, fmsnowwriter *wr, fmsnowtimer *timer);
+static int process_quicklook(fmio_img img, unsigned char *lmask,
+	landspans *land, nwpice nwp, char *pname, cfgstruct *cfg, statcoeffstr *coeffs,
+	int mitiff, int stride, fmsnowwriter *wr, fmsnowwscene *sc,
+	fmsnowtimer *timer);
+static int process_streamscene(fmsnowstreamscene *ss, fmsnowprobe *pr,
+	cfgstruct *cfg, statcoeffstr *coeffs, int mitiff, FILE *out,
+	streamtile *st, fmsnowwriter *wr, fmsnowtimer *timer);
+static int submit_products(char *sname, char *sa, char *area, fmtime t,
+	fmucsref ref, float cover, float cloudfree, pixcountstr *cnt,
+	osihdf ice, unsigned char *classed, unsigned char *cat,
+	cfgstruct *cfg, int mitiff, int index, fmsnowwriter *wr,
+	fmsnowwscene *sc);
+#ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+static float streamt0m(void *data, int xc, int yc);
+#endif
+
 int main(int argc, char *argv[]) {
 
     char *where="fmsnowcover";
-    char what[FMSNOWCOVER_MSGLENGTH];
     extern char *optarg;
-    int ret;
-    short errflg = 0, iflg = 0, cflg = 0;
-    short status;
-    unsigned int size;
-    char fname[FILENAME],datestr[25];
-    char pname[4];
-    char *lmaskf, *opfn1, *opfn2, *opfn3;
-    char *infile, *cfgfile, *coffile;
-    char *fnwc[3]={"h12sf","h12pl","h12ml"};
-    unsigned char *classed, *cat;
+    int ret, i, failed;
+    int status = FM_OK, nwriters = FMSNOWCOVER_WRITERS, nscenes = 0;
+    int period = 0, quicklook = 0, fd;
+    double tscene;
+    short errflg = 0, cflg = 0, mflg = 0, nflg = 0, lflg = 0, xflg = 0;
+    short landflg = 0;
+    char *cfgfile, *coffile, *metricsfile, *date_end = NULL;
+    char *roipath = NULL, *streampath = NULL, *tracefile = NULL;
+    char *scenes[FMSNOWCOVER_MAXSCENES];
+    char infile[FILELEN], datestr[25];
+    fmsec1970 stime = 0, etime = 0;
+    fmsnowprobe probe;
+    fmsnowroi roi;
+    fmsnowstreamscene ss;
+    streamtile stile;
+    FILE *streamfp, *prodout = NULL;
     cfgstruct cfg;
-    FILE *lmask_located; /*Can be removed later*/
-    fmio_mihead iinfo = {
-	"Not known",
-	00, 00, 00, 00, 0000, -9, 
-	{0, 0, 0, 0, 0, 0, 0, 0}, 
-	0, 0, 0, 0., 0., -999., -999.
-    };
-    fmio_mihead clinfo = {
-	"Not known",
-	00, 00, 00, 00, 0000, -9, 
-	{0, 0, 0, 0, 0, 0, 0, 0}, 
-	0, 0, 0, 0., 0., -999., -999.
-    };
-    fmio_img img;
-    fmucsref refucs;
-    fmtime reftime;
-    nwpice nwp;
-    osihdf lm;
-    osihdf ice;
-    osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
-    char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
-    float cloudfree;
-
-    statcoeffstr coeffs = {{{0}}};
-    int image_type;
+    statcoeffstr coeffs;
+    fmsnowtimer timer;
+    fmsnowwriter writer;
 
     /*
      * Interprete commandline arguments.
      */
-     while ((ret = getopt(argc, argv, "c:i:o:")) != EOF) {
+    roi.type = FMSNOWROI_NONE;
+     while ((ret = getopt(argc, argv, "c:i:o:M:w:nld:p:r:g:q:s:xLT:")) != EOF) {
 	switch (ret) {
 	    case 'c':
 		cfgfile = (char *) malloc(FILELEN);
@@ -116,16 +180,125 @@ int main(int argc, char *argv[]) {
 		cflg++;
                 break;
 	    case 'i':
-		if (!strcpy(fname, optarg)) exit(FM_OK);
-		iflg++;
+		if (nscenes == FMSNOWCOVER_MAXSCENES) {
+		    fmerrmsg(where,"Too many input files, max is %d",
+			    FMSNOWCOVER_MAXSCENES);
+		    exit(FM_VAROUTOFSCOPE_ERR);
+		}
+		scenes[nscenes++] = optarg;
+                break;
+	    case 'M':
+		metricsfile = optarg;
+		mflg++;
+                break;
+	    case 'w':
+		nwriters = atoi(optarg);
+                break;
+	    case 'n':
+		nflg++;
+                break;
+	    case 'l':
+		lflg++;
+                break;
+	    case 'd':
+		date_end = optarg;
+                break;
+	    case 'p':
+		period = atoi(optarg);
+                break;
+	    case 'r':
+		if (fmsnowroi_parse(optarg, FMSNOWROI_PIXEL, &roi)) errflg++;
+                break;
+	    case 'g':
+		if (fmsnowroi_parse(optarg, FMSNOWROI_GEO, &roi)) errflg++;
+                break;
+	    case 'o':
+		roipath = optarg;
+                break;
+	    case 'q':
+		quicklook = atoi(optarg);
+		if (quicklook < 2) errflg++;
+                break;
+	    case 's':
+		streampath = optarg;
+                break;
+	    case 'x':
+		xflg++;
+                break;
+	    case 'L':
+		landflg++;
+                break;
+	    case 'T':
+		tracefile = optarg;
                 break;
 	    default:
 		usage();
 	}
     }
-    if (!iflg || !cflg) errflg++;
+    if ((!nscenes && !streampath) || !cflg) errflg++;
+    if (streampath && (nscenes || lflg || quicklook || landflg ||
+		roi.type != FMSNOWROI_NONE)) errflg++;
+    if (xflg && !streampath) errflg++;
+    if (date_end && (strlen(date_end) != 10 || period <= 0)) errflg++;
+    if (roi.type != FMSNOWROI_NONE && !roipath) errflg++;
     if (errflg) usage();
 
+    /*
+     * Scenes must be within period hours before date_end (or now) if
+     * period is given.
+     */
+    if (period > 0) {
+	etime = date_end ? ymdh2fmsec1970(date_end,0) : (fmsec1970) time(NULL);
+	stime = etime-period*3600;
+    }
+
+    /*
+     * Listing mode, the scenes are checked from the header only and one
+     * line is written for each, the driver may use this to plan which
+     * files to process.
+     */
+    if (lflg) {
+	if (decode_cfg(cfgfile,&cfg) != 0) {
+	    fmerrmsg(where,"Could not decode configuration");
+	    exit(FM_IO_ERR);
+	}
+	for (i=0;i<nscenes;i++) {
+	    snprintf(infile,FILELEN,"%s/%s",cfg.imgpath,scenes[i]);
+	    fmsnowprobe_scene(infile, scenes[i], stime, etime, &probe);
+	    if (probe.status == FMSNOWPROBE_NOTILE ||
+		    probe.status == FMSNOWPROBE_UNREADABLE) {
+		fprintf(stdout,"%s - - - - %s\n", scenes[i],
+			fmsnowprobe_status(probe.status));
+		continue;
+	    }
+	    fmsec19702isodatetime(probe.time, datestr);
+	    fprintf(stdout,"%s %s %s %s %.0f %s\n", scenes[i], probe.area,
+		    probe.sa, datestr, probe.cover,
+		    fmsnowprobe_status(probe.status));
+	}
+	exit(FM_OK);
+    }
+
+    /*
+     * Products go to stdout, messages are sent to stderr instead so
+     * that the product stream is not broken.
+     */
+    if (xflg) {
+	fd = dup(1);
+	if (fd < 0 || !(prodout = fdopen(fd,"w")) || dup2(2,1) < 0) {
+	    fmerrmsg(where,"Could not set up product output to stdout");
+	    exit(FM_IO_ERR);
+	}
+    }
+
+    fmsnowtimer_init(&timer, where);
+    if (nscenes == 1) fmsnowtimer_input(&timer, scenes[0]);
+    if (streampath) fmsnowtimer_input(&timer, streampath);
+    if (tracefile && fmsnowtrace_open(tracefile, where)) {
+	fmerrmsg(where,"Could not open trace file %s", tracefile);
+	exit(FM_IO_ERR);
+    }
+
     fprintf(stdout,"\n");
     fprintf(stdout," ================================================\n");
     fprintf(stdout," |                  FMSNOWCOVER                 |\n");
@@ -135,96 +308,283 @@ int main(int argc, char *argv[]) {
     /*
      * Decode configuration file.
      */
+    fmsnowtimer_start(&timer, "config");
     if (decode_cfg(cfgfile,&cfg) != 0) {
 	fmerrmsg(where,"Could not decode configuration");
 	exit(FM_IO_ERR);
     }
+    fmsnowtimer_stop(&timer, "config");
 
     /*
-     * Set up datapaths etc.
+     * Products of a region of interest are not put with those of the
+     * full tile and not added to the index file.
      */
-    infile = (char *) malloc(FILELEN);
-    if (!infile) {
-	fprintf(stderr,"%s\n"," Trouble processing:");
-	fprintf(stderr,"%s\n",infile);
-	fmerrmsg(where,"Could not allocate memory for infile");
-	exit(FM_MEMALL_ERR);
+    if (roi.type != FMSNOWROI_NONE) {
+	snprintf(cfg.productpath,FILELEN,"%s",roipath);
+	cfg.cubepath[0] = '\0';
     }
-    sprintf(infile,"%s/%s",cfg.imgpath,fname);
-    lmaskf = (char *) malloc(FILELEN);
-    if (!lmaskf) {
-	fprintf(stderr,"%s\n"," Trouble processing:");
-	fprintf(stderr,"%s\n",infile);
-	fmerrmsg(where,"Could not allocate memory for lmaskf");
-	exit(FM_MEMALL_ERR);
-    }
-    if (strstr(fname,"ns") != NULL) {
-	sprintf(pname,"%s","ns");
-	sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg.lmpath,"dnns");
-    } else if (strstr(fname,"at") != NULL) {
-	sprintf(pname,"%s","at");
-	sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg.lmpath,"dnat");
-    } else if (strstr(fname,"nr") != NULL) {
-	sprintf(pname,"%s","nr");
-	sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg.lmpath,"dnnr");
-    } else if (strstr(fname,"gr") != NULL) {
-	sprintf(pname,"%s","gr");
-	sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg.lmpath,"dngr");
-    } else if (strstr(fname,"NoA") != NULL) { /*adding new tile*/
-        sprintf(pname,"%s","noa");
-	sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg.lmpath,"dnnoa");
 
-    } else {
-	fprintf(stderr,"%s\n"," Trouble processing:");
-	fprintf(stderr,"%s\n",infile);
-	fprintf(stderr," ERROR(main):  area not recognised\n");
-	exit(FM_VAROUTOFSCOPE_ERR);
-    }
     /*setting path to file containing probability coeffs*/
     coffile = (char *) malloc(FILELEN);
     if (!coffile) {
-	fprintf(stderr,"%s\n"," Trouble processing:");
-	fprintf(stderr,"%s\n",coffile);
 	fmerrmsg(where,"Could not allocate memory for coffile");
 	exit(FM_MEMALL_ERR);
     }
     sprintf(coffile,"%s",cfg.probtabname);
+
+    /*
+     * Loading the statistical coeffs into statcoeffs struct, they are
+     * used for all scenes.
+     */
+    fmlogmsg(where,"Loading statistical coefficients from \n\t%s", coffile);
+    fmsnowtimer_start(&timer, "coeffs");
+    initstatcoeffs(&coeffs);
+    ret = rdstatcoeffs(coffile,&coeffs);
+    if (ret) {
+      /*fmerrmsg(where," Trouble reading statistical coefficients, exiting..");
+	exit(FM_IO_ERR);*/
+      printf(" WARNING: %d potential issues encountered ",ret);
+      printf("when loading coefficients\n");
+    }
+    if (buildstatcoeffs(&coeffs)) {
+	fmerrmsg(where,"Statistical coefficients in %s can not be used",
+		coffile);
+	exit(FM_IO_ERR);
+    }
+    fmsnowtimer_stop(&timer, "coeffs");
+
+    /*
+     * Process the scenes, the products of a scene are written by the
+     * writer threads while the next scene is processed.
+     */
+    fmsnowwriter_init(&writer, nwriters);
+    if (streampath) {
+	/*
+	 * Scenes are read from the stream until it ends, scenes that
+	 * would be rejected are found from the frame header.
+	 */
+	if (strcmp(streampath,"-") == 0) {
+	    streamfp = stdin;
+	} else if (!(streamfp = fopen(streampath,"r"))) {
+	    fmerrmsg(where,"Could not open %s", streampath);
+	    exit(FM_IO_ERR);
+	}
+	memset(&stile,0,sizeof(streamtile));
+	while (1) {
+	    fmsnowtimer_start(&timer, "stream");
+	    ret = fmsnowstream_read(streamfp, &ss);
+	    fmsnowtimer_stop(&timer, "stream");
+	    if (ret == FMSNOWSTREAM_END) break;
+	    if (ret) {
+		fmerrmsg(where,"Could not read scene %d of %s", nscenes+1,
+			streampath);
+		status = ret;
+		break;
+	    }
+	    nscenes++;
+	    fmsnowtimer_addbytes(&timer, "stream",
+		    (long long) ss.ref.iw*ss.ref.ih*FMSNOWLIB_CHANNELS*ss.bytes);
+	    fmsnowprobe_header(ss.tile, ss.sa, tofmsec1970(ss.time),
+		    ss.cover, ss.ref.iw, ss.ref.ih, stime, etime, &probe);
+	    if (probe.status == FMSNOWPROBE_NOTILE) {
+		fmerrmsg(where,"Area %s of scene %d not recognised", ss.tile,
+			nscenes);
+		status = FM_VAROUTOFSCOPE_ERR;
+	    } else if (probe.status == FMSNOWPROBE_LOWCOVER) {
+		fmlogmsg(where,
+		"The percentage coverage (%.0f%%) of scene %d is too small for further processing.",
+			probe.cover, nscenes);
+		fmsnowtimer_count(&timer, "scenes.lowcover", 1);
+	    } else if (probe.status == FMSNOWPROBE_OUTSIDE) {
+		fmlogmsg(where,"Scene %d is outside the time window, skipped.",
+			nscenes);
+		fmsnowtimer_count(&timer, "scenes.outside", 1);
+	    } else {
+		tscene = fmsnowtrace_now();
+		ret = process_streamscene(&ss, &probe, &cfg, &coeffs, !nflg,
+			prodout, &stile, &writer, &timer);
+		fmsnowtrace_span("scene", "scene", ss.tile, tscene,
+			fmsnowtrace_now());
+		if (ret) {
+		    fmerrmsg(where,"Could not process scene %d", nscenes);
+		    status = ret;
+		}
+	    }
+	    fmsnowstream_free(&ss);
+	}
+	if (streamfp != stdin) fclose(streamfp);
+	fmsnowlib_tile_free(&stile.t);
+    }
+    for (i=0;!streampath && i<nscenes;i++) {
+	/*
+	 * Scenes that would be rejected are found from the header, before
+	 * any image data are read.
+	 */
+	snprintf(infile,FILELEN,"%s/%s",cfg.imgpath,scenes[i]);
+	fmsnowtimer_start(&timer, "probe");
+	fmsnowwriter_hdf5lock();
+	fmsnowprobe_scene(infile, scenes[i], stime, etime, &probe);
+	fmsnowwriter_hdf5unlock();
+	fmsnowtimer_stop(&timer, "probe");
+	if (probe.status == FMSNOWPROBE_NOTILE) {
+	    fmerrmsg(where,"Area of %s not recognised", scenes[i]);
+	    status = FM_VAROUTOFSCOPE_ERR;
+	    continue;
+	} else if (probe.status == FMSNOWPROBE_UNREADABLE) {
+	    fmerrmsg(where,"Could not read header of %s", scenes[i]);
+	    status = FM_IO_ERR;
+	    continue;
+	} else if (probe.status == FMSNOWPROBE_LOWCOVER) {
+	    fmlogmsg(where,
+	    "The percentage coverage (%.0f%%) of %s is too small for further processing.",
+		    probe.cover, scenes[i]);
+	    fmsnowtimer_count(&timer, "scenes.lowcover", 1);
+	    continue;
+	} else if (probe.status == FMSNOWPROBE_OUTSIDE) {
+	    fmlogmsg(where,"%s is outside the time window, skipped.",
+		    scenes[i]);
+	    fmsnowtimer_count(&timer, "scenes.outside", 1);
+	    continue;
+	}
+	tscene = fmsnowtrace_now();
+	ret = process_scene(scenes[i], &probe, &cfg, &coeffs, !nflg,
+		roi.type != FMSNOWROI_NONE ? &roi : NULL, quicklook, landflg,
+		&writer, &timer);
+	fmsnowtrace_span("scene", "scene", scenes[i], tscene,
+		fmsnowtrace_now());
+	if (ret) {
+	    fmerrmsg(where,"Could not process %s", scenes[i]);
+	    status = ret;
+	}
+    }
+    fmsnowtimer_start(&timer, "writewait");
+    failed = fmsnowwriter_finish(&writer, &timer);
+    fmsnowtimer_stop(&timer, "writewait");
+    if (failed) {
+	fmerrmsg(where,"%d product files could not be written", failed);
+	if (status == FM_OK) status = FM_IO_ERR;
+    }
+    fmsnowtimer_count(&timer, "scenes", nscenes);
+
+    fprintf(stdout," ================================================\n");
+    free(coffile);
+
+    fmsnowtimer_report(&timer, stdout);
+    if (mflg) fmsnowtimer_append(&timer, metricsfile);
+    fmsnowtrace_close();
+    if (prodout && fclose(prodout) && status == FM_OK) status = FM_IO_ERR;
+
+    exit(status);
+}
+
+/*
+ * NAME:
+ * process_scene
+ *
+ * PURPOSE:
+ * To estimate the snow cover of one scene and hand the products to the
+ * writer.
+ *
+ * NOTES:
+ * The scene has been checked by fmsnowprobe_scene, which gives the
+ * tile. If roi is given only the region of interest is processed and
+ * the scene is not added to the index file. If quicklook is given a
+ * product of every quicklook pixel is written first. The MITIFF images
+ * are not written if mitiff is 0, they can be made from the HDF5
+ * product by fmsnowrender.
+ *
+ * If landonly is given only the land and coast pixels of the land/sea
+ * mask are processed, their spans are read from the cache next to the
+ * mask or found and written there. The spans of a region of interest are
+ * found from the cut mask and not cached.
+ */
+static int process_scene(char *fname, fmsnowprobe *pr, cfgstruct *cfg,
+	statcoeffstr *coeffs, int mitiff, fmsnowroi *roi, int quicklook,
+	int landonly, fmsnowwriter *wr, fmsnowtimer *timer) {
+
+    char *where="fmsnowcover";
+    char what[FMSNOWCOVER_MSGLENGTH];
+    short status;
+    unsigned int size;
+    char pname[4], sa[32];
+    char lmaskf[FILELEN], infile[FILELEN];
+    char *fnwc[3]={"h12sf","h12pl","h12ml"};
+    unsigned char *classed, *cat;
+    FILE *lmask_located; /*Can be removed later*/
+    fmio_img img;
+    fmucsref refucs, tileucs;
+    fmtime reftime;
+    nwpice nwp;
+    osihdf lm;
+    landspans spans, *land = NULL;
+    double tread;
+    osihdf ice;
+    osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
+    float cloudfree, cover;
+    struct stat sbuf;
+    pixcountstr pixcnt;
+    fmsnowwscene *sc = NULL;
+
+    /*
+     * Set up datapaths etc.
+     */
+    sprintf(infile,"%s/%s",cfg->imgpath,fname);
+    sprintf(pname,"%s",pr->area);
+    sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg->lmpath,pr->lmtile);
    
     /*
      * Open file with AVHRR information and read image
-     * data and information
+     * data and information. The input may be HDF5 which is written by
+     * the writer threads at the same time.
      */
     fprintf(stdout," Reading input AVHRR data...\n");
     fprintf(stdout," %s\n", fname);
+    fmsnowtimer_start(timer, "image");
     fm_init_fmio_img(&img);
-    if (fm_readdata(infile, &img)) {
+    fmsnowwriter_hdf5lock();
+    tread = fmsnowtrace_now();
+    status = fm_readdata(infile, &img);
+    fmsnowtrace_span("read", "image", infile, tread, fmsnowtrace_now());
+    fmsnowwriter_hdf5unlock();
+    if (status) {
 	fmerrmsg(where,"Could not open file...\n");
-	exit(FM_IO_ERR);
+	fmsnowtimer_stop(timer, "image");
+	return(FM_IO_ERR);
+    }
+    fmsnowtimer_stop(timer, "image");
+    if (stat(infile,&sbuf) == 0) {
+	fmsnowtimer_addbytes(timer, "image", (long long) sbuf.st_size);
     }
 
     printf(" Satellite: %s\n", img.sa);
     printf(" Time: %02d/%02d/%4d %02d:%02d\n", img.dd, img.mm, img.yy,
     img.ho, img.mi);
-    sprintf(iinfo.satellite,"%s",img.sa);
-    iinfo.hour = img.ho;
-    iinfo.minute = img.mi;
-    iinfo.day = img.dd;
-    iinfo.month = img.mm;
-    iinfo.year = img.yy;
-    iinfo.zsize = img.z;
-    iinfo.xsize = img.iw;
-    iinfo.ysize = img.ih;
-    iinfo.Ax = img.Ax;
-    iinfo.Ay = img.Ay;
-    iinfo.Bx = img.Bx;
-    iinfo.By = img.By;
-    size = img.iw*img.ih;
     printf(" Image cover: %.2f\n",img.cover);
-    if ((img.cover < 40. && (strstr(fname,"NoA") == NULL))) {
-	fmlogmsg(where,
-	"The percentage coverage (%.0f%) of this scene is too small for further processing.",img.cover);
-	exit(FM_OK);
+
+    /*
+     * Cut the image to the region of interest, libfmio reads the full
+     * tile. The full planes are freed here, so the following steps only
+     * handle the window.
+     */
+    fm_img2fmucsref(img,&tileucs);
+    if (roi) {
+	if (fmsnowroi_window(roi, tileucs)) {
+	    fmlogmsg(where,"The region of interest is outside %s.", fname);
+	    fm_clear_fmio_img(&img);
+	    fmsnowtimer_count(timer, "scenes.outsideroi", 1);
+	    return(FM_OK);
+	}
+	fmlogmsg(where,"Processing columns %d-%d and rows %d-%d",
+		roi->col0, roi->col0+roi->iw-1, roi->row0, roi->row0+roi->ih-1);
+	if (fmsnowroi_cropimg(&img, roi)) {
+	    fmerrmsg(where,"Could not cut %s to the region of interest",
+		    fname);
+	    fm_clear_fmio_img(&img);
+	    return(FM_MEMALL_ERR);
+	}
     }
+    size = img.iw*img.ih;
 
     fm_img2fmtime(img,&reftime);
     fm_img2fmucsref(img,&refucs);
@@ -237,14 +597,29 @@ int main(int argc, char *argv[]) {
 
     nwpice_init(&nwp);
 
+    fmsnowtimer_start(timer, "nwp");
     #ifdef FMSNOWCOVER_HAVE_LIBUSENWP
-    if (nwpice_read(cfg.nwppath,fnwc,3,4,reftime,refucs,&nwp)) {
+    if (strlen(cfg->nwppath) == 0) {
+	fmlogmsg(where,"No NWPPATH given, continuing without NWP data.");
+    } else if (strlen(cfg->nwpcache) > 0) {
+	if (nwpice_readcache(cfg->nwpcache,cfg->nwppath,fnwc,3,4,reftime,
+		    refucs,&nwp)) {
+	    fmerrmsg(where,"No NWP data available.");
+	    fm_clear_fmio_img(&img);
+	    nwpice_free(&nwp);
+	    fmsnowtimer_stop(timer, "nwp");
+	    return(FM_IO_ERR);
+	}
+	fmsnowtimer_count(timer, "nwp.cachehit", nwp.cachemap ? 1 : 0);
+    } else if (nwpice_read(cfg->nwppath,fnwc,3,4,reftime,refucs,&nwp)) {
     	fmerrmsg(where,"No NWP data available.");
     	fm_clear_fmio_img(&img);
     	nwpice_free(&nwp);
-    	exit(FM_IO_ERR);
+	fmsnowtimer_stop(timer, "nwp");
+    	return(FM_IO_ERR);
     }
     #endif
+    fmsnowtimer_stop(timer, "nwp");
 
     /*
      * Get land/sea mask, accepted if within 0.5 km of the image.
@@ -252,16 +627,36 @@ int main(int argc, char *argv[]) {
      */
     
     lm.d = NULL;
+    fmsnowtimer_start(timer, "landmask");
     if (lmask_located = fopen(lmaskf,"r")) {
       fprintf(stdout," Reading land/sea mask (GTOPO30 based):\n %s\n", lmaskf);
+      fmsnowwriter_hdf5lock();
+      tread = fmsnowtrace_now();
       status = read_hdf5_product(lmaskf, &lm, 0);
+      fmsnowtrace_span("read", "landmask", lmaskf, tread, fmsnowtrace_now());
+      fmsnowwriter_hdf5unlock();
       fclose(lmask_located);
+      if (stat(lmaskf,&sbuf) == 0) {
+	fmsnowtimer_addbytes(timer, "landmask", (long long) sbuf.st_size);
+      }
+      fmsnowtimer_stop(timer, "landmask");
       if (status != 0) {
 	fprintf(stderr,"%s\n"," Trouble processing:");
 	fprintf(stderr,"%s\n",infile);
 	fprintf(stderr,"%s%s\n", fmerrmsg,"Could not read land/sea mask");
+	fm_clear_fmio_img(&img);
+	nwpice_free(&nwp);
 	return(FM_IO_ERR);
       }
+      if (roi && lm.h.iw == tileucs.iw && lm.h.ih == tileucs.ih) {
+	if (fmsnowroi_cropprod(&lm, roi)) {
+	    fmerrmsg(where,"Could not cut land/sea mask");
+	    fm_clear_fmio_img(&img);
+	    nwpice_free(&nwp);
+	    free_osihdf(&lm);
+	    return(FM_MEMALL_ERR);
+	}
+      }
       fprintf(stdout," Checking for area consistency with land/sea mask...\n");
       if (((int) floorf(lm.h.Bx*10.)) != ((int) floorf(img.Bx*10.)) || 
 	  ((int) floorf(lm.h.By*10.)) != ((int) floorf(img.By*10.)) ||
@@ -278,23 +673,53 @@ int main(int argc, char *argv[]) {
 	fprintf(stderr," By: %f %f\n", lm.h.By, img.By);
 	fprintf(stderr," iw: %d %d\n", lm.h.iw, img.iw);
 	fprintf(stderr," ih: %d %d\n", lm.h.ih, img.ih);
+	fm_clear_fmio_img(&img);
+	nwpice_free(&nwp);
+	free_osihdf(&lm);
 	return(FM_IO_ERR);
       }
     }
     else {
 	fmlogmsg(where,"No landmask is available, continuing without.");
+	fmsnowtimer_stop(timer, "landmask");
     }
 
     /*
-     * Loading the statistical coeffs into statcoeffs struct           
+     * Spans of the land pixels for land only mode, all pixels are
+     * processed if they can not be found.
      */
-    fmlogmsg(where,"Loading statistical coefficients from \n\t%s", coffile);
-    ret = rdstatcoeffs(coffile,&coeffs);
-    if (ret) {
-      /*fmerrmsg(where," Trouble reading statistical coefficients, exiting..");
-	exit(FM_IO_ERR);*/
-      printf(" WARNING: %d potential issues encountered ",ret);
-      printf("when loading coefficients\n");
+    if (landonly && lm.d == NULL) {
+	fmlogmsg(where,"No landmask for land only mode, all pixels are used.");
+    } else if (landonly) {
+	fmsnowtimer_start(timer, "landspans");
+	if (!roi && read_land_spans(lmaskf, img.iw, img.ih, &spans) == FM_OK) {
+	    land = &spans;
+	    fmsnowtimer_count(timer, "landspans.cachehit", 1);
+	} else if (find_land_spans((unsigned char *) lm.d->data, img.iw,
+		    img.ih, &spans) == FM_OK) {
+	    land = &spans;
+	    fmsnowtimer_count(timer, "landspans.cachehit", 0);
+	    if (!roi && write_land_spans(lmaskf, &spans)) {
+		fmlogmsg(where,"Land spans of %s not cached.", lmaskf);
+	    }
+	} else {
+	    fmerrmsg(where,"Could not find land spans, all pixels are used.");
+	}
+	fmsnowtimer_stop(timer, "landspans");
+    }
+
+    /*
+     * The quick-look is written while the full resolution products are
+     * made, it is part of the same writer scene and removed when the
+     * full resolution products are written.
+     */
+    if (quicklook > 1) {
+	sc = fmsnowwriter_scene(wr);
+	if (!sc || process_quicklook(img, lm.d ? (unsigned char *) lm.d->data :
+		    NULL, land, nwp, pname, cfg, coeffs, mitiff, quicklook, wr, sc,
+		    timer)) {
+	    fmerrmsg(where,"Could not make quick-look of %s", fname);
+	}
     }
 
     /*
@@ -320,32 +745,37 @@ int main(int argc, char *argv[]) {
     status = malloc_osihdf(&ice,ice_ft,ice_desc);
 
     classed = (unsigned char *) malloc(size*sizeof(char));
-    if (!classed) {
-	sprintf(what,
-	"Could not allocate memory for classed array while processing : %s\n",
-		infile);
-	fmerrmsg(where,what);
-	exit(FM_MEMALL_ERR);
-    }
     /*MAK added 22/9-09*/
     cat = (unsigned char *) malloc(size*sizeof(char));
-    if (!cat) {
+    if (status || !classed || !cat) {
 	sprintf(what,
-	"Could not allocate memory for cat array while processing : %s\n",
+	"Could not allocate memory for output arrays while processing : %s\n",
 		infile);
 	fmerrmsg(where,what);
-	exit(FM_MEMALL_ERR);
+	if (classed) free(classed);
+	if (cat) free(cat);
+	if (!status) free_osihdf(&ice);
+	fm_clear_fmio_img(&img);
+	nwpice_free(&nwp);
+	if (lm.d != NULL) free_osihdf(&lm);
+	if (land) free_land_spans(land);
+	if (sc) fmsnowwriter_abort(wr, sc);
+	return(FM_MEMALL_ERR);
     }
 
     fmlogmsg(where,"Estimating ice probability");
 
+    fmsnowtimer_start(timer, "pixels");
+    initpixcount(&pixcnt);
     if (lm.d == NULL) {
-      status = process_pixels4ice(img, NULL, NULL, nwp,
-				  ice.d, classed, cat, 2, coeffs);
+      status = process_pixels4ice(img, NULL, NULL, NULL, nwp,
+				  ice.d, classed, cat, 2, 1, coeffs, &pixcnt);
     } else {
       status = process_pixels4ice(img, NULL, (unsigned char *)(lm.d->data), 
-				  nwp, ice.d, classed, cat, 2, coeffs);
+				  land, nwp, ice.d, classed, cat, 2, 1, coeffs, &pixcnt);
     }
+    fmsnowtimer_stop(timer, "pixels");
+    pixcount2timer(&pixcnt, timer);
     
     if ((status) && (status != 10)) {
 	sprintf(what,"Something failed while processing pixels of %s",infile);
@@ -363,93 +793,486 @@ int main(int argc, char *argv[]) {
      * Should add freeing of lmask here if needed in future...
      */
     fmlogmsg(where,"Cleaning memory");
-    fm_clear_fmio_img(&img);
+    nwpice_free(&nwp);
     if (lm.d != NULL) {
       free_osihdf(&lm);
     }
+    if (land) free_land_spans(land);
+
+    /*
+     * The cloud free coverage is found from the statistics collected
+     * while processing the pixels.
+     */
+    printf(" cover: %f\n",img.cover);
+    cloudfree = pixcount2cloudfree(&pixcnt);
+    printf(" cloudfree: %f\n", cloudfree);
+
+    /*
+     * The image data are released before the products are handed to the
+     * writer, which may have to wait for a free slot.
+     */
+    snprintf(sa,sizeof(sa),"%s",img.sa);
+    cover = img.cover;
+    fm_clear_fmio_img(&img);
+
+    return(submit_products(fname, sa, pname, reftime, refucs, cover,
+		cloudfree, &pixcnt, ice, classed, cat, cfg, mitiff, roi == NULL,
+		wr, sc));
+}
+
+/*
+ * NAME:
+ * process_streamscene
+ *
+ * PURPOSE:
+ * To estimate the snow cover of a scene read from a stream, and write
+ * the products to out or hand them to the writer.
+ *
+ * NOTES:
+ * The classification is made by fmsnowlib, the land/sea mask is read
+ * and the positions of the pixels found only when the tile changes. If
+ * out is given the product frame is written to it and the scene is not
+ * added to the index file. Otherwise the products are named and indexed
+ * as those of process_scene, the scene is named
+ * <satellite>_<yyyymmdd>_<hhmm>.<tile> in the index file.
+ */
+static int process_streamscene(fmsnowstreamscene *ss, fmsnowprobe *pr,
+	cfgstruct *cfg, statcoeffstr *coeffs, int mitiff, FILE *out,
+	streamtile *st, fmsnowwriter *wr, fmsnowtimer *timer) {
+
+    char *where="fmsnowcover";
+    char sname[FILELEN];
+    char lmaskf[FILELEN];
+    char *fnwc[3]={"h12sf","h12pl","h12ml"};
+    int i, k, size, status;
+    unsigned char *classed, *cat, *lmask;
+    float *probs[FMSNOWCOVER_OLEVELS], cloudfree;
+    fmucsref *ref = &ss->ref;
+    fmtime *t = &ss->time;
+    nwpice nwp;
+    osihdf lm;
+    osihdf ice;
+    double tread;
+    osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
+    struct stat sbuf;
+    pixcountstr pixcnt;
+    fmsnowlib_scene lsc;
+
+    size = ref->iw*ref->ih;
+    snprintf(sname,FILELEN,"%s_%04d%02d%02d_%02d%02d.%s", ss->sa,
+	    t->fm_year, t->fm_mon, t->fm_mday, t->fm_hour, t->fm_min,
+	    ss->tile);
+    fprintf(stdout," Scene from stream: %s\n", sname);
+    printf(" Image cover: %.2f\n",ss->cover);
+
+    /*
+     * Land/sea mask and pixel positions, kept for the following scenes
+     * of the same tile.
+     */
+    if (!st->t.geo || strcmp(st->lmtile,pr->lmtile) != 0 ||
+	    st->t.ref.iw != ref->iw || st->t.ref.ih != ref->ih ||
+	    st->t.ref.Ax != ref->Ax || st->t.ref.Ay != ref->Ay ||
+	    st->t.ref.Bx != ref->Bx || st->t.ref.By != ref->By) {
+	fmsnowlib_tile_free(&st->t);
+	sprintf(lmaskf,"%s/physiography.%s.hdf5",cfg->lmpath,pr->lmtile);
+	fmsnowtimer_start(timer, "landmask");
+	lm.d = NULL;
+	lmask = NULL;
+	if (stat(lmaskf,&sbuf) == 0) {
+	    fprintf(stdout," Reading land/sea mask (GTOPO30 based):\n %s\n",
+		    lmaskf);
+	    fmsnowwriter_hdf5lock();
+	    tread = fmsnowtrace_now();
+	    status = read_hdf5_product(lmaskf, &lm, 0);
+	    fmsnowtrace_span("read", "landmask", lmaskf, tread, fmsnowtrace_now());
+	    fmsnowwriter_hdf5unlock();
+	    if (status) {
+		fmerrmsg(where,"Could not read land/sea mask %s", lmaskf);
+		fmsnowtimer_stop(timer, "landmask");
+		return(FM_IO_ERR);
+	    }
+	    fmsnowtimer_addbytes(timer, "landmask", (long long) sbuf.st_size);
+	    if (((int) floorf(lm.h.Bx*10.)) != ((int) floorf(ref->Bx*10.)) || 
+		((int) floorf(lm.h.By*10.)) != ((int) floorf(ref->By*10.)) ||
+		((int) floorf(lm.h.Ax*10.)) != ((int) floorf(ref->Ax*10.)) || 
+		((int) floorf(lm.h.Ay*10.)) != ((int) floorf(ref->Ay*10.)) ||
+		lm.h.iw != ref->iw || lm.h.ih != ref->ih) {
+		fmerrmsg(where,
+			"Inconsistency between land/sea mask and data input");
+		free_osihdf(&lm);
+		fmsnowtimer_stop(timer, "landmask");
+		return(FM_IO_ERR);
+	    }
+	    lmask = (unsigned char *) lm.d->data;
+	} else {
+	    fmlogmsg(where,"No landmask is available, continuing without.");
+	}
+	status = fmsnowlib_tile_init(&st->t, coeffs, *ref, lmask);
+	if (lm.d) free_osihdf(&lm);
+	fmsnowtimer_stop(timer, "landmask");
+	if (status) return(status);
+	sprintf(st->lmtile,"%s",pr->lmtile);
+    }
+
+    /*
+     * NWP surface temperature, kept on the coarse grid and sampled by
+     * fmsnowlib_classify for the pixels reaching probest.
+     */
+    nwpice_init(&nwp);
+    fmsnowtimer_start(timer, "nwp");
+    #ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+    if (strlen(cfg->nwppath) == 0) {
+	fmlogmsg(where,"No NWPPATH given, continuing without NWP data.");
+    } else {
+	if (strlen(cfg->nwpcache) > 0) {
+	    status = nwpice_readcache(cfg->nwpcache,cfg->nwppath,fnwc,3,4,
+		    *t,*ref,&nwp);
+	    fmsnowtimer_count(timer, "nwp.cachehit", nwp.cachemap ? 1 : 0);
+	} else {
+	    status = nwpice_read(cfg->nwppath,fnwc,3,4,*t,*ref,&nwp);
+	}
+	if (status) {
+	    fmerrmsg(where,"No NWP data available.");
+	    nwpice_free(&nwp);
+	    fmsnowtimer_stop(timer, "nwp");
+	    return(FM_IO_ERR);
+	}
+    }
+    #endif
+    fmsnowtimer_stop(timer, "nwp");
+
+    init_osihdf(&ice);
+    sprintf(ice.h.source, "%s", ss->sa);
+    sprintf(ice.h.product, "%s", where);
+    ice.h.iw = ref->iw;
+    ice.h.ih = ref->ih;
+    ice.h.z = FMSNOWCOVER_OLEVELS;
+    ice.h.Ax = ref->Ax;
+    ice.h.Ay = ref->Ay;
+    ice.h.Bx = ref->Bx;
+    ice.h.By = ref->By;
+    ice.h.year = t->fm_year;
+    ice.h.month = t->fm_mon;
+    ice.h.day = t->fm_mday;
+    ice.h.hour = t->fm_hour;
+    ice.h.minute = t->fm_min;
+    status = malloc_osihdf(&ice,ice_ft,ice_desc);
+    classed = (unsigned char *) malloc(size*sizeof(char));
+    cat = (unsigned char *) malloc(size*sizeof(char));
+    if (status || !classed || !cat) {
+	fmerrmsg(where,"Could not allocate memory for output arrays");
+	if (classed) free(classed);
+	if (cat) free(cat);
+	if (!status) free_osihdf(&ice);
+	nwpice_free(&nwp);
+	return(FM_MEMALL_ERR);
+    }
+    for (i=0;i<FMSNOWCOVER_OLEVELS;i++) probs[i] = (float *) ice.d[i].data;
+
+    fmlogmsg(where,"Estimating ice probability");
+    memset(&lsc,0,sizeof(fmsnowlib_scene));
+    lsc.time = *t;
+    snprintf(lsc.sa,sizeof(lsc.sa),"%s",ss->sa);
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) lsc.ch[k] = ss->ch[k];
+    #ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+    if (nwp.t0m) {
+	lsc.tsurf = streamt0m;
+	lsc.tsurfdata = &nwp;
+    }
+    #endif
+    /*
+     * The 3A test of process_pixels4ice is on the count of T4, this is
+     * only known if the stream gives counts.
+     */
+    if (ss->bytes == FMSNOWSTREAM_UINT8 ||
+	    ss->gain[3] != 1. || ss->offset[3] != 0.) {
+	lsc.t4sat3a = ss->gain[3]*FMSNOWSAT3ACOUNT+ss->offset[3];
+    }
+    fmsnowtimer_start(timer, "pixels");
+    initpixcount(&pixcnt);
+    status = fmsnowlib_classify(&st->t, &lsc, probs, classed, cat, &pixcnt);
+    fmsnowtimer_stop(timer, "pixels");
+    pixcount2timer(&pixcnt, timer);
+    nwpice_free(&nwp);
+    if (status) {
+	fmerrmsg(where,"Something failed while processing pixels of %s",
+		sname);
+	free(classed);
+	free(cat);
+	free_osihdf(&ice);
+	return(status);
+    }
+    fmlogmsg(where,"Finished estimating ice probability");
+    cloudfree = pixcount2cloudfree(&pixcnt);
+    printf(" cloudfree: %f\n", cloudfree);
+
+    /*
+     * Products to the output stream.
+     */
+    if (out) {
+	fmsnowtimer_start(timer, "streamout");
+	status = fmsnowstream_write(out, ss, cloudfree, probs, classed, cat);
+	fmsnowtimer_stop(timer, "streamout");
+	fmsnowtimer_addbytes(timer, "streamout",
+		(long long) size*(FMSNOWCOVER_OLEVELS*sizeof(float)+2));
+	free(classed);
+	free(cat);
+	free_osihdf(&ice);
+	return(status);
+    }
+
+    /*
+     * Product files, as those of process_scene.
+     */
+    return(submit_products(sname, ss->sa, pr->area, *t, *ref, ss->cover,
+		cloudfree, &pixcnt, ice, classed, cat, cfg, mitiff, 1, wr, NULL));
+}
+
+#ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+/*
+ * NAME:
+ * streamt0m
+ *
+ * PURPOSE:
+ * The NWP surface temperature of a tile pixel for fmsnowlib_classify,
+ * data is the nwpice of the scene.
+ */
+static float streamt0m(void *data, int xc, int yc) {
+
+    return(nwpice_t0m((nwpice *) data, xc, yc));
+}
+#endif
+
+/*
+ * NAME:
+ * submit_products
+ *
+ * PURPOSE:
+ * To name the products of a scene and hand them to the writer, the HDF5
+ * product (or the pass of the cube of the tile) and the MITIFF images if
+ * mitiff is set. sname is the input scene, sa the satellite and area the
+ * tile of the scene.
+ *
+ * NOTES:
+ * The writer owns ice, classed and cat from here. sc is the writer scene
+ * of the quick-look if any, otherwise a scene is started. The index
+ * record is added when all products are written, unless index is 0.
+ *
+ * RETURN VALUES:
+ * FM_OK, or FM_MEMALL_ERR if no writer scene could be started.
+ */
+static int submit_products(char *sname, char *sa, char *area, fmtime t,
+	fmucsref ref, float cover, float cloudfree, pixcountstr *cnt,
+	osihdf ice, unsigned char *classed, unsigned char *cat,
+	cfgstruct *cfg, int mitiff, int index, fmsnowwriter *wr,
+	fmsnowwscene *sc) {
+
+    char datestr[25];
+    char opfn1[FILELEN+5], opfn2[FILELEN+5], opfn3[FILELEN+5];
+    fmio_mihead clinfo = {
+	"Not known",
+	00, 00, 00, 00, 0000, -9, 
+	{0, 0, 0, 0, 0, 0, 0, 0}, 
+	0, 0, 0, 0., 0., -999., -999.
+    };
+    passextent ext;
+    fmsnowindexrec rec;
 
     /*
      * Write results to files, HDF5 file for internal use and TIFF 6.0 
-     * (MITIFF) file for visual presentation on Internet/DIANA etc.
+     * (MITIFF) file for visual presentation on Internet/DIANA etc. The
+     * files are written by the writer threads.
      *
      * MITIFF generation will be moved to a separate application in
      * time...
      */
-    sprintf(clinfo.satellite,"%s",img.sa);
-    clinfo.hour = img.ho;
-    clinfo.minute = img.mi;
-    clinfo.day = img.dd;
-    clinfo.month = img.mm;
-    clinfo.year = img.yy;
+    sprintf(clinfo.satellite,"%s",sa);
+    clinfo.hour = t.fm_hour;
+    clinfo.minute = t.fm_min;
+    clinfo.day = t.fm_mday;
+    clinfo.month = t.fm_mon;
+    clinfo.year = t.fm_year;
     clinfo.zsize = 1;
-    clinfo.xsize = img.iw;
-    clinfo.ysize = img.ih;
-    clinfo.Ax = img.Ax;
-    clinfo.Ay = img.Ay;
-    clinfo.Bx = img.Bx;
-    clinfo.By = img.By;
-
-    opfn1 = (char *) malloc(FILELEN+5);
-    if (!opfn1) exit(FM_IO_ERR);
-    sprintf(opfn1,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.hdf5", 
-	cfg.productpath,pname,
-	img.yy, img.mm, img.dd, img.ho, img.mi);
-    sprintf(what,"Creating output file: %s", opfn1);
-    fmlogmsg(where,what);
-    status = store_hdf5_product(opfn1,ice);
-    if (status != 0) {
-	sprintf(what,"Trouble processing: %s",infile);
-	fmerrmsg(where,what);
-    }
+    clinfo.xsize = ref.iw;
+    clinfo.ysize = ref.ih;
+    clinfo.Ax = ref.Ax;
+    clinfo.Ay = ref.Ay;
+    clinfo.Bx = ref.Bx;
+    clinfo.By = ref.By;
 
-    opfn2 = (char *) malloc(FILELEN+5);
-    if (!opfn2) exit(FM_IO_ERR);
+    sprintf(opfn1,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.hdf5", 
+	cfg->productpath,area,
+	t.fm_year, t.fm_mon, t.fm_mday, t.fm_hour, t.fm_min);
     sprintf(opfn2,"%s/fmsnow_%s_%4d%02d%02d%02d%02d.mitiff", 
-	cfg.productpath,pname,
-	img.yy, img.mm, img.dd, img.ho, img.mi);
-    sprintf(what,"Creating output file: %s", opfn2);
-    fmlogmsg(where,what);
-    image_type = 0;
-    store_snow(opfn2,classed,clinfo,image_type);
-
-
+	cfg->productpath,area,
+	t.fm_year, t.fm_mon, t.fm_mday, t.fm_hour, t.fm_min);
     /*Can be helpful when trying to improve the product*/
     /*Must make some changes in subroutines as well. */
-    opfn3 = (char *) malloc(FILELEN+5);
-    if (!opfn3) exit(FM_IO_ERR);
     sprintf(opfn3,"%s/fmsnow_cat_%s_%4d%02d%02d%02d%02d.mitiff", 
-	cfg.productpath,pname,
-	img.yy, img.mm, img.dd, img.ho, img.mi);
-    sprintf(what,"Creating output file: %s", opfn3);
-    fmlogmsg(where,what);
-    image_type = 1;
-    store_snow(opfn3,cat,clinfo,image_type);
-
+	cfg->productpath,area,
+	t.fm_year, t.fm_mon, t.fm_mday, t.fm_hour, t.fm_min);
+    if (strlen(cfg->cubepath) > 0) {
+	fmsnowcube_name(cfg->cubepath, area, opfn1);
+    }
 
     /*
      * Add information on processed scenes, time and area
      * identifications as well as valid image data coverage within the
-     * tile and estimated cloud free coverage of the scene.
+     * tile and estimated cloud free coverage of the scene. The index
+     * file is updated when all products are written.
      */
-    printf(" cover: %f\n",img.cover);
-    cloudfree = findcloudfree(ice.d,img.iw,img.ih);
-    fmsec19702isodatetime(tofmsec1970(reftime), datestr);
-    if (updateindexfile(cfg.indexfile,fname,opfn1,datestr,pname,img.cover,cloudfree)) {
-	fmerrmsg(where,"Could not update %s", cfg.indexfile);
+    memset(&rec,0,sizeof(fmsnowindexrec));
+    fmsec19702isodatetime(tofmsec1970(t), datestr);
+    snprintf(rec.indexfile,FILELEN,"%s",cfg->indexfile);
+    snprintf(rec.avhrrfile,FILELEN,"%s",sname);
+    snprintf(rec.productfile,FILELEN,"%s",opfn1);
+    snprintf(rec.datetime,25,"%s",datestr);
+    snprintf(rec.area,8,"%s",area);
+    rec.cover = cover;
+    rec.cloudfree = cloudfree;
+    rec.cnt = *cnt;
+
+    if (!sc) sc = fmsnowwriter_scene(wr);
+    if (!sc) {
+	free(classed);
+	free(cat);
+	free_osihdf(&ice);
+	return(FM_MEMALL_ERR);
+    }
+    /*
+     * The rows and columns with valid data, fmaccusnow skips the rest.
+     * The product is written without extent if it can not be found.
+     * With CUBEPATH the pass is added to the cube of the tile instead.
+     */
+    if (strlen(cfg->cubepath) > 0) {
+	fmsnowwriter_cube(wr, sc, "cube", opfn1, area, ice,
+		tofmsec1970(t), cover, cloudfree);
+    } else if (find_pass_extent((float *) ice.d[0].data, ice.h.iw, ice.h.ih,
+		&ext) == FM_OK) {
+	fmsnowwriter_hdf5extent(wr, sc, "hdf5", opfn1, ice, &ext);
+    } else {
+	fmsnowwriter_hdf5(wr, sc, "hdf5", opfn1, ice);
     }
+    if (mitiff) {
+	fmsnowwriter_mitiff(wr, sc, "mitiff", opfn2, classed, clinfo, 0);
+	fmsnowwriter_mitiff(wr, sc, "mitiffcat", opfn3, cat, clinfo, 1);
+    } else {
+	free(classed);
+	free(cat);
+    }
+    fmsnowwriter_close(wr, sc, index ? &rec : NULL);
 
+    return(FM_OK);
+}
 
-    fprintf(stdout," ================================================\n");
-    free(opfn1);
-    free(opfn2);
-    free(opfn3);
+/*
+ * NAME:
+ * process_quicklook
+ *
+ * PURPOSE:
+ * To classify every stride pixel of the scene in each direction and hand
+ * the quick-look product to the writer.
+ *
+ * NOTES:
+ * The quick-look is named fmsnowql_<tile>_<date>, it is not added to the
+ * index file. The files are removed by the writer when the full
+ * resolution products of the scene are written. If the quick-look can
+ * not be written it is reported, but the scene is indexed as usual.
+ */
+static int process_quicklook(fmio_img img, unsigned char *lmask,
+	landspans *land, nwpice nwp, char *pname, cfgstruct *cfg, statcoeffstr *coeffs,
+	int mitiff, int stride, fmsnowwriter *wr, fmsnowwscene *sc,
+	fmsnowtimer *timer) {
 
-    /*M vel med?*/
-    free(classed);
-    free(cat);
-    free_osihdf(&ice);
+    char *where="process_quicklook";
+    char opfn1[FILELEN+5], opfn2[FILELEN+5], opfn3[FILELEN+5];
+    unsigned char *classed, *cat;
+    fmio_mihead clinfo = {
+	"Not known",
+	00, 00, 00, 00, 0000, -9, 
+	{0, 0, 0, 0, 0, 0, 0, 0}, 
+	0, 0, 0, 0., 0., -999., -999.
+    };
+    osihdf ql;
+    osi_dtype ql_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    char *ql_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
+    int size;
 
-    exit(FM_OK);
+    fmsnowtimer_start(timer, "quicklook");
+    init_osihdf(&ql);
+    sprintf(ql.h.source, "%s", img.sa);
+    sprintf(ql.h.product, "%s", "fmsnowcover");
+    ql.h.iw = (img.iw+stride-1)/stride;
+    ql.h.ih = (img.ih+stride-1)/stride;
+    ql.h.z = FMSNOWCOVER_OLEVELS;
+    ql.h.Ax = img.Ax*stride;
+    ql.h.Ay = img.Ay*stride;
+    ql.h.Bx = img.Bx;
+    ql.h.By = img.By;
+    ql.h.year = img.yy;
+    ql.h.month = img.mm;
+    ql.h.day = img.dd;
+    ql.h.hour = img.ho;
+    ql.h.minute = img.mi;
+    size = ql.h.iw*ql.h.ih;
+    classed = (unsigned char *) malloc(size*sizeof(char));
+    cat = (unsigned char *) malloc(size*sizeof(char));
+    if (malloc_osihdf(&ql,ql_ft,ql_desc) || !classed || !cat) {
+	fmerrmsg(where,"Could not allocate quick-look");
+	if (classed) free(classed);
+	if (cat) free(cat);
+	fmsnowtimer_stop(timer, "quicklook");
+	return(FM_MEMALL_ERR);
+    }
+
+    fmlogmsg(where,"Estimating ice probability for every %d pixel", stride);
+    process_pixels4ice(img, NULL, lmask, land, nwp, ql.d, classed, cat, 2, stride,
+	    coeffs, NULL);
+    fmsnowtimer_stop(timer, "quicklook");
+
+    sprintf(clinfo.satellite,"%s",img.sa);
+    clinfo.hour = img.ho;
+    clinfo.minute = img.mi;
+    clinfo.day = img.dd;
+    clinfo.month = img.mm;
+    clinfo.year = img.yy;
+    clinfo.zsize = 1;
+    clinfo.xsize = ql.h.iw;
+    clinfo.ysize = ql.h.ih;
+    clinfo.Ax = ql.h.Ax;
+    clinfo.Ay = ql.h.Ay;
+    clinfo.Bx = ql.h.Bx;
+    clinfo.By = ql.h.By;
+
+    sprintf(opfn1,"%s/fmsnowql_%s_%4d%02d%02d%02d%02d.hdf5", 
+	cfg->productpath,pname,
+	img.yy, img.mm, img.dd, img.ho, img.mi);
+    sprintf(opfn2,"%s/fmsnowql_%s_%4d%02d%02d%02d%02d.mitiff", 
+	cfg->productpath,pname,
+	img.yy, img.mm, img.dd, img.ho, img.mi);
+    sprintf(opfn3,"%s/fmsnowql_cat_%s_%4d%02d%02d%02d%02d.mitiff", 
+	cfg->productpath,pname,
+	img.yy, img.mm, img.dd, img.ho, img.mi);
+
+    /*
+     * The files are given to fmsnowwriter_replace before they are
+     * submitted, so that a quick-look that can not be written does not
+     * fail the full resolution products of the scene.
+     */
+    fmsnowwriter_replace(wr, sc, opfn1);
+    fmsnowwriter_hdf5(wr, sc, "qlhdf5", opfn1, ql);
+    if (mitiff) {
+	fmsnowwriter_replace(wr, sc, opfn2);
+	fmsnowwriter_replace(wr, sc, opfn3);
+	fmsnowwriter_mitiff(wr, sc, "qlmitiff", opfn2, classed, clinfo, 0);
+	fmsnowwriter_mitiff(wr, sc, "qlmitiffcat", opfn3, cat, clinfo, 1);
+    } else {
+	free(classed);
+	free(cat);
+    }
+
+    return(FM_OK);
 }
 
 /*
@@ -463,11 +1286,67 @@ void usage() {
     fprintf(stdout,"\n");
     fprintf(stdout," SYNTAX:\n");
     fprintf(stdout,
-	    " ice_avhrr -c <cfgfile> -i <infile>\n\n");
+	    " ice_avhrr -c <cfgfile> -i <infile> [-i <infile> ...]\n");
+    fprintf(stdout,
+	    "   [-w <writers>] [-n] [-M <metricsfile>] [-d <date_end>]\n");
+    fprintf(stdout,
+	    "   [-p <period>] [-l] [-r <window> | -g <box>] [-o <roidir>]\n");
+    fprintf(stdout,
+	    "   [-q <stride>] [-L] [-T <tracefile>]\n");
+    fprintf(stdout,
+	    " ice_avhrr -c <cfgfile> -s <stream> [-x] [-w <writers>] [-n]\n");
+    fprintf(stdout,
+	    "   [-M <metricsfile>] [-d <date_end>] [-p <period>]\n");
+    fprintf(stdout,
+	    "   [-T <tracefile>]\n\n");
     fprintf(stdout,
 	    " <cfgfile>: Configuration file containing data paths etc.\n");
     fprintf(stdout,
 	    " <infile>: Input METSAT file, path is taken from cfgfile.\n");
+    fprintf(stdout,
+	    " <writers>: Threads writing products, 0 writes them in turn\n");
+    fprintf(stdout,
+	    "   (default %d).\n", FMSNOWCOVER_WRITERS);
+    fprintf(stdout,
+	    " -n: No MITIFF images, use fmsnowrender to make them.\n");
+    fprintf(stdout,
+	    " <metricsfile>: File the timing report of the run is appended to.\n");
+    fprintf(stdout,
+	    " <date_end>: End of time window as yyyymmddhh (default now).\n");
+    fprintf(stdout,
+	    " <period>: Length of time window in hours, scenes outside are\n");
+    fprintf(stdout,
+	    "   skipped.\n");
+    fprintf(stdout,
+	    " -l: List tile, satellite, time, cover and status of the input\n");
+    fprintf(stdout,
+	    "   files from their headers, nothing is processed.\n");
+    fprintf(stdout,
+	    " <window>: Region of interest as col0,row0,col1,row1 (pixels).\n");
+    fprintf(stdout,
+	    " <box>: Region of interest as latmin,lonmin,latmax,lonmax.\n");
+    fprintf(stdout,
+	    " <roidir>: Directory of region of interest products.\n");
+    fprintf(stdout,
+	    " <stride>: Write a quick-look of every stride pixel first, it is\n");
+    fprintf(stdout,
+	    "   removed when the full resolution products are written.\n");
+    fprintf(stdout,
+	    " -L: Land only, sea pixels of the land/sea mask are not processed\n");
+    fprintf(stdout,
+	    "   and set to %d.\n", FMSNOWCOVERMISVAL_SEA);
+    fprintf(stdout,
+	    " <tracefile>: Timeline of the run for chrome://tracing or\n");
+    fprintf(stdout,
+	    "   Perfetto, see fmsnowtrace.c.\n");
+    fprintf(stdout,
+	    " <stream>: Read scenes from a named pipe or file, - for stdin.\n");
+    fprintf(stdout,
+	    "   The frame format is described in scenestream.c.\n");
+    fprintf(stdout,
+	    " -x: Write the products of <stream> to stdout, messages go to\n");
+    fprintf(stdout,
+	    "   stderr.\n");
     fprintf(stdout,"\n");
     fprintf(stdout," The configuration file contains all necessary data\n");
     fprintf(stdout," paths for production of ice tiles. Output names are\n");
@@ -501,6 +1380,7 @@ int decode_cfg(char cfgfile[],cfgstruct *cfg) {
 	fmerrmsg(where,"%s","Could not open config file.");
 	return(FM_IO_ERR);
     }
+    memset(cfg,0,sizeof(cfgstruct));
 
     while (fgets(dummy,FILELEN,fp) != NULL) {
 	if (strncmp(dummy,"#",1) == 0) continue;
@@ -536,6 +1416,15 @@ int decode_cfg(char cfgfile[],cfgstruct *cfg) {
 	    }
 	    fmremovenewline(pt);
 	    sprintf(cfg->nwppath,"%s",pt);
+	} else if (strncmp(pt,"NWPCACHE",8) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for nwpcache.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    fmremovenewline(pt);
+	    sprintf(cfg->nwpcache,"%s",pt);
 	} else if (strncmp(pt,"CMPATH",6) == 0) {
 	    pt = strtok(NULL,token);
 	    if (!pt) {
@@ -581,6 +1470,15 @@ int decode_cfg(char cfgfile[],cfgstruct *cfg) {
 	    }
 	    fmremovenewline(pt);
 	    sprintf(cfg->indexfile,"%s",pt);
+	} else if (strncmp(pt,"CUBEPATH",8) == 0) {
+	    pt = strtok(NULL,token);
+	    if (!pt) {
+		fmerrmsg(where,"%s","strtok trouble for cubepath.");
+		free(dummy);
+		return(FM_IO_ERR);
+	    }
+	    fmremovenewline(pt);
+	    sprintf(cfg->cubepath,"%s",pt);
 	}
     }
 
@@ -593,200 +1491,39 @@ int decode_cfg(char cfgfile[],cfgstruct *cfg) {
 
 
 /*
- * NAME:
- * rdstatcoeffs
- *
- * PURPOSE:
- * To read the statistical coefficients needed in probest from file
- * with name&path given in config-file.
+ * The line is added by fmsnowindex_append, which locks the index file
+ * so that several processes can update it. A scene processed again gets
+ * a new line, fmsnowindex_read and fmsnowindex_compact keep only the
+ * last line of each scene.
  *
- */
-
-int rdstatcoeffs (char *coeffsfile, statcoeffstr *cof){
-  char *where="rdstatcoeffs";
-  char what[FMSNOWCOVER_MSGLENGTH];
-  FILE *fpi;
-  char *line = NULL;
-  ssize_t read;
-  size_t len = 0;
-  dummystr dummies = {" "," ",' ',0.,0.,0.};
-  int j, ret;
-
-  ret = 0; 
-
-  fpi = fopen(coeffsfile,"r");
-  if (!fpi) { 
-    sprintf(what,"Unable to open file %s",coeffsfile);
-    fmerrmsg(where,what);
-    return(FM_IO_ERR);
-  }
-
-  while ( (read = getline(&line,&len,fpi)) != -1 ) {
-    j = 0;
-    while ((line[j] == ' ') && j < FMSNOWCOVER_MSGLENGTH) j++;
-    if (j >= FMSNOWCOVER_MSGLENGTH) {
-      sprintf(what,"Line length exceeds maximum length");
-      fmerrmsg(where,what);
-      return(FM_IO_ERR);
-    }
-    if ((line[j] == '#') || line[j] == '\n') continue;
-    if (sscanf(line,"%s%s %c%lf%lf%lf",dummies.surf,dummies.feat,
-	       &dummies.key,&dummies.par1,&dummies.par2,&dummies.par3) != 6) {
-      sprintf(what,"Wrong format on line '%s %s..'\n",dummies.surf,
-	      dummies.feat);
-      fmerrmsg(where,what);
-      return(FM_IO_ERR);
-    }
-    else {
-      ret += locstatcoeffs(dummies,cof);
-      sprintf(dummies.surf," ");
-      sprintf(dummies.feat," ");
-      dummies.key = ' ';
-      dummies.par1 = dummies.par2 = dummies.par3 = 0.;
-    }
-  }
-
-  if (line) free(line);
-  fclose(fpi);
-  
-  return(ret);
-}
-
-/*search through statcoeffstr to find right location for parameters*/
-int locstatcoeffs (dummystr dummies, statcoeffstr *cof){
-  char *where="locstatcoeffs";
-  char what[FMSNOWCOVER_MSGLENGTH];
-  int featflg,surfflg,ret;
-
-  featflg = surfflg = 0;
- 
-  if (!strcmp(dummies.surf,"ice")) { /*strcmp returns 0 if match!*/
-    if (!strcmp(dummies.feat,"a1")) putcoeffs(&cof->ice.a1,dummies);
-    else if (!strcmp(dummies.feat,"r21")) putcoeffs(&cof->ice.r21,dummies);
-    else if (!strcmp(dummies.feat,"r3a1")) putcoeffs(&cof->ice.r3a1,dummies);
-    else if (!strcmp(dummies.feat,"r3b1")) putcoeffs(&cof->ice.r3b1,dummies);
-    else if (!strcmp(dummies.feat,"dt"))  putcoeffs(&cof->ice.dt,dummies);
-    else featflg++;
-  } 
-  else if (!strcmp(dummies.surf,"snow")) { /*strcmp returns 0 if match!*/
-    if (!strcmp(dummies.feat,"a1")) putcoeffs(&cof->snow.a1,dummies);
-    else if (!strcmp(dummies.feat,"r21")) putcoeffs(&cof->snow.r21,dummies);
-    else if (!strcmp(dummies.feat,"r3a1")) putcoeffs(&cof->snow.r3a1,dummies);
-    else if (!strcmp(dummies.feat,"r3b1")) putcoeffs(&cof->snow.r3b1,dummies);
-    else if (!strcmp(dummies.feat,"dt"))  putcoeffs(&cof->snow.dt,dummies);
-    else featflg++;
-  }
-  else if (!strcmp(dummies.surf,"cloud")) {
-    if (!strcmp(dummies.feat,"a1")) putcoeffs(&cof->cloud.a1,dummies);
-    else if (!strcmp(dummies.feat,"r21")) putcoeffs(&cof->cloud.r21,dummies);
-    else if (!strcmp(dummies.feat,"r3a1")) putcoeffs(&cof->cloud.r3a1,dummies);
-    else if (!strcmp(dummies.feat,"r3b1")) putcoeffs(&cof->cloud.r3b1,dummies);
-    else if (!strcmp(dummies.feat,"dt"))  putcoeffs(&cof->cloud.dt,dummies);
-    else featflg++;
-  }
-  else if (!strcmp(dummies.surf,"water")) {
-    if (!strcmp(dummies.feat,"a1")) putcoeffs(&cof->water.a1,dummies);
-    else if (!strcmp(dummies.feat,"r21")) putcoeffs(&cof->water.r21,dummies);
-    else if (!strcmp(dummies.feat,"r3a1")) putcoeffs(&cof->water.r3a1,dummies);
-    else if (!strcmp(dummies.feat,"r3b1")) putcoeffs(&cof->water.r3b1,dummies);
-    else if (!strcmp(dummies.feat,"dt"))  putcoeffs(&cof->water.dt,dummies);
-    else featflg++;
-  }
-  else if (!strcmp(dummies.surf,"land")) {
-    if (!strcmp(dummies.feat,"a1")) putcoeffs(&cof->land.a1,dummies);
-    else if (!strcmp(dummies.feat,"r21")) putcoeffs(&cof->land.r21,dummies);
-    else if (!strcmp(dummies.feat,"r3a1")) putcoeffs(&cof->land.r3a1,dummies);
-    else if (!strcmp(dummies.feat,"r3b1")) putcoeffs(&cof->land.r3b1,dummies);
-    else if (!strcmp(dummies.feat,"dt"))  putcoeffs(&cof->land.dt,dummies);
-    else featflg++;
-  }
-  else surfflg++;
-
-  /*
-  if (featflg || surfflg) {
-    if (featflg) sprintf(what,"Feature '%s' not recognised for surface %s\n",
-	      dummies.feat,dummies.surf);
-    if (surfflg) sprintf(what,"Surface '%s' not recognised\n",dummies.surf);
-    fmerrmsg(where,what);
-    exit(FM_OK);
-  }
-  */
-  ret = featflg+surfflg;
-  return(ret);
-}
-
-/*place stat. parameters at right location in statcoeffstr*/
-int putcoeffs(featstr *feat, dummystr dummies) {
-  feat->key  = dummies.key;
-  feat->par1 = dummies.par1;
-  feat->par2 = dummies.par2;
-  feat->par3 = dummies.par3;
-  feat->count++; /*will equal the number of times a specific set of
-		    parameters are read. Should ideally not differ from one..*/
-  return(FM_OK);
-}
-
-float findcloudfree(datafield *d, int xsize, int ysize) {
-    char *where="findcloudfree";
-    int i, validpixels;
-    float cloudfree, notcovered;
-
-    for (i=0;i<FMSNOWCOVER_OLEVELS;i++) {
-	if (d[i].type != OSI_FLOAT) {
-	    fmerrmsg(where,"Data layer with wrong type %d.", i);
-	    exit(FM_OTHER_ERR);
-	}
-    }
-    notcovered = cloudfree = 0;
-    for (i=0;i<(xsize*ysize);i++) {
-	if (((float *) d[0].data)[i] == FMSNOWCOVERMISVAL_NOCOV) notcovered++;
-	if (((float *) d[0].data)[i] > ((float *) d[1].data)[i] > ((float *) 
-	    d[2].data)[i]) {
-	    cloudfree++;
-	} else if (((float *) d[1].data)[i] > ((float *) d[0].data)[i] > ((float *) d[2].data)[i]) {
-	    cloudfree++;
-	}
-    }
-
-    notcovered /= (xsize*ysize);
-    cloudfree /= ((xsize*ysize)-notcovered);
-    printf(" cloudfree: %f\n", cloudfree);
-    printf(" notcovered: %f\n", notcovered);
-
-    return(cloudfree);
-}
-
-/*
- * This only updates the index file, no checking of duplicates etc is
- * done, that is taken care of by the process_snow script.
+ * If cnt is given the scene statistics of pixcount2str are appended to
+ * the line after the fixed columns.
  */
 int updateindexfile(char *filename, char *avhrrfile, char *fmsnowfile,
-    char *datetime, char *areaname, float validraw, float cloudfree) {
+    char *datetime, char *areaname, float validraw, float cloudfree,
+    pixcountstr *cnt) {
 
     char *where="updateindexfile";
     char productfname[100], *pt;
-    FILE *fp;
+    char counts[FMSNOWPIX_STRLEN];
+    char line[FMSNOWPIX_STRLEN+FILELEN+200];
 
     fmlogmsg(where,"Updating product directory index file.");
 
     pt = rindex(fmsnowfile,'/');
-    sprintf(productfname,"%s",pt+1);
+    sprintf(productfname,"%s",pt ? pt+1 : fmsnowfile);
 
-    fp = fopen(filename,"a");
-    if (! fp) {
-	fmerrmsg(where,"Could not open %s",filename);
-	return(FM_IO_ERR);
+    snprintf(line,sizeof(line),"%s %s %s %s %.0f %.0f",
+	    datetime, avhrrfile, productfname, areaname, validraw,
+	    cloudfree*100.);
+    if (cnt && pixcount2str(cnt,counts,FMSNOWPIX_STRLEN) == FM_OK) {
+	strcat(line," ");
+	strcat(line,counts);
     }
+    strcat(line,"\n");
 
-    fprintf(fp,"%s ",datetime);
-    fprintf(fp,"%s ",avhrrfile);
-    fprintf(fp,"%s ",productfname);
-    fprintf(fp,"%s ",areaname);
-    fprintf(fp,"%.0f ",validraw);
-    fprintf(fp,"%.0f\n",cloudfree*100.);
-
-    if (fclose(fp)) {
-	fmerrmsg(where,"Could not properly close %s", filename);
+    if (fmsnowindex_append(filename, line)) {
+	fmerrmsg(where,"Could not add %s to %s", avhrrfile, filename);
 	return(FM_IO_ERR);
     }
 
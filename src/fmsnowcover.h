@@ -40,11 +40,34 @@
  * Mari Anne Killie, METNO/FOU, 26.08.2008: Added A3b in struct
  * pinpstr and edited for r3a1/r3b1 in struct surfstr
  * Mari Anne Killie, METNO/FOU, 08.05.2009: snow added, d34 removed.
+ * ystein Gody, METNO/FOU, 19.10.2026: statcoeffstr holds classes and
+ * features as tables read from the coefficient file.
+ * ystein Gody, METNO/FOU, 19.10.2026: fmsnowtimer.h included for stage
+ * timing.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added pixcountstr.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added nwpcache to cfgstruct.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added FMSNOWCOVER_MAXSCENES and
+ * FMSNOWCOVER_WRITERS.
+ * ystein Gody, METNO/FOU, 19.10.2026: Scene statistics added to
+ * pixcountstr, findcloudfree removed.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowindex functions.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowprobe.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowroi.
+ * ystein Gody, METNO/FOU, 19.10.2026: Guarded against repeated inclusion,
+ * as fmsnowlib.h includes it.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowprobe_header.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added cubepath to cfgstruct.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added FMSNOWCOVERMISVAL_SEA,
+ * FMSNOWPIX_SEA and landspans.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added FMSNOWSAT3ACOUNT.
  *
  * CVS_ID:
  * $Id: fmsnowcover.h,v 1.13 2012-01-04 11:37:07 mariak Exp $
  */ 
 
+#ifndef _FMSNOWCOVER_H
+#define _FMSNOWCOVER_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +77,7 @@
 #include <fmutil.h>
 #include <fmio.h>
 #include <getnwp.h>
+#include <fmsnowtimer.h>
 
 #define FMSNOWCOVER_MSGLENGTH 255 /* String length for system messages */
 #define MAXCHANNELS 6
@@ -63,11 +87,15 @@
 #define DUMMYSTR 100
 #define NWP_NOFIELDS 5
 #define FMSNOWCOVER_OLEVELS 3 /* Number of output levels */
+#define FMSNOWCOVER_MAXSCENES 64 /* Input files in one run */
+#define FMSNOWCOVER_WRITERS 3 /* Default number of writer threads */
 #define FMSNOWCOVERMISVAL_NOCOV -991 
 #define FMSNOWCOVERMISVAL_NIGHT -990 
 #define FMSNOWCOVERMISVAL_LAND -992
 #define FMSNOWCOVERMISVAL_3A -993
+#define FMSNOWCOVERMISVAL_SEA -994 /* sea, land only products */
 #define FMSNOWSUNZEN 85.
+#define FMSNOWSAT3ACOUNT 50 /* T4 count above which missing 3A is saturated */
 #define FMSNOWSEA 0 
 #define FMSNOWLAND 191 /*works better than 255?!*/
 /*The following 5 can be removed:*/
@@ -98,11 +126,13 @@
 typedef struct {
     char imgpath[FILELEN];
     char nwppath[FILELEN];
+    char nwpcache[FILELEN];
     char cmpath[FILELEN];
     char lmpath[FILELEN];
     char productpath[FILELEN];
     char probtabname[FILELEN];
     char indexfile[FILELEN];
+    char cubepath[FILELEN];
 } cfgstruct;
 
 /*
@@ -146,6 +176,35 @@ typedef struct {
     double pcloud;
 } probstr;
 
+/*
+ * Surface regimes determined from the land/sea mask and channel modes
+ * (3A or 3B daytime) used to select classes and features in probest.
+ */
+#define FMSNOWREGSEA 0
+#define FMSNOWREGLAND 1
+#define FMSNOWREGCOAST 2
+#define FMSNOWREGIMES 3
+#define FMSNOWREGMASK(r) (1<<(r))
+#define FMSNOWMODE3A 0
+#define FMSNOWMODE3B 1
+#define FMSNOWMODES 2
+#define FMSNOWMODEMASK(m) (1<<(m))
+
+/*
+ * Features probest is able to evaluate, see statcoeffs.c for the names
+ * used in the coefficient table.
+ */
+#define FMSNOWFEAT_A1 0   /* A1/cos(soz) */
+#define FMSNOWFEAT_R21 1  /* A2/A1 */
+#define FMSNOWFEAT_R3A1 2 /* A3/A1 */
+#define FMSNOWFEAT_R3B1 3 /* A3b/(A1/cos(soz)) */
+#define FMSNOWFEAT_DT 4   /* T(NWP)-T4 */
+#define FMSNOWFEAT_T45 5  /* T4-T5 */
+
+#define FMSNOWMAXCLASSES 10
+#define FMSNOWMAXFEATS 10
+#define FMSNOWNAMELEN 10
+
 /*
  * Data structure to hold probability coefficients read from file 
  */
@@ -155,33 +214,139 @@ typedef struct { /*struct for coefficients!*/
   double par2;
   double par3;
   int count; /*counts the number of times coeffs are read!*/
+  double c0; /*normalisation terms set by buildstatcoeffs*/
+  double c1;
 } featstr;
 
 typedef struct {
-  featstr a1;
-  featstr r21;
-  featstr r3a1;
-  featstr r3b1;
-  featstr dt;
-} surfstr;
+  char name[FMSNOWNAMELEN];
+  short declared;
+  short output; /*0: P(ice/snow), 1: P(water/land), 2: P(cloud)*/
+  short regimes; /*FMSNOWREGMASK of regimes where class is used*/
+  double prior;
+} classstr;
+
+typedef struct {
+  char name[FMSNOWNAMELEN];
+  short id; /*FMSNOWFEAT_...*/
+  short declared;
+} featdefstr;
 
+/*
+ * Classes and features with the coefficients for each combination
+ * (par[class][feature]). nact/act and nuse/use are the lists of classes
+ * used in each surface regime and features used in each channel mode,
+ * created by buildstatcoeffs.
+ */
 typedef struct {
-  surfstr ice;
-  surfstr snow;
-  surfstr cloud;
-  surfstr water;
-  surfstr land;
+  int nclass;
+  int nfeat;
+  int featdecl;
+  classstr cls[FMSNOWMAXCLASSES];
+  featdefstr feat[FMSNOWMAXFEATS];
+  featstr par[FMSNOWMAXCLASSES][FMSNOWMAXFEATS];
+  int nact[FMSNOWREGIMES];
+  short act[FMSNOWREGIMES][FMSNOWMAXCLASSES];
+  int nuse[FMSNOWMODES];
+  short use[FMSNOWMODES][FMSNOWMAXFEATS];
 } statcoeffstr;
 
+/*
+ * Pixel counters for the ways a pixel can leave process_pixels4ice.
+ * Pixels reaching the 3A check or probest are also counted by surface
+ * regime, channel mode and whether NWP data were used.
+ */
+#define FMSNOWPIX_NIGHT 0     /* sun below FMSNOWSUNZEN */
+#define FMSNOWPIX_NOCOV 1     /* no infrared data */
+#define FMSNOWPIX_3A 2        /* 3A saturation hack */
+#define FMSNOWPIX_PROBSUM 3   /* probabilities do not sum to 1 */
+#define FMSNOWPIX_NAN 4       /* NaN probabilities */
+#define FMSNOWPIX_OK 5        /* classified */
+#define FMSNOWPIX_SEA 6       /* sea, not processed in land only mode */
+#define FMSNOWPIX_EXITS 7
+#define FMSNOWPIX_NWPMODES 2  /* without or with NWP data */
+#define FMSNOWPIX_PCLASSES 21 /* classes of pice2class */
+#define FMSNOWPIX_STRLEN 512  /* length of pixcount2str output */
+
+/*
+ * Statistics of classified pixels are accumulated in the same pass: the
+ * classes of the MITIFF images and the sum of P(ice/snow) by regime.
+ */
 typedef struct {
-  char feat[10];
-  char surf[10];
-  char key;
-  double par1;
-  double par2;
-  double par3;
-} dummystr;
-  
+    long exits[FMSNOWPIX_EXITS];
+    long regime[FMSNOWPIX_EXITS][FMSNOWREGIMES][FMSNOWMODES][FMSNOWPIX_NWPMODES];
+    long pclass[FMSNOWPIX_PCLASSES];
+    long cat[CATLIMITS+1];
+    double psnow[FMSNOWREGIMES];
+} pixcountstr;
+
+/*
+ * Header information of an input scene found by fmsnowprobe_scene,
+ * scenes with status other than FMSNOWPROBE_OK are not read in full.
+ */
+#define FMSNOWCOVER_MINCOVER 40. /* Minimum coverage of tile (%) */
+#define FMSNOWPROBE_OK 0
+#define FMSNOWPROBE_NOTILE 1      /* tile not recognised */
+#define FMSNOWPROBE_UNREADABLE 2  /* header could not be read */
+#define FMSNOWPROBE_LOWCOVER 3    /* coverage below FMSNOWCOVER_MINCOVER */
+#define FMSNOWPROBE_OUTSIDE 4     /* outside the time window */
+
+typedef struct {
+    char area[8]; /* tile in product names */
+    char lmtile[8]; /* tile of land/sea mask */
+    char sa[32];
+    fmsec1970 time;
+    float cover;
+    unsigned int iw;
+    unsigned int ih;
+    int status;
+} fmsnowprobe;
+
+/*
+ * Region of interest, a pixel window or latitude/longitude box within
+ * the tile. The window is found for each scene by fmsnowroi_window.
+ */
+#define FMSNOWROI_NONE 0
+#define FMSNOWROI_PIXEL 1 /* col0,row0,col1,row1 */
+#define FMSNOWROI_GEO 2   /* latmin,lonmin,latmax,lonmax */
+
+typedef struct {
+    int type;
+    double v[4];
+    int col0; /* window in the tile */
+    int row0;
+    int iw;
+    int ih;
+} fmsnowroi;
+
+/*
+ * Row spans of land and coast pixels (land/sea mask above FMSNOWSEA)
+ * of a tile, the spans of row r are row[r] to row[r+1]-1. Only these
+ * pixels are processed in land only mode.
+ */
+#define FMSNOWSPANS_SUFFIX ".spans" /* cache next to the land/sea mask */
+
+typedef struct {
+    int iw;
+    int ih;
+    int nspans;
+    int *row; /* ih+1 offsets into first and last */
+    int *first;
+    int *last;
+} landspans;
+
+/*
+ * Exit status and resources used by a command run by the benchmark
+ * drivers.
+ */
+typedef struct {
+    int status;
+    double wall;
+    double user;
+    double sys;
+    long maxrss;
+} runstat;
+
 /*
  * Prototypes
  */
@@ -190,23 +355,61 @@ void usage(void);
 int decode_cfg(char cfgfile[],cfgstruct *cfg);
 
 int process_pixels4ice(fmio_img img, 
-    unsigned char *cmask[], unsigned char *lmask, nwpice nwp, 
-    datafield *probs, unsigned char *class, unsigned char *cat,
-    short algo, statcoeffstr cof);
+    unsigned char *cmask[], unsigned char *lmask, landspans *land,
+    nwpice nwp, datafield *probs, unsigned char *class, unsigned char *cat,
+    short algo, int stride, statcoeffstr *cof, pixcountstr *cnt);
+unsigned char pice2class(double pice);
+unsigned char probs2cat(probstr *p);
+void initpixcount(pixcountstr *cnt);
+void mergepixcount(pixcountstr *dst, pixcountstr *src);
+int pixcount2timer(pixcountstr *cnt, fmsnowtimer *tm);
+int pixcount2str(pixcountstr *cnt, char *str, int len);
+float pixcount2cloudfree(pixcountstr *cnt);
+float pixcount2psnow(pixcountstr *cnt, int reg);
 
 void moment(float data[], int n, float *ave, float *adev, float *sdev,
     float *var, float *skew, float *curt);
 
-int probest(pinpstr cpa, probstr *p, statcoeffstr cof);
+int probest(pinpstr cpa, probstr *p, statcoeffstr *cof);
+int lmask2regime(short lmask);
 double gammapdf(double alpha, double beta, double x);
 double normalpdf(double mean, double sdev, double x);
 
 /*void store_mitiff_result(char *outfile,unsigned char *icep,fmio_mihead img);*/
 /*void store_mitiff_cat(char *outfile, unsigned char *cat, fmio_mihead img);*/
+int initstatcoeffs(statcoeffstr *cof);
 int rdstatcoeffs(char *coeffsfile, statcoeffstr *coeffs);
-double findprob(featstr feat, double x, char *whereami);
-int locstatcoeffs (dummystr dummies, statcoeffstr *cof);
-int putcoeffs(featstr *feat, dummystr dummies);
-float findcloudfree(datafield *d, int xsize, int ysize);
+int parsestatcoeffline(char *line, statcoeffstr *cof);
+int buildstatcoeffs(statcoeffstr *cof);
+double findprob(featstr *feat, double x, char *whereami);
+void synthseed(unsigned long seed);
+double synthuniform(void);
+double synthgauss(void);
+double synthgamma(double alpha, double beta);
+int synthpixels(statcoeffstr *cof, int reg, int mode, pinpstr *pix,
+    int npix);
+int runcommand(char *argv[], char *logfile, runstat *rs);
+int readtimerline(char *logfile, long offset, char *line, int len);
+double timerfield(char *line, char *key);
 int updateindexfile(char *filename, char *avhrrfile, char *fmsnowfile,
-    char *datetime, char *areaname, float validraw, float cloudfree); 
+    char *datetime, char *areaname, float validraw, float cloudfree,
+    pixcountstr *cnt);
+int fmsnowindex_append(char *filename, char *line);
+int fmsnowindex_read(char *filename, FILE *fp);
+int fmsnowindex_compact(char *filename, long keep);
+int fmsnowprobe_scene(char *infile, char *fname, fmsec1970 stime,
+    fmsec1970 etime, fmsnowprobe *pr);
+int fmsnowprobe_header(char *tile, char *sa, fmsec1970 reftime,
+    float cover, unsigned int iw, unsigned int ih, fmsec1970 stime,
+    fmsec1970 etime, fmsnowprobe *pr);
+char *fmsnowprobe_status(int status);
+int fmsnowroi_parse(char *arg, int type, fmsnowroi *roi);
+int fmsnowroi_window(fmsnowroi *roi, fmucsref ref);
+int fmsnowroi_cropimg(fmio_img *img, fmsnowroi *roi);
+int fmsnowroi_cropprod(osihdf *p, fmsnowroi *roi);
+int find_land_spans(unsigned char *lmask, int iw, int ih, landspans *ls);
+int read_land_spans(char *lmaskf, int iw, int ih, landspans *ls);
+int write_land_spans(char *lmaskf, landspans *ls);
+void free_land_spans(landspans *ls);
+
+#endif /* _FMSNOWCOVER_H */
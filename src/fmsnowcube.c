@@ -0,0 +1,109 @@
+/*
+ * NAME:
+ * fmsnowcube
+ *
+ * PURPOSE:
+ * To list the passes of a cube written by fmsnowcover, or to remove old
+ * passes from it.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Cube of a tile (fmsnowcube_<tile>.hdf5 in CUBEPATH).
+ * o Number of days to keep (optional).
+ *
+ * OUTPUT:
+ * Without -k the passes of the cube are listed on stdout, one line with
+ * slot, time, satellite, coverage and cloud free fraction for each. With
+ * -k passes older than the number of days given are removed, their
+ * slots are reused by later passes.
+ *
+ * NOTES:
+ * The cube is locked while read or updated, so fmsnowcube can be run
+ * while fmsnowcover is appending to it. See snowcube.c.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+#include <unistd.h>
+#include <time.h>
+
+static void cubeusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowcube";
+    extern char *optarg;
+    char *cubefile = NULL, timestr[DATESTRINGLENGTH];
+    int i, ret, npass, ndropped;
+    long keep = -1;
+    fmsnowcube cube;
+
+    while ((ret = getopt(argc, argv, "i:k:")) != EOF) {
+	switch (ret) {
+	    case 'i':
+		cubefile = optarg;
+		break;
+	    case 'k':
+		keep = atol(optarg)*24*3600;
+		if (keep < 0) cubeusage();
+		break;
+	    default:
+		cubeusage();
+	}
+    }
+    if (!cubefile) cubeusage();
+
+    if (keep >= 0) {
+	if (fmsnowcube_drop(cubefile, (fmsec1970) (time(NULL)-keep),
+		    &ndropped)) {
+	    fmerrmsg(where,"Could not remove passes from %s", cubefile);
+	    exit(FM_IO_ERR);
+	}
+	fmlogmsg(where,"Removed %d passes from %s", ndropped, cubefile);
+    } else {
+	if (fmsnowcube_open(cubefile, &cube)) {
+	    fmerrmsg(where,"Could not open %s", cubefile);
+	    exit(FM_IO_ERR);
+	}
+	fprintf(stdout,"# %s tile %s %dx%d, %d slots\n", cube.fname,
+		cube.tile, cube.ref.iw, cube.ref.ih, cube.nslots);
+	npass = 0;
+	for (i=0;i<cube.nslots;i++) {
+	    if (cube.pass[i].time == 0) continue;
+	    fmsec19702isodatetime(cube.pass[i].time, timestr);
+	    fprintf(stdout,"%d %s %s %.3f %.3f\n", i, timestr,
+		    cube.pass[i].satellite, cube.pass[i].cover,
+		    cube.pass[i].cloudfree);
+	    npass++;
+	}
+	fprintf(stdout,"# %d passes\n", npass);
+	fmsnowcube_close(&cube);
+    }
+
+    exit(FM_OK);
+}
+
+static void cubeusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout," fmsnowcube -i <cube> [-k <days>]\n\n");
+    fprintf(stdout," <cube>: Cube of a tile written by fmsnowcover,\n");
+    fprintf(stdout,"   fmsnowcube_<tile>.hdf5 in CUBEPATH.\n");
+    fprintf(stdout," <days>: Remove passes older than this, otherwise the\n");
+    fprintf(stdout,"   passes are listed on stdout.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
@@ -0,0 +1,88 @@
+/*
+ * NAME:
+ * fmsnowcube.h
+ *
+ * PURPOSE:
+ * Per tile store of the pass products of fmsnowcover, one HDF5 file
+ * with all passes of a tile as time x y x x datacubes.
+ *
+ * NOTES:
+ * See snowcube.c for the layout and encoding. Included by
+ * fmaccusnow.h.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Noted the encoding of sea pixels.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _FMSNOWCUBE_H
+#define _FMSNOWCUBE_H
+
+#include <hdf5.h>
+
+#define FMSNOWCUBE_PREFIX "fmsnowcube_" /* fmsnowcube_<tile>.hdf5 */
+#define FMSNOWCUBE_LEVELS 3 /* P(ice/snow), P(water/land), P(cloud) */
+#define FMSNOWCUBE_TCHUNK 16 /* passes in a chunk */
+#define FMSNOWCUBE_SCHUNK 64 /* rows and columns in a chunk */
+#define FMSNOWCUBE_SATLEN 32
+
+/*
+ * Encoding of the probabilities, 0-FMSNOWCUBE_SCALE is the probability
+ * times FMSNOWCUBE_SCALE, the rest are the missing values of
+ * fmsnowcover.
+ */
+#define FMSNOWCUBE_SCALE 250
+#define FMSNOWCUBE_NOCOV 251
+#define FMSNOWCUBE_NIGHT 252
+#define FMSNOWCUBE_LAND 253
+#define FMSNOWCUBE_3A 254
+#define FMSNOWCUBE_FILL 255 /* not written, read as no coverage */
+
+/*
+ * Sea pixels of land only products (FMACCUSNOWMISVAL_SEA) are stored as
+ * FMSNOWCUBE_FILL, fmaccusnow treats both as undefined.
+ */
+
+/*
+ * A slot of the cube, time is 0 for free slots.
+ */
+typedef struct {
+    fmsec1970 time;
+    char satellite[FMSNOWCUBE_SATLEN];
+    float cover;
+    float cloudfree;
+} fmsnowcubepass;
+
+/*
+ * A cube opened for reading.
+ */
+typedef struct {
+    char fname[FILELEN];
+    char tile[16];
+    char area[16];
+    char product[128];
+    char projstr[128];
+    fmucsref ref;
+    int nslots;
+    fmsnowcubepass *pass;
+    float value[256]; /* decoded values */
+    int lockfd;
+    hid_t fid;
+    hid_t layer[FMSNOWCUBE_LEVELS];
+} fmsnowcube;
+
+int fmsnowcube_name(char *dir, char *tile, char *fname);
+int fmsnowcube_append(char *fname, char *tile, osihdf *prod,
+    fmsec1970 time, float cover, float cloudfree);
+int fmsnowcube_open(char *fname, fmsnowcube *cb);
+int fmsnowcube_read(fmsnowcube *cb, int slot0, int nslots, int col0,
+    int row0, int w, int h, unsigned char *buf[FMSNOWCUBE_LEVELS]);
+void fmsnowcube_close(fmsnowcube *cb);
+int fmsnowcube_drop(char *fname, fmsec1970 before, int *ndropped);
+
+#endif /* _FMSNOWCUBE_H */
@@ -0,0 +1,93 @@
+/*
+ * NAME:
+ * fmsnowindex
+ *
+ * PURPOSE:
+ * To list or compact the index file of processed scenes written by
+ * fmsnowcover.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Index file.
+ * o Number of days to keep (optional).
+ *
+ * OUTPUT:
+ * Without -c the index is written to stdout with only the last line of
+ * each scene. With -c the index file is rewritten that way, scenes older
+ * than the number of days given are removed.
+ *
+ * NOTES:
+ * The index is locked while read or rewritten, so fmsnowindex can be run
+ * while fmsnowcover is updating it. See indexfile.c.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <unistd.h>
+
+static void indexusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowindex";
+    extern char *optarg;
+    char *indexfile = NULL;
+    int ret, cflg = 0;
+    long keep = 0;
+
+    while ((ret = getopt(argc, argv, "i:ck:")) != EOF) {
+	switch (ret) {
+	    case 'i':
+		indexfile = optarg;
+		break;
+	    case 'c':
+		cflg++;
+		break;
+	    case 'k':
+		keep = atol(optarg)*24*3600;
+		break;
+	    default:
+		indexusage();
+	}
+    }
+    if (!indexfile || keep < 0) indexusage();
+
+    if (cflg) {
+	if (fmsnowindex_compact(indexfile, keep)) {
+	    fmerrmsg(where,"Could not compact %s", indexfile);
+	    exit(FM_IO_ERR);
+	}
+    } else {
+	if (fmsnowindex_read(indexfile, stdout)) {
+	    fmerrmsg(where,"Could not read %s", indexfile);
+	    exit(FM_IO_ERR);
+	}
+    }
+
+    exit(FM_OK);
+}
+
+static void indexusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout," fmsnowindex -i <indexfile> [-c] [-k <days>]\n\n");
+    fprintf(stdout," <indexfile>: Index file of fmsnowcover (INDEXFILE).\n");
+    fprintf(stdout," -c: Rewrite the index with one line for each scene,\n");
+    fprintf(stdout,"   otherwise the index is listed that way on stdout.\n");
+    fprintf(stdout," <days>: Remove scenes older than this with -c.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
@@ -0,0 +1,272 @@
+/*
+ * NAME:
+ * fmsnowlib
+ *
+ * PURPOSE:
+ * To classify AVHRR data held in memory as fmsnowcover does, so that
+ * other programs (e.g. the preprocessing chain) can do the
+ * classification without writing and reading files. Built as
+ * libfmsnowcover.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Coefficient table as text, in the format of the file read by
+ *   rdstatcoeffs.
+ * o Geometry and land/sea mask of the tile.
+ * o Calibrated channels of each scene, and NWP surface temperature if
+ *   available.
+ *
+ * OUTPUT:
+ * P(ice/snow), P(water/land) and P(cloud), the classes of the MITIFF
+ * images and the categories in buffers of the caller, with the same
+ * missing values as the products of fmsnowcover.
+ *
+ * NOTES:
+ * Usage is fmsnowlib_model once, fmsnowlib_tile_init for each tile and
+ * fmsnowlib_classify for each scene. No files are read or written.
+ *
+ * The coefficients and tile are not changed by fmsnowlib_classify, so
+ * several threads may classify scenes with the same coefficients and
+ * tile at the same time as long as each has its own output buffers.
+ *
+ * The pixels are classified as in process_pixels4ice. The position of
+ * each pixel is found once for the tile, only the solar zenith angle is
+ * found for each scene. A pixel without 3A (A3 is 0) in 3A mode is
+ * taken as saturated by process_pixels4ice if the count of T4 is above
+ * FMSNOWSAT3ACOUNT. As the channels are given calibrated, T4 is compared
+ * to the calibrated value of that count, t4sat3a of the scene, which
+ * gives the same pixels as the calibration is increasing. If t4sat3a is
+ * not known (0), all such pixels with T4 are taken as saturated.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Pixels are counted as in
+ * process_pixels4ice if counters are given.
+ * ystein Gody, METNO/FOU, 19.10.2026: The 3A test uses the T4 threshold
+ * of process_pixels4ice (t4sat3a).
+ * ystein Gody, METNO/FOU, 19.10.2026: The surface temperature is sampled
+ * only for pixels reaching probest.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowlib.h>
+
+#define CHVAL(sc,k,n) ((sc)->ch[k] ? (sc)->ch[k][n] : 0.)
+
+static void countpix(pixcountstr *c, int ex, int reg, int mode, int usenwp);
+
+/*
+ * NAME:
+ * fmsnowlib_model
+ *
+ * PURPOSE:
+ * To decode the coefficient table in coeffs (lines separated by
+ * newline) and prepare it for use.
+ *
+ * RETURN VALUES:
+ * FM_OK if the coefficients can be used, FM_IO_ERR otherwise.
+ */
+int fmsnowlib_model(char *coeffs, statcoeffstr *cof) {
+
+    char *where="fmsnowlib_model";
+    char line[FMSNOWCOVER_MSGLENGTH+1];
+    char *pt, *end;
+    int len;
+
+    initstatcoeffs(cof);
+    for (pt=coeffs;pt && *pt;pt=end ? end+1 : NULL) {
+	end = strchr(pt,'\n');
+	len = end ? end-pt : strlen(pt);
+	if (len > FMSNOWCOVER_MSGLENGTH) {
+	    fmerrmsg(where,"Line length exceeds maximum length");
+	    return(FM_IO_ERR);
+	}
+	snprintf(line,FMSNOWCOVER_MSGLENGTH+1,"%.*s",len,pt);
+	if (parsestatcoeffline(line,cof) < 0) {
+	    fmerrmsg(where,"Wrong format on line '%s'",line);
+	    return(FM_IO_ERR);
+	}
+    }
+
+    return(buildstatcoeffs(cof));
+}
+
+/*
+ * NAME:
+ * fmsnowlib_tile_init
+ *
+ * PURPOSE:
+ * To set up a tile, lmask (ref.iw*ref.ih values as in the land/sea
+ * masks of fmsnowcover) is copied and may be NULL, all pixels are then
+ * treated as sea. cof must be kept while the tile is used.
+ */
+int fmsnowlib_tile_init(fmsnowlib_tile *t, statcoeffstr *cof,
+	fmucsref ref, unsigned char *lmask) {
+
+    char *where="fmsnowlib_tile_init";
+    int n, size;
+    fmindex cart;
+
+    memset(t,0,sizeof(fmsnowlib_tile));
+    if (ref.iw <= 0 || ref.ih <= 0) {
+	fmerrmsg(where,"Tile has no pixels");
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    size = ref.iw*ref.ih;
+    t->cof = cof;
+    t->ref = ref;
+    t->geo = (fmgeopos *) malloc(size*sizeof(fmgeopos));
+    if (lmask) t->lmask = (unsigned char *) malloc(size);
+    if (!t->geo || (lmask && !t->lmask)) {
+	fmerrmsg(where,"Could not allocate tile");
+	fmsnowlib_tile_free(t);
+	return(FM_MEMALL_ERR);
+    }
+    if (lmask) memcpy(t->lmask,lmask,size);
+
+    for (n=0;n<size;n++) {
+	cart.row = n/ref.iw;
+	cart.col = n%ref.iw;
+	t->geo[n] = fmucs2geo(fmind2ucs(ref, cart),MI);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowlib_tile_free
+ *
+ * PURPOSE:
+ * To free the tile.
+ */
+void fmsnowlib_tile_free(fmsnowlib_tile *t) {
+
+    if (t->geo) free(t->geo);
+    if (t->lmask) free(t->lmask);
+    memset(t,0,sizeof(fmsnowlib_tile));
+}
+
+/*
+ * NAME:
+ * fmsnowlib_classify
+ *
+ * PURPOSE:
+ * To classify a scene covering the tile. probs are the output levels of
+ * the fmsnowcover product, class and cat the MITIFF images and may be
+ * NULL. All buffers have the size of the tile. If cnt is given the
+ * pixels are added to it as by process_pixels4ice, it must not be
+ * shared by threads.
+ */
+int fmsnowlib_classify(fmsnowlib_tile *t, fmsnowlib_scene *sc,
+	float *probs[FMSNOWCOVER_OLEVELS], unsigned char *class,
+	unsigned char *cat, pixcountstr *cnt) {
+
+    int j, n, size, doy, ex, reg, mode, usenwp;
+    float zsun, misval;
+    fmsec1970 timeidsec;
+    unsigned char cl, ct;
+    pinpstr cpar;
+    probstr p;
+
+    if (!t->geo || !probs[0] || !probs[1] || !probs[2]) {
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    size = t->ref.iw*t->ref.ih;
+    timeidsec = tofmsec1970(sc->time);
+    doy = fmdayofyear(sc->time);
+
+    memset(&cpar,0,sizeof(pinpstr));
+    cpar.A3b = -999.;
+    cpar.saz = 0.;
+    cpar.algo = 2;
+    usenwp = (sc->tsurf) ? 1 : 0;
+
+    for (n=0;n<size;n++) {
+
+	if (class) class[n] = 0;
+	if (cat) cat[n] = UNDEF;
+	misval = FMSNOWCOVERMISVAL_NOCOV;
+
+	zsun = fmsolarzenith(fmutc2tst(timeidsec, t->geo[n].lon), t->geo[n]);
+	if (zsun >= FMSNOWSUNZEN) {
+	    misval = FMSNOWCOVERMISVAL_NIGHT;
+	    if (cnt) cnt->exits[FMSNOWPIX_NIGHT]++;
+	} else if (CHVAL(sc,3,n) == 0 && CHVAL(sc,4,n) == 0) {
+	    misval = FMSNOWCOVERMISVAL_NOCOV;
+	    if (cnt) cnt->exits[FMSNOWPIX_NOCOV]++;
+	} else {
+	    cpar.A1 = CHVAL(sc,0,n);
+	    cpar.A2 = CHVAL(sc,1,n);
+	    cpar.T3 = CHVAL(sc,2,n);
+	    cpar.T4 = CHVAL(sc,3,n);
+	    cpar.T5 = CHVAL(sc,4,n);
+	    cpar.A3 = CHVAL(sc,5,n);
+	    cpar.soz = zsun;
+	    cpar.daytime3b = (cpar.T3 > 0 && cpar.A3 == 0) ? 1 : 0;
+	    cpar.lmask = (t->lmask) ? (short) t->lmask[n] : 0;
+	    if (cpar.daytime3b) {
+		cpar.A3b = fm_ch3brefl(cpar.T3,cpar.T4,cpar.soz,sc->sa,doy);
+	    }
+	    reg = lmask2regime(cpar.lmask);
+	    mode = (cpar.daytime3b) ? FMSNOWMODE3B : FMSNOWMODE3A;
+
+	    if (!cpar.daytime3b && cpar.A3 == 0 && cpar.T4 > sc->t4sat3a) {
+		misval = FMSNOWCOVERMISVAL_3A;
+		ex = FMSNOWPIX_3A;
+	    } else {
+		cpar.tdiff = 0.;
+		if (sc->tsurf) {
+		    cpar.tdiff = sc->tsurf(sc->tsurfdata, n%t->ref.iw,
+			    n/t->ref.iw)-cpar.T4;
+		}
+		probest(cpar, &p, t->cof);
+		if (p.pice+p.pfree+p.pcloud < 0.95 ||
+			p.pice+p.pfree+p.pcloud > 1.05) {
+		    ex = FMSNOWPIX_PROBSUM;
+		} else if (isnan(p.pice) || isnan(p.pfree) || isnan(p.pcloud)) {
+		    ex = FMSNOWPIX_NAN;
+		} else {
+		    ex = FMSNOWPIX_OK;
+		}
+	    }
+	    if (cnt) countpix(cnt, ex, reg, mode, usenwp);
+	    if (ex == FMSNOWPIX_OK) {
+		probs[0][n] = p.pice;
+		probs[1][n] = p.pfree;
+		probs[2][n] = p.pcloud;
+		cl = pice2class(p.pice);
+		ct = probs2cat(&p);
+		if (class) class[n] = cl;
+		if (cat) cat[n] = ct;
+		if (cnt) {
+		    cnt->pclass[cl]++;
+		    cnt->cat[ct]++;
+		    cnt->psnow[reg] += p.pice;
+		}
+		continue;
+	    }
+	}
+
+	for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+	    probs[j][n] = misval;
+	}
+    }
+
+    return(FM_OK);
+}
+
+static void countpix(pixcountstr *c, int ex, int reg, int mode, int usenwp) {
+
+    c->exits[ex]++;
+    c->regime[ex][reg][mode][usenwp]++;
+}
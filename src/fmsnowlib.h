@@ -0,0 +1,84 @@
+/*
+ * NAME:
+ * fmsnowlib.h
+ *
+ * PURPOSE:
+ * Interface of libfmsnowcover, the classification of fmsnowcover for
+ * programs having the AVHRR data in memory.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * See fmsnowlib.c.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: fmsnowlib_classify counts the
+ * pixels.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added t4sat3a to fmsnowlib_scene.
+ * ystein Gody, METNO/FOU, 19.10.2026: The surface temperature is sampled
+ * by a function of the caller (fmsnowlib_tsurf).
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _FMSNOWLIB_H
+#define _FMSNOWLIB_H
+
+#include <fmsnowcover.h>
+
+#define FMSNOWLIB_CHANNELS 6 /* A1, A2, T3, T4, T5, A3 as in fmio_img */
+
+/*
+ * Tile the scenes are classified on. The land/sea mask and the position
+ * of each pixel are kept, the coefficients are those of the caller.
+ */
+typedef struct {
+    statcoeffstr *cof;
+    fmucsref ref;
+    unsigned char *lmask; /* NULL if not in use */
+    fmgeopos *geo;
+} fmsnowlib_tile;
+
+/*
+ * NWP surface temperature (K) at tile pixel (xc,yc), data is that given
+ * with the scene, e.g. an nwpice sampled by nwpice_t0m.
+ */
+typedef float (*fmsnowlib_tsurf)(void *data, int xc, int yc);
+
+/*
+ * Scene to classify, the channels are calibrated (reflectance and
+ * brightness temperature as given by fm_byte2float) and 0 where
+ * missing. Channels not available are NULL.
+ */
+typedef struct {
+    fmtime time;
+    char sa[32]; /* satellite, used for the reflectance of 3B */
+    float *ch[FMSNOWLIB_CHANNELS];
+    fmsnowlib_tsurf tsurf; /* NULL if NWP data are not in use */
+    void *tsurfdata; /* given to tsurf */
+    float t4sat3a; /* T4 (K) of count FMSNOWSAT3ACOUNT, 0 if not known */
+} fmsnowlib_scene;
+
+int fmsnowlib_model(char *coeffs, statcoeffstr *cof);
+int fmsnowlib_tile_init(fmsnowlib_tile *t, statcoeffstr *cof,
+    fmucsref ref, unsigned char *lmask);
+void fmsnowlib_tile_free(fmsnowlib_tile *t);
+int fmsnowlib_classify(fmsnowlib_tile *t, fmsnowlib_scene *sc,
+    float *probs[FMSNOWCOVER_OLEVELS], unsigned char *class,
+    unsigned char *cat, pixcountstr *cnt);
+
+#endif /* _FMSNOWLIB_H */
@@ -0,0 +1,276 @@
+/*
+ * NAME:
+ * fmsnowlibcheck
+ *
+ * PURPOSE:
+ * To check that fmsnowlib_classify (used for streamed scenes) gives the
+ * same products as process_pixels4ice (used for scene files) for a
+ * scene, e.g. a synthetic scene made by fmsnowsynth.
+ *
+ * REQUIREMENTS:
+ * libfmutil
+ * libfmio
+ * libosihdf5
+ *
+ * INPUT:
+ * o MITIFF scene file (channels 1, 2, 3B, 4, 5 and 3A).
+ * o Optionally an OSIHDF5 land/sea mask of the same grid.
+ * o Statistical coefficients.
+ *
+ * OUTPUT:
+ * The number of pixels differing in the probabilities, classes and
+ * categories and in the pixel counters on stdout. The return value is
+ * FM_OK if the products are identical and FM_OTHER_ERR otherwise.
+ *
+ * NOTES:
+ * The scene is classified by process_pixels4ice as in process_scene and
+ * by fmsnowlib_classify with the channels calibrated as by scenestream
+ * for a uint8 stream, i.e. counts of 0 are 0 and the rest are given by
+ * fm_byte2float. NWP data are not used.
+ *
+ * Synthetic scenes have no pixels with T4 near the count of the 3A
+ * test, so T4 and 3A of every FMSNOWCHECK_EVERY pixel in 3A mode are
+ * set to counts around FMSNOWSAT3ACOUNT before classifying (unless -k).
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowlib.h>
+#include <unistd.h>
+
+#define FMSNOWCHECK_EVERY 16
+#define FMSNOWCHECK_MAXREPORT 10
+
+static void checkusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowlibcheck";
+    extern char *optarg;
+    char *coffile = "../etc/statcoeffs_4surfs.txt";
+    char *imgfile = NULL, *lmfile = NULL;
+    char *chname[FMSNOWLIB_CHANNELS] = {
+	"Reflectance","Reflectance","Temperature",
+	"Temperature","Temperature","Reflectance"
+    };
+    char *exname[FMSNOWPIX_EXITS] = {
+	"night","nocov","sat3a","probsum","nan","ok","sea"
+    };
+    int ret, keep = 0, n, j, k, size, nset, nprobs, nclass, ncat, ncnt;
+    unsigned char *lmask = NULL, *class1, *cat1, *class2, *cat2;
+    float *probs2[FMSNOWCOVER_OLEVELS], *p1;
+    osi_dtype ice_ft[FMSNOWCOVER_OLEVELS]={OSI_FLOAT,OSI_FLOAT,OSI_FLOAT};
+    char *ice_desc[FMSNOWCOVER_OLEVELS]={"P(ice/snow)","P(water/land)","P(cloud)"};
+    fmio_img img;
+    fmscale calib;
+    fmucsref ref;
+    osihdf ice, lm;
+    nwpice nwp;
+    statcoeffstr coeffs;
+    fmsnowlib_tile t;
+    fmsnowlib_scene sc;
+    pixcountstr cnt1, cnt2;
+
+    while ((ret = getopt(argc, argv, "c:i:l:k")) != EOF) {
+	switch (ret) {
+	    case 'c':
+		coffile = optarg;
+		break;
+	    case 'i':
+		imgfile = optarg;
+		break;
+	    case 'l':
+		lmfile = optarg;
+		break;
+	    case 'k':
+		keep = 1;
+		break;
+	    default:
+		checkusage();
+	}
+    }
+    if (!imgfile) checkusage();
+
+    initstatcoeffs(&coeffs);
+    if (rdstatcoeffs(coffile,&coeffs) == FM_IO_ERR ||
+	    buildstatcoeffs(&coeffs)) {
+	fmerrmsg(where,"Could not use statistical coefficients in %s",
+		coffile);
+	exit(FM_IO_ERR);
+    }
+
+    fm_init_fmio_img(&img);
+    if (fm_readdata(imgfile, &img)) {
+	fmerrmsg(where,"Could not read %s", imgfile);
+	exit(FM_IO_ERR);
+    }
+    if (img.z < FMSNOWLIB_CHANNELS) {
+	fmerrmsg(where,"%s has %d channels, %d are needed", imgfile, img.z,
+		FMSNOWLIB_CHANNELS);
+	exit(FM_IO_ERR);
+    }
+    size = img.iw*img.ih;
+    fm_img2fmucsref(img,&ref);
+    fm_img2slopes(img,&calib);
+
+    lm.d = NULL;
+    if (lmfile) {
+	if (read_hdf5_product(lmfile, &lm, 0)) {
+	    fmerrmsg(where,"Could not read %s", lmfile);
+	    exit(FM_IO_ERR);
+	}
+	if (lm.h.iw != img.iw || lm.h.ih != img.ih) {
+	    fmerrmsg(where,"%s and %s are not on the same grid", lmfile,
+		    imgfile);
+	    exit(FM_IO_ERR);
+	}
+	lmask = (unsigned char *) lm.d->data;
+    }
+
+    /*
+     * Pixels around the T4 count of the 3A test.
+     */
+    nset = 0;
+    if (!keep) {
+	for (n=0;n<size;n++) {
+	    if (img.image[2][n] != 0 || img.image[3][n] == 0) continue;
+	    if (n%FMSNOWCHECK_EVERY) continue;
+	    img.image[5][n] = 0;
+	    img.image[3][n] = FMSNOWSAT3ACOUNT-1+(n/FMSNOWCHECK_EVERY)%3;
+	    nset++;
+	}
+    }
+    fprintf(stdout,"# scene: %s (%dx%d)\n", imgfile, img.iw, img.ih);
+    fprintf(stdout,"# pixels set around the 3A test: %d\n", nset);
+
+    /*
+     * The file path.
+     */
+    init_osihdf(&ice);
+    ice.h.iw = img.iw;
+    ice.h.ih = img.ih;
+    ice.h.z = FMSNOWCOVER_OLEVELS;
+    class1 = (unsigned char *) malloc(size);
+    cat1 = (unsigned char *) malloc(size);
+    class2 = (unsigned char *) malloc(size);
+    cat2 = (unsigned char *) malloc(size);
+    for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+	probs2[j] = (float *) malloc(size*sizeof(float));
+    }
+    if (malloc_osihdf(&ice,ice_ft,ice_desc) || !class1 || !cat1 ||
+	    !class2 || !cat2 || !probs2[0] || !probs2[1] || !probs2[2]) {
+	fmerrmsg(where,"Could not allocate memory for %d pixels", size);
+	exit(FM_MEMALL_ERR);
+    }
+    memset(&sc,0,sizeof(fmsnowlib_scene));
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) {
+	sc.ch[k] = (float *) malloc(size*sizeof(float));
+	if (!sc.ch[k]) {
+	    fmerrmsg(where,"Could not allocate memory for %d pixels", size);
+	    exit(FM_MEMALL_ERR);
+	}
+    }
+
+    nwpice_init(&nwp);
+    initpixcount(&cnt1);
+    if (process_pixels4ice(img, NULL, lmask, NULL, nwp, ice.d, class1,
+		cat1, 2, 1, &coeffs, &cnt1)) {
+	fmerrmsg(where,"process_pixels4ice failed on %s", imgfile);
+	exit(FM_OTHER_ERR);
+    }
+
+    /*
+     * The stream path.
+     */
+    fm_img2fmtime(img,&sc.time);
+    snprintf(sc.sa,sizeof(sc.sa),"%s",img.sa);
+    sc.tsurf = NULL;
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) {
+	for (n=0;n<size;n++) {
+	    sc.ch[k][n] = (img.image[k][n] == 0) ? 0. :
+		fm_byte2float(img.image[k][n], calib, chname[k]);
+	}
+    }
+    sc.t4sat3a = fm_byte2float(FMSNOWSAT3ACOUNT, calib, "Temperature");
+    if (fmsnowlib_tile_init(&t, &coeffs, ref, lmask)) {
+	fmerrmsg(where,"Could not set up the tile of %s", imgfile);
+	exit(FM_OTHER_ERR);
+    }
+    initpixcount(&cnt2);
+    if (fmsnowlib_classify(&t, &sc, probs2, class2, cat2, &cnt2)) {
+	fmerrmsg(where,"fmsnowlib_classify failed on %s", imgfile);
+	exit(FM_OTHER_ERR);
+    }
+
+    /*
+     * Compare the products pixel by pixel.
+     */
+    nprobs = nclass = ncat = 0;
+    for (n=0;n<size;n++) {
+	for (j=0;j<FMSNOWCOVER_OLEVELS;j++) {
+	    p1 = (float *) ice.d[j].data;
+	    if (p1[n] != probs2[j][n]) break;
+	}
+	if (j < FMSNOWCOVER_OLEVELS) {
+	    if (nprobs < FMSNOWCHECK_MAXREPORT) {
+		fprintf(stdout,"# pixel %d,%d level %d: %f %f\n",
+			n%img.iw, n/img.iw, j, p1[n], probs2[j][n]);
+	    }
+	    nprobs++;
+	}
+	if (class1[n] != class2[n]) nclass++;
+	if (cat1[n] != cat2[n]) ncat++;
+    }
+    ncnt = 0;
+    for (j=0;j<FMSNOWPIX_EXITS;j++) {
+	fprintf(stdout,"%-8s %10ld %10ld\n", exname[j], cnt1.exits[j],
+		cnt2.exits[j]);
+	if (cnt1.exits[j] != cnt2.exits[j]) ncnt++;
+    }
+    fprintf(stdout,"probs    %10d\n", nprobs);
+    fprintf(stdout,"class    %10d\n", nclass);
+    fprintf(stdout,"cat      %10d\n", ncat);
+
+    fmsnowlib_tile_free(&t);
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) free(sc.ch[k]);
+    for (j=0;j<FMSNOWCOVER_OLEVELS;j++) free(probs2[j]);
+    free(class1);
+    free(cat1);
+    free(class2);
+    free(cat2);
+    free_osihdf(&ice);
+    if (lm.d) free_osihdf(&lm);
+    fm_clear_fmio_img(&img);
+
+    if (nprobs || nclass || ncat || ncnt) {
+	fmerrmsg(where,"The products of the file and stream paths differ");
+	exit(FM_OTHER_ERR);
+    }
+    fmlogmsg(where,"The products of the file and stream paths are identical");
+
+    exit(FM_OK);
+}
+
+static void checkusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " fmsnowlibcheck -i <scene> [-l <landmask>] [-c <coeffile>] [-k]\n\n");
+    fprintf(stdout," <scene>: MITIFF scene, e.g. made by fmsnowsynth.\n");
+    fprintf(stdout," <landmask>: OSIHDF5 land/sea mask of the scene.\n");
+    fprintf(stdout," <coeffile>: Statistical coefficients.\n");
+    fprintf(stdout," -k: Keep T4 and 3A, no pixels are set around the\n");
+    fprintf(stdout,"   count of the 3A test.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
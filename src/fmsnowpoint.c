@@ -0,0 +1,649 @@
+/*
+ * NAME:
+ * fmsnowpoint
+ *
+ * PURPOSE:
+ * To extract the time series of P(ice/snow), P(water/land) and P(cloud)
+ * at stations or small areas from the pass products of fmsnowcover.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Index file of fmsnowcover (INDEXFILE).
+ * o Directory of the pass products (PRODUCTPATH) and of the cubes
+ *   (CUBEPATH) if not the same.
+ * o File of points, one on each line as
+ *
+ *     <id> <lat> <lon>
+ *     <id> <latmin>,<lonmin>,<latmax>,<lonmax>
+ *
+ *   the latter being an area. Lines starting with # are skipped.
+ * o Period (optional).
+ *
+ * OUTPUT:
+ * CSV on stdout or the file given, one line for each point and pass
+ * with data at the point:
+ *
+ *   id,tile,time,satellite,npix,nvalid,pice,pfree,pcloud
+ *
+ * where npix is the number of pixels of the point (1) or area, nvalid
+ * those with data and the probabilities are averages over them. Lines
+ * are ordered by point and time.
+ *
+ * NOTES:
+ * Only the passes of the index within the period are used. A point is
+ * taken from the tile it is furthest inside, an area from the tile
+ * containing most of it, using the header of the first pass (or the
+ * cube) of each tile.
+ *
+ * The passes of a cube (see snowcube.c) are read with one hyperslab for
+ * each point, holding the window of the point in all passes of the
+ * period. A pass file is read once for all points of its tile, and not
+ * at all if its extent (see passextent.c) shows no data at the points.
+ * HDF5 is not thread safe, so reading is not done in parallel.
+ *
+ * A pass file is read whole by read_hdf5_product, libosihdf5 can not
+ * read a window of its layers. The time series of a few points over a
+ * long period of pass files thus reads all pixels of every pass with
+ * data at the points, which is slow. Write the passes to cubes
+ * (CUBEPATH of fmsnowcover) where such series are needed.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <fmaccusnow.h>
+#include <unistd.h>
+
+#define POINT_IDLEN 32
+#define POINT_LINELEN 256
+
+typedef struct {
+    char id[POINT_IDLEN];
+    int ispoint;
+    double lat, lon;
+    fmsnowroi roi; /* window in tile */
+    int tile; /* -1 if outside all tiles */
+} pointloc;
+
+typedef struct {
+    char area[8];
+    char cubefile[FILELEN]; /* passes in a cube if set */
+    fmucsref ref;
+    int haveref;
+    int npass;
+    char **files;
+    fmsec1970 *times;
+} pointtile;
+
+typedef struct {
+    int point;
+    fmsec1970 time;
+    char satellite[FMSNOWCUBE_SATLEN];
+    int npix;
+    int nvalid;
+    double pice, pfree, pcloud;
+} pointrow;
+
+typedef struct {
+    int n, nalloc;
+    pointrow *r;
+} pointrows;
+
+static int readpoints(char *fname, pointloc **pts, int *npts);
+static int readpasses(char *indexfile, char *proddir, char *cubedir,
+    fmsec1970 stime, fmsec1970 etime, pointtile **tiles, int *ntiles);
+static int tileref(pointtile *t);
+static void placepoints(pointloc *pts, int npts, pointtile *tiles,
+    int ntiles);
+static int cubeseries(pointtile *t, int tile, pointloc *pts, int npts,
+    fmsec1970 stime, fmsec1970 etime, pointrows *rows);
+static int fileseries(pointtile *t, int tile, pointloc *pts, int npts,
+    pointrows *rows, int *nread, int *nskipped);
+static pointrow *addrow(pointrows *rows, int point, fmsec1970 time,
+    char *satellite);
+static int cmprows(const void *a, const void *b);
+static void pointusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowpoint";
+    extern char *optarg;
+    char *indexfile = NULL, *proddir = NULL, *cubedir = NULL;
+    char *pointfile = NULL, *outfile = NULL, timestr[DATESTRINGLENGTH];
+    int i, ret, npts, ntiles, nread = 0, nskipped = 0, ncubes = 0;
+    fmsec1970 stime = 0, etime = 0;
+    pointloc *pts;
+    pointtile *tiles;
+    pointrows rows;
+    pointrow *r;
+    FILE *fp = stdout;
+
+    while ((ret = getopt(argc, argv, "i:d:k:p:s:e:o:")) != EOF) {
+	switch (ret) {
+	    case 'i':
+		indexfile = optarg;
+		break;
+	    case 'd':
+		proddir = optarg;
+		break;
+	    case 'k':
+		cubedir = optarg;
+		break;
+	    case 'p':
+		pointfile = optarg;
+		break;
+	    case 's':
+		if (strlen(optarg) != 10) pointusage();
+		stime = ymdh2fmsec1970(optarg,0);
+		break;
+	    case 'e':
+		if (strlen(optarg) != 10) pointusage();
+		etime = ymdh2fmsec1970(optarg,0);
+		break;
+	    case 'o':
+		outfile = optarg;
+		break;
+	    default:
+		pointusage();
+	}
+    }
+    if (!indexfile || !proddir || !pointfile) pointusage();
+    if (!cubedir) cubedir = proddir;
+
+    if (readpoints(pointfile, &pts, &npts)) {
+	fmerrmsg(where,"Could not read points from %s", pointfile);
+	exit(FM_IO_ERR);
+    }
+    if (readpasses(indexfile, proddir, cubedir, stime, etime, &tiles,
+		&ntiles)) {
+	fmerrmsg(where,"Could not read %s", indexfile);
+	exit(FM_IO_ERR);
+    }
+    for (i=0;i<ntiles;i++) {
+	if (tileref(&tiles[i])) {
+	    fmerrmsg(where,"Could not find the grid of tile %s, skipping it",
+		    tiles[i].area);
+	}
+    }
+    placepoints(pts, npts, tiles, ntiles);
+    for (i=0;i<npts;i++) {
+	if (pts[i].tile < 0) {
+	    fmlogmsg(where,"%s is outside the tiles with passes", pts[i].id);
+	}
+    }
+
+    memset(&rows,0,sizeof(pointrows));
+    for (i=0;i<ntiles;i++) {
+	if (!tiles[i].haveref) continue;
+	if (strlen(tiles[i].cubefile) > 0) {
+	    if (cubeseries(&tiles[i], i, pts, npts, stime, etime, &rows)) {
+		fmerrmsg(where,"Could not read %s", tiles[i].cubefile);
+		exit(FM_IO_ERR);
+	    }
+	    ncubes++;
+	}
+	if (fileseries(&tiles[i], i, pts, npts, &rows, &nread, &nskipped)) {
+	    exit(FM_IO_ERR);
+	}
+    }
+    fmlogmsg(where,"Read %d cubes and %d passes, %d passes without data at the points skipped",
+	    ncubes, nread, nskipped);
+
+    if (outfile && !(fp = fopen(outfile,"w"))) {
+	fmerrmsg(where,"Could not create %s", outfile);
+	exit(FM_IO_ERR);
+    }
+    if (rows.n > 0) qsort(rows.r, rows.n, sizeof(pointrow), cmprows);
+    fprintf(fp,"id,tile,time,satellite,npix,nvalid,pice,pfree,pcloud\n");
+    for (i=0;i<rows.n;i++) {
+	r = &rows.r[i];
+	fmsec19702isodatetime(r->time, timestr);
+	fprintf(fp,"%s,%s,%s,%s,%d,%d,%.3f,%.3f,%.3f\n", pts[r->point].id,
+		tiles[pts[r->point].tile].area, timestr, r->satellite,
+		r->npix, r->nvalid, r->pice/r->nvalid, r->pfree/r->nvalid,
+		r->pcloud/r->nvalid);
+    }
+    if (outfile && fclose(fp)) {
+	fmerrmsg(where,"Could not write %s", outfile);
+	exit(FM_IO_ERR);
+    }
+
+    exit(FM_OK);
+}
+
+/*
+ * Read the points, a point is given as latitude and longitude and an
+ * area as a box (see fmsnowroi_parse).
+ */
+static int readpoints(char *fname, pointloc **pts, int *npts) {
+
+    char *where="readpoints";
+    char line[POINT_LINELEN], a[POINT_LINELEN], b[POINT_LINELEN];
+    int n = 0, nalloc = 0, nf;
+    pointloc *p = NULL, *tmp;
+    FILE *fp;
+
+    *pts = NULL;
+    *npts = 0;
+    fp = fopen(fname,"r");
+    if (!fp) return(FM_IO_ERR);
+    while (fgets(line,POINT_LINELEN,fp)) {
+	if (line[0] == '#') continue;
+	if (n == nalloc) {
+	    nalloc = nalloc ? 2*nalloc : 64;
+	    tmp = (pointloc *) realloc(p, nalloc*sizeof(pointloc));
+	    if (!tmp) {
+		free(p);
+		fclose(fp);
+		return(FM_MEMALL_ERR);
+	    }
+	    p = tmp;
+	}
+	memset(&p[n],0,sizeof(pointloc));
+	nf = sscanf(line,"%31s %255s %255s", p[n].id, a, b);
+	if (nf < 1) continue;
+	if (nf == 3) {
+	    p[n].ispoint = 1;
+	    p[n].lat = atof(a);
+	    p[n].lon = atof(b);
+	} else if (nf != 2 ||
+		fmsnowroi_parse(a, FMSNOWROI_GEO, &p[n].roi) != FM_OK) {
+	    fmerrmsg(where,"Could not decode %s", line);
+	    free(p);
+	    fclose(fp);
+	    return(FM_SYNTAX_ERR);
+	}
+	p[n].tile = -1;
+	n++;
+    }
+    fclose(fp);
+    if (n == 0) {
+	free(p);
+	return(FM_IO_ERR);
+    }
+
+    *pts = p;
+    *npts = n;
+
+    return(FM_OK);
+}
+
+/*
+ * Collect the passes of the index within the period by tile. The
+ * passes of a tile in a cube are only noted, they are selected when the
+ * cube is read. A product written for several scenes is used once.
+ */
+static int readpasses(char *indexfile, char *proddir, char *cubedir,
+	fmsec1970 stime, fmsec1970 etime, pointtile **tiles, int *ntiles) {
+
+    char line[POINT_LINELEN*4], product[FILELEN], area[8], fname[FILELEN];
+    int i, j, n = 0;
+    fmtime ft;
+    fmsec1970 t;
+    pointtile *tl = NULL, *tmp;
+    FILE *fp;
+
+    *tiles = NULL;
+    *ntiles = 0;
+    fp = tmpfile();
+    if (!fp) return(FM_IO_ERR);
+    if (fmsnowindex_read(indexfile, fp)) {
+	fclose(fp);
+	return(FM_IO_ERR);
+    }
+    rewind(fp);
+
+    while (fgets(line,sizeof(line),fp)) {
+	memset(&ft,0,sizeof(fmtime));
+	if (sscanf(line,"%4d-%2d-%2d%*c%2d:%2d%*s %*s %255s %7s",
+		    &ft.fm_year, &ft.fm_mon, &ft.fm_mday, &ft.fm_hour,
+		    &ft.fm_min, product, area) != 7) continue;
+	t = tofmsec1970(ft);
+	if ((stime > 0 && t < stime) || (etime > 0 && t > etime)) continue;
+
+	for (i=0;i<n && strcmp(tl[i].area,area) != 0;i++);
+	if (i == n) {
+	    tmp = (pointtile *) realloc(tl, (n+1)*sizeof(pointtile));
+	    if (!tmp) {
+		fclose(fp);
+		return(FM_MEMALL_ERR);
+	    }
+	    tl = tmp;
+	    memset(&tl[n],0,sizeof(pointtile));
+	    sprintf(tl[n].area,"%s",area);
+	    n++;
+	}
+
+	if (strncmp(product,FMSNOWCUBE_PREFIX,strlen(FMSNOWCUBE_PREFIX))
+		== 0) {
+	    snprintf(tl[i].cubefile,FILELEN,"%s/%s",cubedir,product);
+	    continue;
+	}
+	snprintf(fname,FILELEN,"%s/%s",proddir,product);
+	for (j=0;j<tl[i].npass && strcmp(tl[i].files[j],fname) != 0;j++);
+	if (j < tl[i].npass) {
+	    tl[i].times[j] = t; /* product replaced by a later scene */
+	    continue;
+	}
+	tl[i].files = (char **) realloc(tl[i].files,
+		(tl[i].npass+1)*sizeof(char *));
+	tl[i].times = (fmsec1970 *) realloc(tl[i].times,
+		(tl[i].npass+1)*sizeof(fmsec1970));
+	if (!tl[i].files || !tl[i].times) {
+	    fclose(fp);
+	    return(FM_MEMALL_ERR);
+	}
+	tl[i].files[tl[i].npass] = (char *) malloc(FILELEN);
+	if (!tl[i].files[tl[i].npass]) {
+	    fclose(fp);
+	    return(FM_MEMALL_ERR);
+	}
+	sprintf(tl[i].files[tl[i].npass],"%s",fname);
+	tl[i].times[tl[i].npass] = t;
+	tl[i].npass++;
+    }
+    fclose(fp);
+
+    *tiles = tl;
+    *ntiles = n;
+
+    return(FM_OK);
+}
+
+/*
+ * Find the grid of a tile from its cube or the header of its first
+ * readable pass.
+ */
+static int tileref(pointtile *t) {
+
+    int i;
+    fmsnowcube cb;
+    osihdf h;
+
+    if (strlen(t->cubefile) > 0 && fmsnowcube_open(t->cubefile, &cb) == 0) {
+	t->ref = cb.ref;
+	t->haveref = 1;
+	fmsnowcube_close(&cb);
+	return(FM_OK);
+    }
+    for (i=0;i<t->npass;i++) {
+	init_osihdf(&h);
+	if (read_hdf5_product(t->files[i],&h,1) == 0) {
+	    t->ref.Ax = h.h.Ax;
+	    t->ref.Ay = h.h.Ay;
+	    t->ref.Bx = h.h.Bx;
+	    t->ref.By = h.h.By;
+	    t->ref.iw = h.h.iw;
+	    t->ref.ih = h.h.ih;
+	    t->haveref = 1;
+	    free_osihdf(&h);
+	    return(FM_OK);
+	}
+	free_osihdf(&h);
+    }
+
+    return(FM_IO_ERR);
+}
+
+/*
+ * Give each point the tile it is furthest inside, and each area the
+ * tile holding the largest part of it, with the window in that tile.
+ */
+static void placepoints(pointloc *pts, int npts, pointtile *tiles,
+	int ntiles) {
+
+    int i, j, best, margin;
+    double col, row;
+    fmgeopos geop;
+    fmucspos pos;
+    fmsnowroi roi;
+
+    for (i=0;i<npts;i++) {
+	best = -1;
+	for (j=0;j<ntiles;j++) {
+	    if (!tiles[j].haveref) continue;
+	    roi = pts[i].roi;
+	    if (pts[i].ispoint) {
+		geop.lat = pts[i].lat;
+		geop.lon = pts[i].lon;
+		pos = fmgeo2ucs(geop, MI);
+		col = floor((pos.eastings-tiles[j].ref.Bx)/tiles[j].ref.Ax+0.5);
+		row = floor((tiles[j].ref.By-pos.northings)/tiles[j].ref.Ay+0.5);
+		if (col < 0 || row < 0 || col > tiles[j].ref.iw-1 ||
+			row > tiles[j].ref.ih-1) continue;
+		roi.type = FMSNOWROI_PIXEL;
+		roi.v[0] = roi.v[2] = col;
+		roi.v[1] = roi.v[3] = row;
+	    }
+	    if (fmsnowroi_window(&roi, tiles[j].ref) != FM_OK) continue;
+	    if (pts[i].ispoint) {
+		margin = roi.col0;
+		if (roi.row0 < margin) margin = roi.row0;
+		if (tiles[j].ref.iw-1-roi.col0 < margin)
+		    margin = tiles[j].ref.iw-1-roi.col0;
+		if (tiles[j].ref.ih-1-roi.row0 < margin)
+		    margin = tiles[j].ref.ih-1-roi.row0;
+	    } else {
+		margin = roi.iw*roi.ih;
+	    }
+	    if (best < 0 || margin > best) {
+		best = margin;
+		pts[i].tile = j;
+		pts[i].roi = roi;
+	    }
+	}
+    }
+}
+
+/*
+ * Time series of the points of a tile from its cube, one read for each
+ * point.
+ */
+static int cubeseries(pointtile *t, int tile, pointloc *pts, int npts,
+	fmsec1970 stime, fmsec1970 etime, pointrows *rows) {
+
+    int i, k, p, s, slot0, slot1, nslots, off, w, h;
+    unsigned char *buf[FMSNOWCUBE_LEVELS];
+    float pice, pfree, pcloud;
+    fmsnowcube cb;
+    pointrow *r;
+
+    if (fmsnowcube_open(t->cubefile, &cb)) return(FM_IO_ERR);
+    slot0 = cb.nslots;
+    slot1 = -1;
+    for (s=0;s<cb.nslots;s++) {
+	if (cb.pass[s].time == 0 || (stime > 0 && cb.pass[s].time < stime) ||
+		(etime > 0 && cb.pass[s].time > etime)) continue;
+	if (s < slot0) slot0 = s;
+	slot1 = s;
+    }
+    nslots = slot1-slot0+1;
+
+    for (p=0;p<npts && nslots>0;p++) {
+	if (pts[p].tile != tile) continue;
+	w = pts[p].roi.iw;
+	h = pts[p].roi.ih;
+	for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+	    buf[k] = (unsigned char *) malloc(nslots*w*h);
+	}
+	if (!buf[0] || !buf[1] || !buf[2] ||
+		fmsnowcube_read(&cb, slot0, nslots, pts[p].roi.col0,
+		    pts[p].roi.row0, w, h, buf)) {
+	    for (k=0;k<FMSNOWCUBE_LEVELS;k++) if (buf[k]) free(buf[k]);
+	    fmsnowcube_close(&cb);
+	    return(FM_IO_ERR);
+	}
+	for (s=slot0;s<=slot1;s++) {
+	    if (cb.pass[s].time == 0 || (stime > 0 && cb.pass[s].time < stime) ||
+		    (etime > 0 && cb.pass[s].time > etime)) continue;
+	    r = addrow(rows, p, cb.pass[s].time, cb.pass[s].satellite);
+	    if (!r) {
+		fmsnowcube_close(&cb);
+		return(FM_MEMALL_ERR);
+	    }
+	    r->npix = w*h;
+	    off = (s-slot0)*w*h;
+	    for (i=off;i<off+w*h;i++) {
+		pice = cb.value[buf[0][i]];
+		pfree = cb.value[buf[1][i]];
+		pcloud = cb.value[buf[2][i]];
+		if (pice < 0. || pfree < 0. || pcloud < 0.) continue;
+		r->pice += pice;
+		r->pfree += pfree;
+		r->pcloud += pcloud;
+		r->nvalid++;
+	    }
+	    if (r->nvalid == 0) rows->n--;
+	}
+	for (k=0;k<FMSNOWCUBE_LEVELS;k++) free(buf[k]);
+    }
+    fmsnowcube_close(&cb);
+
+    return(FM_OK);
+}
+
+/*
+ * Time series of the points of a tile from its pass files, each file is
+ * read once for all points. The whole file is read, see NOTES above.
+ */
+static int fileseries(pointtile *t, int tile, pointloc *pts, int npts,
+	pointrows *rows, int *nread, int *nskipped) {
+
+    char *where="fileseries";
+    int f, p, row, col, used, elem;
+    float pice, pfree, pcloud;
+    passextent ex;
+    fmsnowroi *w;
+    osihdf h;
+    pointrow *r;
+
+    for (p=0;p<npts && pts[p].tile!=tile;p++);
+    if (p == npts) return(FM_OK);
+
+    for (f=0;f<t->npass;f++) {
+
+	/*
+	 * Skip the pass if none of the points are within its extent.
+	 */
+	if (read_pass_extent(t->files[f], t->ref.iw, t->ref.ih, &ex) == 0) {
+	    used = 0;
+	    for (p=0;p<npts && !used;p++) {
+		if (pts[p].tile != tile) continue;
+		w = &pts[p].roi;
+		for (row=w->row0;row<w->row0+w->ih && !used;row++) {
+		    used = (ex.first[row] <= w->col0+w->iw-1 &&
+			    ex.last[row] >= w->col0);
+		}
+	    }
+	    free_pass_extent(&ex);
+	    if (!used) {
+		(*nskipped)++;
+		continue;
+	    }
+	}
+
+	init_osihdf(&h);
+	if (read_hdf5_product(t->files[f],&h,0) != 0) {
+	    fmerrmsg(where,"Could not read %s, skipping it", t->files[f]);
+	    free_osihdf(&h);
+	    continue;
+	}
+	(*nread)++;
+	if (h.h.iw != t->ref.iw || h.h.ih != t->ref.ih || h.h.z < 3) {
+	    fmerrmsg(where,"%s is not on the grid of tile %s, skipping it",
+		    t->files[f], t->area);
+	    free_osihdf(&h);
+	    continue;
+	}
+
+	for (p=0;p<npts;p++) {
+	    if (pts[p].tile != tile) continue;
+	    r = addrow(rows, p, t->times[f], h.h.source);
+	    if (!r) {
+		free_osihdf(&h);
+		return(FM_MEMALL_ERR);
+	    }
+	    w = &pts[p].roi;
+	    r->npix = w->iw*w->ih;
+	    for (row=w->row0;row<w->row0+w->ih;row++) {
+		for (col=w->col0;col<w->col0+w->iw;col++) {
+		    elem = fmivec(col, row, t->ref.iw);
+		    pice = ((float *) h.d[0].data)[elem];
+		    pfree = ((float *) h.d[1].data)[elem];
+		    pcloud = ((float *) h.d[2].data)[elem];
+		    if (pice < 0. || pfree < 0. || pcloud < 0.) continue;
+		    r->pice += pice;
+		    r->pfree += pfree;
+		    r->pcloud += pcloud;
+		    r->nvalid++;
+		}
+	    }
+	    if (r->nvalid == 0) rows->n--;
+	}
+	free_osihdf(&h);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Add a line to the output.
+ */
+static pointrow *addrow(pointrows *rows, int point, fmsec1970 time,
+	char *satellite) {
+
+    pointrow *tmp, *r;
+
+    if (rows->n == rows->nalloc) {
+	rows->nalloc = rows->nalloc ? 2*rows->nalloc : 1024;
+	tmp = (pointrow *) realloc(rows->r, rows->nalloc*sizeof(pointrow));
+	if (!tmp) return(NULL);
+	rows->r = tmp;
+    }
+    r = &rows->r[rows->n++];
+    memset(r,0,sizeof(pointrow));
+    r->point = point;
+    r->time = time;
+    snprintf(r->satellite,FMSNOWCUBE_SATLEN,"%s",satellite);
+
+    return(r);
+}
+
+static int cmprows(const void *a, const void *b) {
+
+    const pointrow *ra = (const pointrow *) a;
+    const pointrow *rb = (const pointrow *) b;
+
+    if (ra->point != rb->point) return(ra->point-rb->point);
+    if (ra->time != rb->time) return(ra->time < rb->time ? -1 : 1);
+
+    return(strcmp(ra->satellite, rb->satellite));
+}
+
+static void pointusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout," fmsnowpoint -i <indexfile> -d <productdir> -p <points>\n");
+    fprintf(stdout,"   [-k <cubedir>] [-s <start>] [-e <end>] [-o <csvfile>]\n\n");
+    fprintf(stdout," <indexfile>: Index file of fmsnowcover (INDEXFILE).\n");
+    fprintf(stdout," <productdir>: Pass products (PRODUCTPATH).\n");
+    fprintf(stdout," <points>: File with lines <id> <lat> <lon> or\n");
+    fprintf(stdout,"   <id> <latmin>,<lonmin>,<latmax>,<lonmax>.\n");
+    fprintf(stdout," <cubedir>: Cubes (CUBEPATH), default <productdir>.\n");
+    fprintf(stdout," <start>, <end>: Period as yyyymmddhh (optional).\n");
+    fprintf(stdout," <csvfile>: Output, default stdout.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
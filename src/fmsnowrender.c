@@ -0,0 +1,294 @@
+/*
+ * NAME:
+ * fmsnowrender
+ *
+ * PURPOSE:
+ * To make the MITIFF images of a HDF5 product from fmsnowcover or
+ * fmaccusnow on demand, when fmsnowcover or fmaccusnow are run without
+ * MITIFF output (-n). Images already made are reused.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o HDF5 product of fmsnowcover (P(ice/snow), P(water/land), P(cloud))
+ *   or fmaccusnow (class, P(snow), P(clear)).
+ * o Image type, prob for the ice probability image and cat for the
+ *   categorized image.
+ *
+ * OUTPUT:
+ * MITIFF images, the names are written to stdout. The images are named
+ * as they would have been by fmsnowcover and fmaccusnow and put in the
+ * directory of the product unless another directory is given.
+ *
+ * NOTES:
+ * An image is made only if it does not exist or is older than the
+ * product, unless -f is given. Images are written to a temporary name
+ * and renamed, so that requests for the same image at the same time do
+ * not see partial files.
+ *
+ * The classes are found by pice2class and probs2cat as in
+ * process_pixels4ice for passes, and taken from the class layer for
+ * composites, so the images are the same as those made during
+ * production. The satellite given in the header of composite images is
+ * that of the first pass.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Quick-look products of fmsnowcover
+ * -q are named as by fmsnowcover.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <fmaccusnow.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define RENDER_PROB 0 /* image_type of store_snow */
+#define RENDER_CAT 1
+
+static int rendername(char *prodfile, char *cachedir, int image_type,
+	char *outfile);
+static int renderimage(osihdf *prod, int image_type, unsigned char *im);
+static int uptodate(char *outfile, char *prodfile);
+static void renderusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowrender";
+    extern char *optarg;
+    char *prodfile = NULL, *cachedir = NULL, *type = "all";
+    char outfile[FILELEN], tmpname[FILELEN+16];
+    int ret, t, force = 0, status = FM_OK, loaded = 0;
+    int types[2], ntypes = 0;
+    unsigned char *im = NULL;
+    fmio_mihead clinfo = {
+	"Not known",
+	00, 00, 00, 00, 0000, -9,
+	{0, 0, 0, 0, 0, 0, 0, 0},
+	0, 0, 0, 0., 0., -999., -999.
+    };
+    osihdf prod;
+
+    while ((ret = getopt(argc, argv, "i:t:d:f")) != EOF) {
+	switch (ret) {
+	    case 'i':
+		prodfile = optarg;
+		break;
+	    case 't':
+		type = optarg;
+		break;
+	    case 'd':
+		cachedir = optarg;
+		break;
+	    case 'f':
+		force++;
+		break;
+	    default:
+		renderusage();
+	}
+    }
+    if (!prodfile) renderusage();
+
+    if (strcmp(type,"prob") == 0 || strcmp(type,"all") == 0) {
+	types[ntypes++] = RENDER_PROB;
+    }
+    if (strcmp(type,"cat") == 0 || strcmp(type,"all") == 0) {
+	types[ntypes++] = RENDER_CAT;
+    }
+    if (ntypes == 0) renderusage();
+
+    init_osihdf(&prod);
+    for (t=0;t<ntypes;t++) {
+	if (rendername(prodfile, cachedir, types[t], outfile)) {
+	    fmerrmsg(where,"Can not name the image of %s", prodfile);
+	    exit(FM_SYNTAX_ERR);
+	}
+	if (!force && uptodate(outfile, prodfile)) {
+	    fprintf(stdout,"%s\n",outfile);
+	    continue;
+	}
+
+	if (!loaded) {
+	    if (read_hdf5_product(prodfile, &prod, 0)) {
+		fmerrmsg(where,"Could not read %s", prodfile);
+		exit(FM_IO_ERR);
+	    }
+	    loaded++;
+	    im = (unsigned char *) malloc(prod.h.iw*prod.h.ih*sizeof(char));
+	    if (!im) {
+		fmerrmsg(where,"Could not allocate image");
+		exit(FM_MEMALL_ERR);
+	    }
+	    sprintf(clinfo.satellite,"%s",prod.h.source);
+	    clinfo.hour = prod.h.hour;
+	    clinfo.minute = prod.h.minute;
+	    clinfo.day = prod.h.day;
+	    clinfo.month = prod.h.month;
+	    clinfo.year = prod.h.year;
+	    clinfo.zsize = 1;
+	    clinfo.xsize = prod.h.iw;
+	    clinfo.ysize = prod.h.ih;
+	    clinfo.Ax = prod.h.Ax;
+	    clinfo.Ay = prod.h.Ay;
+	    clinfo.Bx = prod.h.Bx;
+	    clinfo.By = prod.h.By;
+	}
+
+	if (renderimage(&prod, types[t], im)) {
+	    fmerrmsg(where,"%s is not a snow product", prodfile);
+	    status = FM_SYNTAX_ERR;
+	    break;
+	}
+	sprintf(tmpname,"%s.%d",outfile,(int) getpid());
+	if (store_snow(tmpname, im, clinfo, types[t]) ||
+		rename(tmpname, outfile)) {
+	    fmerrmsg(where,"Could not create %s", outfile);
+	    unlink(tmpname);
+	    status = FM_IO_ERR;
+	    break;
+	}
+	fprintf(stdout,"%s\n",outfile);
+    }
+
+    if (im) free(im);
+    if (loaded) free_osihdf(&prod);
+
+    exit(status);
+}
+
+/*
+ * NAME:
+ * rendername
+ *
+ * PURPOSE:
+ * To find the name of the image, fmsnow_<tile>_<date>.hdf5 from
+ * fmsnowcover gives fmsnow_<tile>_<date>.mitiff and
+ * fmsnow_cat_<tile>_<date>.mitiff, quick-looks (fmsnowql_) likewise,
+ * <prefix>_<rest>.hdf5 from fmaccusnow
+ * gives <prefix>-sp_<rest>.mitiff and <prefix>-cl_<rest>.mitiff.
+ */
+static int rendername(char *prodfile, char *cachedir, int image_type,
+	char *outfile) {
+
+    char dir[FILELEN], base[FILELEN];
+    char *pt;
+    int len;
+
+    pt = strrchr(prodfile,'/');
+    if (pt) {
+	snprintf(dir,FILELEN,"%.*s",(int) (pt-prodfile),prodfile);
+	pt++;
+    } else {
+	sprintf(dir,".");
+	pt = prodfile;
+    }
+    if (cachedir) snprintf(dir,FILELEN,"%s",cachedir);
+
+    len = strlen(pt);
+    if (len < 6 || strcmp(pt+len-5,".hdf5") != 0) return(FM_SYNTAX_ERR);
+    snprintf(base,FILELEN,"%.*s",len-5,pt);
+
+    if (strncmp(base,"fmsnow_",7) == 0 || strncmp(base,"fmsnowql_",9) == 0) {
+	pt = strchr(base,'_')+1;
+	if (image_type == RENDER_PROB) {
+	    snprintf(outfile,FILELEN,"%s/%s.mitiff",dir,base);
+	} else {
+	    snprintf(outfile,FILELEN,"%s/%.*scat_%s.mitiff",dir,
+		    (int) (pt-base),base,pt);
+	}
+    } else {
+	pt = strchr(base,'_');
+	if (!pt) return(FM_SYNTAX_ERR);
+	snprintf(outfile,FILELEN,"%s/%.*s-%s%s.mitiff",dir,
+		(int) (pt-base),base,
+		(image_type == RENDER_PROB) ? "sp" : "cl", pt);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * renderimage
+ *
+ * PURPOSE:
+ * To find the classes shown in the image from the product layers.
+ */
+static int renderimage(osihdf *prod, int image_type, unsigned char *im) {
+
+    int i, size;
+    float *pice, *pfree, *pcloud, *psnow;
+    int *cl;
+    probstr p;
+
+    if (prod->h.z < 3) return(FM_SYNTAX_ERR);
+    size = prod->h.iw*prod->h.ih;
+
+    if (prod->d[0].type == OSI_FLOAT && prod->d[1].type == OSI_FLOAT &&
+	    prod->d[2].type == OSI_FLOAT) {
+	/*
+	 * Pass from fmsnowcover, pixels not classified have missing
+	 * values in all layers.
+	 */
+	pice = (float *) prod->d[0].data;
+	pfree = (float *) prod->d[1].data;
+	pcloud = (float *) prod->d[2].data;
+	for (i=0;i<size;i++) {
+	    if (pice[i] < 0.) {
+		im[i] = (image_type == RENDER_PROB) ? 0 : UNDEF;
+		continue;
+	    }
+	    p.pice = pice[i];
+	    p.pfree = pfree[i];
+	    p.pcloud = pcloud[i];
+	    im[i] = (image_type == RENDER_PROB) ?
+		pice2class(p.pice) : probs2cat(&p);
+	}
+    } else if (prod->d[0].type == CLASS_DT && prod->d[1].type == PROB_DT) {
+	/*
+	 * Composite from fmaccusnow.
+	 */
+	cl = (int *) prod->d[0].data;
+	psnow = (float *) prod->d[1].data;
+	for (i=0;i<size;i++) {
+	    im[i] = (image_type == RENDER_PROB) ?
+		pice2class(psnow[i]) : (unsigned char) cl[i];
+	}
+    } else {
+	return(FM_SYNTAX_ERR);
+    }
+
+    return(FM_OK);
+}
+
+static int uptodate(char *outfile, char *prodfile) {
+    struct stat obuf, pbuf;
+
+    if (stat(outfile,&obuf) || obuf.st_size == 0) return(0);
+    if (stat(prodfile,&pbuf)) return(0);
+
+    return(obuf.st_mtime >= pbuf.st_mtime);
+}
+
+static void renderusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " fmsnowrender -i <product> [-t <type>] [-d <dir>] [-f]\n\n");
+    fprintf(stdout," <product>: HDF5 product of fmsnowcover or fmaccusnow.\n");
+    fprintf(stdout," <type>: prob, cat or all (default).\n");
+    fprintf(stdout," <dir>: Directory of the images, default is that of\n");
+    fprintf(stdout,"   the product.\n");
+    fprintf(stdout," -f: Make the images even if they are up to date.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
@@ -0,0 +1,56 @@
+/*
+ * NAME:
+ * fmsnowstream.h
+ *
+ * PURPOSE:
+ * Framed scenes read by fmsnowcover from stdin or a named pipe, and
+ * framed products written to stdout.
+ *
+ * NOTES:
+ * See scenestream.c for the format. fmsnowcover.h must be included
+ * first.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _FMSNOWSTREAM_H
+#define _FMSNOWSTREAM_H
+
+#include <fmsnowlib.h>
+
+#define FMSNOWSTREAM_END 1 /* no more scenes, not an error */
+#define FMSNOWSTREAM_LINELEN 256
+#define FMSNOWSTREAM_FLOAT32 4 /* bytes of each value */
+#define FMSNOWSTREAM_UINT8 1
+
+/*
+ * Scene read from a stream, the channels are calibrated when read and
+ * ordered as in fmsnowlib_scene.
+ */
+typedef struct {
+    char sa[32];
+    char tile[16]; /* as in input file names, e.g. ns */
+    fmtime time;
+    fmucsref ref;
+    float cover;
+    int strip; /* rows in each strip, 0 if whole planes */
+    int bytes; /* FMSNOWSTREAM_FLOAT32 or FMSNOWSTREAM_UINT8 */
+    float gain[FMSNOWLIB_CHANNELS];
+    float offset[FMSNOWLIB_CHANNELS];
+    float *ch[FMSNOWLIB_CHANNELS];
+} fmsnowstreamscene;
+
+int fmsnowstream_read(FILE *fp, fmsnowstreamscene *ss);
+void fmsnowstream_free(fmsnowstreamscene *ss);
+int fmsnowstream_write(FILE *fp, fmsnowstreamscene *ss, float cloudfree,
+    float *probs[FMSNOWCOVER_OLEVELS], unsigned char *class,
+    unsigned char *cat);
+
+#endif /* _FMSNOWSTREAM_H */
@@ -0,0 +1,482 @@
+/*
+ * NAME:
+ * fmsnowsynth
+ *
+ * PURPOSE:
+ * To create a synthetic AVHRR scene and a matching physiography (land
+ * fraction) file for one of the tiles, to run fmsnowcover without
+ * operational data.
+ *
+ * REQUIREMENTS:
+ * libfmutil
+ * libosihdf5
+ * libtiff
+ *
+ * INPUT:
+ * o Statistical coefficients, the channel values of each pixel are
+ *   drawn from the pdfs of a class used in the surface regime.
+ * o Tile, scene size, time and the wanted night fraction, coverage and
+ *   fraction of 3B lines given on the commandline.
+ *
+ * OUTPUT:
+ * o Multichannel MITIFF file with channels 1, 2, 3B, 4, 5 and 3A, in
+ *   the order used by process_pixels4ice.
+ * o OSIHDF5 file containing land fraction (0-255) for the same grid.
+ *
+ * NOTES:
+ * The tile covers the same area whatever the scene size, the pixel size
+ * is scaled to keep the extent of the 1200x1200 1.5 km tiles.
+ *
+ * Reflectances are stored as 0.4*count (%), temperatures as
+ * 163.0+0.5*count (K), the calibration tables of the MITIFF header are
+ * written accordingly.
+ *
+ * The satellite swath covers the left part of the tile, the fraction
+ * covered is set by the coverage. 3B lines are put at the bottom of the
+ * tile. If a night fraction is given, the hour of the scene is chosen
+ * to get approximately this fraction of the tile with a solar zenith
+ * angle above FMSNOWSUNZEN.
+ *
+ * BUGS:
+ * Pixels are drawn independently, so the scenes have no spatial
+ * structure except for the land fraction.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <synthpix.h>
+#include <unistd.h>
+#include <tiffio.h>
+
+#define SYNTH_CHANNELS 6
+#define SYNTH_REFLGAIN 0.4
+#define SYNTH_TEMPGAIN 0.5
+#define SYNTH_TEMPOFFSET 163.0
+
+static int writescene(char *fname, unsigned char *image[], int iw, int ih,
+	fmucsref ucs, fmtime t);
+static int writelandmask(char *fname, unsigned char *lmask, char *tile,
+	fmucsref ucs);
+static float nightfrac(fmucsref ucs, fmtime t);
+static unsigned char reflcount(double refl);
+static unsigned char tempcount(double temp);
+static void synthusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowsynth";
+    extern char *optarg;
+    char *coffile = "../etc/statcoeffs_4surfs.txt";
+    char *tile = "ns", *imgfile = NULL, *lmfile = NULL;
+    char *datetime = "201003211200";
+    int ret, i, xc, yc, size = SYNTHTILE_SIZE, reg, mode, ch, best;
+    int yy, mm, dd, ho, mi;
+    float night = -1., cover = 100., frac3b = 0., f, bestdiff;
+    double x, y, s, edge;
+    unsigned char *image[SYNTH_CHANNELS], *lmask;
+    unsigned long seed = 19102026UL;
+    pinpstr pix;
+    fmucsref ucs;
+    fmindex cart;
+    fmucspos ucspos;
+    fmgeopos geop;
+    fmtime t;
+    fmsec1970 tsec, tst;
+    statcoeffstr coeffs;
+
+    while ((ret = getopt(argc, argv, "c:t:s:d:N:v:b:r:o:l:")) != EOF) {
+	switch (ret) {
+	    case 'c':
+		coffile = optarg;
+		break;
+	    case 't':
+		tile = optarg;
+		break;
+	    case 's':
+		size = atoi(optarg);
+		break;
+	    case 'd':
+		datetime = optarg;
+		break;
+	    case 'N':
+		night = atof(optarg);
+		break;
+	    case 'v':
+		cover = atof(optarg);
+		break;
+	    case 'b':
+		frac3b = atof(optarg);
+		break;
+	    case 'r':
+		seed = strtoul(optarg,NULL,10);
+		break;
+	    case 'o':
+		imgfile = optarg;
+		break;
+	    case 'l':
+		lmfile = optarg;
+		break;
+	    default:
+		synthusage();
+	}
+    }
+    if (!imgfile || !lmfile || size < 2) synthusage();
+    if (sscanf(datetime,"%4d%2d%2d%2d%2d",&yy,&mm,&dd,&ho,&mi) != 5) {
+	fmerrmsg(where,"Could not decode %s as yyyymmddhhmm", datetime);
+	exit(FM_SYNTAX_ERR);
+    }
+
+    if (synthtileucs(tile, size, &ucs)) {
+	fmerrmsg(where,"Tile %s is not known", tile);
+	exit(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    initstatcoeffs(&coeffs);
+    if (rdstatcoeffs(coffile,&coeffs) == FM_IO_ERR ||
+	    buildstatcoeffs(&coeffs)) {
+	fmerrmsg(where,"Could not use statistical coefficients in %s",
+		coffile);
+	exit(FM_IO_ERR);
+    }
+    synthseed(seed);
+
+    t.fm_year = yy;
+    t.fm_mon = mm;
+    t.fm_mday = dd;
+    t.fm_hour = ho;
+    t.fm_min = mi;
+    t.fm_sec = 0;
+
+    /*
+     * Choose the time of day (in steps of 15 minutes) giving the night
+     * fraction requested.
+     */
+    if (night >= 0.) {
+	best = 0;
+	bestdiff = 2.;
+	for (i=0;i<96;i++) {
+	    t.fm_hour = i/4;
+	    t.fm_min = 15*(i%4);
+	    f = fabs(nightfrac(ucs,t)-night);
+	    if (f < bestdiff) {
+		bestdiff = f;
+		best = i;
+	    }
+	}
+	t.fm_hour = best/4;
+	t.fm_min = 15*(best%4);
+	fmlogmsg(where,"Using %02d:%02d UTC, night fraction %.2f",
+		t.fm_hour, t.fm_min, nightfrac(ucs,t));
+    }
+    tsec = tofmsec1970(t);
+
+    for (ch=0;ch<SYNTH_CHANNELS;ch++) {
+	image[ch] = (unsigned char *) calloc(size*size,sizeof(char));
+	if (!image[ch]) {
+	    fmerrmsg(where,"Could not allocate memory for the scene");
+	    exit(FM_MEMALL_ERR);
+	}
+    }
+    lmask = (unsigned char *) malloc(size*size);
+    if (!lmask) {
+	fmerrmsg(where,"Could not allocate memory for the land mask");
+	exit(FM_MEMALL_ERR);
+    }
+
+    for (yc=0;yc<size;yc++) {
+	for (xc=0;xc<size;xc++) {
+	    i = fmivec(xc, yc, size);
+
+	    /*
+	     * Smooth land/sea pattern with a coastal zone of mixed
+	     * pixels.
+	     */
+	    x = (double) xc/size;
+	    y = (double) yc/size;
+	    s = sin(2.*fmPI*(1.5*x+0.1))*cos(2.*fmPI*(1.2*y-0.2))+0.2*x;
+	    if (s <= -0.05) {
+		lmask[i] = FMSNOWSEA;
+	    } else if (s >= 0.05) {
+		lmask[i] = 255;
+	    } else {
+		lmask[i] = (unsigned char) (1.+253.*(s+0.05)/0.1);
+	    }
+
+	    /*
+	     * The swath edge is slanted, cover is the mean fraction.
+	     */
+	    edge = cover/100.+0.2*(y-0.5);
+	    if (x >= edge) continue;
+
+	    cart.row = yc;
+	    cart.col = xc;
+	    ucspos = fmind2ucs(ucs, cart);
+	    geop = fmucs2geo(ucspos,MI);
+	    tst = fmutc2tst(tsec, geop.lon);
+	    pix.soz = fmsolarzenith(tst, geop);
+	    if (pix.soz > 89.) pix.soz = 89.;
+
+	    if (lmask[i] <= FMSNOWSEA) {
+		reg = FMSNOWREGSEA;
+	    } else if (lmask[i] >= FMSNOWLAND) {
+		reg = FMSNOWREGLAND;
+	    } else {
+		reg = FMSNOWREGCOAST;
+	    }
+	    mode = (y >= 1.-frac3b) ? FMSNOWMODE3B : FMSNOWMODE3A;
+	    pix.lmask = lmask[i];
+	    if (synthpixels(&coeffs, reg, mode, &pix, 1)) {
+		fmerrmsg(where,"No classes available for regime %d", reg);
+		exit(FM_VAROUTOFSCOPE_ERR);
+	    }
+
+	    if (pix.soz < FMSNOWSUNZEN) {
+		image[0][i] = reflcount(pix.A1);
+		image[1][i] = reflcount(pix.A2);
+	    }
+	    image[3][i] = tempcount(pix.T4);
+	    image[4][i] = tempcount(pix.T5);
+	    if (mode == FMSNOWMODE3B) {
+		/*
+		 * Warmer 3B for higher reflectance in 3B, only roughly
+		 * what fm_ch3brefl assumes.
+		 */
+		image[2][i] = tempcount(pix.T4+2.+0.6*pix.A3b);
+		image[5][i] = 0;
+	    } else {
+		image[2][i] = 0;
+		image[5][i] = reflcount(pix.A3);
+	    }
+	}
+    }
+
+    if (writescene(imgfile, image, size, size, ucs, t)) {
+	fmerrmsg(where,"Could not write %s", imgfile);
+	exit(FM_IO_ERR);
+    }
+    if (writelandmask(lmfile, lmask, tile, ucs)) {
+	fmerrmsg(where,"Could not write %s", lmfile);
+	exit(FM_IO_ERR);
+    }
+    fmlogmsg(where,"Created %s and %s", imgfile, lmfile);
+
+    for (ch=0;ch<SYNTH_CHANNELS;ch++) {
+	free(image[ch]);
+    }
+    free(lmask);
+
+    exit(FM_OK);
+}
+
+/*
+ * NAME:
+ * nightfrac
+ *
+ * PURPOSE:
+ * To estimate the fraction of the tile with a solar zenith angle above
+ * FMSNOWSUNZEN, using a grid of 50x50 pixels.
+ */
+static float nightfrac(fmucsref ucs, fmtime t) {
+    int xc, yc, n = 0;
+    fmindex cart;
+    fmgeopos geop;
+    fmsec1970 tsec;
+
+    tsec = tofmsec1970(t);
+    for (yc=0;yc<50;yc++) {
+	for (xc=0;xc<50;xc++) {
+	    cart.row = yc*ucs.ih/50;
+	    cart.col = xc*ucs.iw/50;
+	    geop = fmucs2geo(fmind2ucs(ucs, cart),MI);
+	    if (fmsolarzenith(fmutc2tst(tsec, geop.lon), geop) >= FMSNOWSUNZEN) {
+		n++;
+	    }
+	}
+    }
+
+    return(n/2500.);
+}
+
+static unsigned char reflcount(double refl) {
+    double c;
+
+    c = refl/SYNTH_REFLGAIN+0.5;
+    if (c < 1.) return(1);
+    if (c > 255.) return(255);
+
+    return((unsigned char) c);
+}
+
+static unsigned char tempcount(double temp) {
+    double c;
+
+    c = (temp-SYNTH_TEMPOFFSET)/SYNTH_TEMPGAIN+0.5;
+    if (c < 1.) return(1);
+    if (c > 255.) return(255);
+
+    return((unsigned char) c);
+}
+
+/*
+ * NAME:
+ * writescene
+ *
+ * PURPOSE:
+ * To write the channels as a multichannel MITIFF file, one image
+ * directory per channel with the MITIFF header in the first.
+ */
+static int writescene(char *fname, unsigned char *image[], int iw, int ih,
+	fmucsref ucs, fmtime t) {
+
+    char *where="writescene";
+    char *chname[SYNTH_CHANNELS] = {"1","2","3B","4","5","3A"};
+    char *head, *pt;
+    int ch, j, row;
+    TIFF *fp;
+
+    head = (char *) malloc(FMIO_TIFFHEAD+SYNTH_CHANNELS*256*8);
+    if (!head) {
+	fmerrmsg(where,"Could not allocate memory for header");
+	return(FM_MEMALL_ERR);
+    }
+    pt = head;
+    pt += sprintf(pt," Satellite: NOAA-18\n");
+    pt += sprintf(pt," Date and Time: %02d:%02d %02d/%02d-%4d\n",
+	    t.fm_hour, t.fm_min, t.fm_mday, t.fm_mon, t.fm_year);
+    pt += sprintf(pt," SatDir: 0\n");
+    pt += sprintf(pt," Channels: %d In this file:",SYNTH_CHANNELS);
+    for (ch=0;ch<SYNTH_CHANNELS;ch++) {
+	pt += sprintf(pt," %s",chname[ch]);
+    }
+    pt += sprintf(pt,"\n Xsize: %d\n Ysize: %d\n", iw, ih);
+    pt += sprintf(pt," Map projection: Stereographic\n");
+    pt += sprintf(pt," TrueLat: 60 N\n GridRot: 0\n");
+    pt += sprintf(pt," Xunit:1000 m Yunit: 1000 m\n");
+    pt += sprintf(pt," NPX: 0.000000 NPY: 0.000000\n");
+    pt += sprintf(pt," Ax: %f Ay: %f Bx: %f By: %f\n",
+	    ucs.Ax, ucs.Ay, ucs.Bx, ucs.By);
+    for (ch=0;ch<SYNTH_CHANNELS;ch++) {
+	if (ch == 2 || ch == 3 || ch == 4) {
+	    pt += sprintf(pt," Table_calibration: %s, Temperature, K, 8, [",
+		    chname[ch]);
+	    for (j=0;j<256;j++) {
+		pt += sprintf(pt," %.2f", SYNTH_TEMPOFFSET+SYNTH_TEMPGAIN*j);
+	    }
+	} else {
+	    pt += sprintf(pt," Table_calibration: %s, Reflectance, %%, 8, [",
+		    chname[ch]);
+	    for (j=0;j<256;j++) {
+		pt += sprintf(pt," %.2f", SYNTH_REFLGAIN*j);
+	    }
+	}
+	pt += sprintf(pt," ]\n");
+    }
+
+    fp = TIFFOpen(fname,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", fname);
+	free(head);
+	return(FM_IO_ERR);
+    }
+    for (ch=0;ch<SYNTH_CHANNELS;ch++) {
+	TIFFSetField(fp, TIFFTAG_IMAGEWIDTH, iw);
+	TIFFSetField(fp, TIFFTAG_IMAGELENGTH, ih);
+	TIFFSetField(fp, TIFFTAG_BITSPERSAMPLE, 8);
+	TIFFSetField(fp, TIFFTAG_SAMPLESPERPIXEL, 1);
+	TIFFSetField(fp, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+	TIFFSetField(fp, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+	TIFFSetField(fp, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFSetField(fp, TIFFTAG_ROWSPERSTRIP, 1);
+	if (ch == 0) {
+	    TIFFSetField(fp, TIFFTAG_IMAGEDESCRIPTION, head);
+	}
+	for (row=0;row<ih;row++) {
+	    if (TIFFWriteScanline(fp, &image[ch][row*iw], row, 0) < 0) {
+		fmerrmsg(where,"Could not write channel %s", chname[ch]);
+		TIFFClose(fp);
+		free(head);
+		return(FM_IO_ERR);
+	    }
+	}
+	TIFFWriteDirectory(fp);
+    }
+    TIFFClose(fp);
+    free(head);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * writelandmask
+ *
+ * PURPOSE:
+ * To store the land fraction in the same layout as the physiography
+ * files in etc.
+ */
+static int writelandmask(char *fname, unsigned char *lmask, char *tile,
+	fmucsref ucs) {
+
+    int status;
+    osihdf lm;
+    osi_dtype lm_ft[1] = {OSI_UCHAR};
+    char *lm_desc[1] = {"Fraction of land"};
+
+    init_osihdf(&lm);
+    sprintf(lm.h.source, "%s", "fmsnowsynth");
+    sprintf(lm.h.product, "%s", "Fraction of land");
+    sprintf(lm.h.area, "%s", tile);
+    sprintf(lm.h.projstr, "%s",
+	    "+proj=stere +a=6371000 +b=6371000 +lat_0=90 +lat_ts=60 +lon_0=0");
+    lm.h.iw = ucs.iw;
+    lm.h.ih = ucs.ih;
+    lm.h.z = 1;
+    lm.h.Ax = ucs.Ax;
+    lm.h.Ay = ucs.Ay;
+    lm.h.Bx = ucs.Bx;
+    lm.h.By = ucs.By;
+    lm.h.year = 2009;
+    lm.h.month = 1;
+    lm.h.day = 1;
+    lm.h.hour = 0;
+    lm.h.minute = 0;
+    if (malloc_osihdf(&lm,lm_ft,lm_desc)) return(FM_MEMALL_ERR);
+    memcpy(lm.d[0].data, lmask, ucs.iw*ucs.ih);
+
+    status = store_hdf5_product(fname,lm);
+    free_osihdf(&lm);
+
+    return(status ? FM_IO_ERR : FM_OK);
+}
+
+static void synthusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " fmsnowsynth -o <scene> -l <landmask> [-t <tile>] [-s <size>]\n");
+    fprintf(stdout,
+	    "   [-d <yyyymmddhhmm>] [-N <night>] [-v <cover>] [-b <frac3b>]\n");
+    fprintf(stdout,
+	    "   [-c <coeffile>] [-r <seed>]\n\n");
+    fprintf(stdout," <scene>: Output MITIFF file, the name must contain\n");
+    fprintf(stdout,"   the tile (as expected by fmsnowcover).\n");
+    fprintf(stdout," <landmask>: Output OSIHDF5 land fraction file.\n");
+    fprintf(stdout," <tile>: ns, nr, at or gr (default ns).\n");
+    fprintf(stdout," <size>: Pixels along each side (default %d).\n",
+	    SYNTHTILE_SIZE);
+    fprintf(stdout," <night>: Fraction of tile in darkness (0-1), the\n");
+    fprintf(stdout,"   hour given in -d is then ignored.\n");
+    fprintf(stdout," <cover>: Percentage of tile covered by the swath.\n");
+    fprintf(stdout," <frac3b>: Fraction of lines using 3B (0-1).\n");
+    fprintf(stdout," <coeffile>: Statistical coefficients to draw from.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
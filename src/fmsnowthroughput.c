@@ -0,0 +1,277 @@
+/*
+ * NAME:
+ * fmsnowthroughput
+ *
+ * PURPOSE:
+ * End to end benchmark of fmsnowcover. Synthetic scenes are created by
+ * fmsnowsynth for each tile and scene size requested, fmsnowcover is
+ * run on each scene and the time and memory used are reported as CSV.
+ *
+ * REQUIREMENTS:
+ * fmsnowsynth and fmsnowcover binaries
+ *
+ * INPUT:
+ * o Work directory, img, lm and prod are created below it and a
+ *   configuration file for fmsnowcover is written there.
+ * o Tiles, scene sizes and scene properties given on the commandline.
+ *
+ * OUTPUT:
+ * CSV with one line per run of fmsnowcover:
+ * tile,size,pixels,run,status,wall_s,user_s,sys_s,maxrss_kb,pixels_per_s,
+ * config_s,coeffs_s,probe_s,image_s,nwp_s,landmask_s,quicklook_s,
+ * pixels_s,writewait_s,hdf5_s,mitiff_s,mitiffcat_s,index_s
+ *
+ * The stage times are the wall times of the timing line of fmsnowcover
+ * (fmsnowtimer): image is the reading of the scene, pixels the
+ * classification, hdf5, mitiff and mitiffcat the writing of the
+ * products by the writer threads and index the update of the index
+ * file. Stages not run are given as 0.
+ *
+ * NOTES:
+ * No NWPPATH is written to the configuration file, so fmsnowcover runs
+ * without NWP data (the dt feature is not used). The output of
+ * fmsnowcover is appended to fmsnowcover.log in the work directory.
+ *
+ * Extra arguments to fmsnowcover can be given by -x, e.g. to check
+ * other options.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: runcommand moved to benchrun.c.
+ * ystein Gody, METNO/FOU, 19.10.2026: Wall time of each stage of
+ * fmsnowcover added.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define THRU_MAXARGS 64
+#define THRU_LINELEN 8192
+
+static char *stages[] = {"config", "coeffs", "probe", "image", "nwp",
+    "landmask", "quicklook", "pixels", "writewait", "hdf5", "mitiff",
+    "mitiffcat", "index", NULL};
+
+static int splitargs(char *str, char *argv[], int maxargs);
+static void thruusage(void);
+
+int main(int argc, char *argv[]) {
+
+    char *where="fmsnowthroughput";
+    extern char *optarg;
+    char *workdir = NULL, *csvfile = NULL, *extra = NULL;
+    char *fmsnowcover = "./fmsnowcover", *fmsnowsynth = "./fmsnowsynth";
+    char *coffile = "../etc/statcoeffs_4surfs.txt";
+    char *tilelist = "ns", *sizelist = "1200";
+    char *night = NULL, *cover = "100", *frac3b = "0";
+    char tilebuf[FILELEN], sizebuf[FILELEN], extrabuf[FILELEN];
+    char cfgfile[FILELEN], logfile[FILELEN], dname[FILELEN];
+    char scene[FILELEN], imgfile[FILELEN], lmfile[FILELEN];
+    char sizestr[20], *tile, *sizept, *tsave, *ssave;
+    char *cargv[THRU_MAXARGS], line[THRU_LINELEN], key[FILELEN];
+    int ret, size, nrep = 3, r, n, nextra, k;
+    long logsize;
+    runstat rs;
+    struct stat sbuf;
+    FILE *fp, *csv;
+
+    while ((ret = getopt(argc, argv, "w:p:g:c:t:s:r:N:v:b:x:o:")) != EOF) {
+	switch (ret) {
+	    case 'w':
+		workdir = optarg;
+		break;
+	    case 'p':
+		fmsnowcover = optarg;
+		break;
+	    case 'g':
+		fmsnowsynth = optarg;
+		break;
+	    case 'c':
+		coffile = optarg;
+		break;
+	    case 't':
+		tilelist = optarg;
+		break;
+	    case 's':
+		sizelist = optarg;
+		break;
+	    case 'r':
+		nrep = atoi(optarg);
+		break;
+	    case 'N':
+		night = optarg;
+		break;
+	    case 'v':
+		cover = optarg;
+		break;
+	    case 'b':
+		frac3b = optarg;
+		break;
+	    case 'x':
+		extra = optarg;
+		break;
+	    case 'o':
+		csvfile = optarg;
+		break;
+	    default:
+		thruusage();
+	}
+    }
+    if (!workdir || nrep < 1) thruusage();
+
+    sprintf(dname,"%s/img",workdir);
+    mkdir(workdir,0755);
+    mkdir(dname,0755);
+    sprintf(dname,"%s/lm",workdir);
+    mkdir(dname,0755);
+    sprintf(dname,"%s/prod",workdir);
+    mkdir(dname,0755);
+
+    sprintf(cfgfile,"%s/fmsnowthroughput.cfg",workdir);
+    sprintf(logfile,"%s/fmsnowcover.log",workdir);
+    fp = fopen(cfgfile,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not create %s", cfgfile);
+	exit(FM_IO_ERR);
+    }
+    fprintf(fp,"IMGPATH %s/img\n",workdir);
+    fprintf(fp,"LMPATH %s/lm\n",workdir);
+    fprintf(fp,"PRODUCTPATH %s/prod\n",workdir);
+    fprintf(fp,"PROBTABNAME %s\n",coffile);
+    fprintf(fp,"INDEXFILE %s/prod/fmsnowcover.index\n",workdir);
+    fclose(fp);
+
+    if (csvfile) {
+	csv = fopen(csvfile,"w");
+	if (!csv) {
+	    fmerrmsg(where,"Could not create %s", csvfile);
+	    exit(FM_IO_ERR);
+	}
+    } else {
+	csv = stdout;
+    }
+    fprintf(csv,"tile,size,pixels,run,status,wall_s,user_s,sys_s,");
+    fprintf(csv,"maxrss_kb,pixels_per_s");
+    for (k=0;stages[k];k++) {
+	fprintf(csv,",%s_s",stages[k]);
+    }
+    fprintf(csv,"\n");
+
+    sprintf(tilebuf,"%s",tilelist);
+    for (tile=strtok_r(tilebuf,",",&tsave); tile;
+	    tile=strtok_r(NULL,",",&tsave)) {
+	sprintf(sizebuf,"%s",sizelist);
+	for (sizept=strtok_r(sizebuf,",",&ssave); sizept;
+		sizept=strtok_r(NULL,",",&ssave)) {
+	    size = atoi(sizept);
+	    sprintf(sizestr,"%d",size);
+	    sprintf(scene,"synth_%s_%d.%s.aha",tile,size,tile);
+	    sprintf(imgfile,"%s/img/%s",workdir,scene);
+	    sprintf(lmfile,"%s/lm/physiography.dn%s.hdf5",workdir,tile);
+
+	    n = 0;
+	    cargv[n++] = fmsnowsynth;
+	    cargv[n++] = "-t"; cargv[n++] = tile;
+	    cargv[n++] = "-s"; cargv[n++] = sizestr;
+	    cargv[n++] = "-c"; cargv[n++] = coffile;
+	    cargv[n++] = "-v"; cargv[n++] = cover;
+	    cargv[n++] = "-b"; cargv[n++] = frac3b;
+	    if (night) {
+		cargv[n++] = "-N"; cargv[n++] = night;
+	    }
+	    cargv[n++] = "-o"; cargv[n++] = imgfile;
+	    cargv[n++] = "-l"; cargv[n++] = lmfile;
+	    cargv[n] = NULL;
+	    fmlogmsg(where,"Creating %s", imgfile);
+	    if (runcommand(cargv, logfile, &rs) || rs.status) {
+		fmerrmsg(where,"Could not create scene for %s %d", tile, size);
+		continue;
+	    }
+
+	    n = 0;
+	    cargv[n++] = fmsnowcover;
+	    cargv[n++] = "-c"; cargv[n++] = cfgfile;
+	    cargv[n++] = "-i"; cargv[n++] = scene;
+	    if (extra) {
+		sprintf(extrabuf,"%s",extra);
+		nextra = splitargs(extrabuf, &cargv[n], THRU_MAXARGS-n-1);
+		n += nextra;
+	    }
+	    cargv[n] = NULL;
+
+	    for (r=0;r<nrep;r++) {
+		logsize = (stat(logfile,&sbuf) == 0) ? (long) sbuf.st_size : 0;
+		if (runcommand(cargv, logfile, &rs)) {
+		    fmerrmsg(where,"Could not run %s", fmsnowcover);
+		    exit(FM_IO_ERR);
+		}
+		if (readtimerline(logfile, logsize, line, THRU_LINELEN)) {
+		    fmerrmsg(where,"No timing reported by %s, see %s",
+			    fmsnowcover, logfile);
+		}
+		fprintf(csv,"%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%ld,%.0f",
+			tile, size, size*size, r, rs.status,
+			rs.wall, rs.user, rs.sys, rs.maxrss,
+			(rs.wall > 0.) ? size*size/rs.wall : 0.);
+		for (k=0;stages[k];k++) {
+		    sprintf(key,"%s.wall",stages[k]);
+		    fprintf(csv,",%.3f",timerfield(line,key));
+		}
+		fprintf(csv,"\n");
+		fflush(csv);
+	    }
+	}
+    }
+
+    if (csv != stdout) fclose(csv);
+
+    exit(FM_OK);
+}
+
+/*
+ * NAME:
+ * splitargs
+ *
+ * PURPOSE:
+ * To split a string into arguments separated by space.
+ */
+static int splitargs(char *str, char *argv[], int maxargs) {
+    int n = 0;
+    char *pt, *save;
+
+    for (pt=strtok_r(str," ",&save); pt && n<maxargs;
+	    pt=strtok_r(NULL," ",&save)) {
+	argv[n++] = pt;
+    }
+
+    return(n);
+}
+
+static void thruusage(void) {
+    fprintf(stdout,"\n");
+    fprintf(stdout," SYNTAX:\n");
+    fprintf(stdout,
+	    " fmsnowthroughput -w <workdir> [-t <tiles>] [-s <sizes>] [-r <repeats>]\n");
+    fprintf(stdout,
+	    "   [-N <night>] [-v <cover>] [-b <frac3b>] [-c <coeffile>]\n");
+    fprintf(stdout,
+	    "   [-p <fmsnowcover>] [-g <fmsnowsynth>] [-x <args>] [-o <csvfile>]\n\n");
+    fprintf(stdout," <workdir>: Directory for scenes, masks and products.\n");
+    fprintf(stdout," <tiles>: Comma separated tiles (default ns).\n");
+    fprintf(stdout," <sizes>: Comma separated scene sizes (default 1200).\n");
+    fprintf(stdout," <repeats>: Runs of fmsnowcover per scene (default 3).\n");
+    fprintf(stdout," <night>, <cover>, <frac3b>: Passed to fmsnowsynth.\n");
+    fprintf(stdout," <args>: Extra arguments to fmsnowcover.\n");
+    fprintf(stdout," <csvfile>: Output file, default is stdout.\n");
+    fprintf(stdout,"\n");
+    exit(FM_OK);
+}
@@ -0,0 +1,319 @@
+/*
+ * NAME:
+ * fmsnowtimer
+ *
+ * PURPOSE:
+ * To measure wall clock and CPU time and peak memory used in the
+ * processing stages of fmsnowcover and fmaccusnow, and report them on a
+ * single line that is easy to parse by benchmark and monitoring scripts.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * The report is one line of key=value pairs:
+ * fmsnowtimer program=<name> start=<yyyy-mm-ddThh:mm:ssZ>
+ * [input=<name>] wall=<s> cpu=<s> maxrss=<kB> <stage>.wall=<s>
+ * <stage>.cpu=<s> <stage>.rss=<kB> <stage>.calls=<n>
+ * [<stage>.bytes=<n>] ... [<counter>=<n>] ...
+ *
+ * NOTES:
+ * Stages are identified by name and created when first started. A
+ * stage may be started and stopped several times, e.g. once for each
+ * file read, the time is accumulated. All functions accept a NULL
+ * timer and then do nothing, so functions can be timed only when the
+ * caller wants to.
+ *
+ * The memory reported for a stage is the peak resident set size of the
+ * process (ru_maxrss) when the stage last stopped, i.e. it includes
+ * memory allocated by earlier stages that is still in use. A stage
+ * that increases it is the one that set a new peak.
+ *
+ * Counters are added by fmsnowtimer_count and reported after the
+ * stages in the order they were first counted.
+ *
+ * fmsnowtimer_append adds the report to a metrics file, so that the
+ * performance of operational runs can be followed over time.
+ *
+ * Work done in other threads is added by fmsnowtimer_add, the CPU time
+ * is then that of the threads, while the CPU time of the other stages
+ * and the total is that of the process.
+ *
+ * Each time a stage is stopped it is added to the trace of fmsnowtrace,
+ * if one is open, as a span of category "stage".
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Peak RSS per stage, start time and
+ * input name added to the report, fmsnowtimer_append added.
+ * ystein Gody, METNO/FOU, 19.10.2026: Counters added.
+ * ystein Gody, METNO/FOU, 19.10.2026: fmsnowtimer_add added.
+ * ystein Gody, METNO/FOU, 19.10.2026: Stages are added to the trace.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <fmutil.h>
+#include <fmsnowtimer.h>
+#include <fmsnowtrace.h>
+
+static double wallnow(void);
+static double cpunow(void);
+static long rssnow(void);
+static fmsnowstage *findstage(fmsnowtimer *tm, char *name);
+
+int fmsnowtimer_init(fmsnowtimer *tm, char *program) {
+
+    if (!tm) return(FM_OK);
+
+    memset(tm,0,sizeof(fmsnowtimer));
+    snprintf(tm->program,FMSNOWTIMER_NAMELEN,"%s",program);
+    tm->wall0 = wallnow();
+    tm->cpu0 = cpunow();
+    tm->start = (long) time(NULL);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowtimer_input
+ *
+ * PURPOSE:
+ * To set the name of the input processed, it is included in the report.
+ */
+int fmsnowtimer_input(fmsnowtimer *tm, char *input) {
+
+    if (!tm) return(FM_OK);
+
+    snprintf(tm->input,FMSNOWTIMER_INPUTLEN,"%s",input);
+
+    return(FM_OK);
+}
+
+int fmsnowtimer_start(fmsnowtimer *tm, char *name) {
+    fmsnowstage *st;
+
+    if (!tm) return(FM_OK);
+
+    st = findstage(tm, name);
+    if (!st) return(FM_VAROUTOFSCOPE_ERR);
+    if (st->running) return(FM_OK);
+    st->running = 1;
+    st->calls++;
+    st->wall0 = wallnow();
+    st->cpu0 = cpunow();
+
+    return(FM_OK);
+}
+
+int fmsnowtimer_stop(fmsnowtimer *tm, char *name) {
+    fmsnowstage *st;
+    double wall;
+
+    if (!tm) return(FM_OK);
+
+    st = findstage(tm, name);
+    if (!st) return(FM_VAROUTOFSCOPE_ERR);
+    if (!st->running) return(FM_OK);
+    st->running = 0;
+    wall = wallnow();
+    st->wall += wall-st->wall0;
+    st->cpu += cpunow()-st->cpu0;
+    st->maxrss = rssnow();
+    fmsnowtrace_span("stage", st->name, NULL, st->wall0, wall);
+
+    return(FM_OK);
+}
+
+int fmsnowtimer_addbytes(fmsnowtimer *tm, char *name, long long bytes) {
+    fmsnowstage *st;
+
+    if (!tm) return(FM_OK);
+
+    st = findstage(tm, name);
+    if (!st) return(FM_VAROUTOFSCOPE_ERR);
+    st->bytes += bytes;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowtimer_add
+ *
+ * PURPOSE:
+ * To add time measured elsewhere, e.g. in a writer thread, to a stage.
+ */
+int fmsnowtimer_add(fmsnowtimer *tm, char *name, int calls, double wall,
+	double cpu, long long bytes) {
+    fmsnowstage *st;
+
+    if (!tm) return(FM_OK);
+
+    st = findstage(tm, name);
+    if (!st) return(FM_VAROUTOFSCOPE_ERR);
+    st->calls += calls;
+    st->wall += wall;
+    st->cpu += cpu;
+    st->bytes += bytes;
+    st->maxrss = rssnow();
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowtimer_count
+ *
+ * PURPOSE:
+ * To add n to the counter name, the counter is created if needed.
+ */
+int fmsnowtimer_count(fmsnowtimer *tm, char *name, long long n) {
+    int i;
+
+    if (!tm) return(FM_OK);
+
+    for (i=0;i<tm->ncount;i++) {
+	if (strcmp(tm->count[i].name,name) == 0) break;
+    }
+    if (i == tm->ncount) {
+	if (tm->ncount == FMSNOWTIMER_MAXCOUNTS) return(FM_VAROUTOFSCOPE_ERR);
+	snprintf(tm->count[i].name,FMSNOWTIMER_KEYLEN,"%s",name);
+	tm->ncount++;
+    }
+    tm->count[i].value += n;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowtimer_report
+ *
+ * PURPOSE:
+ * To write the time used by each stage as one line to fp. Stages that
+ * are still running are reported up to now.
+ */
+int fmsnowtimer_report(fmsnowtimer *tm, FILE *fp) {
+    int i;
+    double wall, cpu;
+    long maxrss;
+    char start[FMSNOWTIMER_NAMELEN];
+    time_t t;
+    fmsnowstage *st;
+
+    if (!tm) return(FM_OK);
+
+    t = (time_t) tm->start;
+    strftime(start,FMSNOWTIMER_NAMELEN,"%Y-%m-%dT%H:%M:%SZ",gmtime(&t));
+    fprintf(fp,"fmsnowtimer program=%s start=%s", tm->program, start);
+    if (strlen(tm->input) > 0) {
+	fprintf(fp," input=%s", tm->input);
+    }
+    fprintf(fp," wall=%.3f cpu=%.3f maxrss=%ld",
+	    wallnow()-tm->wall0, cpunow()-tm->cpu0, rssnow());
+    for (i=0;i<tm->nstage;i++) {
+	st = &tm->stage[i];
+	wall = st->wall;
+	cpu = st->cpu;
+	maxrss = st->maxrss;
+	if (st->running) {
+	    wall += wallnow()-st->wall0;
+	    cpu += cpunow()-st->cpu0;
+	    maxrss = rssnow();
+	}
+	fprintf(fp," %s.wall=%.3f %s.cpu=%.3f %s.rss=%ld %s.calls=%d",
+		st->name, wall, st->name, cpu, st->name, maxrss,
+		st->name, st->calls);
+	if (st->bytes) {
+	    fprintf(fp," %s.bytes=%lld", st->name, st->bytes);
+	}
+    }
+    for (i=0;i<tm->ncount;i++) {
+	fprintf(fp," %s=%lld", tm->count[i].name, tm->count[i].value);
+    }
+    fprintf(fp,"\n");
+    fflush(fp);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowtimer_append
+ *
+ * PURPOSE:
+ * To append the report to a metrics file, the file is created if it
+ * does not exist.
+ */
+int fmsnowtimer_append(fmsnowtimer *tm, char *filename) {
+    char *where="fmsnowtimer_append";
+    FILE *fp;
+
+    if (!tm) return(FM_OK);
+
+    fp = fopen(filename,"a");
+    if (!fp) {
+	fmerrmsg(where,"Could not open %s", filename);
+	return(FM_IO_ERR);
+    }
+    fmsnowtimer_report(tm, fp);
+    if (fclose(fp)) {
+	fmerrmsg(where,"Could not properly close %s", filename);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+static fmsnowstage *findstage(fmsnowtimer *tm, char *name) {
+    int i;
+
+    for (i=0;i<tm->nstage;i++) {
+	if (strcmp(tm->stage[i].name,name) == 0) return(&tm->stage[i]);
+    }
+    if (tm->nstage == FMSNOWTIMER_MAXSTAGES) return(NULL);
+    snprintf(tm->stage[i].name,FMSNOWTIMER_NAMELEN,"%s",name);
+    tm->nstage++;
+
+    return(&tm->stage[i]);
+}
+
+static double wallnow(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return(tv.tv_sec+1.e-6*tv.tv_usec);
+}
+
+static double cpunow(void) {
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return(ru.ru_utime.tv_sec+1.e-6*ru.ru_utime.tv_usec+
+	    ru.ru_stime.tv_sec+1.e-6*ru.ru_stime.tv_usec);
+}
+
+static long rssnow(void) {
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return(ru.ru_maxrss);
+}
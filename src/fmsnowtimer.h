@@ -0,0 +1,77 @@
+/*
+ * NAME:
+ * fmsnowtimer.h
+ *
+ * PURPOSE:
+ * Timing of the processing stages of fmsnowcover and fmaccusnow.
+ *
+ * NOTES:
+ * A stage may be started and stopped several times, the time used is
+ * accumulated. Counters (e.g. pixels processed) may be added to the
+ * report. See fmsnowtimer.c.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Peak RSS, input name and metrics
+ * file added.
+ * ystein Gody, METNO/FOU, 19.10.2026: Counters added.
+ * ystein Gody, METNO/FOU, 19.10.2026: fmsnowtimer_add added.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _FMSNOWTIMER_H
+#define _FMSNOWTIMER_H
+
+#include <stdio.h>
+
+#define FMSNOWTIMER_MAXSTAGES 24
+#define FMSNOWTIMER_NAMELEN 24
+#define FMSNOWTIMER_INPUTLEN 256
+#define FMSNOWTIMER_MAXCOUNTS 96
+#define FMSNOWTIMER_KEYLEN 48
+
+typedef struct {
+    char name[FMSNOWTIMER_NAMELEN];
+    int calls;
+    int running;
+    double wall; /* accumulated wall clock time [s] */
+    double cpu; /* accumulated user+system CPU time [s] */
+    double wall0;
+    double cpu0;
+    long long bytes; /* bytes read or written within the stage */
+    long maxrss; /* peak resident set size when stage stopped [kB] */
+} fmsnowstage;
+
+typedef struct {
+    char name[FMSNOWTIMER_KEYLEN];
+    long long value;
+} fmsnowcount;
+
+typedef struct {
+    char program[FMSNOWTIMER_NAMELEN];
+    char input[FMSNOWTIMER_INPUTLEN];
+    long start; /* seconds since 1970 when the timer was initialised */
+    int nstage;
+    double wall0;
+    double cpu0;
+    fmsnowstage stage[FMSNOWTIMER_MAXSTAGES];
+    int ncount;
+    fmsnowcount count[FMSNOWTIMER_MAXCOUNTS];
+} fmsnowtimer;
+
+int fmsnowtimer_init(fmsnowtimer *tm, char *program);
+int fmsnowtimer_start(fmsnowtimer *tm, char *name);
+int fmsnowtimer_stop(fmsnowtimer *tm, char *name);
+int fmsnowtimer_addbytes(fmsnowtimer *tm, char *name, long long bytes);
+int fmsnowtimer_input(fmsnowtimer *tm, char *input);
+int fmsnowtimer_add(fmsnowtimer *tm, char *name, int calls, double wall,
+    double cpu, long long bytes);
+int fmsnowtimer_count(fmsnowtimer *tm, char *name, long long n);
+int fmsnowtimer_report(fmsnowtimer *tm, FILE *fp);
+int fmsnowtimer_append(fmsnowtimer *tm, char *filename);
+
+#endif /* _FMSNOWTIMER_H */
@@ -0,0 +1,285 @@
+/*
+ * NAME:
+ * fmsnowtrace
+ *
+ * PURPOSE:
+ * To write a timeline of a run of fmsnowcover or fmaccusnow, with the
+ * processing stages, the files read and written and the work of each
+ * thread, that can be viewed after the run in chrome://tracing or
+ * Perfetto (ui.perfetto.dev, opened as a local file).
+ *
+ * REQUIREMENTS:
+ * POSIX threads
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * A JSON array of trace events, one event on each line:
+ *
+ *   [
+ *   {"ph":"M","pid":<pid>,"tid":1,"name":"process_name","args":{...}},
+ *   {"ph":"X","pid":<pid>,"tid":<tid>,"name":<name>,"cat":<cat>,
+ *    "ts":<us>,"dur":<us>,"args":{"detail":<detail>}},
+ *   ...
+ *   ]
+ *
+ * ts is the start in microseconds from fmsnowtrace_open and dur the
+ * length of the span. Threads are numbered from 1 (the thread calling
+ * fmsnowtrace_open) in the order they first add an event, and named by
+ * fmsnowtrace_thread.
+ *
+ * NOTES:
+ * Spans are written when they end, by fmsnowtrace_span with the times
+ * from fmsnowtrace_now. Each stage of fmsnowtimer is added as a span
+ * of category "stage" when stopped, other spans are added where the
+ * programs read or write a file ("read", "write"), wait ("wait") or
+ * process a tile or a group of passes ("tile", "merge").
+ *
+ * The closing bracket is written by fmsnowtrace_close, which is also
+ * called at exit. The viewers accept a trace without it, so the trace
+ * of a run that failed can be used as well.
+ *
+ * All functions do nothing until fmsnowtrace_open is called, and
+ * fmsnowtrace_now then returns 0 without reading the clock. The trace
+ * must be opened before other threads use it, events added after it is
+ * closed are dropped.
+ *
+ * Names and details are written as Latin-1, characters that are not
+ * printable ASCII are escaped.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <fmutil.h>
+#include <fmsnowtrace.h>
+
+static FILE *tracefp = NULL;
+static pthread_mutex_t tracelock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t tracetidkey;
+static double trace0;
+static long nevents;
+static int ntids;
+static int tracepid;
+
+static int tracetid(void);
+static void putevent(char *ph);
+static void putstr(char *s);
+static void closeatexit(void);
+static double tracewall(void);
+
+/*
+ * NAME:
+ * fmsnowtrace_open
+ *
+ * PURPOSE:
+ * To start the trace, filename is truncated. The process is named by
+ * program and the calling thread "main".
+ */
+int fmsnowtrace_open(char *filename, char *program) {
+    char *where="fmsnowtrace_open";
+
+    if (tracefp) return(FM_OK);
+
+    if (pthread_key_create(&tracetidkey, NULL)) {
+	fmerrmsg(where,"%s","Could not create thread key");
+	return(FM_MEMALL_ERR);
+    }
+    tracefp = fopen(filename,"w");
+    if (!tracefp) {
+	fmerrmsg(where,"Could not create %s", filename);
+	pthread_key_delete(tracetidkey);
+	return(FM_IO_ERR);
+    }
+    fprintf(tracefp,"[\n");
+    trace0 = tracewall();
+    nevents = 0;
+    ntids = 0;
+    tracepid = (int) getpid();
+    atexit(closeatexit);
+
+    pthread_mutex_lock(&tracelock);
+    putevent("M");
+    fprintf(tracefp,",\"name\":\"process_name\",\"args\":{\"name\":");
+    putstr(program);
+    fprintf(tracefp,"}}");
+    pthread_mutex_unlock(&tracelock);
+    fmsnowtrace_thread("main");
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowtrace_close
+ *
+ * PURPOSE:
+ * To end the trace and close the file, later calls do nothing.
+ */
+int fmsnowtrace_close(void) {
+    char *where="fmsnowtrace_close";
+    int status = FM_OK;
+
+    pthread_mutex_lock(&tracelock);
+    if (tracefp) {
+	fprintf(tracefp,"\n]\n");
+	if (fclose(tracefp)) {
+	    fmerrmsg(where,"%s","Could not properly close the trace");
+	    status = FM_IO_ERR;
+	}
+	tracefp = NULL;
+    }
+    pthread_mutex_unlock(&tracelock);
+
+    return(status);
+}
+
+/*
+ * NAME:
+ * fmsnowtrace_thread
+ *
+ * PURPOSE:
+ * To name the calling thread in the trace.
+ */
+void fmsnowtrace_thread(char *name) {
+
+    if (!tracefp) return;
+
+    pthread_mutex_lock(&tracelock);
+    if (!tracefp) {
+	pthread_mutex_unlock(&tracelock);
+	return;
+    }
+    putevent("M");
+    fprintf(tracefp,",\"name\":\"thread_name\",\"args\":{\"name\":");
+    putstr(name);
+    fprintf(tracefp,"}}");
+    pthread_mutex_unlock(&tracelock);
+}
+
+/*
+ * NAME:
+ * fmsnowtrace_now
+ *
+ * PURPOSE:
+ * To give the time for fmsnowtrace_span, 0 if the trace is not open.
+ */
+double fmsnowtrace_now(void) {
+
+    if (!tracefp) return(0.);
+
+    return(tracewall());
+}
+
+/*
+ * NAME:
+ * fmsnowtrace_span
+ *
+ * PURPOSE:
+ * To add a span from t0 to t1 (from fmsnowtrace_now or gettimeofday)
+ * for the calling thread. detail, e.g. the file read, may be NULL.
+ * Spans with t0 0 were started before the trace was open and are not
+ * added.
+ */
+void fmsnowtrace_span(char *cat, char *name, char *detail, double t0,
+	double t1) {
+
+    if (!tracefp || t0 <= 0.) return;
+
+    if (t0 < trace0) t0 = trace0;
+    if (t1 < t0) t1 = t0;
+    pthread_mutex_lock(&tracelock);
+    if (!tracefp) {
+	pthread_mutex_unlock(&tracelock);
+	return;
+    }
+    putevent("X");
+    fprintf(tracefp,",\"name\":");
+    putstr(name);
+    fprintf(tracefp,",\"cat\":");
+    putstr(cat);
+    fprintf(tracefp,",\"ts\":%.0f,\"dur\":%.0f",
+	    (t0-trace0)*1.e6, (t1-t0)*1.e6);
+    if (detail) {
+	fprintf(tracefp,",\"args\":{\"detail\":");
+	putstr(detail);
+	fprintf(tracefp,"}");
+    }
+    fprintf(tracefp,"}");
+    pthread_mutex_unlock(&tracelock);
+}
+
+/*
+ * Start an event of type ph for the calling thread, the caller adds the
+ * other keys and the closing brace. Called with the lock held.
+ */
+static void putevent(char *ph) {
+
+    fprintf(tracefp,"%s{\"ph\":\"%s\",\"pid\":%d,\"tid\":%d",
+	    nevents > 0 ? ",\n" : "", ph, tracepid, tracetid());
+    nevents++;
+}
+
+/*
+ * Number of the calling thread, given when first asked. Called with the
+ * lock held.
+ */
+static int tracetid(void) {
+    void *v;
+
+    v = pthread_getspecific(tracetidkey);
+    if (!v) {
+	v = (void *) (long) ++ntids;
+	pthread_setspecific(tracetidkey, v);
+    }
+
+    return((int) (long) v);
+}
+
+/*
+ * Write s as a JSON string.
+ */
+static void putstr(char *s) {
+    unsigned char *c;
+
+    fputc('"',tracefp);
+    for (c=(unsigned char *) s;*c;c++) {
+	if (*c == '"' || *c == '\\') {
+	    fprintf(tracefp,"\\%c",*c);
+	} else if (*c < 0x20 || *c > 0x7e) {
+	    fprintf(tracefp,"\\u%04x",*c);
+	} else {
+	    fputc(*c,tracefp);
+	}
+    }
+    fputc('"',tracefp);
+}
+
+static void closeatexit(void) {
+
+    fmsnowtrace_close();
+}
+
+static double tracewall(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return(tv.tv_sec+1.e-6*tv.tv_usec);
+}
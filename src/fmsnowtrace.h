@@ -0,0 +1,34 @@
+/*
+ * NAME:
+ * fmsnowtrace.h
+ *
+ * PURPOSE:
+ * Timeline trace of fmsnowcover and fmaccusnow in the trace event
+ * format of Chrome and Perfetto.
+ *
+ * NOTES:
+ * One trace file per process, the functions may be called from any
+ * thread and do nothing unless fmsnowtrace_open has been called. See
+ * fmsnowtrace.c.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _FMSNOWTRACE_H
+#define _FMSNOWTRACE_H
+
+int fmsnowtrace_open(char *filename, char *program);
+int fmsnowtrace_close(void);
+void fmsnowtrace_thread(char *name);
+double fmsnowtrace_now(void);
+void fmsnowtrace_span(char *cat, char *name, char *detail, double t0,
+    double t1);
+
+#endif /* _FMSNOWTRACE_H */
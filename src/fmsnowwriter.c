@@ -0,0 +1,645 @@
+/*
+ * NAME:
+ * fmsnowwriter
+ *
+ * PURPOSE:
+ * To write the products of fmsnowcover in background threads, so that
+ * the HDF5 product and the MITIFF images are written in parallel and
+ * the next scene can be read and processed while the products of the
+ * previous one are written.
+ *
+ * REQUIREMENTS:
+ * POSIX threads
+ *
+ * INPUT:
+ * o Products and images of a scene, the writer takes over the buffers
+ *   and frees them when written.
+ * o Index record of the scene.
+ *
+ * OUTPUT:
+ * o Product files.
+ * o The index record is appended to the index file when all products of
+ *   the scene are written.
+ *
+ * NOTES:
+ * Usage for each scene is fmsnowwriter_scene, then one call for each
+ * file and finally fmsnowwriter_close. fmsnowwriter_finish waits for
+ * all files, stops the threads and adds the time used for each kind of
+ * file to the timer of the caller.
+ *
+ * At most FMSNOWWRITER_MAXSCENES scenes are waiting to be written,
+ * fmsnowwriter_scene blocks until an earlier scene is finished. This
+ * limits the memory held by the writer.
+ *
+ * The HDF5 library is not built thread safe, all HDF5 access in the
+ * process must be done between fmsnowwriter_hdf5lock and
+ * fmsnowwriter_hdf5unlock.
+ *
+ * The index record is not written if any product of the scene failed.
+ * Index records of consecutive scenes may be written out of order. The
+ * record is appended by the thread finishing the scene after the lock
+ * of the writer is released, so that a wait for the lock of the index
+ * file does not stop the other threads. The record locks of the index
+ * file do not exclude threads of the same process, appends are
+ * serialised by a mutex of their own. The time used is reported as the
+ * stage "index".
+ *
+ * Files given to fmsnowwriter_replace, e.g. a quick-look written earlier
+ * in the same scene, are removed when all files of the scene are
+ * written. As jobs of a scene are finished before the scene, they are
+ * never removed before they are written. If such a file is given before
+ * it is submitted, failing to write it does not fail the scene: the
+ * index record is written and the run succeeds, only the files to be
+ * replaced are kept.
+ *
+ * The extent of a product is written by the job writing the product,
+ * after it, so that it is never newer than the product it describes. A
+ * product that can not be written has its old extent removed.
+ *
+ * With 0 threads files are written when submitted, as before.
+ *
+ * Each file written and each wait for the HDF5 lock is added to the
+ * trace of fmsnowtrace, if one is open, for the thread doing it.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Files of a scene can be replaced by
+ * later files (fmsnowwriter_replace).
+ * ystein Gody, METNO/FOU, 19.10.2026: The valid data extent of a product
+ * may be written with it (fmsnowwriter_hdf5extent).
+ * ystein Gody, METNO/FOU, 19.10.2026: Pass products may be added to the
+ * cube of the tile instead (fmsnowwriter_cube).
+ * ystein Gody, METNO/FOU, 19.10.2026: Files written and HDF5 lock waits
+ * are added to the trace.
+ * ystein Gody, METNO/FOU, 19.10.2026: The index record is appended
+ * outside the lock and timed (index).
+ * ystein Gody, METNO/FOU, 19.10.2026: A file to be replaced (quick-look)
+ * that fails does not fail the scene.
+ * ystein Gody, METNO/FOU, 19.10.2026: Index records are appended by one
+ * thread at a time.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowwriter_abort.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <fmaccusnow.h>
+#include <fmsnowwriter.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+
+static pthread_mutex_t hdf5lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t indexlock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *writerthread(void *arg);
+static int submit(fmsnowwriter *wr, fmsnowwjob *job);
+static int runjob(fmsnowwjob *job);
+static int jobdone(fmsnowwriter *wr, fmsnowwjob *job, int status,
+	double wall, double cpu);
+static void scenedone(fmsnowwriter *wr, fmsnowwscene *sc);
+static void addstat(fmsnowwriter *wr, char *name, double wall, double cpu,
+	long long bytes);
+static int isreplaced(fmsnowwscene *sc, char *fname);
+static double wallnow(void);
+static double threadcpu(void);
+
+int fmsnowwriter_init(fmsnowwriter *wr, int nthreads) {
+
+    char *where="fmsnowwriter_init";
+    int i;
+
+    memset(wr,0,sizeof(fmsnowwriter));
+    pthread_mutex_init(&wr->lock, NULL);
+    pthread_cond_init(&wr->work, NULL);
+    pthread_cond_init(&wr->done, NULL);
+
+    if (nthreads > FMSNOWWRITER_MAXTHREADS) nthreads = FMSNOWWRITER_MAXTHREADS;
+    for (i=0;i<nthreads;i++) {
+	if (pthread_create(&wr->thread[i], NULL, writerthread, wr)) {
+	    fmerrmsg(where,"Could not start writer thread %d", i);
+	    break;
+	}
+	wr->nthreads++;
+    }
+    if (nthreads > 0 && wr->nthreads == 0) {
+	fmlogmsg(where,"Writing files without background threads.");
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_scene
+ *
+ * PURPOSE:
+ * To start a new scene, waits until less than FMSNOWWRITER_MAXSCENES
+ * scenes are being written.
+ */
+fmsnowwscene *fmsnowwriter_scene(fmsnowwriter *wr) {
+
+    char *where="fmsnowwriter_scene";
+    fmsnowwscene *sc;
+
+    sc = (fmsnowwscene *) calloc(1,sizeof(fmsnowwscene));
+    if (!sc) {
+	fmerrmsg(where,"Could not allocate scene");
+	return(NULL);
+    }
+
+    pthread_mutex_lock(&wr->lock);
+    while (wr->nthreads > 0 && wr->nscenes >= FMSNOWWRITER_MAXSCENES) {
+	pthread_cond_wait(&wr->done, &wr->lock);
+    }
+    wr->nscenes++;
+    pthread_mutex_unlock(&wr->lock);
+
+    return(sc);
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_hdf5
+ *
+ * PURPOSE:
+ * To write prod to fname, the data of prod are freed when written.
+ */
+int fmsnowwriter_hdf5(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+	char *fname, osihdf prod) {
+
+    return(fmsnowwriter_hdf5extent(wr, sc, stage, fname, prod, NULL));
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_hdf5extent
+ *
+ * PURPOSE:
+ * To write prod to fname and the extent ext (see passextent.c) after it,
+ * the writer takes over the data of both. ext may be NULL.
+ */
+int fmsnowwriter_hdf5extent(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+	char *fname, osihdf prod, passextent *ext) {
+
+    fmsnowwjob *job;
+
+    job = (fmsnowwjob *) calloc(1,sizeof(fmsnowwjob));
+    if (!job) {
+	free_osihdf(&prod);
+	if (ext) free_pass_extent(ext);
+	return(FM_MEMALL_ERR);
+    }
+    job->type = FMSNOWWRITER_HDF5;
+    snprintf(job->stage,FMSNOWTIMER_NAMELEN,"%s",stage);
+    snprintf(job->fname,FILELEN,"%s",fname);
+    job->prod = prod;
+    if (ext) job->ext = *ext;
+    job->scene = sc;
+
+    return(submit(wr, job));
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_cube
+ *
+ * PURPOSE:
+ * To add the pass product prod of tile to the cube fname (see
+ * snowcube.c), prod is freed when written.
+ */
+int fmsnowwriter_cube(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+	char *fname, char *tile, osihdf prod, fmsec1970 time, float cover,
+	float cloudfree) {
+
+    fmsnowwjob *job;
+
+    job = (fmsnowwjob *) calloc(1,sizeof(fmsnowwjob));
+    if (!job) {
+	free_osihdf(&prod);
+	return(FM_MEMALL_ERR);
+    }
+    job->type = FMSNOWWRITER_CUBE;
+    snprintf(job->stage,FMSNOWTIMER_NAMELEN,"%s",stage);
+    snprintf(job->fname,FILELEN,"%s",fname);
+    snprintf(job->tile,16,"%s",tile);
+    job->prod = prod;
+    job->time = time;
+    job->cover = cover;
+    job->cloudfree = cloudfree;
+    job->scene = sc;
+
+    return(submit(wr, job));
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_mitiff
+ *
+ * PURPOSE:
+ * To write im to fname using store_snow, im is freed when written.
+ */
+int fmsnowwriter_mitiff(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+	char *fname, unsigned char *im, fmio_mihead info, int image_type) {
+
+    fmsnowwjob *job;
+
+    job = (fmsnowwjob *) calloc(1,sizeof(fmsnowwjob));
+    if (!job) {
+	free(im);
+	return(FM_MEMALL_ERR);
+    }
+    job->type = FMSNOWWRITER_MITIFF;
+    snprintf(job->stage,FMSNOWTIMER_NAMELEN,"%s",stage);
+    snprintf(job->fname,FILELEN,"%s",fname);
+    job->im = im;
+    job->info = info;
+    job->image_type = image_type;
+    job->scene = sc;
+
+    return(submit(wr, job));
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_replace
+ *
+ * PURPOSE:
+ * To remove fname when the files of the scene are written, unless any
+ * of them failed. fname may be written by the scene, it should then be
+ * given before it is submitted.
+ */
+int fmsnowwriter_replace(fmsnowwriter *wr, fmsnowwscene *sc, char *fname) {
+
+    pthread_mutex_lock(&wr->lock);
+    if (sc->nreplace == FMSNOWWRITER_MAXREPLACE) {
+	pthread_mutex_unlock(&wr->lock);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    snprintf(sc->replace[sc->nreplace++],FILELEN,"%s",fname);
+    pthread_mutex_unlock(&wr->lock);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_close
+ *
+ * PURPOSE:
+ * To mark that all files of the scene are submitted. rec is appended to
+ * the index file when they are written, it may be NULL.
+ */
+int fmsnowwriter_close(fmsnowwriter *wr, fmsnowwscene *sc,
+	fmsnowindexrec *rec) {
+
+    int finished;
+
+    pthread_mutex_lock(&wr->lock);
+    if (rec) {
+	sc->rec = *rec;
+	sc->index = 1;
+    }
+    sc->closed = 1;
+    finished = (sc->pending == 0);
+    pthread_mutex_unlock(&wr->lock);
+    if (finished) scenedone(wr, sc);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_abort
+ *
+ * PURPOSE:
+ * To close a scene whose products could not be made. No index record
+ * is written and files given to fmsnowwriter_replace are kept.
+ */
+int fmsnowwriter_abort(fmsnowwriter *wr, fmsnowwscene *sc) {
+
+    int finished;
+
+    pthread_mutex_lock(&wr->lock);
+    sc->replfailed++;
+    sc->closed = 1;
+    finished = (sc->pending == 0);
+    pthread_mutex_unlock(&wr->lock);
+    if (finished) scenedone(wr, sc);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowwriter_finish
+ *
+ * PURPOSE:
+ * To wait for all files to be written and stop the threads.
+ *
+ * RETURN VALUES:
+ * Number of files that could not be written.
+ */
+int fmsnowwriter_finish(fmsnowwriter *wr, fmsnowtimer *tm) {
+
+    int i;
+    fmsnowwstat *st;
+
+    pthread_mutex_lock(&wr->lock);
+    while (wr->nscenes > 0 && wr->nthreads > 0) {
+	pthread_cond_wait(&wr->done, &wr->lock);
+    }
+    wr->stop = 1;
+    pthread_cond_broadcast(&wr->work);
+    pthread_mutex_unlock(&wr->lock);
+
+    for (i=0;i<wr->nthreads;i++) {
+	pthread_join(wr->thread[i], NULL);
+    }
+    wr->nthreads = 0;
+
+    for (i=0;i<wr->nstat;i++) {
+	st = &wr->stat[i];
+	fmsnowtimer_add(tm, st->name, st->calls, st->wall, st->cpu, st->bytes);
+    }
+
+    pthread_cond_destroy(&wr->work);
+    pthread_cond_destroy(&wr->done);
+    pthread_mutex_destroy(&wr->lock);
+
+    return(wr->failed);
+}
+
+void fmsnowwriter_hdf5lock(void) {
+    double t0;
+
+    t0 = fmsnowtrace_now();
+    pthread_mutex_lock(&hdf5lock);
+    fmsnowtrace_span("wait", "hdf5lock", NULL, t0, fmsnowtrace_now());
+}
+
+void fmsnowwriter_hdf5unlock(void) {
+
+    pthread_mutex_unlock(&hdf5lock);
+}
+
+static int submit(fmsnowwriter *wr, fmsnowwjob *job) {
+
+    fmsnowwscene *sc = job->scene;
+    double wall0, cpu0;
+    int status, finished;
+
+    pthread_mutex_lock(&wr->lock);
+    sc->pending++;
+    if (wr->nthreads > 0) {
+	if (wr->tail) {
+	    wr->tail->next = job;
+	} else {
+	    wr->head = job;
+	}
+	wr->tail = job;
+	pthread_cond_signal(&wr->work);
+	pthread_mutex_unlock(&wr->lock);
+	return(FM_OK);
+    }
+    pthread_mutex_unlock(&wr->lock);
+
+    wall0 = wallnow();
+    cpu0 = threadcpu();
+    status = runjob(job);
+    pthread_mutex_lock(&wr->lock);
+    finished = jobdone(wr, job, status, wallnow()-wall0, threadcpu()-cpu0);
+    pthread_mutex_unlock(&wr->lock);
+    if (finished) scenedone(wr, sc);
+
+    return(status);
+}
+
+static void *writerthread(void *arg) {
+
+    fmsnowwriter *wr = (fmsnowwriter *) arg;
+    fmsnowwjob *job;
+    fmsnowwscene *sc;
+    double wall0, cpu0;
+    int status;
+
+    fmsnowtrace_thread("writer");
+    pthread_mutex_lock(&wr->lock);
+    while (1) {
+	while (!wr->head && !wr->stop) {
+	    pthread_cond_wait(&wr->work, &wr->lock);
+	}
+	if (!wr->head) break;
+	job = wr->head;
+	wr->head = job->next;
+	if (!wr->head) wr->tail = NULL;
+	pthread_mutex_unlock(&wr->lock);
+
+	wall0 = wallnow();
+	cpu0 = threadcpu();
+	status = runjob(job);
+
+	sc = job->scene;
+	pthread_mutex_lock(&wr->lock);
+	if (jobdone(wr, job, status, wallnow()-wall0, threadcpu()-cpu0)) {
+	    pthread_mutex_unlock(&wr->lock);
+	    scenedone(wr, sc);
+	    pthread_mutex_lock(&wr->lock);
+	}
+    }
+    pthread_mutex_unlock(&wr->lock);
+
+    return(NULL);
+}
+
+/*
+ * Write the file of job and free its buffers.
+ */
+static int runjob(fmsnowwjob *job) {
+
+    char *where="fmsnowwriter";
+    char extname[FILELEN+8];
+    int status = FM_OK;
+    double t0;
+
+    fmlogmsg(where,"Creating output file: %s", job->fname);
+    t0 = fmsnowtrace_now();
+    switch (job->type) {
+	case FMSNOWWRITER_HDF5:
+	    fmsnowwriter_hdf5lock();
+	    status = store_hdf5_product(job->fname,job->prod);
+	    free_osihdf(&job->prod);
+	    fmsnowwriter_hdf5unlock();
+	    if (job->ext.first) {
+		if (status == 0) {
+		    status = write_pass_extent(job->fname, &job->ext);
+		} else {
+		    snprintf(extname,FILELEN+8,"%s%s",job->fname,
+			    PASSEXTENT_SUFFIX);
+		    unlink(extname);
+		}
+		free_pass_extent(&job->ext);
+	    }
+	    break;
+	case FMSNOWWRITER_MITIFF:
+	    status = store_snow(job->fname,job->im,job->info,job->image_type);
+	    free(job->im);
+	    break;
+	case FMSNOWWRITER_CUBE:
+	    fmsnowwriter_hdf5lock();
+	    status = fmsnowcube_append(job->fname, job->tile, &job->prod,
+		    job->time, job->cover, job->cloudfree);
+	    fmsnowwriter_hdf5unlock();
+	    job->bytes = (long long) FMSNOWCUBE_LEVELS*
+		job->prod.h.iw*job->prod.h.ih;
+	    free_osihdf(&job->prod);
+	    break;
+    }
+    if (status != 0) {
+	fmerrmsg(where,"Could not write %s", job->fname);
+	status = FM_IO_ERR;
+    }
+    fmsnowtrace_span("write", job->stage, job->fname, t0, fmsnowtrace_now());
+
+    return(status);
+}
+
+/*
+ * Record the time used, returns 1 if this was the last file of a closed
+ * scene, which must then be finished by scenedone. Called with the lock
+ * held.
+ */
+static int jobdone(fmsnowwriter *wr, fmsnowwjob *job, int status,
+	double wall, double cpu) {
+
+    fmsnowwscene *sc = job->scene;
+    struct stat sbuf;
+    long long bytes = 0;
+
+    if (job->type == FMSNOWWRITER_CUBE) {
+	bytes = job->bytes;
+    } else if (stat(job->fname,&sbuf) == 0) {
+	bytes = (long long) sbuf.st_size;
+    }
+    addstat(wr, job->stage, wall, cpu, bytes);
+
+    if (status && isreplaced(sc, job->fname)) {
+	sc->replfailed++;
+    } else if (status) {
+	sc->failed++;
+	wr->failed++;
+    }
+    free(job);
+
+    sc->pending--;
+
+    return(sc->closed && sc->pending == 0);
+}
+
+/*
+ * Write the index record, remove replaced files and release the scene.
+ * Called without the lock, no other thread uses a finished scene. The
+ * record is appended under indexlock, see indexfile.c.
+ */
+static void scenedone(fmsnowwriter *wr, fmsnowwscene *sc) {
+
+    char *where="fmsnowwriter";
+    fmsnowindexrec *r = &sc->rec;
+    double wall0, cpu0, t0;
+    int i;
+
+    if (sc->index) {
+	if (sc->failed) {
+	    fmerrmsg(where,"%s not added to %s as products are missing",
+		    r->avhrrfile, r->indexfile);
+	} else {
+	    wall0 = wallnow();
+	    cpu0 = threadcpu();
+	    t0 = fmsnowtrace_now();
+	    pthread_mutex_lock(&indexlock);
+	    if (updateindexfile(r->indexfile, r->avhrrfile,
+			r->productfile, r->datetime, r->area, r->cover,
+			r->cloudfree, &r->cnt)) {
+		fmerrmsg(where,"Could not update %s", r->indexfile);
+	    }
+	    pthread_mutex_unlock(&indexlock);
+	    fmsnowtrace_span("write", "index", r->indexfile, t0,
+		    fmsnowtrace_now());
+	    pthread_mutex_lock(&wr->lock);
+	    addstat(wr, "index", wallnow()-wall0, threadcpu()-cpu0, 0);
+	    pthread_mutex_unlock(&wr->lock);
+	}
+    }
+    for (i=0;i<sc->nreplace && !sc->failed && !sc->replfailed;i++) {
+	fmlogmsg(where,"Removing %s", sc->replace[i]);
+	unlink(sc->replace[i]);
+    }
+    free(sc);
+
+    pthread_mutex_lock(&wr->lock);
+    wr->nscenes--;
+    pthread_cond_broadcast(&wr->done);
+    pthread_mutex_unlock(&wr->lock);
+}
+
+/*
+ * Add the time used by one file (or index record) of stage to the
+ * statistics. Called with the lock held.
+ */
+static void addstat(fmsnowwriter *wr, char *name, double wall, double cpu,
+	long long bytes) {
+
+    int i;
+    fmsnowwstat *st;
+
+    for (i=0;i<wr->nstat;i++) {
+	if (strcmp(wr->stat[i].name,name) == 0) break;
+    }
+    if (i == FMSNOWWRITER_MAXSTATS) return;
+    st = &wr->stat[i];
+    if (i == wr->nstat) {
+	snprintf(st->name,FMSNOWTIMER_NAMELEN,"%s",name);
+	wr->nstat++;
+    }
+    st->calls++;
+    st->wall += wall;
+    st->cpu += cpu;
+    st->bytes += bytes;
+}
+
+/*
+ * Whether fname is to be replaced when the scene is finished. Called with
+ * the lock held.
+ */
+static int isreplaced(fmsnowwscene *sc, char *fname) {
+    int i;
+
+    for (i=0;i<sc->nreplace;i++) {
+	if (strcmp(sc->replace[i],fname) == 0) return(1);
+    }
+
+    return(0);
+}
+
+static double wallnow(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return(tv.tv_sec+1.e-6*tv.tv_usec);
+}
+
+static double threadcpu(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) return(0.);
+
+    return(ts.tv_sec+1.e-9*ts.tv_nsec);
+}
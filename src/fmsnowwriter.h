@@ -0,0 +1,129 @@
+/*
+ * NAME:
+ * fmsnowwriter.h
+ *
+ * PURPOSE:
+ * Background writing of the products of fmsnowcover.
+ *
+ * NOTES:
+ * The buffers handed to the writer are owned by it and freed when the
+ * file is written. See fmsnowwriter.c. fmsnowcover.h must be included
+ * first.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowwriter_replace.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowwriter_hdf5extent,
+ * fmaccusnow.h must be included before this file.
+ * ystein Gody, METNO/FOU, 19.10.2026: Room for the index stage in the
+ * statistics.
+ * ystein Gody, METNO/FOU, 19.10.2026: Failed files to be replaced are
+ * counted apart.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowwriter_cube.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowwriter_abort.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _FMSNOWWRITER_H
+#define _FMSNOWWRITER_H
+
+#include <pthread.h>
+
+#define FMSNOWWRITER_MAXTHREADS 8
+#define FMSNOWWRITER_MAXSCENES 2 /* scenes waiting to be written */
+#define FMSNOWWRITER_MAXSTATS 12
+#define FMSNOWWRITER_MAXREPLACE 3 /* files replaced by a scene */
+#define FMSNOWWRITER_HDF5 0
+#define FMSNOWWRITER_MITIFF 1
+#define FMSNOWWRITER_CUBE 2
+
+/*
+ * Index file record written when all products of a scene are stored.
+ */
+typedef struct {
+    char indexfile[FILELEN];
+    char avhrrfile[FILELEN];
+    char productfile[FILELEN];
+    char datetime[25];
+    char area[8];
+    float cover;
+    float cloudfree;
+    pixcountstr cnt;
+} fmsnowindexrec;
+
+typedef struct {
+    int pending; /* jobs not finished */
+    int closed; /* all jobs submitted */
+    int failed;
+    int replfailed; /* files to be replaced that failed */
+    int index; /* write index record when finished */
+    fmsnowindexrec rec;
+    int nreplace; /* files removed when finished */
+    char replace[FMSNOWWRITER_MAXREPLACE][FILELEN];
+} fmsnowwscene;
+
+typedef struct fmsnowwjob {
+    int type;
+    char stage[FMSNOWTIMER_NAMELEN];
+    char fname[FILELEN];
+    osihdf prod;
+    passextent ext; /* written after prod if first is set */
+    char tile[16]; /* pass added to the cube fname */
+    fmsec1970 time;
+    float cover;
+    float cloudfree;
+    long long bytes; /* written to the cube */
+    unsigned char *im;
+    fmio_mihead info;
+    int image_type;
+    fmsnowwscene *scene;
+    struct fmsnowwjob *next;
+} fmsnowwjob;
+
+typedef struct {
+    char name[FMSNOWTIMER_NAMELEN];
+    int calls;
+    double wall;
+    double cpu;
+    long long bytes;
+} fmsnowwstat;
+
+typedef struct {
+    int nthreads; /* 0 means files are written by the caller */
+    pthread_t thread[FMSNOWWRITER_MAXTHREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work; /* jobs queued or stopping */
+    pthread_cond_t done; /* a scene is finished */
+    fmsnowwjob *head;
+    fmsnowwjob *tail;
+    int nscenes; /* scenes not finished */
+    int stop;
+    int failed; /* files that could not be written */
+    int nstat;
+    fmsnowwstat stat[FMSNOWWRITER_MAXSTATS];
+} fmsnowwriter;
+
+int fmsnowwriter_init(fmsnowwriter *wr, int nthreads);
+fmsnowwscene *fmsnowwriter_scene(fmsnowwriter *wr);
+int fmsnowwriter_hdf5(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+    char *fname, osihdf prod);
+int fmsnowwriter_hdf5extent(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+    char *fname, osihdf prod, passextent *ext);
+int fmsnowwriter_cube(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+    char *fname, char *tile, osihdf prod, fmsec1970 time, float cover,
+    float cloudfree);
+int fmsnowwriter_mitiff(fmsnowwriter *wr, fmsnowwscene *sc, char *stage,
+    char *fname, unsigned char *im, fmio_mihead info, int image_type);
+int fmsnowwriter_replace(fmsnowwriter *wr, fmsnowwscene *sc, char *fname);
+int fmsnowwriter_close(fmsnowwriter *wr, fmsnowwscene *sc,
+    fmsnowindexrec *rec);
+int fmsnowwriter_abort(fmsnowwriter *wr, fmsnowwscene *sc);
+int fmsnowwriter_finish(fmsnowwriter *wr, fmsnowtimer *tm);
+void fmsnowwriter_hdf5lock(void);
+void fmsnowwriter_hdf5unlock(void);
+
+#endif /* _FMSNOWWRITER_H */
@@ -15,7 +15,8 @@
  * o requested output grid (as specified by remote sensing software)
  *
  * OUTPUT:
- * data structure
+ * data structure, fields are given on the coarse grid described by
+ * step, cw and ch.
  * return values:
  * 0-OK
  * 1-command syntax error
@@ -40,18 +41,30 @@
  * MODIFIED:
  * ystein Gody, METNO/FOU, 27.03.2009: Take input path, filename
  * wildcards and number of wildcards to use in addition to the usual...
+ * ystein Gody, METNO/FOU, 19.10.2026: Filenames are created by
+ * nwpfeltfiles, added nwpice_readcache.
+ * ystein Gody, METNO/FOU, 19.10.2026: The fields are interpolated to a
+ * coarse grid aligned with the tile (nwpice_grid) instead of every tile
+ * pixel, and are sampled bilinearly by nwpice_t0m where needed. The size of
+ * the tile is no longer limited by FMIO_MAXIMGSIZE.
  *
  * CVS_ID:
  * $Id: getnwp.c,v 1.4 2009-09-10 14:16:21 mariak Exp $
  */
 
 #include <getnwp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int nwpfeltfiles(char *fpath, char **filenames, int nruns, 
+	fmtime reqtime, char ***fnsf, int *len);
+static void nwpfeltfiles_free(char **fnsf);
 
 int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
 	reqtime, fmucsref refucs, nwpice *nwp) {
 
     char *where="nwpice_read";
-    int i, imgsize;
+    int i, imgsize, step, cw, ch;
     /* HIRLAM/NWP variables */
     int nfiles=FFNS, iunit=10, interp=1, itime[5];
     int nparam1=NOFIELDS1, nparam2=NOFIELDS2;
@@ -81,16 +94,19 @@ int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
 
     /* 
      * Create the grid specification used by feltfiles and libmi. 
-     * Requested grid description, only one supported yet.
+     * Requested grid description, only one supported yet. The grid has
+     * the origin of the tile and every step'th tile pixel, the NWP
+     * data are smooth on this scale.
      */
+    nwpice_grid(refucs, &step, &cw, &ch);
     satgrid[0] = 60.;
     satgrid[1] = 0.;
     satgrid[2] = 1000.;
     satgrid[3] = 1000.;
     satgrid[4] = 0.;
     satgrid[5] = 0.;
-    satgrid[6] = refucs.Ax;
-    satgrid[7] = refucs.Ay;
+    satgrid[6] = refucs.Ax*step;
+    satgrid[7] = refucs.Ay*step;
     satgrid[8] = refucs.Bx;
     satgrid[9] = refucs.By;
     /* Requested valid time */
@@ -103,32 +119,11 @@ int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
     /*
      * Create the filenames to use. Currently only one level is required
      * for this software, implying that only one set of files containing
-     * the surface parameters need to be read by this software. Memory
-     * must be allocated contigous.
+     * the surface parameters need to be read by this software. 
      */
-    if (strstr(fpath,"/opdata")) {
-	len1 =  strlen(fpath)+1+strlen(filenames[0])+6+1;
-    } else if (strstr(fpath,"/starc")) {
-	len1 =  strlen(fpath)+1+11+strlen(filenames[0])+6+1+9;
-    } else {
-	fmerrmsg(where,"Could not determine source for NWP data.");
+    if (nwpfeltfiles(fpath, filenames, nruns, reqtime, &fnsf, &len1)) {
 	return(FM_IO_ERR);
     }
-    if (fmalloc_byte_2d_contiguous(&fnsf,nruns,len1)){
-	fmerrmsg(where,"Could not allocate fnsf");
-	exit(FM_MEMALL_ERR);
-    }
-    for (i=0;i<nruns;i++) {
-	if (strstr(fpath,"/opdata")) {
-	    sprintf(fnsf[i],"%s/%s%02d.dat",fpath,filenames[0],(i*6));
-	} else if (strstr(fpath,"/starc")) {
-	    sprintf(fnsf[i],"%s/%4d/%02d/%02d/%s%02d.dat_%4d%02d%02d",
-		    fpath,
-		    reqtime.fm_year, reqtime.fm_mon,reqtime.fm_mday,
-		    filenames[0],(i*6),
-		    reqtime.fm_year, reqtime.fm_mon,reqtime.fm_mday);
-	}
-    }
     fmlogmsg(where,"Collecting HIRLAM data from %s",fpath);
 
     /*
@@ -137,11 +132,7 @@ int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
      * the numbers of gridpoints in x and y direction and nparam is the
      * number of fields/parameters collected. 
      */
-    imgsize = refucs.iw*refucs.ih;
-    if (imgsize > FMIO_MAXIMGSIZE) {
-	fmerrmsg(where,"Data container for NWP is too small, the required size if %d while only %d is available.", imgsize, FMIO_MAXIMGSIZE);
-	return(FM_IO_ERR);
-    }
+    imgsize = cw*ch;
     nwpfield1 = (float *) malloc(NOFIELDS1*imgsize*sizeof(float));
     if (!nwpfield1) {
 	fmerrmsg(where,"Could not allocate nwpfield1.");
@@ -157,7 +148,7 @@ int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
 	    &nparam1, iparam1, icontrol, nwpfield1, &iundef, &ierror, len1);
     */
     getfield_(&nfiles, fnsf[0], &iunit, &interp, 
-	    satgrid, &refucs.iw, &refucs.ih, itime, 
+	    satgrid, &cw, &ch, itime, 
 	    &nparam1, iparam1, icontrol, nwpfield1, &iundef, &ierror, len1);
 
     if (ierror) {
@@ -213,6 +204,9 @@ int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
      * Transfer the UCS information
      */
     nwp->refucs = refucs;
+    nwp->step = step;
+    nwp->cw = cw;
+    nwp->ch = ch;
 
     /*
      * Allocate the data structure that will contain the NWP data
@@ -301,6 +295,161 @@ int nwpice_read(char *fpath, char **filenames, int nrf, int nruns, fmtime
     return(FM_OK);
 }
 
+/*
+ * NAME:
+ * nwpice_grid
+ *
+ * PURPOSE:
+ * To find the coarse grid the NWP fields are kept on. Grid point (i,j)
+ * is tile pixel (i*step,j*step), the grid covers the whole tile so
+ * that every pixel has four surrounding grid points.
+ */
+int nwpice_grid(fmucsref refucs, int *step, int *cw, int *ch) {
+
+    *step = (int) (NWPICE_GRIDSPACING/refucs.Ax);
+    if (*step < 1) *step = 1;
+    *cw = (refucs.iw-1)/(*step)+2;
+    *ch = (refucs.ih-1)/(*step)+2;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * nwpice_t0m
+ *
+ * PURPOSE:
+ * To estimate the surface temperature at tile pixel (xc,yc) by
+ * bilinear interpolation in the coarse grid.
+ *
+ * NOTES:
+ * If any of the surrounding grid points is undefined, the value of the
+ * nearest grid point is returned.
+ */
+float nwpice_t0m(nwpice *nwp, int xc, int yc) {
+    int i, j, k;
+    float fx, fy, *t = nwp->t0m;
+
+    i = xc/nwp->step;
+    j = yc/nwp->step;
+    fx = (float) (xc-i*nwp->step)/nwp->step;
+    fy = (float) (yc-j*nwp->step)/nwp->step;
+    k = j*nwp->cw+i;
+
+    if (t[k] > NWPICE_UNDEF || t[k+1] > NWPICE_UNDEF ||
+	    t[k+nwp->cw] > NWPICE_UNDEF || t[k+nwp->cw+1] > NWPICE_UNDEF) {
+	if (fx >= 0.5) k++;
+	if (fy >= 0.5) k += nwp->cw;
+	return(t[k]);
+    }
+
+    return((1.-fy)*((1.-fx)*t[k]+fx*t[k+1])+
+	    fy*((1.-fx)*t[k+nwp->cw]+fx*t[k+nwp->cw+1]));
+}
+
+/*
+ * NAME:
+ * nwpice_readcache
+ *
+ * PURPOSE:
+ * To get the NWP data from the cache in cachedir if a field valid for
+ * reqtime is found there, and otherwise read them by nwpice_read and
+ * add them to the cache. See nwpcache.c.
+ *
+ * NOTES:
+ * nwp->cachemap is set when the data were found in the cache. Failure
+ * to store the field in the cache is reported but is not an error.
+ */
+int nwpice_readcache(char *cachedir, char *fpath, char **filenames, 
+	int nrf, int nruns, fmtime reqtime, fmucsref refucs, nwpice *nwp) {
+
+    char *where="nwpice_readcache";
+    char **fnsf;
+    int i, len, ret;
+    time_t newest;
+    struct stat sbuf;
+
+    /*
+     * A field in the cache is only used if it is newer than all felt
+     * files, otherwise a new model run may be available.
+     */
+    if (nwpfeltfiles(fpath, filenames, nruns, reqtime, &fnsf, &len)) {
+	return(FM_IO_ERR);
+    }
+    newest = 0;
+    for (i=0;i<nruns;i++) {
+	if (stat(fnsf[i],&sbuf) == 0 && sbuf.st_mtime > newest) {
+	    newest = sbuf.st_mtime;
+	}
+    }
+    nwpfeltfiles_free(fnsf);
+
+    if (nwpcache_get(cachedir, reqtime, refucs, newest, nwp) == FM_OK) {
+	return(FM_OK);
+    }
+
+    ret = nwpice_read(fpath, filenames, nrf, nruns, reqtime, refucs, nwp);
+    if (ret) return(ret);
+
+    if (nwpcache_put(cachedir, nwp)) {
+	fmerrmsg(where,"Could not add NWP data to cache in %s", cachedir);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * nwpfeltfiles
+ *
+ * PURPOSE:
+ * To create the names of the felt files to search for the model runs
+ * requested. Memory must be allocated contiguous.
+ */
+static int nwpfeltfiles(char *fpath, char **filenames, int nruns, 
+	fmtime reqtime, char ***fnsf, int *len) {
+
+    char *where="nwpfeltfiles";
+    int i;
+
+    if (strstr(fpath,"/opdata")) {
+	*len =  strlen(fpath)+1+strlen(filenames[0])+6+1;
+    } else if (strstr(fpath,"/starc")) {
+	*len =  strlen(fpath)+1+11+strlen(filenames[0])+6+1+9;
+    } else {
+	fmerrmsg(where,"Could not determine source for NWP data.");
+	return(FM_IO_ERR);
+    }
+    if (fmalloc_byte_2d_contiguous(fnsf,nruns,*len)){
+	fmerrmsg(where,"Could not allocate fnsf");
+	exit(FM_MEMALL_ERR);
+    }
+    for (i=0;i<nruns;i++) {
+	if (strstr(fpath,"/opdata")) {
+	    sprintf((*fnsf)[i],"%s/%s%02d.dat",fpath,filenames[0],(i*6));
+	} else if (strstr(fpath,"/starc")) {
+	    sprintf((*fnsf)[i],"%s/%4d/%02d/%02d/%s%02d.dat_%4d%02d%02d",
+		    fpath,
+		    reqtime.fm_year, reqtime.fm_mon,reqtime.fm_mday,
+		    filenames[0],(i*6),
+		    reqtime.fm_year, reqtime.fm_mon,reqtime.fm_mday);
+	}
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Free the names of nwpfeltfiles, allocated as one block of characters
+ * and the row pointers.
+ */
+static void nwpfeltfiles_free(char **fnsf) {
+
+    if (!fnsf) return;
+    free(fnsf[0]);
+    free(fnsf);
+}
+
 /*
  * NAME:
  * nwpice_init
@@ -341,6 +490,9 @@ int nwpice_init(nwpice *nwp) {
 
     nwp->topo = NULL;
 
+    nwp->cachemap = NULL;
+    nwp->cachelen = 0;
+
     return(FM_OK);
 }
 
@@ -375,6 +527,11 @@ int nwpice_free(nwpice *nwp) {
     if (nwp->t700hpa) free(nwp->t700hpa);
     if (nwp->t500hpa) free(nwp->t500hpa);
 
+    if (nwp->cachemap) {
+	munmap(nwp->cachemap, nwp->cachelen);
+	nwp->cachemap = NULL;
+	nwp->t0m = NULL;
+    }
     if (nwp->t0m) free(nwp->t0m);
     if (nwp->t2m) free(nwp->t2m);
 
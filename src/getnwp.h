@@ -19,7 +19,10 @@
  * ystein Gody, met.no/FOU, 18.10.2004 
  *
  * MODIFIED:
- * NA
+ * ystein Gody, METNO/FOU, 19.10.2026: Added cache of interpolated fields
+ * (nwpcache.c).
+ * ystein Gody, METNO/FOU, 19.10.2026: t0m is kept on a coarse grid
+ * aligned with the tile and sampled by nwpice_t0m.
  *
  * CVS_ID:
  * $Id: getnwp.h,v 1.3 2009-03-30 13:42:53 steingod Exp $
@@ -29,6 +32,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <fmio.h>
 #include <fmutil.h>
 
@@ -39,11 +43,16 @@
 #define NOFIELDS1 1
 #define NOFIELDS2 0
 #define NOFIELDS NOFIELDS1+NOFIELDS2
+#define NWPICE_GRIDSPACING 6. /* km, half the HIRLAM12 grid spacing */
+#define NWPICE_UNDEF 1.e30 /* larger values are undefined (+1.e35) */
 
 typedef struct {
     fmsec1970 validtime;
     int leadtime;
     fmucsref refucs;
+    int step; /* tile pixels between coarse grid points */
+    int cw; /* coarse grid width */
+    int ch; /* coarse grid height */
     float *t950hpa; /* temp at 950 hPa */
     float *t800hpa; /* temp at 800 hPa */
     float *t700hpa; /* temp at 700 hPa */
@@ -54,11 +63,20 @@ typedef struct {
     float *topo; /* model topography */
     float *pw; /* precipitable water */
     float *rh; /* relative humidity at surface */
+    void *cachemap; /* t0m is mapped from the NWP cache if not NULL */
+    size_t cachelen;
 } nwpice;
 
 int nwpice_init(nwpice *nwp); 
 int nwpice_read(char *fpath, char **filenames, int nrf, int nruns,
 	fmtime reqtime, fmucsref refucs, nwpice *nwp);
+int nwpice_readcache(char *cachedir, char *fpath, char **filenames, 
+	int nrf, int nruns, fmtime reqtime, fmucsref refucs, nwpice *nwp);
 int nwpice_free(nwpice *nwp);
+int nwpice_grid(fmucsref refucs, int *step, int *cw, int *ch);
+float nwpice_t0m(nwpice *nwp, int xc, int yc);
+int nwpcache_get(char *cachedir, fmtime reqtime, fmucsref refucs,
+	time_t newest, nwpice *nwp);
+int nwpcache_put(char *cachedir, nwpice *nwp);
 
 #endif /* NWP_READ */
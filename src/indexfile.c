@@ -0,0 +1,351 @@
+/*
+ * NAME:
+ * indexfile
+ *
+ * PURPOSE:
+ * To maintain the index file of processed scenes (INDEXFILE) when
+ * several fmsnowcover processes update it at the same time, and to keep
+ * it free of duplicates.
+ *
+ * REQUIREMENTS:
+ * POSIX record locks (fcntl).
+ *
+ * INPUT:
+ * o Index file.
+ * o Line to add.
+ *
+ * OUTPUT:
+ * Updated index file.
+ *
+ * NOTES:
+ * The index is an append only log, one line per scene. Lines are added
+ * with a single write while holding a write lock on the file, so lines
+ * from different processes are never mixed. Record locks do not
+ * exclude threads of the same process, the caller must serialise
+ * appends within the process (fmsnowwriter does).
+ *
+ * A scene is identified by the first four columns (time, satellite
+ * file, product file and tile). When a scene is processed again the
+ * later line replaces the earlier one, fmsnowindex_read returns only the
+ * last line of each scene and fmsnowindex_compact rewrites the file that
+ * way. Compaction writes a new file and renames it, processes waiting
+ * for the lock on the old file notice this and reopen. Closing any
+ * descriptor of the file releases the locks of the process, so the file
+ * is read through the locked descriptor and closed only once.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define INDEX_LINELEN 4096
+#define INDEX_KEYCOLS 4
+
+typedef struct {
+    char *line;
+    int keylen; /* the key is the first keylen characters of line */
+    int order;
+} indexrec;
+
+static int lockindex(char *filename, int flags, short type);
+static int indexkey(char *line);
+static fmsec1970 indextime(char *line);
+static int cmpkey(const void *a, const void *b);
+static int cmporder(const void *a, const void *b);
+static int readindex(FILE *fp, indexrec **recs, int *nrecs);
+static int uniqueindex(indexrec *recs, int nrecs);
+static void freeindex(indexrec *recs, int nrecs);
+
+/*
+ * NAME:
+ * fmsnowindex_append
+ *
+ * PURPOSE:
+ * To add a line to the index file, the file is created if needed. The
+ * line must end with a newline.
+ */
+int fmsnowindex_append(char *filename, char *line) {
+
+    char *where="fmsnowindex_append";
+    int fd;
+    ssize_t len;
+
+    fd = lockindex(filename, O_WRONLY|O_APPEND|O_CREAT, F_WRLCK);
+    if (fd < 0) {
+	fmerrmsg(where,"Could not open and lock %s", filename);
+	return(FM_IO_ERR);
+    }
+    len = strlen(line);
+    if (write(fd, line, len) != len) {
+	fmerrmsg(where,"Could not write to %s", filename);
+	close(fd);
+	return(FM_IO_ERR);
+    }
+    if (close(fd)) {
+	fmerrmsg(where,"Could not properly close %s", filename);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowindex_read
+ *
+ * PURPOSE:
+ * To write the last line of each scene in the index to fp, in the
+ * order they were added.
+ */
+int fmsnowindex_read(char *filename, FILE *fp) {
+
+    char *where="fmsnowindex_read";
+    int fd, i, nrecs;
+    indexrec *recs;
+    FILE *ifp;
+
+    fd = lockindex(filename, O_RDONLY, F_RDLCK);
+    if (fd < 0 || !(ifp = fdopen(fd,"r"))) {
+	fmerrmsg(where,"Could not open and lock %s", filename);
+	if (fd >= 0) close(fd);
+	return(FM_IO_ERR);
+    }
+    if (readindex(ifp, &recs, &nrecs)) {
+	fmerrmsg(where,"Could not read %s", filename);
+	fclose(ifp);
+	return(FM_IO_ERR);
+    }
+    fclose(ifp);
+
+    nrecs = uniqueindex(recs, nrecs);
+    for (i=0;i<nrecs;i++) {
+	fputs(recs[i].line, fp);
+    }
+    freeindex(recs, nrecs);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowindex_compact
+ *
+ * PURPOSE:
+ * To rewrite the index with only the last line of each scene. Scenes
+ * older than keep seconds before now are removed, all are kept if keep
+ * is 0.
+ */
+int fmsnowindex_compact(char *filename, long keep) {
+
+    char *where="fmsnowindex_compact";
+    char tmpname[FILELEN+16];
+    int fd, i, nrecs, nold, nkept = 0;
+    fmsec1970 limit = 0, t;
+    indexrec *recs;
+    FILE *ifp, *fp;
+
+    fd = lockindex(filename, O_RDWR, F_WRLCK);
+    if (fd < 0 || !(ifp = fdopen(fd,"r+"))) {
+	fmerrmsg(where,"Could not open and lock %s", filename);
+	if (fd >= 0) close(fd);
+	return(FM_IO_ERR);
+    }
+    if (readindex(ifp, &recs, &nrecs)) {
+	fmerrmsg(where,"Could not read %s", filename);
+	fclose(ifp);
+	return(FM_IO_ERR);
+    }
+    nold = nrecs;
+    nrecs = uniqueindex(recs, nrecs);
+    if (keep > 0) limit = (fmsec1970) time(NULL)-keep;
+
+    snprintf(tmpname,FILELEN+16,"%s.%d",filename,(int) getpid());
+    fp = fopen(tmpname,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not create %s", tmpname);
+	freeindex(recs, nrecs);
+	fclose(ifp);
+	return(FM_IO_ERR);
+    }
+    for (i=0;i<nrecs;i++) {
+	if (keep > 0) {
+	    t = indextime(recs[i].line);
+	    if (t > 0 && t < limit) continue;
+	}
+	fputs(recs[i].line, fp);
+	nkept++;
+    }
+    freeindex(recs, nrecs);
+    if (fclose(fp) || rename(tmpname, filename)) {
+	fmerrmsg(where,"Could not replace %s", filename);
+	unlink(tmpname);
+	fclose(ifp);
+	return(FM_IO_ERR);
+    }
+    fclose(ifp);
+    fmlogmsg(where,"%s compacted from %d to %d lines", filename, nold, nkept);
+
+    return(FM_OK);
+}
+
+/*
+ * Open and lock the index, retrying if the file was replaced by
+ * fmsnowindex_compact while waiting for the lock.
+ */
+static int lockindex(char *filename, int flags, short type) {
+
+    int fd;
+    struct flock fl;
+    struct stat fbuf, pbuf;
+
+    while (1) {
+	fd = open(filename, flags, 0644);
+	if (fd < 0) return(-1);
+	memset(&fl,0,sizeof(struct flock));
+	fl.l_type = type;
+	fl.l_whence = SEEK_SET;
+	if (fcntl(fd, F_SETLKW, &fl)) {
+	    close(fd);
+	    return(-1);
+	}
+	if (fstat(fd,&fbuf) == 0 && stat(filename,&pbuf) == 0 &&
+		fbuf.st_ino == pbuf.st_ino && fbuf.st_dev == pbuf.st_dev) {
+	    return(fd);
+	}
+	close(fd);
+    }
+}
+
+/*
+ * Length of the key columns including the space after them, short
+ * lines are used as they are.
+ */
+static int indexkey(char *line) {
+
+    char *pt = line, *end;
+    int n;
+
+    for (n=0;n<INDEX_KEYCOLS;n++) {
+	end = strchr(pt,' ');
+	if (!end) return(strlen(line));
+	pt = end+1;
+    }
+
+    return(pt-line);
+}
+
+static fmsec1970 indextime(char *line) {
+
+    fmtime t;
+
+    memset(&t,0,sizeof(fmtime));
+    if (sscanf(line,"%4d-%2d-%2d%*c%2d:%2d", &t.fm_year, &t.fm_mon,
+		&t.fm_mday, &t.fm_hour, &t.fm_min) != 5) {
+	return(0);
+    }
+
+    return(tofmsec1970(t));
+}
+
+static int cmpkey(const void *a, const void *b) {
+
+    const indexrec *ra = (const indexrec *) a;
+    const indexrec *rb = (const indexrec *) b;
+    int ret;
+
+    if (ra->keylen != rb->keylen) return(ra->keylen-rb->keylen);
+    ret = strncmp(ra->line, rb->line, ra->keylen);
+    if (ret) return(ret);
+
+    return(ra->order-rb->order);
+}
+
+static int cmporder(const void *a, const void *b) {
+
+    return(((const indexrec *) a)->order-((const indexrec *) b)->order);
+}
+
+static int readindex(FILE *fp, indexrec **recs, int *nrecs) {
+
+    char line[INDEX_LINELEN+1];
+    int n = 0, nalloc = 0;
+    indexrec *r = NULL, *tmp;
+
+    *recs = NULL;
+    *nrecs = 0;
+    while (fgets(line,INDEX_LINELEN,fp)) {
+	if (strlen(line) < 2) continue;
+	if (n == nalloc) {
+	    nalloc = nalloc ? 2*nalloc : 1024;
+	    tmp = (indexrec *) realloc(r, nalloc*sizeof(indexrec));
+	    if (!tmp) {
+		freeindex(r, n);
+		return(FM_MEMALL_ERR);
+	    }
+	    r = tmp;
+	}
+	if (line[strlen(line)-1] != '\n') strcat(line,"\n");
+	r[n].line = strdup(line);
+	if (!r[n].line) {
+	    freeindex(r, n);
+	    return(FM_MEMALL_ERR);
+	}
+	r[n].keylen = indexkey(line);
+	r[n].order = n;
+	n++;
+    }
+    if (ferror(fp)) {
+	freeindex(r, n);
+	return(FM_IO_ERR);
+    }
+
+    *recs = r;
+    *nrecs = n;
+
+    return(FM_OK);
+}
+
+/*
+ * Keep the last line of each scene, in the original order. The number
+ * of lines kept is returned.
+ */
+static int uniqueindex(indexrec *recs, int nrecs) {
+
+    int i, n = 0;
+
+    if (nrecs == 0) return(0);
+    qsort(recs, nrecs, sizeof(indexrec), cmpkey);
+    for (i=0;i<nrecs;i++) {
+	if (i+1 < nrecs && recs[i].keylen == recs[i+1].keylen &&
+		strncmp(recs[i].line, recs[i+1].line, recs[i].keylen) == 0) {
+	    free(recs[i].line);
+	    continue;
+	}
+	recs[n++] = recs[i];
+    }
+    qsort(recs, n, sizeof(indexrec), cmporder);
+
+    return(n);
+}
+
+static void freeindex(indexrec *recs, int nrecs) {
+
+    int i;
+
+    for (i=0;i<nrecs;i++) free(recs[i].line);
+    free(recs);
+}
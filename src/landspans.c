@@ -0,0 +1,248 @@
+/*
+ * NAME:
+ * landspans
+ *
+ * PURPOSE:
+ * To find the row spans of land and coast pixels of a tile from the
+ * land/sea mask, so that process_pixels4ice can skip the sea in land
+ * only mode.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Land/sea mask of a tile (physiography.<tile>.hdf5).
+ * o Span file of the mask.
+ *
+ * OUTPUT:
+ * The first and last column of each run of pixels above FMSNOWSEA in
+ * each row, written next to the mask as <mask>.spans.
+ *
+ * NOTES:
+ * The span file is text:
+ *
+ *   FMSNOWSPANS 1
+ *   size <iw> <ih>
+ *   <row> <first> <last>
+ *   ...
+ *
+ * with one line for each span, rows in increasing order. A row may have
+ * several spans (islands, fjords) or none.
+ *
+ * read_land_spans does not use a span file older than the mask, or of
+ * another size. The mask directory may be read only, then the spans are
+ * found again for every scene.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SPANS_LINELEN 64
+
+static int allocspans(landspans *ls, int iw, int ih, int nspans);
+
+/*
+ * NAME:
+ * find_land_spans
+ *
+ * PURPOSE:
+ * To find the spans of the land and coast pixels of the mask.
+ */
+int find_land_spans(unsigned char *lmask, int iw, int ih, landspans *ls)
+{
+
+  int row, col, n;
+  unsigned char *m;
+
+  /*
+   * Count the spans first, then fill them in.
+   */
+  n = 0;
+  for (row=0;row<ih;row++) {
+    m = lmask+row*iw;
+    for (col=0;col<iw;col++) {
+      if (m[col] > FMSNOWSEA && (col == 0 || m[col-1] <= FMSNOWSEA)) n++;
+    }
+  }
+  if (allocspans(ls, iw, ih, n)) return(FM_MEMALL_ERR);
+
+  n = 0;
+  for (row=0;row<ih;row++) {
+    m = lmask+row*iw;
+    ls->row[row] = n;
+    for (col=0;col<iw;col++) {
+      if (m[col] <= FMSNOWSEA) continue;
+      ls->first[n] = col;
+      for (;col<iw && m[col] > FMSNOWSEA;col++);
+      ls->last[n++] = col-1;
+    }
+  }
+  ls->row[ih] = n;
+
+  return(FM_OK);
+}
+
+/*
+ * NAME:
+ * write_land_spans
+ *
+ * PURPOSE:
+ * To write the spans of the mask lmaskf, to a temporary file which is
+ * renamed.
+ */
+int write_land_spans(char *lmaskf, landspans *ls)
+{
+
+  char *where="write_land_spans";
+  char fname[FILELEN+8], tmpname[FILELEN+24];
+  int row, n;
+  FILE *fp;
+
+  snprintf(fname,FILELEN+8,"%s%s",lmaskf,FMSNOWSPANS_SUFFIX);
+  snprintf(tmpname,FILELEN+24,"%s.%d",fname,(int) getpid());
+  fp = fopen(tmpname,"w");
+  if (!fp) {
+    fmerrmsg(where,"Could not create %s", tmpname);
+    return(FM_IO_ERR);
+  }
+  fprintf(fp,"FMSNOWSPANS 1\n");
+  fprintf(fp,"size %d %d\n", ls->iw, ls->ih);
+  for (row=0;row<ls->ih;row++) {
+    for (n=ls->row[row];n<ls->row[row+1];n++) {
+      fprintf(fp,"%d %d %d\n", row, ls->first[n], ls->last[n]);
+    }
+  }
+  if (fclose(fp) || rename(tmpname,fname)) {
+    fmerrmsg(where,"Could not write %s", fname);
+    unlink(tmpname);
+    return(FM_IO_ERR);
+  }
+
+  return(FM_OK);
+}
+
+/*
+ * NAME:
+ * read_land_spans
+ *
+ * PURPOSE:
+ * To read the spans of the mask lmaskf, which must be iw*ih.
+ *
+ * RETURN VALUES:
+ * FM_OK - spans read
+ * FM_IO_ERR - no usable span file, the spans must be found from the mask
+ */
+int read_land_spans(char *lmaskf, int iw, int ih, landspans *ls)
+{
+
+  char fname[FILELEN+8], line[SPANS_LINELEN];
+  int row, first, last, fiw, fih, n, prow, plast;
+  struct stat mbuf, sbuf;
+  FILE *fp;
+
+  memset(ls,0,sizeof(landspans));
+  snprintf(fname,FILELEN+8,"%s%s",lmaskf,FMSNOWSPANS_SUFFIX);
+  if (stat(fname,&sbuf) || stat(lmaskf,&mbuf) ||
+      sbuf.st_mtime < mbuf.st_mtime) {
+    return(FM_IO_ERR);
+  }
+  fp = fopen(fname,"r");
+  if (!fp) return(FM_IO_ERR);
+  if (!fgets(line,SPANS_LINELEN,fp) ||
+      strncmp(line,"FMSNOWSPANS 1",13) != 0 ||
+      !fgets(line,SPANS_LINELEN,fp) ||
+      sscanf(line,"size %d %d",&fiw,&fih) != 2 ||
+      fiw != iw || fih != ih) {
+    fclose(fp);
+    return(FM_IO_ERR);
+  }
+
+  /*
+   * The spans are counted before they are read, as for the mask.
+   */
+  n = 0;
+  while (fgets(line,SPANS_LINELEN,fp)) n++;
+  if (allocspans(ls, iw, ih, n)) {
+    fclose(fp);
+    return(FM_IO_ERR);
+  }
+  rewind(fp);
+  if (!fgets(line,SPANS_LINELEN,fp) || !fgets(line,SPANS_LINELEN,fp)) {
+    fclose(fp);
+    free_land_spans(ls);
+    return(FM_IO_ERR);
+  }
+
+  n = 0;
+  prow = 0;
+  plast = -1;
+  while (fgets(line,SPANS_LINELEN,fp)) {
+    if (sscanf(line,"%d %d %d",&row,&first,&last) != 3 ||
+	row < prow || row >= ih || first < 0 || last >= iw ||
+	first > last || (row == prow && first <= plast)) {
+      fclose(fp);
+      free_land_spans(ls);
+      return(FM_IO_ERR);
+    }
+    for (;prow<row;prow++) ls->row[prow+1] = n;
+    ls->first[n] = first;
+    ls->last[n++] = last;
+    plast = last;
+  }
+  for (;prow<ih;prow++) ls->row[prow+1] = n;
+  fclose(fp);
+
+  return(FM_OK);
+}
+
+/*
+ * NAME:
+ * free_land_spans
+ *
+ * PURPOSE:
+ * To free the spans.
+ */
+void free_land_spans(landspans *ls)
+{
+
+  if (ls->row) free(ls->row);
+  if (ls->first) free(ls->first);
+  if (ls->last) free(ls->last);
+  memset(ls,0,sizeof(landspans));
+}
+
+/*
+ * Allocate spans of a tile, row[0] is 0 and the others are set by the
+ * caller.
+ */
+static int allocspans(landspans *ls, int iw, int ih, int nspans)
+{
+
+  memset(ls,0,sizeof(landspans));
+  ls->row = (int *) malloc((ih+1)*sizeof(int));
+  ls->first = (int *) malloc((nspans > 0 ? nspans : 1)*sizeof(int));
+  ls->last = (int *) malloc((nspans > 0 ? nspans : 1)*sizeof(int));
+  if (!ls->row || !ls->first || !ls->last) {
+    free_land_spans(ls);
+    return(FM_MEMALL_ERR);
+  }
+  ls->iw = iw;
+  ls->ih = ih;
+  ls->nspans = nspans;
+  ls->row[0] = 0;
+
+  return(FM_OK);
+}
@@ -0,0 +1,273 @@
+/*
+ * NAME:
+ * nwpcache.c
+ *
+ * PURPOSE:
+ * To keep NWP surface temperature fields interpolated to a tile on
+ * disk, so that scenes from different satellites covering the same
+ * tile within the validity window of a model field can reuse the field
+ * instead of searching the felt files and interpolating again.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o cache directory
+ * o requested time and tile UCS
+ *
+ * OUTPUT:
+ * The t0m field in nwpice is mapped read only from the cache file.
+ *
+ * NOTES:
+ * Each cache file holds one field and is named
+ * t0m_<iw>x<ih>_<Ax>_<Ay>_<Bx>_<By>_<yyyymmddhh>+<leadtime>.nwpc
+ * where the date is the valid time of the field and leadtime the
+ * forecast length, i.e. the model run is valid time minus leadtime. The
+ * file starts with a nwpcachehead followed by the field on the coarse
+ * grid of nwpice_grid (cw*ch floats).
+ *
+ * A field is reused for scenes within NWPCACHE_WINDOW of its valid
+ * time, the field closest in time and then the newest model run is
+ * selected. Fields older than the newest felt file are not used, as a
+ * new model run may have arrived.
+ *
+ * Files are written to a temporary name and renamed, so that processes
+ * reading the cache at the same time never see a partial file. Fields
+ * more than NWPCACHE_KEEP older than the one stored are removed.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Fields are stored on the coarse NWP
+ * grid.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <getnwp.h>
+
+#define NWPCACHE_MAGIC "FMNWPC2"
+#define NWPCACHE_WINDOW 5400 /* seconds */
+#define NWPCACHE_KEEP (48*3600) /* seconds */
+#define NWPCACHE_NAMELEN 256
+
+typedef struct {
+    char magic[8];
+    int iw;
+    int ih;
+    float Ax;
+    float Ay;
+    float Bx;
+    float By;
+    long long validtime;
+    int leadtime;
+    int step;
+} nwpcachehead;
+
+static void nwpcacheprefix(fmucsref refucs, char *prefix);
+static int nwpcacheparse(char *name, char *prefix, fmsec1970 *validtime,
+	int *leadtime);
+
+/*
+ * NAME:
+ * nwpcache_get
+ *
+ * PURPOSE:
+ * To find a cached field for the tile valid at reqtime. newest is the
+ * modification time of the newest felt file.
+ *
+ * RETURN VALUES:
+ * FM_OK - field found and mapped into nwp
+ * FM_IO_ERR - no usable field found
+ */
+int nwpcache_get(char *cachedir, fmtime reqtime, fmucsref refucs,
+	time_t newest, nwpice *nwp) {
+
+    char *where="nwpcache_get";
+    char prefix[NWPCACHE_NAMELEN], fname[NWPCACHE_NAMELEN];
+    char best[NWPCACHE_NAMELEN];
+    fmsec1970 reqsec, validtime, bestvalid = 0;
+    int leadtime, bestlead = 0, fd, step, cw, ch;
+    long dt, bestdt = NWPCACHE_WINDOW+1;
+    size_t len;
+    void *map;
+    nwpcachehead *h;
+    struct dirent *de;
+    struct stat sbuf;
+    DIR *dp;
+
+    reqsec = tofmsec1970(reqtime);
+    nwpcacheprefix(refucs, prefix);
+
+    dp = opendir(cachedir);
+    if (!dp) return(FM_IO_ERR);
+    best[0] = '\0';
+    while ((de = readdir(dp)) != NULL) {
+	if (nwpcacheparse(de->d_name, prefix, &validtime, &leadtime)) continue;
+	dt = labs((long) (validtime-reqsec));
+	if (dt > NWPCACHE_WINDOW) continue;
+	if (dt < bestdt || (dt == bestdt &&
+		    validtime-3600*leadtime > bestvalid-3600*bestlead)) {
+	    sprintf(fname,"%s/%s",cachedir,de->d_name);
+	    if (stat(fname,&sbuf) || sbuf.st_mtime < newest) continue;
+	    bestdt = dt;
+	    bestvalid = validtime;
+	    bestlead = leadtime;
+	    sprintf(best,"%s",fname);
+	}
+    }
+    closedir(dp);
+    if (strlen(best) == 0) return(FM_IO_ERR);
+
+    nwpice_grid(refucs, &step, &cw, &ch);
+    len = sizeof(nwpcachehead)+cw*ch*sizeof(float);
+    fd = open(best, O_RDONLY);
+    if (fd < 0) return(FM_IO_ERR);
+    if (fstat(fd,&sbuf) || sbuf.st_size != len) {
+	fmerrmsg(where,"%s has wrong size, not used", best);
+	close(fd);
+	return(FM_IO_ERR);
+    }
+    map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+	fmerrmsg(where,"Could not map %s", best);
+	return(FM_IO_ERR);
+    }
+    h = (nwpcachehead *) map;
+    if (strncmp(h->magic,NWPCACHE_MAGIC,8) != 0 ||
+	    h->iw != refucs.iw || h->ih != refucs.ih ||
+	    h->Ax != refucs.Ax || h->Ay != refucs.Ay ||
+	    h->Bx != refucs.Bx || h->By != refucs.By || h->step != step) {
+	fmerrmsg(where,"%s does not match the tile, not used", best);
+	munmap(map, len);
+	return(FM_IO_ERR);
+    }
+
+    if (nwp->t0m) free(nwp->t0m);
+    nwp->t0m = (float *) ((char *) map+sizeof(nwpcachehead));
+    nwp->cachemap = map;
+    nwp->cachelen = len;
+    nwp->validtime = (fmsec1970) h->validtime;
+    nwp->leadtime = h->leadtime;
+    nwp->refucs = refucs;
+    nwp->step = step;
+    nwp->cw = cw;
+    nwp->ch = ch;
+    fmlogmsg(where,"Using cached NWP data from %s", best);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * nwpcache_put
+ *
+ * PURPOSE:
+ * To store the t0m field read by nwpice_read in the cache.
+ */
+int nwpcache_put(char *cachedir, nwpice *nwp) {
+
+    char *where="nwpcache_put";
+    char prefix[NWPCACHE_NAMELEN], fname[NWPCACHE_NAMELEN];
+    char tmpname[NWPCACHE_NAMELEN];
+    fmsec1970 validtime;
+    fmtime vt;
+    int leadtime;
+    size_t n;
+    nwpcachehead h;
+    struct dirent *de;
+    DIR *dp;
+    FILE *fp;
+
+    if (!nwp->t0m) return(FM_VAROUTOFSCOPE_ERR);
+
+    memset(&h,0,sizeof(nwpcachehead));
+    memcpy(h.magic,NWPCACHE_MAGIC,8);
+    h.iw = nwp->refucs.iw;
+    h.ih = nwp->refucs.ih;
+    h.Ax = nwp->refucs.Ax;
+    h.Ay = nwp->refucs.Ay;
+    h.Bx = nwp->refucs.Bx;
+    h.By = nwp->refucs.By;
+    h.validtime = (long long) nwp->validtime;
+    h.leadtime = nwp->leadtime;
+    h.step = nwp->step;
+
+    nwpcacheprefix(nwp->refucs, prefix);
+    tofmtime(nwp->validtime, &vt);
+    sprintf(fname,"%s/%s%04d%02d%02d%02d+%02d.nwpc", cachedir, prefix,
+	    vt.fm_year, vt.fm_mon, vt.fm_mday, vt.fm_hour, nwp->leadtime);
+    sprintf(tmpname,"%s.%d", fname, (int) getpid());
+
+    fp = fopen(tmpname,"w");
+    if (!fp) {
+	fmerrmsg(where,"Could not create %s", tmpname);
+	return(FM_IO_ERR);
+    }
+    n = (size_t) nwp->cw*nwp->ch;
+    if (fwrite(&h,sizeof(nwpcachehead),1,fp) != 1 ||
+	    fwrite(nwp->t0m,sizeof(float),n,fp) != n) {
+	fmerrmsg(where,"Could not write %s", tmpname);
+	fclose(fp);
+	unlink(tmpname);
+	return(FM_IO_ERR);
+    }
+    if (fclose(fp) || rename(tmpname,fname)) {
+	fmerrmsg(where,"Could not store %s", fname);
+	unlink(tmpname);
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * Remove old fields of this tile.
+     */
+    dp = opendir(cachedir);
+    if (!dp) return(FM_OK);
+    while ((de = readdir(dp)) != NULL) {
+	if (nwpcacheparse(de->d_name, prefix, &validtime, &leadtime)) continue;
+	if (validtime < nwp->validtime-NWPCACHE_KEEP) {
+	    sprintf(fname,"%s/%s",cachedir,de->d_name);
+	    unlink(fname);
+	}
+    }
+    closedir(dp);
+
+    return(FM_OK);
+}
+
+static void nwpcacheprefix(fmucsref refucs, char *prefix) {
+
+    sprintf(prefix,"t0m_%dx%d_%g_%g_%g_%g_", refucs.iw, refucs.ih,
+	    refucs.Ax, refucs.Ay, refucs.Bx, refucs.By);
+}
+
+static int nwpcacheparse(char *name, char *prefix, fmsec1970 *validtime,
+	int *leadtime) {
+    fmtime vt;
+    int len = strlen(prefix);
+
+    if (strncmp(name,prefix,len) != 0) return(FM_SYNTAX_ERR);
+    if (strlen(name)-len < 15 || strcmp(name+strlen(name)-5,".nwpc") != 0) {
+	return(FM_SYNTAX_ERR);
+    }
+    memset(&vt,0,sizeof(fmtime));
+    if (sscanf(name+len,"%4d%2d%2d%2d+%d", &vt.fm_year, &vt.fm_mon,
+		&vt.fm_mday, &vt.fm_hour, leadtime) != 5) {
+	return(FM_SYNTAX_ERR);
+    }
+    *validtime = tofmsec1970(vt);
+
+    return(FM_OK);
+}
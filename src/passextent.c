@@ -0,0 +1,211 @@
+/*
+ * NAME:
+ * passextent
+ *
+ * PURPOSE:
+ * To record the part of the tile covered by valid data in a pass
+ * product of fmsnowcover, so that fmaccusnow only handles that part.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o P(ice/snow) of a pass product.
+ * o Extent file of a product.
+ *
+ * OUTPUT:
+ * The first and last column with probabilities in each row, written
+ * next to the product as <product>.extent.
+ *
+ * NOTES:
+ * The extent file is text:
+ *
+ *   FMSNOWEXTENT 1
+ *   size <iw> <ih>
+ *   <row> <first> <last>
+ *   ...
+ *
+ * with one line for each row having valid pixels. Pixels outside the
+ * extent have missing values (no coverage, night or 3A) in the product.
+ *
+ * The extent is written after the product. read_pass_extent does not
+ * use an extent older than the product, or of another size, as it may
+ * belong to an earlier version of the product.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define EXTENT_LINELEN 64
+
+static int allocextent(passextent *ex, int iw, int ih);
+
+/*
+ * NAME:
+ * find_pass_extent
+ *
+ * PURPOSE:
+ * To find the extent of the valid pixels (pice >= 0) of a product.
+ */
+int find_pass_extent(float *pice, int iw, int ih, passextent *ex)
+{
+
+  int row, col;
+  float *p;
+
+  if (allocextent(ex, iw, ih)) return(FM_MEMALL_ERR);
+
+  for (row=0;row<ih;row++) {
+    p = pice+row*iw;
+    for (col=0;col<iw && p[col] < 0.;col++);
+    if (col == iw) continue;
+    ex->first[row] = col;
+    for (col=iw-1;p[col] < 0.;col--);
+    ex->last[row] = col;
+    ex->nrows++;
+  }
+
+  return(FM_OK);
+}
+
+/*
+ * NAME:
+ * write_pass_extent
+ *
+ * PURPOSE:
+ * To write the extent of the product prodfile, to a temporary file
+ * which is renamed.
+ */
+int write_pass_extent(char *prodfile, passextent *ex)
+{
+
+  char *where="write_pass_extent";
+  char fname[FILELEN+8], tmpname[FILELEN+24];
+  int row;
+  FILE *fp;
+
+  snprintf(fname,FILELEN+8,"%s%s",prodfile,PASSEXTENT_SUFFIX);
+  snprintf(tmpname,FILELEN+24,"%s.%d",fname,(int) getpid());
+  fp = fopen(tmpname,"w");
+  if (!fp) {
+    fmerrmsg(where,"Could not create %s", tmpname);
+    return(FM_IO_ERR);
+  }
+  fprintf(fp,"FMSNOWEXTENT 1\n");
+  fprintf(fp,"size %d %d\n", ex->iw, ex->ih);
+  for (row=0;row<ex->ih;row++) {
+    if (ex->first[row] > ex->last[row]) continue;
+    fprintf(fp,"%d %d %d\n", row, ex->first[row], ex->last[row]);
+  }
+  if (fclose(fp) || rename(tmpname,fname)) {
+    fmerrmsg(where,"Could not write %s", fname);
+    unlink(tmpname);
+    return(FM_IO_ERR);
+  }
+
+  return(FM_OK);
+}
+
+/*
+ * NAME:
+ * read_pass_extent
+ *
+ * PURPOSE:
+ * To read the extent of the product prodfile, which must be iw*ih.
+ *
+ * RETURN VALUES:
+ * FM_OK - extent read
+ * FM_IO_ERR - no usable extent, the full tile must be used
+ */
+int read_pass_extent(char *prodfile, int iw, int ih, passextent *ex)
+{
+
+  char fname[FILELEN+8], line[EXTENT_LINELEN];
+  int row, first, last, fiw, fih;
+  struct stat pbuf, ebuf;
+  FILE *fp;
+
+  memset(ex,0,sizeof(passextent));
+  snprintf(fname,FILELEN+8,"%s%s",prodfile,PASSEXTENT_SUFFIX);
+  if (stat(fname,&ebuf) || stat(prodfile,&pbuf) ||
+      ebuf.st_mtime < pbuf.st_mtime) {
+    return(FM_IO_ERR);
+  }
+  fp = fopen(fname,"r");
+  if (!fp) return(FM_IO_ERR);
+  if (!fgets(line,EXTENT_LINELEN,fp) ||
+      strncmp(line,"FMSNOWEXTENT 1",14) != 0 ||
+      !fgets(line,EXTENT_LINELEN,fp) ||
+      sscanf(line,"size %d %d",&fiw,&fih) != 2 ||
+      fiw != iw || fih != ih || allocextent(ex, iw, ih)) {
+    fclose(fp);
+    return(FM_IO_ERR);
+  }
+  while (fgets(line,EXTENT_LINELEN,fp)) {
+    if (sscanf(line,"%d %d %d",&row,&first,&last) != 3 ||
+	row < 0 || row >= ih || first < 0 || last >= iw || first > last) {
+      fclose(fp);
+      free_pass_extent(ex);
+      return(FM_IO_ERR);
+    }
+    if (ex->first[row] > ex->last[row]) ex->nrows++;
+    ex->first[row] = first;
+    ex->last[row] = last;
+  }
+  fclose(fp);
+
+  return(FM_OK);
+}
+
+/*
+ * NAME:
+ * free_pass_extent
+ *
+ * PURPOSE:
+ * To free the extent.
+ */
+void free_pass_extent(passextent *ex)
+{
+
+  if (ex->first) free(ex->first);
+  if (ex->last) free(ex->last);
+  memset(ex,0,sizeof(passextent));
+}
+
+/*
+ * Allocate an extent with no valid rows.
+ */
+static int allocextent(passextent *ex, int iw, int ih)
+{
+
+  int row;
+
+  memset(ex,0,sizeof(passextent));
+  ex->first = (int *) malloc(ih*sizeof(int));
+  ex->last = (int *) malloc(ih*sizeof(int));
+  if (!ex->first || !ex->last) {
+    free_pass_extent(ex);
+    return(FM_MEMALL_ERR);
+  }
+  ex->iw = iw;
+  ex->ih = ih;
+  for (row=0;row<ih;row++) {
+    ex->first[row] = iw;
+    ex->last[row] = -1;
+  }
+
+  return(FM_OK);
+}
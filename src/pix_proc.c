@@ -19,13 +19,18 @@
  * img - AVHRR image data and header
  * cmask - cloud mask
  * lmask - land/sea mask
+ * land - spans of land and coast pixels in lmask, NULL for all pixels
  * algo - flag determining whether night time or day time data are used
+ * stride - every stride pixel in each direction is processed, 1 for all
+ * cnt - pixel counters, may be NULL
  *
  * OUTPUT:
  * pice - Probability of ice given the AVHRR observations
  * pfree - Probability of open water or land given the AVHRR observations
  * pcloud - Probability of cloud given the AVHRR observations
  * classed - Classed ice probability
+ * The output fields have (iw+stride-1)/stride columns.
+ * cnt - the number of pixels leaving through each exit is added
  *
  * NOTES:
  * Use of algo variable changed, code should be checked for unnecessary use of
@@ -36,6 +41,19 @@
  * A hack to handle saturation problems within 3A is imlemented. This
  * should be handled more properly by the preprocessing in time.
  *
+ * The pixels are counted in a local pixcountstr which is merged into
+ * cnt at the end of the scene, the hot loop does not touch memory
+ * shared with other callers. The scene statistics of the index file are
+ * found in the same pass.
+ *
+ * With stride above 1 a decimated quick-look is made, calibration,
+ * geometry, NWP data and land/sea mask are taken at the pixels used in
+ * the full tile.
+ *
+ * With land only the pixels of its spans are processed (land only
+ * mode), the others are set to FMSNOWCOVERMISVAL_SEA and counted by the
+ * sea exit.
+ *
  * BUGS:
  * NA
  *
@@ -59,6 +77,24 @@
  * introducing fm_ch3brefl.
  * MAK, METNO/FOU, 22.09.2009: (temp.) adding "cat" to categorize each
  * pixel in class with highest probability.
+ * ystein Gody, METNO/FOU, 19.10.2026: Coefficients passed by reference.
+ * ystein Gody, METNO/FOU, 19.10.2026: Class binning moved to pice2class
+ * and probs2cat.
+ * ystein Gody, METNO/FOU, 19.10.2026: dt is not estimated when NWP data
+ * are missing.
+ * ystein Gody, METNO/FOU, 19.10.2026: Pixels are counted for each exit
+ * and regime.
+ * ystein Gody, METNO/FOU, 19.10.2026: NWP surface temperature is sampled
+ * from the coarse grid by nwpice_t0m, only for pixels reaching probest.
+ * ystein Gody, METNO/FOU, 19.10.2026: pice2class and probs2cat moved to
+ * pixclass.c.
+ * ystein Gody, METNO/FOU, 19.10.2026: Classes and P(ice/snow) by regime
+ * are accumulated with the pixel counters.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added stride for quick-look
+ * products.
+ * ystein Gody, METNO/FOU, 19.10.2026: Added land only mode.
+ * ystein Gody, METNO/FOU, 19.10.2026: The T4 count of the 3A test is
+ * FMSNOWSAT3ACOUNT.
  *
  * CVS_ID:
  * $Id: pix_proc.c,v 1.10 2011-12-05 09:58:47 mariak Exp $
@@ -67,13 +103,28 @@
 #include <fmsnowcover.h>
 /*#undef FMSNOWCOVER_HAVE_LIBUSENWP*/
 
+static char *pixexitname[FMSNOWPIX_EXITS] = {
+    "night","nocov","sat3a","probsum","nan","ok","sea"
+};
+static char *pixregname[FMSNOWREGIMES] = {"sea","land","coast"};
+static char *pixmodename[FMSNOWMODES] = {"3a","3b"};
+static char *pixnwpname[FMSNOWPIX_NWPMODES] = {"nonwp","nwp"};
+static char *pixcatname[CATLIMITS+1] = {
+    "none","ice","clear","cloud","uncl","undef"
+};
+
+static void countpix(pixcountstr *c, int ex, int reg, int mode, int usenwp);
+static void countclass(pixcountstr *c, probstr *p, int cl, int ct, int reg);
+static int landpix(landspans *ls, int yc, int xc, int stride, int *s);
+
 int process_pixels4ice(fmio_img img, unsigned char *cmask[], 
-       unsigned char *lmask, nwpice nwp, datafield *probs, 
-       unsigned char *class, unsigned char *cat, short algo, statcoeffstr cof) {
+       unsigned char *lmask, landspans *land, nwpice nwp, datafield *probs, 
+       unsigned char *class, unsigned char *cat, short algo, int stride,
+       statcoeffstr *cof, pixcountstr *cnt) {
     
     char *where="process_pixels4ice";
     char what[FMSNOWCOVER_MSGLENGTH];
-    int i, j, size;
+    int i, j, n, ow, oh, s;
     int xc, yc;
     /* double x; */
     pinpstr cpar;
@@ -88,13 +139,17 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
     float zsun;
     int doy;
     fmscale calib; /*will contain gain and intercept values*/
+    pixcountstr pc;
+    int reg, mode, usenwp;
 
     fmlogmsg(where,
 	    "Now processing the individual pixels to gain ice probability...");
     /*
      * Convert structures to lesser units for later use...
      */
-    size = img.iw*img.ih;
+    if (stride < 1) stride = 1;
+    ow = (img.iw+stride-1)/stride;
+    oh = (img.ih+stride-1)/stride;
 
     ucs0.Ax = img.Ax;
     ucs0.Ay = img.Ay;
@@ -127,16 +182,41 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 
     doy = fmdayofyear(timeid);
 
+    initpixcount(&pc);
+    usenwp = 0;
+    #ifdef FMSNOWCOVER_HAVE_LIBUSENWP
+    if (nwp.t0m) usenwp = 1;
+    #endif
+
     /*
-     * Start of nested loops that run through alle pixels.
+     * In land only mode all pixels are sea until processed.
      */
-    for (yc=0; yc < img.ih; yc++) {
-	for (xc=0; xc < img.iw; xc++) {
+    if (land) {
+	fmlogmsg(where,"Land only mode, %d spans of land pixels",
+		land->nspans);
+	for (i=0; i<ow*oh; i++) {
+	    class[i] = 0;
+	    cat[i] = 5; /*undef.*/
+	    for (j=0; j<FMSNOWCOVER_OLEVELS; j++) {
+		((float *) probs[j].data)[i] = FMSNOWCOVERMISVAL_SEA;
+	    }
+	}
+    }
+
+    /*
+     * Start of nested loops that run through alle pixels, or the land
+     * pixels given by land.
+     */
+    for (yc=0; yc < img.ih; yc += stride) {
+	s = -1;
+	for (xc=landpix(land, yc, 0, stride, &s); xc < img.iw;
+		xc=landpix(land, yc, xc+stride, stride, &s)) {
 
 	    /*
-	     * 2D -> 1D indexing...
+	     * 2D -> 1D indexing, n in the tile and i in the output...
 	     */
-	    i=fmivec(xc, yc, img.iw);
+	    n=fmivec(xc, yc, img.iw);
+	    i=fmivec(xc/stride, yc/stride, ow);
 	    class[i] = 0;
 	    cat[i] = 5; /*undef.*/
 
@@ -172,6 +252,7 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 		for (j=0; j<FMSNOWCOVER_OLEVELS; j++) {
 		    ((float *) probs[j].data)[i] = FMSNOWCOVERMISVAL_NIGHT;
 		}
+		pc.exits[FMSNOWPIX_NIGHT]++;
 		continue;
 	    }
     
@@ -180,10 +261,11 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	     * are available and only for the parts of the image were
 	     * the satellite has passed. 
 	     */
-	    if ((img.image[3][i] == 0) && (img.image[4][i] == 0)) {
+	    if ((img.image[3][n] == 0) && (img.image[4][n] == 0)) {
 		for (j=0; j<FMSNOWCOVER_OLEVELS; j++) {
 		    ((float *) probs[j].data)[i] = FMSNOWCOVERMISVAL_NOCOV;
 		}
+		pc.exits[FMSNOWPIX_NOCOV]++;
 		continue;
 	    }
 
@@ -192,7 +274,7 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	     */
 	    cpar.daytime3b = 0;
 	    if (cpar.algo == 2) {
-		if (img.image[2][i] > 0 && img.image[5][i] == 0) {
+		if (img.image[2][n] > 0 && img.image[5][n] == 0) {
 		    cpar.daytime3b = 1;
 		}
 	    }
@@ -205,18 +287,22 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 		}
 	    }
 	    else {
-		cpar.lmask = (short) lmask[i];
+		cpar.lmask = (short) lmask[n];
 	    }
+	    reg = lmask2regime(cpar.lmask);
+	    mode = (cpar.daytime3b) ? FMSNOWMODE3B : FMSNOWMODE3A;
 
 	    /*
 	     * Added hack on 3A due to saturation problems...
 	     */
 	    if (!cpar.daytime3b) {
-		if ((img.image[5][i] == 0) && (img.image[3][i] > 50)) {
+		if ((img.image[5][n] == 0) &&
+			(img.image[3][n] > FMSNOWSAT3ACOUNT)) {
 		    class[i] = 0;
 		    for (j=0; j<FMSNOWCOVER_OLEVELS; j++) {
 			((float *) probs[j].data)[i] = FMSNOWCOVERMISVAL_3A;
 		    }
+		    countpix(&pc, FMSNOWPIX_3A, reg, mode, usenwp);
 		    continue;
 		}
 	    }
@@ -231,19 +317,19 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	     */
 
 	    if (cpar.algo == 2 && img.z > 3) {
-	        cpar.A1 = fm_byte2float(img.image[0][i], calib, "Reflectance");
-		cpar.A2 = fm_byte2float(img.image[1][i], calib, "Reflectance");
-		cpar.A3 = fm_byte2float(img.image[5][i], calib, "Reflectance");
+	        cpar.A1 = fm_byte2float(img.image[0][n], calib, "Reflectance");
+		cpar.A2 = fm_byte2float(img.image[1][n], calib, "Reflectance");
+		cpar.A3 = fm_byte2float(img.image[5][n], calib, "Reflectance");
 	    }
-	    cpar.T3 = fm_byte2float(img.image[2][i], calib, "Temperature");
-	    cpar.T4 = fm_byte2float(img.image[3][i], calib, "Temperature");
-	    cpar.T5 = fm_byte2float(img.image[4][i], calib, "Temperature");
+	    cpar.T3 = fm_byte2float(img.image[2][n], calib, "Temperature");
+	    cpar.T4 = fm_byte2float(img.image[3][n], calib, "Temperature");
+	    cpar.T5 = fm_byte2float(img.image[4][n], calib, "Temperature");
 	    cpar.soz = zsun;
 	    cpar.saz = 0.;
 
 	    cpar.tdiff = 0.0;	  
 	    #ifdef FMSNOWCOVER_HAVE_LIBUSENWP
-	    cpar.tdiff = nwp.t0m[i]-cpar.T4;
+	    if (usenwp) cpar.tdiff = nwpice_t0m(&nwp, xc, yc)-cpar.T4;
             #endif
 
 	    /* Estimate the reflective part of daytime channel 3b */
@@ -266,6 +352,7 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	     * not sum to 1.
 	     */
 	    if (p.pice+p.pfree+p.pcloud<0.95 || p.pice+p.pfree+p.pcloud>1.05){
+		countpix(&pc, FMSNOWPIX_PROBSUM, reg, mode, usenwp);
 		continue; 
 	    }
  
@@ -274,6 +361,7 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	     * nan (not fixed by statement above). Trying this:
 	     */
 	    if (isnan(p.pice) || isnan(p.pfree) || isnan(p.pcloud)) {
+		countpix(&pc, FMSNOWPIX_NAN, reg, mode, usenwp);
 		continue;
 	    }
 
@@ -313,66 +401,212 @@ int process_pixels4ice(fmio_img img, unsigned char *cmask[],
 	    p = exp(x)/(1+exp(x));
 	    */
 	    
-	    if (p.pice < 0.0) {
-		class[i] = 0;
-	    } else if (p.pice < 0.05) {
-		class[i] = 1;
-	    } else if (p.pice < 0.10) {
-		class[i] = 2;
-	    } else if (p.pice < 0.15) {
-		class[i] = 3;
-	    } else if (p.pice < 0.20) {
-		class[i] = 4;
-	    } else if (p.pice < 0.25) {
-		class[i] = 5;
-	    } else if (p.pice < 0.30) {
-		class[i] = 6;
-	    } else if (p.pice < 0.35) {
-		class[i] = 7;
-	    } else if (p.pice < 0.40) {
-		class[i] = 8;
-	    } else if (p.pice < 0.45) {
-		class[i] = 9;
-	    } else if (p.pice < 0.50) {
-		class[i] = 10;
-	    } else if (p.pice < 0.55) {
-		class[i] = 11;
-	    } else if (p.pice < 0.60) {
-		class[i] = 12;
-	    } else if (p.pice < 0.65) {
-		class[i] = 13;
-	    } else if (p.pice < 0.70) {
-		class[i] = 14;
-	    } else if (p.pice < 0.75) {
-		class[i] = 15;
-	    } else if (p.pice < 0.80) {
-		class[i] = 16;
-	    } else if (p.pice < 0.85) {
-		class[i] = 17;
-	    } else if (p.pice < 0.90) {
-		class[i] = 18;
-	    } else if (p.pice < 0.95) {
-		class[i] = 19;
-	    } else if (p.pice <= 1.0) {
-		class[i] = 20;
-	    } else {
-		class[i] = 0;
-	    }
-
-	    if ((p.pice > p.pfree) && (p.pice > p.pcloud)) {
-	      cat[i] = ICE;
-	    } else if ((p.pfree > p.pice) && (p.pfree > p.pcloud)) {
-	      cat[i] = CLEAR;
-	    } else if ((p.pcloud > p.pice) && (p.pcloud > p.pfree)){
-	      cat[i] = CLOUD;
-	    } else { /*some probs. are equal*/
-	      cat[i] = UNCL;
-	    }
+	    class[i] = pice2class(p.pice);
+	    cat[i] = probs2cat(&p);
+	    countpix(&pc, FMSNOWPIX_OK, reg, mode, usenwp);
+	    countclass(&pc, &p, class[i], cat[i], reg);
 
 	}
     }
+    if (land) {
+	pc.exits[FMSNOWPIX_SEA] = (long) ow*oh;
+	for (j=0; j<FMSNOWPIX_EXITS; j++) {
+	    if (j != FMSNOWPIX_SEA) pc.exits[FMSNOWPIX_SEA] -= pc.exits[j];
+	}
+    }
+    if (cnt) mergepixcount(cnt, &pc);
     fmlogmsg(where,"Now returning to main...");
    
     return(FM_OK);
 }
 
+
+/*
+ * NAME:
+ * initpixcount, mergepixcount
+ *
+ * PURPOSE:
+ * To reset pixel counters and to add the counters of src to dst.
+ */
+void initpixcount(pixcountstr *cnt) {
+
+    memset(cnt,0,sizeof(pixcountstr));
+}
+
+void mergepixcount(pixcountstr *dst, pixcountstr *src) {
+    int e, r, m, n;
+
+    for (e=0;e<FMSNOWPIX_EXITS;e++) {
+	dst->exits[e] += src->exits[e];
+	for (r=0;r<FMSNOWREGIMES;r++) {
+	    for (m=0;m<FMSNOWMODES;m++) {
+		for (n=0;n<FMSNOWPIX_NWPMODES;n++) {
+		    dst->regime[e][r][m][n] += src->regime[e][r][m][n];
+		}
+	    }
+	}
+    }
+    for (e=0;e<FMSNOWPIX_PCLASSES;e++) {
+	dst->pclass[e] += src->pclass[e];
+    }
+    for (e=0;e<=CATLIMITS;e++) {
+	dst->cat[e] += src->cat[e];
+    }
+    for (r=0;r<FMSNOWREGIMES;r++) {
+	dst->psnow[r] += src->psnow[r];
+    }
+}
+
+/*
+ * NAME:
+ * pixcount2timer
+ *
+ * PURPOSE:
+ * To add the pixel counters to the run report. The total for each exit
+ * is reported as pix.<exit>, the counts by regime, mode and NWP use as
+ * pix.<exit>.<regime>.<mode>.<nwp> when not zero and the categories as
+ * cat.<category>.
+ */
+int pixcount2timer(pixcountstr *cnt, fmsnowtimer *tm) {
+    char key[FMSNOWTIMER_KEYLEN];
+    int e, r, m, n;
+
+    for (e=0;e<FMSNOWPIX_EXITS;e++) {
+	sprintf(key,"pix.%s",pixexitname[e]);
+	fmsnowtimer_count(tm, key, cnt->exits[e]);
+    }
+    for (e=0;e<FMSNOWPIX_EXITS;e++) {
+	for (r=0;r<FMSNOWREGIMES;r++) {
+	    for (m=0;m<FMSNOWMODES;m++) {
+		for (n=0;n<FMSNOWPIX_NWPMODES;n++) {
+		    if (cnt->regime[e][r][m][n] == 0) continue;
+		    sprintf(key,"pix.%s.%s.%s.%s",pixexitname[e],
+			    pixregname[r],pixmodename[m],pixnwpname[n]);
+		    fmsnowtimer_count(tm, key, cnt->regime[e][r][m][n]);
+		}
+	    }
+	}
+    }
+    for (e=ICE;e<=UNCL;e++) {
+	sprintf(key,"cat.%s",pixcatname[e]);
+	fmsnowtimer_count(tm, key, cnt->cat[e]);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * pixcount2str
+ *
+ * PURPOSE:
+ * To write the scene statistics used in the index file, separated by
+ * space: the totals for each exit as <exit>=<n>, the categories as
+ * <category>=<n>, the mean P(ice/snow) by regime as psnow.<regime>=<p>
+ * (-1 if no pixels were classified) and the probability classes 0-20
+ * as pclass=<n0>,<n1>,...
+ */
+int pixcount2str(pixcountstr *cnt, char *str, int len) {
+    int e, n;
+
+    n = 0;
+    str[0] = '\0';
+    for (e=0;e<FMSNOWPIX_EXITS && n<len;e++) {
+	n += snprintf(str+n,len-n,"%s%s=%ld",(e > 0) ? " " : "",
+		pixexitname[e],cnt->exits[e]);
+    }
+    for (e=ICE;e<=UNCL && n<len;e++) {
+	n += snprintf(str+n,len-n," %s=%ld",pixcatname[e],cnt->cat[e]);
+    }
+    for (e=0;e<FMSNOWREGIMES && n<len;e++) {
+	n += snprintf(str+n,len-n," psnow.%s=%.3f",pixregname[e],
+		pixcount2psnow(cnt,e));
+    }
+    for (e=0;e<FMSNOWPIX_PCLASSES && n<len;e++) {
+	n += snprintf(str+n,len-n,"%s%ld",(e > 0) ? "," : " pclass=",
+		cnt->pclass[e]);
+    }
+    if (n >= len) return(FM_VAROUTOFSCOPE_ERR);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * pixcount2cloudfree
+ *
+ * PURPOSE:
+ * To estimate the cloud free part of the scene, i.e. the fraction of
+ * pixels with data where ice/snow or clear is more likely than cloud
+ * (the old findcloudfree tried this with chained comparisons). Pixels
+ * without data are those stored with FMSNOWCOVERMISVAL_NOCOV, the sea
+ * of land only mode is not counted either.
+ */
+float pixcount2cloudfree(pixcountstr *cnt) {
+    int e;
+    long covered = 0;
+
+    for (e=0;e<FMSNOWPIX_EXITS;e++) {
+	if (e == FMSNOWPIX_NOCOV || e == FMSNOWPIX_PROBSUM ||
+		e == FMSNOWPIX_NAN || e == FMSNOWPIX_SEA) continue;
+	covered += cnt->exits[e];
+    }
+    if (covered == 0) return(0.);
+
+    return((float) (cnt->cat[ICE]+cnt->cat[CLEAR])/covered);
+}
+
+/*
+ * NAME:
+ * pixcount2psnow
+ *
+ * PURPOSE:
+ * To find the mean P(ice/snow) of the classified pixels in regime reg,
+ * -1 is returned if there are none.
+ */
+float pixcount2psnow(pixcountstr *cnt, int reg) {
+    int m, n;
+    long npix = 0;
+
+    for (m=0;m<FMSNOWMODES;m++) {
+	for (n=0;n<FMSNOWPIX_NWPMODES;n++) {
+	    npix += cnt->regime[FMSNOWPIX_OK][reg][m][n];
+	}
+    }
+    if (npix == 0) return(-1.);
+
+    return(cnt->psnow[reg]/npix);
+}
+
+static void countpix(pixcountstr *c, int ex, int reg, int mode, int usenwp) {
+
+    c->exits[ex]++;
+    c->regime[ex][reg][mode][usenwp]++;
+}
+
+static void countclass(pixcountstr *c, probstr *p, int cl, int ct, int reg) {
+
+    c->pclass[cl]++;
+    c->cat[ct]++;
+    c->psnow[reg] += p->pice;
+}
+
+/*
+ * The first column from xc in row yc to process, a multiple of stride
+ * within the spans of ls, or ls->iw if there is none. s is the span
+ * reached in the row, -1 at the start of the row. All columns are
+ * processed if ls is NULL.
+ */
+static int landpix(landspans *ls, int yc, int xc, int stride, int *s) {
+
+    if (!ls) return(xc);
+    if (*s < 0) *s = ls->row[yc];
+    for (; *s < ls->row[yc+1]; (*s)++) {
+	if (xc < ls->first[*s]) {
+	    xc = ((ls->first[*s]+stride-1)/stride)*stride;
+	}
+	if (xc <= ls->last[*s]) return(xc);
+    }
+
+    return(ls->iw);
+}
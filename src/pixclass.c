@@ -0,0 +1,112 @@
+/*
+ * NAME:
+ * pixclass
+ *
+ * PURPOSE:
+ * To bin the estimated probabilities of a pixel into the classes shown
+ * in the MITIFF images.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * Probabilities of the pixel.
+ *
+ * OUTPUT:
+ * Class of the pixel.
+ *
+ * NOTES:
+ * Used by process_pixels4ice and by fmsnowrender when the images are
+ * made from the HDF5 product afterwards, so both give the same classes.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+
+/*
+ * NAME:
+ * pice2class
+ *
+ * PURPOSE:
+ * To bin the ice probability into the classes used in the MITIFF
+ * product, 0 is unclassified and 1-20 are steps of 0.05.
+ */
+unsigned char pice2class(double pice) {
+
+    if (pice < 0.0) {
+	return(0);
+    } else if (pice < 0.05) {
+	return(1);
+    } else if (pice < 0.10) {
+	return(2);
+    } else if (pice < 0.15) {
+	return(3);
+    } else if (pice < 0.20) {
+	return(4);
+    } else if (pice < 0.25) {
+	return(5);
+    } else if (pice < 0.30) {
+	return(6);
+    } else if (pice < 0.35) {
+	return(7);
+    } else if (pice < 0.40) {
+	return(8);
+    } else if (pice < 0.45) {
+	return(9);
+    } else if (pice < 0.50) {
+	return(10);
+    } else if (pice < 0.55) {
+	return(11);
+    } else if (pice < 0.60) {
+	return(12);
+    } else if (pice < 0.65) {
+	return(13);
+    } else if (pice < 0.70) {
+	return(14);
+    } else if (pice < 0.75) {
+	return(15);
+    } else if (pice < 0.80) {
+	return(16);
+    } else if (pice < 0.85) {
+	return(17);
+    } else if (pice < 0.90) {
+	return(18);
+    } else if (pice < 0.95) {
+	return(19);
+    } else if (pice <= 1.0) {
+	return(20);
+    }
+
+    return(0);
+}
+
+/*
+ * NAME:
+ * probs2cat
+ *
+ * PURPOSE:
+ * To categorize the pixel in the class with highest probability.
+ */
+unsigned char probs2cat(probstr *p) {
+
+    if ((p->pice > p->pfree) && (p->pice > p->pcloud)) {
+	return(ICE);
+    } else if ((p->pfree > p->pice) && (p->pfree > p->pcloud)) {
+	return(CLEAR);
+    } else if ((p->pcloud > p->pice) && (p->pcloud > p->pfree)){
+	return(CLOUD);
+    }
+
+    return(UNCL); /*some probs. are equal*/
+}
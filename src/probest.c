@@ -52,6 +52,12 @@
  * coast on the first try. Perhaps tuning of FMSNOWSEA and FMSNOWLAND will
  * help. Adding SNOWSWITCH to easily test the effect of the 5th class.
  * MAK, METNO/FOU, 19.12.2011: DTLIM added.
+ * ystein Gody, METNO/FOU, 19.10.2026: The hand written products for each
+ * surface and channel combination are replaced by loops over the classes
+ * and features set up by buildstatcoeffs. SNOWSWITCH moved to statcoeffs.c
+ * where the default classes are defined.
+ * ystein Gody, METNO/FOU, 19.10.2026: Regime selection moved to
+ * lmask2regime.
  * 
  * CVS_ID:
  * $Id: probest.c,v 1.11 2013-02-01 10:37:06 mariak Exp $
@@ -63,228 +69,155 @@
 #include <string.h> 
 #include <fmsnowcover.h>
 
-#define SNOWSWITCH 0 /*0: no snow in "coast", 1: snow + ice in coast.  */
-
 #define DTLIM 0 /*Should perhaps be moved, but this decides wether
 		    dT-signature is used or not! 277 K, approx
 		    4celsius. DTLIM 273 used for OSI SAF. To easily
 		    remove this test, set DTLIM to 0!*/
 
+static int featvalue(short id, pinpstr *cpa, double a1, double *x);
+static double pdfvalue(featstr *ft, double x);
+
 /* #undef FMSNOWCOVER_HAVE_LIBUSENWP */
-int probest(pinpstr cpa, probstr *p, statcoeffstr cof) {
+int probest(pinpstr cpa, probstr *p, statcoeffstr *cof) {
+
+    int mode, reg, nf, k, j, c;
+    short fi[FMSNOWMAXFEATS];
+    double x[FMSNOWMAXFEATS];
+    double a1, lh, denomsum, psum[FMSNOWCOVER_OLEVELS];
+    featstr *par;
 
-    double r21, r3a1, r3b1;
-    double pa1gi, pr21gi, pr3a1gi, pdtgi, pr3b1gi;
-    double pa1gc, pr21gc, pr3a1gc, pdtgc, pr3b1gc;
-    double pa1gs, pr21gs, pr3a1gs, pdtgs, pr3b1gs;
-    double pa1gw, pr21gw, pr3a1gw, pdtgw, pr3b1gw;
-    double pa1gl, pr21gl, pr3a1gl, pdtgl, pr3b1gl;
-    double denomsum;
-    double pice=0.5, psnow=0.5, pcloud=0.5, pwater=0.5, pland=0.5;
-    
-    
     /*
-     * Specify conditional probabilities according to statistical results.
+     * Select channel mode and surface regime, the regime decides which
+     * classes are used: 
+     * sea - sea ice, water, cloud
+     * land - snow, land, cloud
+     * coast - ice, land, water, cloud (and snow if SNOWSWITCH is set)
+     * unless other classes are declared in the coefficient table.
      */
-    r21 = cpa.A2/cpa.A1;
-    if (cpa.daytime3b) {
-      r3b1 = cpa.A3b/(cpa.A1/cos(fmdeg2rad(cpa.soz)));
-    } else {
-      r3a1 = cpa.A3/cpa.A1; 
-    }
-
-    /*Later, if needing to cut proc.time: sort the calculations below
-      under the following categories, i.e.: only calculate those that
-      will actually be used*/
-    /* if (cpa.lmask <= FMSNOWSEA) { /\*use classes sea, sea ice, cloud*\/ */
-    /* } else if (cpa.lmask >= FMSNOWLAND) { /\*classes land, snow, cloud*\/ */
-    /* } else { /\*use classes land, sea, snow, sea ice, cloud*\/ */
-    /* } */
-
+    mode = (cpa.daytime3b) ? FMSNOWMODE3B : FMSNOWMODE3A;
+    reg = lmask2regime(cpa.lmask);
 
-    /*Ice and snow*/
-    pa1gi = findprob( cof.ice.a1, cpa.A1/cos(fmdeg2rad(cpa.soz)),"ice a1");
-    pa1gs = findprob( cof.snow.a1, cpa.A1/cos(fmdeg2rad(cpa.soz)),"snow a1");
-    pr21gi = findprob( cof.ice.r21, r21, "ice r21" );
-    pr21gs = findprob( cof.snow.r21, r21, "snow r21" );
-    if (cpa.daytime3b) {
-      pr3b1gi = findprob( cof.ice.r3b1, r3b1, "ice r3b1" );
-      pr3b1gs = findprob( cof.snow.r3b1, r3b1, "snow r3b1" );
-    } else {
-      pr3a1gi = findprob( cof.ice.r3a1, r3a1, "ice r3a1" );
-      pr3a1gs = findprob( cof.snow.r3a1, r3a1, "snow r3a1" );
-    }
-    pdtgi = findprob( cof.ice.dt, cpa.tdiff, "ice dt" );
-    pdtgs = findprob( cof.snow.dt, cpa.tdiff, "snow dt" );
-    
-    /*Clouds*/
-    pa1gc = findprob( cof.cloud.a1, cpa.A1/cos(fmdeg2rad(cpa.soz)),"cloud a1");
-    pr21gc = findprob( cof.cloud.r21, r21, "cloud r21" );
-    if (cpa.daytime3b) {
-	pr3b1gc = findprob( cof.cloud.r3b1, r3b1, "cloud r3b1" );
-    } else {
-	pr3a1gc = findprob( cof.cloud.r3a1, r3a1, "cloud r3a1" );
-    }
-    pdtgc = findprob( cof.cloud.dt, cpa.tdiff, "cloud dt");
-
-    /*Land and water*/
-    pa1gl=findprob( cof.land.a1, cpa.A1/cos(fmdeg2rad(cpa.soz)),"land a1");
-    pa1gw=findprob( cof.water.a1, cpa.A1/cos(fmdeg2rad(cpa.soz)),"water a1");
-    pr21gl = findprob( cof.land.r21, r21, "land r21" );
-    pr21gw = findprob( cof.water.r21, r21, "water r21" );
-    if (cpa.daytime3b) {
-      pr3b1gl = findprob( cof.land.r3b1, r3b1, "land r3b1");
-      pr3b1gw = findprob( cof.water.r3b1, r3b1, "water r3b1");
-    } else {
-      pr3a1gl = findprob( cof.land.r3a1, r3a1, "land r3a1" );
-      pr3a1gw = findprob( cof.water.r3a1, r3a1, "water r3a1" );
+    /*
+     * Estimate the features used for this pixel, features that can not
+     * be used (e.g. dt without NWP data) are left out which is the same
+     * as setting their conditional probabilities to 1.
+     */
+    a1 = cpa.A1/cos(fmdeg2rad(cpa.soz));
+    nf = 0;
+    for (k=0;k<cof->nuse[mode];k++) {
+	if (featvalue(cof->feat[cof->use[mode][k]].id, &cpa, a1, &x[nf])) {
+	    continue;
+	}
+	fi[nf++] = cof->use[mode][k];
     }
-    pdtgl = findprob( cof.land.dt, cpa.tdiff, "land dt" );
-    pdtgw = findprob( cof.water.dt, cpa.tdiff,"water dt" );
-    
 
     /*
-     * Use Bayes theorem and estimate probability for ice.
+     * Use Bayes theorem and estimate the probability of each class, the
+     * classes are summed into the output levels they belong to.
      */
-    /*
-    picegobs = (pr21gi*pr31gi*pa1gi*pdtgi*pice)/
-	((pr21gi*pr31gi*pa1gi*pdtgi*pice)
-	 +(pr21gw*pr31gw*pa1gw*pdtgw*pwater)
-	 +(pr21gc*pr31gc*pa1gc*pdtgc*pcloud));
-    */
-
-    /*if (cpa.tdiff == NULL) {*/
-    if (cpa.tdiff == 0) {
-      pdtgi = pdtgs = pdtgc = pdtgl = pdtgw = 1.;
+    psum[0] = psum[1] = psum[2] = 0.;
+    denomsum = 0.;
+    for (k=0;k<cof->nact[reg];k++) {
+	c = cof->act[reg][k];
+	par = cof->par[c];
+	lh = cof->cls[c].prior;
+	for (j=0;j<nf;j++) {
+	    lh *= pdfvalue(&par[fi[j]], x[j]);
+	}
+	psum[cof->cls[c].output] += lh;
+	denomsum += lh;
     }
 
-    /*the pdtgX-test can fail over ice/snow and should only? be used when a positive model temperature. Fails over Greenland, but is needed over Norway..  Tdiff = T_model - T_4*/
-    if(cpa.tdiff + cpa.T4 < DTLIM) {
-      pdtgi  = pdtgs  = pdtgc  = pdtgl  = pdtgw  = 1.;
-    }
+    p->pice = psum[0]/denomsum;
+    p->pfree = psum[1]/denomsum;
+    p->pcloud = psum[2]/denomsum;
+	
+    return(FM_OK);
+}
 
+/*
+ * NAME:
+ * lmask2regime
+ *
+ * PURPOSE:
+ * To find the surface regime from the land/sea mask value.
+ */
+int lmask2regime(short lmask) {
 
-    /*Used to easily remove signatures when testing*/
-    /*pa1gi  = pa1gs  = pa1gc  = pa1gl  = pa1gw  = 1.;*/
-    /*pr21gi = pr21gs = pr21gc = pr21gl = pr21gw = 1.;*/
-    /*pr3b1gi= pr3b1gs= pr3b1gc= pr3b1gl= pr3b1gw= 1.;*/
-    /*pr3a1gi= pr3a1gs= pr3a1gc= pr3a1gl= pr3a1gw= 1.;*/
-    /*pdtgi  = pdtgs  = pdtgc  = pdtgl  = pdtgw  = 1.;*/
+    if (lmask <= FMSNOWSEA) {
+	return(FMSNOWREGSEA);
+    } else if (lmask >= FMSNOWLAND) {
+	return(FMSNOWREGLAND);
+    }
 
-    if (cpa.lmask <= FMSNOWSEA) { /*Water: use classes sea ice/water/cloud*/
-      if (cpa.daytime3b) {
-	denomsum = (pr21gi*pr3b1gi*pa1gi*pdtgi*pice)
-	          +(pr21gw*pr3b1gw*pa1gw*pdtgw*pwater)
-	          +(pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud);
-	p->pice = (pr21gi*pr3b1gi*pa1gi*pdtgi*pice)/denomsum;
-	p->pfree =(pr21gw*pr3b1gw*pa1gw*pdtgw*pwater)/denomsum;
-	p->pcloud=(pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud)/denomsum;
-      } else {
-	denomsum = (pr21gi*pr3a1gi*pa1gi*pdtgi*pice)
-	  	  +(pr21gw*pr3a1gw*pa1gw*pdtgw*pwater)
-	          +(pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud);
-	p->pice = (pr21gi*pr3a1gi*pa1gi*pdtgi*pice)/denomsum;
-	p->pfree =(pr21gw*pr3a1gw*pa1gw*pdtgw*pwater)/denomsum;
-	p->pcloud=(pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud)/denomsum;
-      }
-    } else if (cpa.lmask >= FMSNOWLAND) { /*Land: use classes snow/land/cloud*/
-      if (cpa.daytime3b) {
-	denomsum = (pr21gs*pr3b1gs*pa1gs*pdtgs*psnow)
-	          +(pr21gl*pr3b1gl*pa1gl*pdtgl*pland)
-	    	  +(pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud);
-	p->pice = (pr21gs*pr3b1gs*pa1gs*pdtgs*psnow)/denomsum;
-	p->pfree =(pr21gl*pr3b1gl*pa1gl*pdtgl*pland)/denomsum;
-	p->pcloud=(pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud)/denomsum;
-      } else {
-	denomsum = (pr21gs*pr3a1gs*pa1gs*pdtgs*psnow)
-	          +(pr21gl*pr3a1gl*pa1gl*pdtgl*pland)
-	          +(pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud);
-	p->pice = (pr21gs*pr3a1gs*pa1gs*pdtgs*psnow)/denomsum;
-	p->pfree =(pr21gl*pr3a1gl*pa1gl*pdtgl*pland)/denomsum;
-	p->pcloud=(pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud)/denomsum;
-      }
-    } else { /*Coast: use classes ice/land/snow/cloud/water*/
- 
-     if (cpa.daytime3b) {
-	denomsum = (pr21gi*pr3b1gi*pa1gi*pdtgi*pice)
-	  +(pr21gs*pr3b1gs*pa1gs*pdtgs*psnow)*SNOWSWITCH
-	  +(pr21gl*pr3b1gl*pa1gl*pdtgl*pland)
-	  +(pr21gw*pr3b1gw*pa1gw*pdtgw*pwater)
-	  +(pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud);
-	p->pice = ((pr21gi*pr3b1gi*pa1gi*pdtgi*pice)
-		   +(pr21gs*pr3b1gs*pa1gs*pdtgs*psnow)*SNOWSWITCH)/denomsum;
-	p->pfree =((pr21gl*pr3b1gl*pa1gl*pdtgl*pland)
-		   +(pr21gw*pr3b1gw*pa1gw*pdtgw*pwater))/denomsum;
-	p->pcloud = (pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud)/denomsum;
-      } else {
-	denomsum = (pr21gi*pr3a1gi*pa1gi*pdtgi*pice)
-	  +(pr21gs*pr3a1gs*pa1gs*pdtgs*psnow)*SNOWSWITCH
-	  +(pr21gl*pr3a1gl*pa1gl*pdtgl*pland)
-	  +(pr21gw*pr3a1gw*pa1gw*pdtgw*pwater)
-	  +(pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud);
-	p->pice = ((pr21gi*pr3a1gi*pa1gi*pdtgi*pice)
-		   +(pr21gs*pr3a1gs*pa1gs*pdtgs*psnow)*SNOWSWITCH)/denomsum;
-	p->pfree =((pr21gl*pr3a1gl*pa1gl*pdtgl*pland)
-		   +(pr21gw*pr3a1gw*pa1gw*pdtgw*pwater))/denomsum;
-	p->pcloud = (pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud)/denomsum;
-     }
+    return(FMSNOWREGCOAST);
+}
 
-     /*  if (cpa.daytime3b) { /\*tester igjen 5 klasser i kystsoner*\/ */
-/*        denomsum = (pr21gs*pr3b1gs*pa1gs*pdtgs*psnow) */
-/* 	  +(pr21gi*pr3b1gi*pa1gi*pdtgi*pice) */
-/* 	  +(pr21gl*pr3b1gl*pa1gl*pdtgl*pland) */
-/* 	  +(pr21gw*pr3b1gw*pa1gw*pdtgw*pwater) */
-/* 	  +(pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud); */
-/*         p->pice =((pr21gi*pr3b1gi*pa1gi*pdtgi*pice) */
-/* 		  +(pr21gs*pr3b1gs*pa1gs*pdtgs*psnow))/denomsum; */
-/* 	p->pfree =((pr21gl*pr3b1gl*pa1gl*pdtgl*pland) */
-/* 		   +(pr21gw*pr3b1gw*pa1gw*pdtgw*pwater))/denomsum; */
-/* 	p->pcloud = (pr21gc*pr3b1gc*pa1gc*pdtgc*pcloud)/denomsum; */
-/*       } else { */
-/* 	denomsum = (pr21gs*pr3a1gs*pa1gs*pdtgs*psnow) */
-/* 	  +(pr21gi*pr3a1gi*pa1gi*pdtgi*pice) */
-/* 	  +(pr21gl*pr3a1gl*pa1gl*pdtgl*pland) */
-/* 	  +(pr21gw*pr3a1gw*pa1gw*pdtgw*pwater) */
-/* 	  +(pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud); */
-/* 	p->pice =((pr21gi*pr3a1gi*pa1gi*pdtgi*pice) */
-/* 		  +(pr21gs*pr3a1gs*pa1gs*pdtgs*psnow))/denomsum; */
-/* 	p->pfree =((pr21gl*pr3a1gl*pa1gl*pdtgl*pland) */
-/* 		   +(pr21gw*pr3a1gw*pa1gw*pdtgw*pwater))/denomsum; */
-/* 	p->pcloud = (pr21gc*pr3a1gc*pa1gc*pdtgc*pcloud)/denomsum; */
-/*      } */
+/*
+ * NAME:
+ * featvalue
+ *
+ * PURPOSE:
+ * To estimate the value of a feature for the pixel. a1 is the
+ * reflectance of channel 1 corrected for solar zenith angle.
+ *
+ * RETURN VALUES:
+ * 0 if the feature is estimated, 1 if it should not be used.
+ */
+static int featvalue(short id, pinpstr *cpa, double a1, double *x) {
 
+    switch (id) {
+	case FMSNOWFEAT_A1:
+	    *x = a1;
+	    break;
+	case FMSNOWFEAT_R21:
+	    *x = cpa->A2/cpa->A1;
+	    break;
+	case FMSNOWFEAT_R3A1:
+	    *x = cpa->A3/cpa->A1;
+	    break;
+	case FMSNOWFEAT_R3B1:
+	    *x = cpa->A3b/a1;
+	    break;
+	case FMSNOWFEAT_DT:
+	    /*
+	     * dt is not available without NWP data. The dt-test can fail
+	     * over ice/snow and should only? be used when a positive model
+	     * temperature. Fails over Greenland, but is needed over
+	     * Norway..  Tdiff = T_model - T_4
+	     */
+	    if (cpa->tdiff == 0 || cpa->tdiff + cpa->T4 < DTLIM) return(1);
+	    *x = cpa->tdiff;
+	    break;
+	case FMSNOWFEAT_T45:
+	    *x = cpa->T4-cpa->T5;
+	    break;
+	default:
+	    return(1);
     }
 
-    /*
-     * Remove ice from areas obviously open water. This could generate
-     * noise over melt ponds and during spring season, but not
-     * necessarily...
-     */
-    /*
-    if ((cpa.T4 > 276.15) || (cpa.T4-cpa.T5 > 2.0) || (cpa.tdiff > 5.)) {
-    picegobs = 0.;
-    }
-    */
-    /*
-    if ((cpa.T4-cpa.T5 > 2.0)) picegobs = 0.;
-    */
-    
-    /*
-    pigr21 = (pr21gi*pice)/
-	((pr21gi*pice)
-	 +(pr21gw*pwater)
-	 +(pr21gc*pcloud));
+    return(0);
+}
 
-    pigr31 = (pr31gi*pice)/
-	((pr31gi*pice)
-	 +(pr31gw*pwater)
-	 +(pr31gc*pcloud));
+/*
+ * NAME:
+ * pdfvalue
+ *
+ * PURPOSE:
+ * Evaluates the pdf using the normalisation terms precomputed by
+ * buildstatcoeffs. Gives the same as normalpdf and gammapdf, except
+ * that the Gamma distribution is 0 (not negative) for x <= 0.
+ */
+static double pdfvalue(featstr *ft, double x) {
+    double d;
 
-    picegobs = pigr21*pigr31;
-    picegobs = pigr31;
-    */
-	
-    return(FM_OK);
+    if (ft->key == 'n') {
+	d = x-ft->par1;
+	return(ft->c0*exp(-d*d*ft->c1));
+    }
+    if (x <= 0) return(0.);
+
+    return(exp(ft->c0+(ft->par1-1.)*log(x)-x*ft->c1));
 }
 
 /*
@@ -305,29 +238,29 @@ int probest(pinpstr cpa, probstr *p, statcoeffstr cof) {
  * OUTPUT:
  * o the probability
  */
-double findprob(featstr feat, double x, char *whereami) {
+double findprob(featstr *feat, double x, char *whereami) {
   double pdf;
   char *where="findpdf";
   char what[FMSNOWCOVER_MSGLENGTH];
   int errflg;
   errflg = 0;
   
-  if (!feat.count) {
+  if (!feat->count) {
     sprintf(what,"Stat. coefficients have not been read for %s",whereami);
     errflg++;
   }
 
-  else if (feat.count == 1){
-    if (feat.key == 'n') pdf = normalpdf(feat.par1, feat.par2, x);
-    else if (feat.key == 'g') pdf = gammapdf(feat.par1, feat.par2, x);
-    /*else if (feat.key == 't') pdf = gammapdf3par(feat.par1,feat.par2,feat.par3,x);*/
+  else if (feat->count == 1){
+    if (feat->key == 'n') pdf = normalpdf(feat->par1, feat->par2, x);
+    else if (feat->key == 'g') pdf = gammapdf(feat->par1, feat->par2, x);
+    /*else if (feat->key == 't') pdf = gammapdf3par(feat->par1,feat->par2,feat->par3,x);*/
     else {
       sprintf(what,"Could not recognize pdf routine key for %s",whereami);
       errflg++;
     }
   }
 
-  else if (feat.count > 1) {
+  else if (feat->count > 1) {
       sprintf(what,"Stat. coefficients for %s are read more than once\n",
 	      whereami);
       errflg++;
@@ -0,0 +1,227 @@
+/*
+ * NAME:
+ * roi
+ *
+ * PURPOSE:
+ * To restrict fmsnowcover to a region of interest within the tile, e.g.
+ * a catchment, given as a pixel window or as a latitude/longitude box.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Region of interest from the command line.
+ * o Image and land/sea mask of the full tile.
+ *
+ * OUTPUT:
+ * Image and land/sea mask cut to the window, the position of the upper
+ * left corner (Bx, By) is moved to the first pixel of the window.
+ *
+ * NOTES:
+ * A latitude/longitude box is converted to the smallest pixel window
+ * containing points sampled along its edges, as the box is not a
+ * rectangle in the tile projection. The window is clipped to the tile.
+ *
+ * The position of pixel (col,row) is Bx+col*Ax, By-row*Ay as in
+ * fmind2ucs.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+
+#define ROI_EDGESAMPLES 16
+
+static int cropplane(void **data, size_t elsize, int iw, fmsnowroi *roi);
+
+/*
+ * NAME:
+ * fmsnowroi_parse
+ *
+ * PURPOSE:
+ * To decode col0,row0,col1,row1 (FMSNOWROI_PIXEL, first and last pixel)
+ * or latmin,lonmin,latmax,lonmax (FMSNOWROI_GEO).
+ */
+int fmsnowroi_parse(char *arg, int type, fmsnowroi *roi) {
+
+    memset(roi,0,sizeof(fmsnowroi));
+    if (sscanf(arg,"%lf,%lf,%lf,%lf",
+		&roi->v[0],&roi->v[1],&roi->v[2],&roi->v[3]) != 4) {
+	return(FM_SYNTAX_ERR);
+    }
+    if (roi->v[2] < roi->v[0] || roi->v[3] < roi->v[1]) {
+	return(FM_SYNTAX_ERR);
+    }
+    roi->type = type;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowroi_window
+ *
+ * PURPOSE:
+ * To find the pixel window of the region within the tile described by
+ * ref.
+ *
+ * RETURN VALUES:
+ * FM_OK - window found
+ * FM_VAROUTOFSCOPE_ERR - region is outside the tile
+ */
+int fmsnowroi_window(fmsnowroi *roi, fmucsref ref) {
+
+    int i, k;
+    double col0, row0, col1, row1, col, row, f;
+    fmgeopos geop;
+    fmucspos pos;
+
+    if (roi->type == FMSNOWROI_PIXEL) {
+	col0 = roi->v[0];
+	row0 = roi->v[1];
+	col1 = roi->v[2];
+	row1 = roi->v[3];
+    } else if (roi->type == FMSNOWROI_GEO) {
+	col0 = row0 = 1e9;
+	col1 = row1 = -1e9;
+	for (k=0;k<4;k++) {
+	    for (i=0;i<=ROI_EDGESAMPLES;i++) {
+		f = (double) i/ROI_EDGESAMPLES;
+		geop.lat = (k < 2) ? roi->v[2*k] : roi->v[0]+f*(roi->v[2]-roi->v[0]);
+		geop.lon = (k < 2) ? roi->v[1]+f*(roi->v[3]-roi->v[1]) : roi->v[2*k-3];
+		pos = fmgeo2ucs(geop, MI);
+		col = (pos.eastings-ref.Bx)/ref.Ax;
+		row = (ref.By-pos.northings)/ref.Ay;
+		if (col < col0) col0 = col;
+		if (col > col1) col1 = col;
+		if (row < row0) row0 = row;
+		if (row > row1) row1 = row;
+	    }
+	}
+	col0 = floor(col0);
+	row0 = floor(row0);
+	col1 = ceil(col1);
+	row1 = ceil(row1);
+    } else {
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+
+    if (col0 < 0) col0 = 0;
+    if (row0 < 0) row0 = 0;
+    if (col1 > ref.iw-1) col1 = ref.iw-1;
+    if (row1 > ref.ih-1) row1 = ref.ih-1;
+    if (col1 < col0 || row1 < row0) return(FM_VAROUTOFSCOPE_ERR);
+
+    roi->col0 = (int) col0;
+    roi->row0 = (int) row0;
+    roi->iw = (int) col1-roi->col0+1;
+    roi->ih = (int) row1-roi->row0+1;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowroi_cropimg
+ *
+ * PURPOSE:
+ * To cut the channels of img to the window found by fmsnowroi_window.
+ */
+int fmsnowroi_cropimg(fmio_img *img, fmsnowroi *roi) {
+
+    int i;
+
+    for (i=0;i<FMIO_MAXCHANNELS;i++) {
+	if (!img->image[i]) continue;
+	if (cropplane((void **) &img->image[i], sizeof(unsigned char),
+		    img->iw, roi)) {
+	    return(FM_MEMALL_ERR);
+	}
+    }
+    img->Bx += roi->col0*img->Ax;
+    img->By -= roi->row0*img->Ay;
+    img->iw = roi->iw;
+    img->ih = roi->ih;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowroi_cropprod
+ *
+ * PURPOSE:
+ * To cut the layers of a product (the land/sea mask) to the window. The
+ * product must cover the full tile.
+ */
+int fmsnowroi_cropprod(osihdf *p, fmsnowroi *roi) {
+
+    int i;
+    size_t elsize;
+
+    for (i=0;i<p->h.z;i++) {
+	switch (p->d[i].type) {
+	    case OSI_UCHAR:
+	    case OSI_CHAR:
+		elsize = sizeof(char);
+		break;
+	    case OSI_USHORT:
+	    case OSI_SHORT:
+		elsize = sizeof(short);
+		break;
+	    case OSI_UINT:
+	    case OSI_INT:
+		elsize = sizeof(int);
+		break;
+	    case OSI_FLOAT:
+		elsize = sizeof(float);
+		break;
+	    case OSI_DOUBLE:
+		elsize = sizeof(double);
+		break;
+	    default:
+		return(FM_VAROUTOFSCOPE_ERR);
+	}
+	if (cropplane(&p->d[i].data, elsize, p->h.iw, roi)) {
+	    return(FM_MEMALL_ERR);
+	}
+    }
+    p->h.Bx += roi->col0*p->h.Ax;
+    p->h.By -= roi->row0*p->h.Ay;
+    p->h.iw = roi->iw;
+    p->h.ih = roi->ih;
+
+    return(FM_OK);
+}
+
+/*
+ * Replace a plane of width iw by the window, the full plane is freed.
+ */
+static int cropplane(void **data, size_t elsize, int iw, fmsnowroi *roi) {
+
+    char *win, *src;
+    int row;
+
+    win = (char *) malloc((size_t) roi->iw*roi->ih*elsize);
+    if (!win) return(FM_MEMALL_ERR);
+    src = (char *) *data;
+    for (row=0;row<roi->ih;row++) {
+	memcpy(win+(size_t) row*roi->iw*elsize,
+		src+((size_t) (roi->row0+row)*iw+roi->col0)*elsize,
+		(size_t) roi->iw*elsize);
+    }
+    free(*data);
+    *data = win;
+
+    return(FM_OK);
+}
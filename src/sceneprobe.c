@@ -0,0 +1,216 @@
+/*
+ * NAME:
+ * sceneprobe
+ *
+ * PURPOSE:
+ * To find the tile, satellite, time and coverage of an input scene from
+ * the file name and header only, so that scenes which would be rejected
+ * are not read in full.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Input file name, with and without path.
+ * o Time window the scene must be within (optional).
+ *
+ * OUTPUT:
+ * fmsnowprobe with the header information and whether the scene should
+ * be processed.
+ *
+ * NOTES:
+ * The tile is taken from the last component of the file name before the
+ * extension, e.g. ns in noaa19_20260310_1027.ns.aha. If this is not a
+ * known tile the name is searched for the tile names in the order used
+ * before, so that old file names are handled as earlier.
+ *
+ * fm_readheader does not allocate the image planes. Input may be HDF5,
+ * the caller must hold the HDF5 lock of fmsnowwriter if products are
+ * written at the same time.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Added fmsnowprobe_header for scenes
+ * read from a stream.
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+
+typedef struct {
+    char *token; /* in the file name */
+    char *area; /* in product names */
+    char *lmtile; /* of the land/sea mask */
+    int anycover; /* processed whatever the coverage */
+} sceneprobetile;
+
+static sceneprobetile probetiles[] = {
+    {"ns", "ns", "dnns", 0},
+    {"at", "at", "dnat", 0},
+    {"nr", "nr", "dnnr", 0},
+    {"gr", "gr", "dngr", 0},
+    {"NoA", "noa", "dnnoa", 1},
+    {NULL, NULL, NULL, 0}
+};
+
+static char *probestatus[] = {
+    "ok", "notile", "unreadable", "lowcover", "outside"
+};
+
+static sceneprobetile *probetile(char *fname);
+static void probedecide(sceneprobetile *t, fmsec1970 stime,
+	fmsec1970 etime, fmsnowprobe *pr);
+
+/*
+ * NAME:
+ * fmsnowprobe_scene
+ *
+ * PURPOSE:
+ * To read the header of a scene and decide whether it is to be
+ * processed. Scenes outside stime to etime are rejected if etime is
+ * not 0.
+ *
+ * RETURN VALUES:
+ * The result is given in pr->status, FM_OK is returned.
+ */
+int fmsnowprobe_scene(char *infile, char *fname, fmsec1970 stime,
+	fmsec1970 etime, fmsnowprobe *pr) {
+
+    sceneprobetile *t;
+    fmio_img img;
+    fmtime reftime;
+
+    memset(pr,0,sizeof(fmsnowprobe));
+    t = probetile(fname);
+    if (!t) {
+	pr->status = FMSNOWPROBE_NOTILE;
+	return(FM_OK);
+    }
+    sprintf(pr->area,"%s",t->area);
+    sprintf(pr->lmtile,"%s",t->lmtile);
+
+    fm_init_fmio_img(&img);
+    if (fm_readheader(infile, &img)) {
+	pr->status = FMSNOWPROBE_UNREADABLE;
+	return(FM_OK);
+    }
+    snprintf(pr->sa,sizeof(pr->sa),"%s",img.sa);
+    fm_img2fmtime(img,&reftime);
+    pr->time = tofmsec1970(reftime);
+    pr->cover = img.cover;
+    pr->iw = img.iw;
+    pr->ih = img.ih;
+    fm_clear_fmio_img(&img);
+
+    probedecide(t, stime, etime, pr);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowprobe_header
+ *
+ * PURPOSE:
+ * To decide whether a scene read from a stream is to be processed, as
+ * fmsnowprobe_scene does for files. tile is given as in file names.
+ *
+ * RETURN VALUES:
+ * The result is given in pr->status, FM_OK is returned.
+ */
+int fmsnowprobe_header(char *tile, char *sa, fmsec1970 reftime, float cover,
+	unsigned int iw, unsigned int ih, fmsec1970 stime, fmsec1970 etime,
+	fmsnowprobe *pr) {
+
+    sceneprobetile *t = NULL;
+    int i;
+
+    memset(pr,0,sizeof(fmsnowprobe));
+    for (i=0;probetiles[i].token;i++) {
+	if (strcmp(tile,probetiles[i].token) == 0) t = &probetiles[i];
+    }
+    if (!t) t = probetile(tile);
+    if (!t) {
+	pr->status = FMSNOWPROBE_NOTILE;
+	return(FM_OK);
+    }
+    sprintf(pr->area,"%s",t->area);
+    sprintf(pr->lmtile,"%s",t->lmtile);
+    snprintf(pr->sa,sizeof(pr->sa),"%s",sa);
+    pr->time = reftime;
+    pr->cover = cover;
+    pr->iw = iw;
+    pr->ih = ih;
+
+    probedecide(t, stime, etime, pr);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowprobe_status
+ *
+ * PURPOSE:
+ * To give the name of a probe status, as used in the listing of
+ * fmsnowcover -l.
+ */
+char *fmsnowprobe_status(int status) {
+
+    if (status < 0 || status > FMSNOWPROBE_OUTSIDE) return("unknown");
+
+    return(probestatus[status]);
+}
+
+static void probedecide(sceneprobetile *t, fmsec1970 stime,
+	fmsec1970 etime, fmsnowprobe *pr) {
+
+    if (!t->anycover && pr->cover < FMSNOWCOVER_MINCOVER) {
+	pr->status = FMSNOWPROBE_LOWCOVER;
+    } else if (etime > 0 && (pr->time < stime || pr->time > etime)) {
+	pr->status = FMSNOWPROBE_OUTSIDE;
+    } else {
+	pr->status = FMSNOWPROBE_OK;
+    }
+}
+
+static sceneprobetile *probetile(char *fname) {
+
+    char token[FILENAME];
+    char *base, *end, *start;
+    int i;
+
+    base = strrchr(fname,'/');
+    base = base ? base+1 : fname;
+
+    /*
+     * Last component before the extension.
+     */
+    end = strrchr(base,'.');
+    if (end) {
+	for (start=end;start>base;start--) {
+	    if (*(start-1) == '.' || *(start-1) == '_') break;
+	}
+	if (end-start < FILENAME) {
+	    snprintf(token,FILENAME,"%.*s",(int) (end-start),start);
+	    for (i=0;probetiles[i].token;i++) {
+		if (strcmp(token,probetiles[i].token) == 0) {
+		    return(&probetiles[i]);
+		}
+	    }
+	}
+    }
+
+    for (i=0;probetiles[i].token;i++) {
+	if (strstr(base,probetiles[i].token)) return(&probetiles[i]);
+    }
+
+    return(NULL);
+}
@@ -0,0 +1,320 @@
+/*
+ * NAME:
+ * scenestream
+ *
+ * PURPOSE:
+ * To read scenes given to fmsnowcover on stdin or through a named pipe,
+ * and write products to stdout, so that fmsnowcover can be used in a
+ * pipeline without input and product files.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Stream of scene frames.
+ *
+ * OUTPUT:
+ * o Scene with calibrated channels.
+ * o Stream of product frames.
+ *
+ * NOTES:
+ * A scene frame is a text header followed by the channel data:
+ *
+ *   FMSNOWSCENE 1
+ *   satellite noaa19
+ *   time 202603101027
+ *   tile ns
+ *   size <iw> <ih>
+ *   ucs <Ax> <Ay> <Bx> <By>
+ *   cover <percent>
+ *   data float32|uint8
+ *   calib <channel> <gain> <offset>
+ *   strip <rows>
+ *   END
+ *
+ * satellite, time, tile, size and ucs are required. tile is given as in
+ * input file names, the UCS as in the products (km, upper left corner).
+ * cover is the valid data coverage of the tile (default 100). The
+ * channels follow in the order A1 A2 T3 T4 T5 A3, in native byte order.
+ * float32 data (the default) are calibrated reflectance (%) and
+ * brightness temperature (K). Values are calibrated as gain*v+offset
+ * if calib is given for the channel (A1...A3), uint8 data are counts
+ * and need calib for every channel used. 0 is missing in all cases and
+ * is kept. Without strip each channel is given as a whole plane, with
+ * strip the image is sent in strips of that many rows (the last may be
+ * shorter) holding all channels, so that a preprocessing chain can send
+ * rows as they are made. Channels with all values missing must still be
+ * sent.
+ *
+ * A product frame has the header FMSNOWPRODUCT 1 with satellite, time,
+ * tile, size, ucs, cover and cloudfree as above, then END, followed by
+ * P(ice/snow), P(water/land) and P(cloud) as float32 planes and the
+ * classes and categories of the MITIFF images as uint8 planes. Missing
+ * values are those of the HDF5 products.
+ *
+ * Frames follow each other directly, the stream ends when no new frame
+ * is started.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <fmsnowstream.h>
+
+static char *streamchannels[FMSNOWLIB_CHANNELS] = {
+    "A1", "A2", "T3", "T4", "T5", "A3"
+};
+
+static int streamline(FILE *fp, char *line);
+static int streamvalues(FILE *fp, fmsnowstreamscene *ss, int k,
+	unsigned char *buf, int start, int n);
+
+/*
+ * NAME:
+ * fmsnowstream_read
+ *
+ * PURPOSE:
+ * To read the next scene of the stream, the planes are allocated and
+ * must be freed by fmsnowstream_free.
+ *
+ * RETURN VALUES:
+ * FM_OK - scene read
+ * FMSNOWSTREAM_END - end of stream
+ * FM_IO_ERR - stream could not be read or is not valid
+ */
+int fmsnowstream_read(FILE *fp, fmsnowstreamscene *ss) {
+
+    char *where="fmsnowstream_read";
+    char line[FMSNOWSTREAM_LINELEN], key[FMSNOWSTREAM_LINELEN];
+    char val[FMSNOWSTREAM_LINELEN];
+    int k, n, row, rows, size, ret, havetime = 0;
+    float gain, offset;
+    unsigned char *buf = NULL;
+
+    memset(ss,0,sizeof(fmsnowstreamscene));
+    ss->bytes = FMSNOWSTREAM_FLOAT32;
+    ss->cover = 100.;
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) {
+	ss->gain[k] = 1.;
+	ss->offset[k] = 0.;
+    }
+
+    /*
+     * A frame is started by its first line, anything else is an error.
+     */
+    do {
+	if (!fgets(line,FMSNOWSTREAM_LINELEN,fp)) {
+	    if (ferror(fp)) {
+		fmerrmsg(where,"Could not read stream");
+		return(FM_IO_ERR);
+	    }
+	    return(FMSNOWSTREAM_END);
+	}
+    } while (sscanf(line,"%s",key) != 1);
+    if (strcmp(key,"FMSNOWSCENE") != 0) {
+	fmerrmsg(where,"Stream is not at the start of a scene");
+	return(FM_IO_ERR);
+    }
+
+    while (1) {
+	if (streamline(fp, line)) {
+	    fmerrmsg(where,"Stream ended in a scene header");
+	    return(FM_IO_ERR);
+	}
+	if (sscanf(line,"%s",key) != 1) continue;
+	if (strcmp(key,"END") == 0) break;
+	ret = 0;
+	if (strcmp(key,"satellite") == 0) {
+	    ret = (sscanf(line,"%*s %31s",ss->sa) != 1);
+	} else if (strcmp(key,"time") == 0) {
+	    memset(&ss->time,0,sizeof(fmtime));
+	    ret = (sscanf(line,"%*s %4d%2d%2d%2d%2d",&ss->time.fm_year,
+			&ss->time.fm_mon,&ss->time.fm_mday,&ss->time.fm_hour,
+			&ss->time.fm_min) != 5);
+	    havetime = !ret;
+	} else if (strcmp(key,"tile") == 0) {
+	    ret = (sscanf(line,"%*s %15s",ss->tile) != 1);
+	} else if (strcmp(key,"size") == 0) {
+	    ret = (sscanf(line,"%*s %d %d",&ss->ref.iw,&ss->ref.ih) != 2);
+	} else if (strcmp(key,"ucs") == 0) {
+	    ret = (sscanf(line,"%*s %f %f %f %f",&ss->ref.Ax,&ss->ref.Ay,
+			&ss->ref.Bx,&ss->ref.By) != 4);
+	} else if (strcmp(key,"cover") == 0) {
+	    ret = (sscanf(line,"%*s %f",&ss->cover) != 1);
+	} else if (strcmp(key,"strip") == 0) {
+	    ret = (sscanf(line,"%*s %d",&ss->strip) != 1 || ss->strip < 0);
+	} else if (strcmp(key,"data") == 0) {
+	    ret = (sscanf(line,"%*s %s",val) != 1);
+	    if (!ret && strcmp(val,"float32") == 0) {
+		ss->bytes = FMSNOWSTREAM_FLOAT32;
+	    } else if (!ret && strcmp(val,"uint8") == 0) {
+		ss->bytes = FMSNOWSTREAM_UINT8;
+	    } else {
+		ret = 1;
+	    }
+	} else if (strcmp(key,"calib") == 0) {
+	    ret = (sscanf(line,"%*s %s %f %f",val,&gain,&offset) != 3);
+	    for (k=0;!ret && k<FMSNOWLIB_CHANNELS;k++) {
+		if (strcmp(val,streamchannels[k]) == 0) break;
+	    }
+	    if (k == FMSNOWLIB_CHANNELS) ret = 1;
+	    if (!ret) {
+		ss->gain[k] = gain;
+		ss->offset[k] = offset;
+	    }
+	} else {
+	    fmlogmsg(where,"Unknown scene header line ignored: %s", key);
+	}
+	if (ret) {
+	    fmerrmsg(where,"Could not decode scene header line %s", key);
+	    return(FM_IO_ERR);
+	}
+    }
+    if (strlen(ss->sa) == 0 || strlen(ss->tile) == 0 || !havetime ||
+	    ss->ref.iw <= 0 || ss->ref.ih <= 0 ||
+	    ss->ref.Ax <= 0. || ss->ref.Ay <= 0.) {
+	fmerrmsg(where,"Scene header is not complete");
+	return(FM_IO_ERR);
+    }
+
+    /*
+     * Channel data, as whole planes or in strips.
+     */
+    size = ss->ref.iw*ss->ref.ih;
+    rows = (ss->strip > 0 && ss->strip < ss->ref.ih) ?
+	ss->strip : ss->ref.ih;
+    if (ss->bytes == FMSNOWSTREAM_UINT8) {
+	buf = (unsigned char *) malloc(rows*ss->ref.iw);
+    }
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) {
+	ss->ch[k] = (float *) malloc(size*sizeof(float));
+	if (!ss->ch[k]) break;
+    }
+    if (k < FMSNOWLIB_CHANNELS || (ss->bytes == FMSNOWSTREAM_UINT8 && !buf)) {
+	fmerrmsg(where,"Could not allocate scene of %dx%d",
+		ss->ref.iw, ss->ref.ih);
+	if (buf) free(buf);
+	fmsnowstream_free(ss);
+	return(FM_MEMALL_ERR);
+    }
+    for (row=0;row<ss->ref.ih;row+=rows) {
+	n = (row+rows > ss->ref.ih) ? ss->ref.ih-row : rows;
+	for (k=0;k<FMSNOWLIB_CHANNELS;k++) {
+	    if (streamvalues(fp, ss, k, buf, row*ss->ref.iw, n*ss->ref.iw)) {
+		fmerrmsg(where,"Stream ended in the data of %s at row %d",
+			streamchannels[k], row);
+		if (buf) free(buf);
+		fmsnowstream_free(ss);
+		return(FM_IO_ERR);
+	    }
+	}
+    }
+    if (buf) free(buf);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowstream_free
+ *
+ * PURPOSE:
+ * To free the planes of a scene.
+ */
+void fmsnowstream_free(fmsnowstreamscene *ss) {
+
+    int k;
+
+    for (k=0;k<FMSNOWLIB_CHANNELS;k++) {
+	if (ss->ch[k]) free(ss->ch[k]);
+	ss->ch[k] = NULL;
+    }
+}
+
+/*
+ * NAME:
+ * fmsnowstream_write
+ *
+ * PURPOSE:
+ * To write the product frame of a scene, the stream is flushed so that
+ * the reader gets the product at once.
+ */
+int fmsnowstream_write(FILE *fp, fmsnowstreamscene *ss, float cloudfree,
+	float *probs[FMSNOWCOVER_OLEVELS], unsigned char *class,
+	unsigned char *cat) {
+
+    char *where="fmsnowstream_write";
+    int i, size;
+
+    size = ss->ref.iw*ss->ref.ih;
+    fprintf(fp,"FMSNOWPRODUCT 1\n");
+    fprintf(fp,"satellite %s\n", ss->sa);
+    fprintf(fp,"time %04d%02d%02d%02d%02d\n", ss->time.fm_year,
+	    ss->time.fm_mon, ss->time.fm_mday, ss->time.fm_hour,
+	    ss->time.fm_min);
+    fprintf(fp,"tile %s\n", ss->tile);
+    fprintf(fp,"size %d %d\n", ss->ref.iw, ss->ref.ih);
+    fprintf(fp,"ucs %.4f %.4f %.4f %.4f\n", ss->ref.Ax, ss->ref.Ay,
+	    ss->ref.Bx, ss->ref.By);
+    fprintf(fp,"cover %.2f\n", ss->cover);
+    fprintf(fp,"cloudfree %.2f\n", cloudfree);
+    fprintf(fp,"END\n");
+    for (i=0;i<FMSNOWCOVER_OLEVELS;i++) {
+	fwrite(probs[i],sizeof(float),size,fp);
+    }
+    fwrite(class,1,size,fp);
+    fwrite(cat,1,size,fp);
+    if (fflush(fp) || ferror(fp)) {
+	fmerrmsg(where,"Could not write product of %s", ss->sa);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Read a header line, lines must end within FMSNOWSTREAM_LINELEN.
+ */
+static int streamline(FILE *fp, char *line) {
+
+    if (!fgets(line,FMSNOWSTREAM_LINELEN,fp)) return(FM_IO_ERR);
+    if (!strchr(line,'\n')) return(FM_IO_ERR);
+
+    return(FM_OK);
+}
+
+/*
+ * Read n values of channel k from start and calibrate them.
+ */
+static int streamvalues(FILE *fp, fmsnowstreamscene *ss, int k,
+	unsigned char *buf, int start, int n) {
+
+    int i;
+    float *v = ss->ch[k]+start;
+
+    if (ss->bytes == FMSNOWSTREAM_UINT8) {
+	if (fread(buf,1,n,fp) != (size_t) n) return(FM_IO_ERR);
+	for (i=0;i<n;i++) {
+	    v[i] = (buf[i] == 0) ? 0. : ss->gain[k]*buf[i]+ss->offset[k];
+	}
+    } else {
+	if (fread(v,sizeof(float),n,fp) != (size_t) n) return(FM_IO_ERR);
+	if (ss->gain[k] != 1. || ss->offset[k] != 0.) {
+	    for (i=0;i<n;i++) {
+		if (v[i] != 0.) v[i] = ss->gain[k]*v[i]+ss->offset[k];
+	    }
+	}
+    }
+
+    return(FM_OK);
+}
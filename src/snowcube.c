@@ -0,0 +1,721 @@
+/*
+ * NAME:
+ * snowcube
+ *
+ * PURPOSE:
+ * To keep the pass products of fmsnowcover in one HDF5 file per tile
+ * (CUBEPATH), so that fmaccusnow reads a time series of each part of
+ * the tile instead of opening a file for each pass.
+ *
+ * REQUIREMENTS:
+ * HDF5, POSIX record locks (fcntl).
+ *
+ * INPUT:
+ * o Pass product of fmsnowcover (P(ice/snow), P(water/land), P(cloud)).
+ * o Cube file, fmsnowcube_<tile>.hdf5.
+ *
+ * OUTPUT:
+ * Updated cube file, or parts of it.
+ *
+ * NOTES:
+ * The cube has the datasets pice, pfree and pcloud, unsigned char of
+ * size slots x ih x iw, chunked as FMSNOWCUBE_TCHUNK slots of
+ * FMSNOWCUBE_SCHUNK x FMSNOWCUBE_SCHUNK pixels. The probabilities are
+ * encoded as described in fmsnowcube.h, so a value is within
+ * 1/(2*FMSNOWCUBE_SCALE) of that of the pass product. The dataset
+ * passes holds time, satellite, cover and cloud free fraction of each
+ * slot, the time is 0 for free slots. The tile and its UCS are
+ * attributes of the file.
+ *
+ * A pass is written to the slot of an earlier version of it (same time
+ * and satellite), or the first free slot, or a new slot at the end. The
+ * slot is written before its entry in passes, so a pass is not seen
+ * until it is complete. Slots are not ordered in time when free slots
+ * are reused, readers must use the times in passes.
+ *
+ * fmsnowcube_drop frees the slots of passes older than a given time,
+ * they are reused by later passes. Free slots at the end are removed,
+ * which releases whole chunks. Files are created with persistent free
+ * space tracking (HDF5 1.10.1 and later) so the space is reused when
+ * the file is opened again.
+ *
+ * Writers hold a write lock and readers a read lock on <cube>.lock,
+ * record locks do not exclude threads of the same process so the
+ * caller must serialise access within the process (fmsnowwriter does,
+ * HDF5 is not thread safe anyway).
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmaccusnow.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define CUBE_PASSES "passes"
+#define CUBE_PASSCHUNK 64
+#define CUBE_VERSION 1
+
+/*
+ * Entry of passes as stored.
+ */
+typedef struct {
+    long long time;
+    char satellite[FMSNOWCUBE_SATLEN];
+    float cover;
+    float cloudfree;
+} cuberec;
+
+static char *cubelayer[FMSNOWCUBE_LEVELS] = {"pice","pfree","pcloud"};
+
+static int lockcube(char *fname, short type);
+static int createcube(char *fname, char *tile, osihdf *prod);
+static int readheader(hid_t fid, fmsnowcube *cb);
+static int readpasses(hid_t fid, fmsnowcubepass **pass, int *nslots);
+static int writepass(hid_t fid, int slot, fmsnowcubepass *p);
+static int setslots(hid_t fid, int nslots);
+static hid_t rectype(void);
+static unsigned char encode(float p);
+static int putattr(hid_t fid, char *name, hid_t type, void *value);
+static int putstrattr(hid_t fid, char *name, char *value);
+static int getattr(hid_t fid, char *name, hid_t type, void *value);
+static int getstrattr(hid_t fid, char *name, char *value, int len);
+
+/*
+ * NAME:
+ * fmsnowcube_name
+ *
+ * PURPOSE:
+ * To name the cube of tile in dir.
+ */
+int fmsnowcube_name(char *dir, char *tile, char *fname) {
+
+    snprintf(fname,FILELEN,"%s/%s%s.hdf5",dir,FMSNOWCUBE_PREFIX,tile);
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowcube_append
+ *
+ * PURPOSE:
+ * To add the pass product prod of tile, observed at time, to the cube
+ * fname. The cube is created if it does not exist.
+ */
+int fmsnowcube_append(char *fname, char *tile, osihdf *prod,
+	fmsec1970 time, float cover, float cloudfree) {
+
+    char *where="fmsnowcube_append";
+    int i, k, fd, slot, nslots, size, status = FM_IO_ERR;
+    unsigned char *buf = NULL;
+    float *data;
+    hid_t fid, ds, fspace, mspace;
+    hsize_t start[3], count[3];
+    struct stat sbuf;
+    fmsnowcube hdr;
+    fmsnowcubepass *pass = NULL, p;
+
+    if (prod->h.z < FMSNOWCUBE_LEVELS) {
+	fmerrmsg(where,"%s is not a pass product", fname);
+	return(FM_SYNTAX_ERR);
+    }
+    memset(&hdr,0,sizeof(fmsnowcube));
+    fd = lockcube(fname, F_WRLCK);
+    if (fd < 0) {
+	fmerrmsg(where,"Could not lock %s", fname);
+	return(FM_IO_ERR);
+    }
+    if (stat(fname,&sbuf) && createcube(fname, tile, prod)) {
+	fmerrmsg(where,"Could not create %s", fname);
+	close(fd);
+	return(FM_IO_ERR);
+    }
+
+    fid = H5Fopen(fname, H5F_ACC_RDWR, H5P_DEFAULT);
+    if (fid < 0) {
+	fmerrmsg(where,"Could not open %s", fname);
+	close(fd);
+	return(FM_IO_ERR);
+    }
+    if (readheader(fid, &hdr) || hdr.ref.iw != prod->h.iw ||
+	    hdr.ref.ih != prod->h.ih || strcmp(hdr.tile,tile) != 0) {
+	fmerrmsg(where,"%s is not a cube of the tile of the product", fname);
+	status = FM_SYNTAX_ERR;
+	goto done;
+    }
+    if (readpasses(fid, &pass, &nslots)) {
+	fmerrmsg(where,"Could not read the passes of %s", fname);
+	goto done;
+    }
+
+    /*
+     * An earlier version of the pass, the first free slot or a new one.
+     */
+    memset(&p,0,sizeof(fmsnowcubepass));
+    p.time = time;
+    snprintf(p.satellite,FMSNOWCUBE_SATLEN,"%s",prod->h.source);
+    p.cover = cover;
+    p.cloudfree = cloudfree;
+    for (slot=0;slot<nslots;slot++) {
+	if (pass[slot].time == p.time &&
+		strcmp(pass[slot].satellite,p.satellite) == 0) break;
+    }
+    if (slot == nslots) {
+	for (slot=0;slot<nslots && pass[slot].time != 0;slot++);
+    }
+    if (slot == nslots && setslots(fid, nslots+1)) {
+	fmerrmsg(where,"Could not extend %s", fname);
+	goto done;
+    }
+
+    size = prod->h.iw*prod->h.ih;
+    buf = (unsigned char *) malloc(size*sizeof(char));
+    if (!buf) {
+	fmerrmsg(where,"Could not allocate buffer");
+	status = FM_MEMALL_ERR;
+	goto done;
+    }
+    start[0] = slot;
+    start[1] = start[2] = 0;
+    count[0] = 1;
+    count[1] = prod->h.ih;
+    count[2] = prod->h.iw;
+    mspace = H5Screate_simple(3, count, NULL);
+    for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+	data = (float *) prod->d[k].data;
+	for (i=0;i<size;i++) buf[i] = encode(data[i]);
+	ds = H5Dopen2(fid, cubelayer[k], H5P_DEFAULT);
+	fspace = H5Dget_space(ds);
+	H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, NULL, count, NULL);
+	i = H5Dwrite(ds, H5T_NATIVE_UCHAR, mspace, fspace, H5P_DEFAULT, buf);
+	H5Sclose(fspace);
+	H5Dclose(ds);
+	if (i < 0) {
+	    fmerrmsg(where,"Could not write %s of %s", cubelayer[k], fname);
+	    H5Sclose(mspace);
+	    goto done;
+	}
+    }
+    H5Sclose(mspace);
+
+    if (writepass(fid, slot, &p)) {
+	fmerrmsg(where,"Could not write the pass to %s", fname);
+	goto done;
+    }
+    status = FM_OK;
+
+done:
+    if (buf) free(buf);
+    if (pass) free(pass);
+    if (H5Fclose(fid) < 0) status = FM_IO_ERR;
+    close(fd);
+
+    return(status);
+}
+
+/*
+ * NAME:
+ * fmsnowcube_open
+ *
+ * PURPOSE:
+ * To open the cube fname for reading, the cube is locked until
+ * fmsnowcube_close.
+ */
+int fmsnowcube_open(char *fname, fmsnowcube *cb) {
+
+    char *where="fmsnowcube_open";
+    int i, k;
+
+    memset(cb,0,sizeof(fmsnowcube));
+    snprintf(cb->fname,FILELEN,"%s",fname);
+    cb->fid = -1;
+    for (k=0;k<FMSNOWCUBE_LEVELS;k++) cb->layer[k] = -1;
+    cb->lockfd = lockcube(fname, F_RDLCK);
+    if (cb->lockfd < 0) {
+	fmerrmsg(where,"Could not lock %s", fname);
+	return(FM_IO_ERR);
+    }
+
+    cb->fid = H5Fopen(fname, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (cb->fid < 0 || readheader(cb->fid, cb) ||
+	    readpasses(cb->fid, &cb->pass, &cb->nslots)) {
+	fmerrmsg(where,"Could not read %s", fname);
+	fmsnowcube_close(cb);
+	return(FM_IO_ERR);
+    }
+    for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+	cb->layer[k] = H5Dopen2(cb->fid, cubelayer[k], H5P_DEFAULT);
+	if (cb->layer[k] < 0) {
+	    fmerrmsg(where,"Could not open %s of %s", cubelayer[k], fname);
+	    fmsnowcube_close(cb);
+	    return(FM_IO_ERR);
+	}
+    }
+
+    for (i=0;i<=FMSNOWCUBE_SCALE;i++) {
+	cb->value[i] = (float) i/FMSNOWCUBE_SCALE;
+    }
+    cb->value[FMSNOWCUBE_NOCOV] = FMACCUSNOWMISVAL_NOCOV;
+    cb->value[FMSNOWCUBE_NIGHT] = FMACCUSNOWMISVAL_NIGHT;
+    cb->value[FMSNOWCUBE_LAND] = FMACCUSNOWMISVAL_LAND;
+    cb->value[FMSNOWCUBE_3A] = FMACCUSNOWMISVAL_3A;
+    cb->value[FMSNOWCUBE_FILL] = FMACCUSNOWMISVAL_NOCOV;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowcube_read
+ *
+ * PURPOSE:
+ * To read the encoded values of the slots slot0 to slot0+nslots-1 of
+ * the w x h pixels from col0, row0. buf holds nslots*h*w values for
+ * each level, slot by slot.
+ */
+int fmsnowcube_read(fmsnowcube *cb, int slot0, int nslots, int col0,
+	int row0, int w, int h, unsigned char *buf[FMSNOWCUBE_LEVELS]) {
+
+    char *where="fmsnowcube_read";
+    int k, ret = 0;
+    hid_t fspace, mspace;
+    hsize_t start[3], count[3];
+
+    if (slot0 < 0 || nslots < 1 || slot0+nslots > cb->nslots ||
+	    col0 < 0 || row0 < 0 || w < 1 || h < 1 ||
+	    col0+w > cb->ref.iw || row0+h > cb->ref.ih) {
+	fmerrmsg(where,"Block outside %s", cb->fname);
+	return(FM_VAROUTOFSCOPE_ERR);
+    }
+    start[0] = slot0;
+    start[1] = row0;
+    start[2] = col0;
+    count[0] = nslots;
+    count[1] = h;
+    count[2] = w;
+    mspace = H5Screate_simple(3, count, NULL);
+    for (k=0;k<FMSNOWCUBE_LEVELS && ret >= 0;k++) {
+	fspace = H5Dget_space(cb->layer[k]);
+	H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, NULL, count, NULL);
+	ret = H5Dread(cb->layer[k], H5T_NATIVE_UCHAR, mspace, fspace,
+		H5P_DEFAULT, buf[k]);
+	H5Sclose(fspace);
+    }
+    H5Sclose(mspace);
+    if (ret < 0) {
+	fmerrmsg(where,"Could not read %s", cb->fname);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * fmsnowcube_close
+ *
+ * PURPOSE:
+ * To close the cube and release the lock.
+ */
+void fmsnowcube_close(fmsnowcube *cb) {
+
+    int k;
+
+    for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+	if (cb->layer[k] >= 0) H5Dclose(cb->layer[k]);
+	cb->layer[k] = -1;
+    }
+    if (cb->fid >= 0) H5Fclose(cb->fid);
+    cb->fid = -1;
+    if (cb->lockfd >= 0) close(cb->lockfd);
+    cb->lockfd = -1;
+    if (cb->pass) free(cb->pass);
+    cb->pass = NULL;
+    cb->nslots = 0;
+}
+
+/*
+ * NAME:
+ * fmsnowcube_drop
+ *
+ * PURPOSE:
+ * To free the slots of the passes before the time before. The number
+ * of passes dropped is returned in ndropped.
+ */
+int fmsnowcube_drop(char *fname, fmsec1970 before, int *ndropped) {
+
+    char *where="fmsnowcube_drop";
+    int fd, slot, nslots, used, status = FM_OK;
+    hid_t fid;
+    fmsnowcubepass *pass = NULL, p;
+
+    *ndropped = 0;
+    fd = lockcube(fname, F_WRLCK);
+    if (fd < 0) {
+	fmerrmsg(where,"Could not lock %s", fname);
+	return(FM_IO_ERR);
+    }
+    fid = H5Fopen(fname, H5F_ACC_RDWR, H5P_DEFAULT);
+    if (fid < 0 || readpasses(fid, &pass, &nslots)) {
+	fmerrmsg(where,"Could not read %s", fname);
+	if (fid >= 0) H5Fclose(fid);
+	close(fd);
+	return(FM_IO_ERR);
+    }
+
+    memset(&p,0,sizeof(fmsnowcubepass));
+    used = 0;
+    for (slot=0;slot<nslots && status == FM_OK;slot++) {
+	if (pass[slot].time == 0) continue;
+	if (pass[slot].time >= before) {
+	    used = slot+1;
+	    continue;
+	}
+	if (writepass(fid, slot, &p)) {
+	    fmerrmsg(where,"Could not free slot %d of %s", slot, fname);
+	    status = FM_IO_ERR;
+	    used = nslots;
+	}
+	(*ndropped)++;
+    }
+    if (used < nslots && setslots(fid, used)) {
+	fmerrmsg(where,"Could not shrink %s", fname);
+	status = FM_IO_ERR;
+    }
+
+    free(pass);
+    if (H5Fclose(fid) < 0) status = FM_IO_ERR;
+    close(fd);
+
+    return(status);
+}
+
+/*
+ * Lock the cube through <cube>.lock, the descriptor is returned.
+ */
+static int lockcube(char *fname, short type) {
+
+    char lockname[FILELEN+8];
+    int fd;
+    struct flock fl;
+
+    snprintf(lockname,FILELEN+8,"%s.lock",fname);
+    fd = open(lockname, O_RDWR|O_CREAT, 0644);
+    if (fd < 0 && type == F_RDLCK) fd = open(lockname, O_RDONLY);
+    if (fd < 0) return(-1);
+    memset(&fl,0,sizeof(struct flock));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    if (fcntl(fd, F_SETLKW, &fl)) {
+	close(fd);
+	return(-1);
+    }
+
+    return(fd);
+}
+
+/*
+ * Create an empty cube for the tile of prod, the caller holds the
+ * write lock.
+ */
+static int createcube(char *fname, char *tile, osihdf *prod) {
+
+    int k, version = CUBE_VERSION, scale = FMSNOWCUBE_SCALE, status = 0;
+    unsigned char fill = FMSNOWCUBE_FILL;
+    hid_t fcpl, fid, space, dcpl, ds, rt;
+    hsize_t dims[3], maxdims[3], chunk[3];
+
+    fcpl = H5Pcreate(H5P_FILE_CREATE);
+#if H5_VERSION_GE(1,10,1)
+    H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_FSM_AGGR, 1, 1);
+#endif
+    fid = H5Fcreate(fname, H5F_ACC_EXCL, fcpl, H5P_DEFAULT);
+    H5Pclose(fcpl);
+    if (fid < 0) return(FM_IO_ERR);
+
+    status |= putstrattr(fid, "tile", tile);
+    status |= putstrattr(fid, "area", prod->h.area);
+    status |= putstrattr(fid, "product", prod->h.product);
+    status |= putstrattr(fid, "projstr", prod->h.projstr);
+    status |= putattr(fid, "iw", H5T_NATIVE_INT, &prod->h.iw);
+    status |= putattr(fid, "ih", H5T_NATIVE_INT, &prod->h.ih);
+    status |= putattr(fid, "Ax", H5T_NATIVE_FLOAT, &prod->h.Ax);
+    status |= putattr(fid, "Ay", H5T_NATIVE_FLOAT, &prod->h.Ay);
+    status |= putattr(fid, "Bx", H5T_NATIVE_FLOAT, &prod->h.Bx);
+    status |= putattr(fid, "By", H5T_NATIVE_FLOAT, &prod->h.By);
+    status |= putattr(fid, "scale", H5T_NATIVE_INT, &scale);
+    status |= putattr(fid, "version", H5T_NATIVE_INT, &version);
+
+    dims[0] = 0;
+    dims[1] = prod->h.ih;
+    dims[2] = prod->h.iw;
+    maxdims[0] = H5S_UNLIMITED;
+    maxdims[1] = dims[1];
+    maxdims[2] = dims[2];
+    chunk[0] = FMSNOWCUBE_TCHUNK;
+    chunk[1] = (dims[1] < FMSNOWCUBE_SCHUNK) ? dims[1] : FMSNOWCUBE_SCHUNK;
+    chunk[2] = (dims[2] < FMSNOWCUBE_SCHUNK) ? dims[2] : FMSNOWCUBE_SCHUNK;
+    space = H5Screate_simple(3, dims, maxdims);
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 3, chunk);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_UCHAR, &fill);
+    for (k=0;k<FMSNOWCUBE_LEVELS;k++) {
+	ds = H5Dcreate2(fid, cubelayer[k], H5T_NATIVE_UCHAR, space,
+		H5P_DEFAULT, dcpl, H5P_DEFAULT);
+	if (ds < 0) status = 1;
+	else H5Dclose(ds);
+    }
+    H5Pclose(dcpl);
+    H5Sclose(space);
+
+    dims[0] = 0;
+    maxdims[0] = H5S_UNLIMITED;
+    chunk[0] = CUBE_PASSCHUNK;
+    space = H5Screate_simple(1, dims, maxdims);
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 1, chunk);
+    rt = rectype();
+    ds = H5Dcreate2(fid, CUBE_PASSES, rt, space, H5P_DEFAULT, dcpl,
+	    H5P_DEFAULT);
+    if (ds < 0) status = 1;
+    else H5Dclose(ds);
+    H5Tclose(rt);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+
+    if (H5Fclose(fid) < 0) status = 1;
+    if (status) {
+	unlink(fname);
+	return(FM_IO_ERR);
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Read the tile and UCS of the cube.
+ */
+static int readheader(hid_t fid, fmsnowcube *cb) {
+
+    int status = 0;
+
+    status |= getstrattr(fid, "tile", cb->tile, 16);
+    status |= getstrattr(fid, "area", cb->area, 16);
+    status |= getstrattr(fid, "product", cb->product, 128);
+    status |= getstrattr(fid, "projstr", cb->projstr, 128);
+    status |= getattr(fid, "iw", H5T_NATIVE_INT, &cb->ref.iw);
+    status |= getattr(fid, "ih", H5T_NATIVE_INT, &cb->ref.ih);
+    status |= getattr(fid, "Ax", H5T_NATIVE_FLOAT, &cb->ref.Ax);
+    status |= getattr(fid, "Ay", H5T_NATIVE_FLOAT, &cb->ref.Ay);
+    status |= getattr(fid, "Bx", H5T_NATIVE_FLOAT, &cb->ref.Bx);
+    status |= getattr(fid, "By", H5T_NATIVE_FLOAT, &cb->ref.By);
+
+    return(status ? FM_IO_ERR : FM_OK);
+}
+
+/*
+ * Read the entries of all slots, pass is allocated.
+ */
+static int readpasses(hid_t fid, fmsnowcubepass **pass, int *nslots) {
+
+    int i, n, ret = 0;
+    hid_t ds, space, rt;
+    hsize_t dims[1];
+    cuberec *rec;
+
+    *pass = NULL;
+    *nslots = 0;
+    ds = H5Dopen2(fid, CUBE_PASSES, H5P_DEFAULT);
+    if (ds < 0) return(FM_IO_ERR);
+    space = H5Dget_space(ds);
+    H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+    n = (int) dims[0];
+
+    rec = (cuberec *) malloc((n+1)*sizeof(cuberec));
+    *pass = (fmsnowcubepass *) malloc((n+1)*sizeof(fmsnowcubepass));
+    if (!rec || !*pass) {
+	if (rec) free(rec);
+	if (*pass) free(*pass);
+	*pass = NULL;
+	H5Dclose(ds);
+	return(FM_MEMALL_ERR);
+    }
+    if (n > 0) {
+	rt = rectype();
+	ret = H5Dread(ds, rt, H5S_ALL, H5S_ALL, H5P_DEFAULT, rec);
+	H5Tclose(rt);
+    }
+    H5Dclose(ds);
+    if (ret < 0) {
+	free(rec);
+	free(*pass);
+	*pass = NULL;
+	return(FM_IO_ERR);
+    }
+
+    for (i=0;i<n;i++) {
+	(*pass)[i].time = (fmsec1970) rec[i].time;
+	memcpy((*pass)[i].satellite,rec[i].satellite,FMSNOWCUBE_SATLEN);
+	(*pass)[i].satellite[FMSNOWCUBE_SATLEN-1] = '\0';
+	(*pass)[i].cover = rec[i].cover;
+	(*pass)[i].cloudfree = rec[i].cloudfree;
+    }
+    free(rec);
+    *nslots = n;
+
+    return(FM_OK);
+}
+
+/*
+ * Write the entry of slot.
+ */
+static int writepass(hid_t fid, int slot, fmsnowcubepass *p) {
+
+    int ret;
+    hid_t ds, fspace, mspace, rt;
+    hsize_t start[1], count[1];
+    cuberec rec;
+
+    memset(&rec,0,sizeof(cuberec));
+    rec.time = (long long) p->time;
+    snprintf(rec.satellite,FMSNOWCUBE_SATLEN,"%s",p->satellite);
+    rec.cover = p->cover;
+    rec.cloudfree = p->cloudfree;
+
+    ds = H5Dopen2(fid, CUBE_PASSES, H5P_DEFAULT);
+    if (ds < 0) return(FM_IO_ERR);
+    start[0] = slot;
+    count[0] = 1;
+    fspace = H5Dget_space(ds);
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, NULL, count, NULL);
+    mspace = H5Screate_simple(1, count, NULL);
+    rt = rectype();
+    ret = H5Dwrite(ds, rt, mspace, fspace, H5P_DEFAULT, &rec);
+    H5Tclose(rt);
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    H5Dclose(ds);
+
+    return((ret < 0) ? FM_IO_ERR : FM_OK);
+}
+
+/*
+ * Set the number of slots of all datasets.
+ */
+static int setslots(hid_t fid, int nslots) {
+
+    int k, status = FM_OK;
+    hid_t ds, space;
+    hsize_t dims[3];
+
+    for (k=0;k<=FMSNOWCUBE_LEVELS;k++) {
+	ds = H5Dopen2(fid, (k < FMSNOWCUBE_LEVELS) ? cubelayer[k] :
+		CUBE_PASSES, H5P_DEFAULT);
+	if (ds < 0) return(FM_IO_ERR);
+	space = H5Dget_space(ds);
+	H5Sget_simple_extent_dims(space, dims, NULL);
+	H5Sclose(space);
+	dims[0] = nslots;
+	if (H5Dset_extent(ds, dims) < 0) status = FM_IO_ERR;
+	H5Dclose(ds);
+    }
+
+    return(status);
+}
+
+static hid_t rectype(void) {
+
+    hid_t rt, st;
+
+    st = H5Tcopy(H5T_C_S1);
+    H5Tset_size(st, FMSNOWCUBE_SATLEN);
+    rt = H5Tcreate(H5T_COMPOUND, sizeof(cuberec));
+    H5Tinsert(rt, "time", HOFFSET(cuberec,time), H5T_NATIVE_LLONG);
+    H5Tinsert(rt, "satellite", HOFFSET(cuberec,satellite), st);
+    H5Tinsert(rt, "cover", HOFFSET(cuberec,cover), H5T_NATIVE_FLOAT);
+    H5Tinsert(rt, "cloudfree", HOFFSET(cuberec,cloudfree),
+	    H5T_NATIVE_FLOAT);
+    H5Tclose(st);
+
+    return(rt);
+}
+
+static unsigned char encode(float p) {
+
+    if (p >= 0. && p <= 1.) {
+	return((unsigned char) (p*FMSNOWCUBE_SCALE+0.5));
+    }
+    if (p == FMACCUSNOWMISVAL_NOCOV) return(FMSNOWCUBE_NOCOV);
+    if (p == FMACCUSNOWMISVAL_NIGHT) return(FMSNOWCUBE_NIGHT);
+    if (p == FMACCUSNOWMISVAL_LAND) return(FMSNOWCUBE_LAND);
+    if (p == FMACCUSNOWMISVAL_3A) return(FMSNOWCUBE_3A);
+
+    return(FMSNOWCUBE_FILL);
+}
+
+static int putattr(hid_t fid, char *name, hid_t type, void *value) {
+
+    int ret;
+    hid_t space, attr;
+
+    space = H5Screate(H5S_SCALAR);
+    attr = H5Acreate2(fid, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    H5Sclose(space);
+    if (attr < 0) return(1);
+    ret = H5Awrite(attr, type, value);
+    H5Aclose(attr);
+
+    return(ret < 0);
+}
+
+static int putstrattr(hid_t fid, char *name, char *value) {
+
+    int ret;
+    hid_t st;
+
+    st = H5Tcopy(H5T_C_S1);
+    H5Tset_size(st, strlen(value)+1);
+    ret = putattr(fid, name, st, value);
+    H5Tclose(st);
+
+    return(ret);
+}
+
+static int getattr(hid_t fid, char *name, hid_t type, void *value) {
+
+    int ret;
+    hid_t attr;
+
+    attr = H5Aopen(fid, name, H5P_DEFAULT);
+    if (attr < 0) return(1);
+    ret = H5Aread(attr, type, value);
+    H5Aclose(attr);
+
+    return(ret < 0);
+}
+
+static int getstrattr(hid_t fid, char *name, char *value, int len) {
+
+    int ret;
+    hid_t st;
+
+    st = H5Tcopy(H5T_C_S1);
+    H5Tset_size(st, len);
+    ret = getattr(fid, name, st, value);
+    H5Tclose(st);
+    value[len-1] = '\0';
+
+    return(ret);
+}
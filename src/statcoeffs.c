@@ -0,0 +1,447 @@
+/*
+ * NAME:
+ * statcoeffs.c
+ *
+ * PURPOSE:
+ * To read the statistical coefficients needed in probest from the
+ * coefficient table (name and path given in the configuration file) and
+ * organise them as a compact class by feature matrix that probest can
+ * loop over.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * o Coefficient table.
+ *
+ * OUTPUT:
+ * o statcoeffstr containing classes, features and pdf coefficients.
+ *
+ * NOTES:
+ * The coefficient table can contain three types of lines:
+ *
+ *   class <name> <output> <prior> <regimes>
+ *   feature <name>
+ *   <class> <feature> <pdf-code> <par1> <par2> <par3>
+ *
+ * <output> is the output level the class contributes to (ice, free or
+ * cloud) and <regimes> is a comma separated list of the surface regimes
+ * (sea, land, coast) where the class is used. Classes that are not
+ * declared get the properties of the built in class with the same name
+ * (ice, snow, cloud, water, land), this reproduces the setup that was
+ * earlier hardcoded in probest. If any feature is declared only the
+ * declared features are used, otherwise all features coefficients are
+ * given for are used. The features available are listed in featdefs
+ * below, they are evaluated by probest.
+ *
+ * rdstatcoeffs and parsestatcoeffline only collect the coefficients,
+ * buildstatcoeffs must be run before the coefficients are used.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * Mari Anne Killie, METNO/FOU, 31.01.2008: rdstatcoeffs, locstatcoeffs
+ * and putcoeffs as part of fmsnowcover.c.
+ *
+ * MODIFIED:
+ * ystein Gody, METNO/FOU, 19.10.2026: Moved from fmsnowcover.c. Replaced
+ * the fixed surface/feature structure by tables declared in the coefficient
+ * file.
+ *
+ * CVS_ID:
+ * NA
+ */
+
+#include <ctype.h>
+#include <fmsnowcover.h>
+
+#define SNOWSWITCH 0 /*0: no snow in "coast", 1: snow + ice in coast.  */
+
+#define FMSNOWALLMODES (FMSNOWMODEMASK(FMSNOWMODE3A)|FMSNOWMODEMASK(FMSNOWMODE3B))
+#define FMSNOWALLREGIMES (FMSNOWREGMASK(FMSNOWREGSEA)|\
+	FMSNOWREGMASK(FMSNOWREGLAND)|FMSNOWREGMASK(FMSNOWREGCOAST))
+
+/*
+ * Classes used when the class is not declared in the coefficient table.
+ */
+static struct {
+    char *name;
+    short output;
+    short regimes;
+} defclasses[] = {
+    {"ice", 0, FMSNOWREGMASK(FMSNOWREGSEA)|FMSNOWREGMASK(FMSNOWREGCOAST)},
+    {"snow", 0, FMSNOWREGMASK(FMSNOWREGLAND)|
+	(SNOWSWITCH ? FMSNOWREGMASK(FMSNOWREGCOAST) : 0)},
+    {"cloud", 2, FMSNOWALLREGIMES},
+    {"water", 1, FMSNOWREGMASK(FMSNOWREGSEA)|FMSNOWREGMASK(FMSNOWREGCOAST)},
+    {"land", 1, FMSNOWREGMASK(FMSNOWREGLAND)|FMSNOWREGMASK(FMSNOWREGCOAST)},
+    {NULL, 0, 0}
+};
+#define FMSNOWDEFPRIOR 0.5
+
+/*
+ * Features probest knows how to evaluate and the channel modes (3A/3B)
+ * they are valid for.
+ */
+static struct {
+    char *name;
+    short id;
+    short modes;
+} featdefs[] = {
+    {"a1", FMSNOWFEAT_A1, FMSNOWALLMODES},
+    {"r21", FMSNOWFEAT_R21, FMSNOWALLMODES},
+    {"r3a1", FMSNOWFEAT_R3A1, FMSNOWMODEMASK(FMSNOWMODE3A)},
+    {"r3b1", FMSNOWFEAT_R3B1, FMSNOWMODEMASK(FMSNOWMODE3B)},
+    {"dt", FMSNOWFEAT_DT, FMSNOWALLMODES},
+    {"t45", FMSNOWFEAT_T45, FMSNOWALLMODES},
+    {NULL, 0, 0}
+};
+
+static char *outputnames[FMSNOWCOVER_OLEVELS] = {"ice","free","cloud"};
+static char *regimenames[FMSNOWREGIMES] = {"sea","land","coast"};
+
+static int findclass(statcoeffstr *cof, char *name, int create);
+static int findfeat(statcoeffstr *cof, char *name, int create);
+static int featdefindex(char *name);
+static int parseclassline(char *line, statcoeffstr *cof);
+
+/*
+ * NAME:
+ * initstatcoeffs
+ *
+ * PURPOSE:
+ * To initialise the coefficient tables before rdstatcoeffs or
+ * parsestatcoeffline is used.
+ */
+int initstatcoeffs(statcoeffstr *cof) {
+
+    memset(cof,0,sizeof(statcoeffstr));
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * rdstatcoeffs
+ *
+ * PURPOSE:
+ * To read the statistical coefficients needed in probest from file
+ * with name&path given in config-file.
+ *
+ * RETURN VALUES:
+ * FM_IO_ERR if the file could not be read or has lines with wrong
+ * format, otherwise the number of lines that were not recognised.
+ */
+int rdstatcoeffs (char *coeffsfile, statcoeffstr *cof){
+    char *where="rdstatcoeffs";
+    FILE *fpi;
+    char *line = NULL;
+    ssize_t read;
+    size_t len = 0;
+    int status, ret;
+
+    ret = 0;
+
+    fpi = fopen(coeffsfile,"r");
+    if (!fpi) {
+	fmerrmsg(where,"Unable to open file %s",coeffsfile);
+	return(FM_IO_ERR);
+    }
+
+    while ( (read = getline(&line,&len,fpi)) != -1 ) {
+	status = parsestatcoeffline(line,cof);
+	if (status < 0) {
+	    fmerrmsg(where,"Wrong format on line '%s'",line);
+	    free(line);
+	    fclose(fpi);
+	    return(FM_IO_ERR);
+	}
+	ret += status;
+    }
+
+    if (line) free(line);
+    fclose(fpi);
+
+    return(ret);
+}
+
+/*
+ * NAME:
+ * parsestatcoeffline
+ *
+ * PURPOSE:
+ * To decode one line of the coefficient table and put the content at
+ * the right location in statcoeffstr.
+ *
+ * RETURN VALUES:
+ * -1 if the line has wrong format, 1 if the class or feature is not
+ * recognised (the line is ignored) and 0 otherwise.
+ */
+int parsestatcoeffline(char *line, statcoeffstr *cof) {
+    char *where="parsestatcoeffline";
+    char surf[FMSNOWNAMELEN], feat[FMSNOWNAMELEN], key;
+    double par1, par2, par3;
+    int j, c, f;
+
+    j = 0;
+    while ((line[j] == ' ' || line[j] == '\t') && j < FMSNOWCOVER_MSGLENGTH) j++;
+    if (j >= FMSNOWCOVER_MSGLENGTH) {
+	fmerrmsg(where,"Line length exceeds maximum length");
+	return(-1);
+    }
+    if (line[j] == '#' || line[j] == '\n' || line[j] == '\0') return(0);
+
+    if (strncmp(&line[j],"class",5) == 0 && isspace(line[j+5])) {
+	return(parseclassline(&line[j+5],cof));
+    }
+    if (strncmp(&line[j],"feature",7) == 0 && isspace(line[j+7])) {
+	if (sscanf(&line[j+7],"%9s",feat) != 1) return(-1);
+	f = findfeat(cof,feat,1);
+	if (f < 0) {
+	    fmerrmsg(where,"Feature '%s' is not recognised",feat);
+	    return(1);
+	}
+	cof->feat[f].declared = 1;
+	cof->featdecl = 1;
+	return(0);
+    }
+
+    if (sscanf(line,"%9s%9s %c%lf%lf%lf",surf,feat,
+		&key,&par1,&par2,&par3) != 6) {
+	return(-1);
+    }
+
+    c = findclass(cof,surf,1);
+    f = findfeat(cof,feat,1);
+    if (c < 0 || f < 0) {
+	if (c < 0) fmerrmsg(where,"Surface '%s' could not be added",surf);
+	if (f < 0) fmerrmsg(where,"Feature '%s' not recognised for surface %s",
+		feat,surf);
+	return(1);
+    }
+
+    cof->par[c][f].key  = key;
+    cof->par[c][f].par1 = par1;
+    cof->par[c][f].par2 = par2;
+    cof->par[c][f].par3 = par3;
+    cof->par[c][f].count++; /*will equal the number of times a specific set of
+		    parameters are read. Should ideally not differ from one..*/
+
+    return(0);
+}
+
+/*
+ * NAME:
+ * buildstatcoeffs
+ *
+ * PURPOSE:
+ * To resolve class properties, check that coefficients are available
+ * for all combinations of classes and features in use, precompute the
+ * normalisation of the pdfs and create the lists of classes used within
+ * each surface regime and features used for each channel mode.
+ *
+ * RETURN VALUES:
+ * FM_OK if the coefficients can be used, FM_IO_ERR otherwise.
+ */
+int buildstatcoeffs(statcoeffstr *cof) {
+    char *where="buildstatcoeffs";
+    int c, f, r, m, k, o, found;
+    short modes[FMSNOWMAXFEATS];
+    featstr *ft;
+
+    /*
+     * Resolve classes that are not declared in the table.
+     */
+    for (c=0;c<cof->nclass;c++) {
+	if (cof->cls[c].declared) continue;
+	cof->cls[c].regimes = 0;
+	for (k=0;defclasses[k].name;k++) {
+	    if (strcmp(defclasses[k].name,cof->cls[c].name) == 0) {
+		cof->cls[c].output = defclasses[k].output;
+		cof->cls[c].regimes = defclasses[k].regimes;
+		cof->cls[c].prior = FMSNOWDEFPRIOR;
+		break;
+	    }
+	}
+	if (!defclasses[k].name) {
+	    fmerrmsg(where,
+		"Class '%s' is neither declared nor known, it is not used",
+		cof->cls[c].name);
+	}
+    }
+
+    /*
+     * Features in use for each channel mode.
+     */
+    for (f=0;f<cof->nfeat;f++) {
+	modes[f] = featdefs[featdefindex(cof->feat[f].name)].modes;
+	if (cof->featdecl && !cof->feat[f].declared) {
+	    fmlogmsg(where,"Feature '%s' is not declared, it is not used",
+		    cof->feat[f].name);
+	    modes[f] = 0;
+	}
+    }
+    for (m=0;m<FMSNOWMODES;m++) {
+	cof->nuse[m] = 0;
+	for (f=0;f<cof->nfeat;f++) {
+	    if (modes[f] & FMSNOWMODEMASK(m)) {
+		cof->use[m][cof->nuse[m]++] = f;
+	    }
+	}
+    }
+
+    /*
+     * Classes in use for each surface regime.
+     */
+    for (r=0;r<FMSNOWREGIMES;r++) {
+	cof->nact[r] = 0;
+	for (c=0;c<cof->nclass;c++) {
+	    if (cof->cls[c].regimes & FMSNOWREGMASK(r)) {
+		cof->act[r][cof->nact[r]++] = c;
+	    }
+	}
+	if (cof->nact[r] == 0) {
+	    fmerrmsg(where,"No classes are available for %s",regimenames[r]);
+	    return(FM_IO_ERR);
+	}
+	for (o=0;o<FMSNOWCOVER_OLEVELS;o++) {
+	    found = 0;
+	    for (k=0;k<cof->nact[r];k++) {
+		if (cof->cls[cof->act[r][k]].output == o) found++;
+	    }
+	    if (!found) {
+		fmlogmsg(where,"No class contributes to output '%s' for %s",
+			outputnames[o],regimenames[r]);
+	    }
+	}
+    }
+
+    /*
+     * Check coefficients and precompute the normalisation of the pdfs.
+     */
+    for (c=0;c<cof->nclass;c++) {
+	if (!cof->cls[c].regimes) continue;
+	for (f=0;f<cof->nfeat;f++) {
+	    if (!modes[f]) continue;
+	    ft = &cof->par[c][f];
+	    if (!ft->count) {
+		fmerrmsg(where,"Stat. coefficients have not been read for %s %s",
+			cof->cls[c].name,cof->feat[f].name);
+		return(FM_IO_ERR);
+	    } else if (ft->count > 1) {
+		fmerrmsg(where,"Stat. coefficients for %s %s are read more than once",
+			cof->cls[c].name,cof->feat[f].name);
+		return(FM_IO_ERR);
+	    }
+	    if (ft->key == 'n' && ft->par2 > 0.) {
+		ft->c0 = 1./(ft->par2*sqrt(2.*fmPI));
+		ft->c1 = 1./(2.*ft->par2*ft->par2);
+	    } else if (ft->key == 'g' && ft->par1 > 0. && ft->par2 > 0.) {
+		ft->c0 = -(lgamma(ft->par1)+ft->par1*log(ft->par2));
+		ft->c1 = 1./ft->par2;
+	    } else {
+		fmerrmsg(where,
+		    "Could not use pdf routine key '%c' with coefficients for %s %s",
+		    ft->key,cof->cls[c].name,cof->feat[f].name);
+		return(FM_IO_ERR);
+	    }
+	}
+    }
+
+    return(FM_OK);
+}
+
+/*
+ * Decode a class declaration, line contains what follows "class".
+ */
+static int parseclassline(char *line, statcoeffstr *cof) {
+    char *where="parseclassline";
+    char name[FMSNOWNAMELEN], output[FMSNOWNAMELEN], regimes[DUMMYSTR];
+    char *pt;
+    double prior;
+    int c, o, r;
+
+    if (sscanf(line,"%9s%9s%lf%99s",name,output,&prior,regimes) != 4) {
+	return(-1);
+    }
+
+    c = findclass(cof,name,1);
+    if (c < 0) {
+	fmerrmsg(where,"Class '%s' could not be added",name);
+	return(1);
+    }
+
+    for (o=0;o<FMSNOWCOVER_OLEVELS;o++) {
+	if (strcmp(output,outputnames[o]) == 0) break;
+    }
+    if (o == FMSNOWCOVER_OLEVELS) {
+	fmerrmsg(where,"Output '%s' not recognised for class %s",output,name);
+	return(1);
+    }
+
+    cof->cls[c].declared = 1;
+    cof->cls[c].output = o;
+    cof->cls[c].prior = prior;
+    cof->cls[c].regimes = 0;
+    for (pt=strtok(regimes,",");pt;pt=strtok(NULL,",")) {
+	for (r=0;r<FMSNOWREGIMES;r++) {
+	    if (strcmp(pt,regimenames[r]) == 0) break;
+	}
+	if (r == FMSNOWREGIMES) {
+	    fmerrmsg(where,"Regime '%s' not recognised for class %s",pt,name);
+	    return(1);
+	}
+	cof->cls[c].regimes |= FMSNOWREGMASK(r);
+    }
+
+    return(0);
+}
+
+/*
+ * Find the index of a class, optionally adding it if not found. Returns
+ * -1 if not found and not possible to add.
+ */
+static int findclass(statcoeffstr *cof, char *name, int create) {
+    int c;
+
+    for (c=0;c<cof->nclass;c++) {
+	if (strcmp(cof->cls[c].name,name) == 0) return(c);
+    }
+    if (!create || cof->nclass >= FMSNOWMAXCLASSES) return(-1);
+
+    sprintf(cof->cls[c].name,"%s",name);
+    cof->nclass++;
+
+    return(c);
+}
+
+/*
+ * Find the index of a feature, optionally adding it if it is known to
+ * probest. Returns -1 if not found and not possible to add.
+ */
+static int findfeat(statcoeffstr *cof, char *name, int create) {
+    int f, k;
+
+    for (f=0;f<cof->nfeat;f++) {
+	if (strcmp(cof->feat[f].name,name) == 0) return(f);
+    }
+    k = featdefindex(name);
+    if (!create || k < 0 || cof->nfeat >= FMSNOWMAXFEATS) return(-1);
+
+    sprintf(cof->feat[f].name,"%s",name);
+    cof->feat[f].id = featdefs[k].id;
+    cof->nfeat++;
+
+    return(f);
+}
+
+static int featdefindex(char *name) {
+    int k;
+
+    for (k=0;featdefs[k].name;k++) {
+	if (strcmp(featdefs[k].name,name) == 0) return(k);
+    }
+
+    return(-1);
+}
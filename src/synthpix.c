@@ -0,0 +1,238 @@
+/*
+ * NAME:
+ * synthpix
+ *
+ * PURPOSE:
+ * Synthetic pixels for benchmarking, drawn from the pdfs in the table
+ * of statistical coefficients.
+ *
+ * REQUIREMENTS:
+ * NA
+ *
+ * INPUT:
+ * NA
+ *
+ * OUTPUT:
+ * NA
+ *
+ * NOTES:
+ * The random numbers are made by a 64 bit linear congruential generator
+ * to get the same pixels on all platforms for a given seed. Normal
+ * deviates use Box-Muller and Gamma deviates the method of Marsaglia
+ * and Tsang.
+ *
+ * The synthetic scenes and products are made for the tiles of
+ * fmsnowcover, the corners of these are given by synthtileucs.
+ *
+ * BUGS:
+ * NA
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#include <fmsnowcover.h>
+#include <synthpix.h>
+
+static unsigned long long synthstate = 19102026ULL;
+
+typedef struct {
+    char *name;
+    float Bx;
+    float By;
+} synthtile;
+
+static synthtile tiles[] = {
+    {"ns", -335., -2540.},
+    {"nr", -335., -740.},
+    {"at", -2135., -2540.},
+    {"gr", -2135., -740.},
+    {NULL, 0., 0.}
+};
+
+static double synthfeat(featstr *ft);
+
+void synthseed(unsigned long seed) {
+
+    synthstate = (unsigned long long) seed;
+}
+
+double synthuniform(void) {
+
+    synthstate = synthstate*6364136223846793005ULL+1442695040888963407ULL;
+
+    return(((synthstate >> 11) & 0xFFFFFFFFFFFFFULL)/4503599627370496.);
+}
+
+double synthgauss(void) {
+    double u1, u2;
+
+    do {
+	u1 = synthuniform();
+    } while (u1 <= 0.);
+    u2 = synthuniform();
+
+    return(sqrt(-2.*log(u1))*cos(2.*fmPI*u2));
+}
+
+double synthgamma(double alpha, double beta) {
+    double d, c, x, v, u;
+
+    if (alpha < 1.) {
+	u = synthuniform();
+	return(synthgamma(alpha+1.,beta)*pow(u,1./alpha));
+    }
+    d = alpha-1./3.;
+    c = 1./sqrt(9.*d);
+    for (;;) {
+	do {
+	    x = synthgauss();
+	    v = 1.+c*x;
+	} while (v <= 0.);
+	v = v*v*v;
+	u = synthuniform();
+	if (log(u) < 0.5*x*x+d-d*v+d*log(v)) break;
+    }
+
+    return(d*v*beta);
+}
+
+/*
+ * NAME:
+ * synthpixels
+ *
+ * PURPOSE:
+ * To fill pix with synthetic pixels for the surface regime and channel
+ * mode. A class is drawn for each pixel according to the priors of the
+ * classes used in the regime, the features are drawn from the pdfs of
+ * that class and converted back to channel values.
+ *
+ * NOTES:
+ * lmask must be set by the caller. A solar zenith angle is drawn
+ * (30-80 degrees) unless soz is set to a non negative value by the
+ * caller. T4 is drawn between 250 and 280 K.
+ *
+ * RETURN VALUES:
+ * 0 on success, 1 if no classes are used in the regime.
+ */
+int synthpixels(statcoeffstr *cof, int reg, int mode, pinpstr *pix,
+	int npix) {
+
+    int i, k, c;
+    double u, psum, a1, cossoz, v;
+    featstr *ft;
+
+    if (cof->nact[reg] == 0) return(1);
+
+    psum = 0.;
+    for (k=0;k<cof->nact[reg];k++) {
+	psum += cof->cls[cof->act[reg][k]].prior;
+    }
+
+    for (i=0;i<npix;i++) {
+	u = synthuniform()*psum;
+	for (k=0;k<cof->nact[reg]-1;k++) {
+	    u -= cof->cls[cof->act[reg][k]].prior;
+	    if (u < 0.) break;
+	}
+	c = cof->act[reg][k];
+
+	if (pix[i].soz < 0.) pix[i].soz = 30.+50.*synthuniform();
+	pix[i].saz = 0.;
+	pix[i].algo = 2;
+	pix[i].cmask = 0;
+	pix[i].daytime3b = (mode == FMSNOWMODE3B);
+	pix[i].T4 = 250.+30.*synthuniform();
+	pix[i].T5 = pix[i].T4-1.;
+	pix[i].T3 = pix[i].T4+5.;
+	pix[i].tdiff = 0.;
+	cossoz = cos(fmdeg2rad(pix[i].soz));
+
+	/*
+	 * a1 is needed to get the other reflectances.
+	 */
+	a1 = 50.;
+	for (k=0;k<cof->nfeat;k++) {
+	    if (cof->feat[k].id == FMSNOWFEAT_A1 && cof->par[c][k].count) {
+		a1 = synthfeat(&cof->par[c][k]);
+	    }
+	}
+	if (fabs(a1) < 0.1) a1 = 0.1;
+	pix[i].A1 = a1*cossoz;
+	pix[i].A2 = pix[i].A1;
+	pix[i].A3 = 0.1*pix[i].A1;
+	pix[i].A3b = 0.05*a1;
+
+	for (k=0;k<cof->nfeat;k++) {
+	    ft = &cof->par[c][k];
+	    if (!ft->count) continue;
+	    switch (cof->feat[k].id) {
+		case FMSNOWFEAT_R21:
+		    pix[i].A2 = synthfeat(ft)*pix[i].A1;
+		    break;
+		case FMSNOWFEAT_R3A1:
+		    pix[i].A3 = synthfeat(ft)*pix[i].A1;
+		    break;
+		case FMSNOWFEAT_R3B1:
+		    pix[i].A3b = synthfeat(ft)*a1;
+		    break;
+		case FMSNOWFEAT_DT:
+		    v = synthfeat(ft);
+		    pix[i].tdiff = (v == 0.) ? 0.01 : v;
+		    break;
+		case FMSNOWFEAT_T45:
+		    pix[i].T5 = pix[i].T4-synthfeat(ft);
+		    break;
+	    }
+	}
+    }
+
+    return(0);
+}
+
+/*
+ * NAME:
+ * synthtileucs
+ *
+ * PURPOSE:
+ * To give the grid of the tile with size*size pixels.
+ *
+ * RETURN VALUES:
+ * FM_OK - ucs set
+ * FM_VAROUTOFSCOPE_ERR - the tile is not known
+ */
+int synthtileucs(char *tile, int size, fmucsref *ucs) {
+    int i;
+
+    for (i=0;tiles[i].name;i++) {
+	if (strcmp(tiles[i].name,tile) == 0) break;
+    }
+    if (!tiles[i].name || size < 1) return(FM_VAROUTOFSCOPE_ERR);
+
+    ucs->Ax = ucs->Ay = SYNTHTILE_PIXSIZE*SYNTHTILE_SIZE/size;
+    ucs->Bx = tiles[i].Bx;
+    ucs->By = tiles[i].By;
+    ucs->iw = ucs->ih = size;
+
+    return(FM_OK);
+}
+
+/*
+ * NAME:
+ * synthfeat
+ *
+ * PURPOSE:
+ * To draw a value from the pdf of a feature.
+ */
+static double synthfeat(featstr *ft) {
+
+    if (ft->key == 'g') return(synthgamma(ft->par1,ft->par2));
+
+    return(ft->par1+ft->par2*synthgauss());
+}
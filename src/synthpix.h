@@ -0,0 +1,35 @@
+/*
+ * NAME:
+ * synthpix.h
+ *
+ * PURPOSE:
+ * The tiles of the synthetic scenes and products of the benchmark
+ * tools (fmsnowsynth, fmaccusnowbench).
+ *
+ * NOTES:
+ * See synthpix.c.
+ *
+ * AUTHOR:
+ * ystein Gody, METNO/FOU, 19.10.2026
+ *
+ * MODIFIED:
+ * NA
+ *
+ * CVS_ID:
+ * $Id$
+ */
+
+#ifndef _SYNTHPIX_H
+#define _SYNTHPIX_H
+
+#include <fmutil.h>
+
+/*
+ * Size of the tiles in pixels and km at full resolution.
+ */
+#define SYNTHTILE_SIZE 1200
+#define SYNTHTILE_PIXSIZE 1.5
+
+int synthtileucs(char *tile, int size, fmucsref *ucs);
+
+#endif /* _SYNTHPIX_H */